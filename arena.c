@@ -0,0 +1,337 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "arena.h"
+#include "utils.h"
+
+// Every allocation is aligned like malloc
+#define ARENA_ALIGNMENT ((size_t)16)
+
+// Size classes of the recycled blocks: 4 per power of two from ARENA_RECYCLE_SIZE on
+#define ARENA_SIZE_CLASSES 208
+
+typedef struct arena_block
+{
+    struct arena_block* next;  // Blocks filled before this one
+    size_t size;               // Bytes of data after the header
+    atomic_size_t used;        // Bytes handed out (past size once the block is full)
+    int large;                 // Holds one large allocation only
+} t_arena_block;
+
+// The data of a block starts after its header, aligned
+#define ARENA_HEADER ((sizeof(t_arena_block) + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1))
+
+struct arena
+{
+    int shared;
+    _Atomic(t_arena_block*) current;  // Block being filled, first of the list
+    pthread_mutex_t lock;      // Shared arenas: new blocks and recycled blocks
+    void* recycled[ARENA_SIZE_CLASSES];  // Released large blocks, linked through their first word
+    atomic_size_t used;        // Bytes taken from the blocks since the last reset
+    size_t next_block_size;
+    size_t peak;               // Most bytes taken before a reset
+    size_t reserved;           // Bytes of the blocks
+};
+
+static t_arena* run_arena = NULL;
+static _Thread_local t_arena* thread_arena = NULL;
+
+static void lock_arena(t_arena* arena)
+{
+    if (arena->shared)
+    {
+        pthread_mutex_lock(&arena->lock);
+    }
+}
+
+static void unlock_arena(t_arena* arena)
+{
+    if (arena->shared)
+    {
+        pthread_mutex_unlock(&arena->lock);
+    }
+}
+
+// Rounds size up to its allocation size, and gives its size class (-1 when it is not recycled)
+// Large sizes are rounded to a quarter of a power of two, so that a released block fits
+// the next allocations of nearby sizes
+static size_t round_size(size_t size, int* size_class)
+{
+    if (size <= ARENA_RECYCLE_SIZE)
+    {
+        *size_class = (size == ARENA_RECYCLE_SIZE) ? 0 : -1;
+        return (size > 0) ? (size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1) : ARENA_ALIGNMENT;
+    }
+    // 2^exponent < size <= 2^(exponent + 1)
+    int exponent = 0;
+    while (((size - 1) >> (exponent + 1)) != 0)
+    {
+        exponent++;
+    }
+    size_t step = (size_t)1 << (exponent - 2);
+    size_t steps = (size + step - 1) / step;
+    *size_class = (exponent - 12) * 4 + (int)steps - 4;
+    if (*size_class >= ARENA_SIZE_CLASSES)
+    {
+        *size_class = -1;
+    }
+    return steps * step;
+}
+
+static t_arena_block* create_block(t_arena* arena, size_t size)
+{
+    t_arena_block* block = (t_arena_block*)malloc(ARENA_HEADER + size);
+    if (block == NULL)
+    {
+        fatal_error("Could not allocate a block of %zu bytes for the arena", size);
+    }
+    block->next = NULL;
+    block->size = size;
+    block->large = 0;
+    atomic_init(&block->used, 0);
+    arena->reserved += size;
+    return block;
+}
+
+static void* block_data(t_arena_block* block, size_t offset)
+{
+    return (char*)block + ARENA_HEADER + offset;
+}
+
+t_arena* create_arena(int shared)
+{
+    t_arena* arena = (t_arena*)calloc(1, sizeof(t_arena));
+    if (arena == NULL)
+    {
+        fatal_error("Could not allocate memory for the arena");
+    }
+    arena->shared = shared;
+    arena->next_block_size = ARENA_FIRST_BLOCK_SIZE;
+    atomic_init(&arena->current, NULL);
+    atomic_init(&arena->used, 0);
+    pthread_mutex_init(&arena->lock, NULL);
+    return arena;
+}
+
+// Takes size bytes from the current block, or returns NULL when it is full
+static void* bump(t_arena* arena, t_arena_block* block, size_t size)
+{
+    size_t offset;
+    if (arena->shared)
+    {
+        offset = atomic_fetch_add_explicit(&block->used, size, memory_order_relaxed);
+    }
+    else
+    {
+        offset = atomic_load_explicit(&block->used, memory_order_relaxed);
+        atomic_store_explicit(&block->used, offset + size, memory_order_relaxed);
+    }
+    return (offset + size <= block->size) ? block_data(block, offset) : NULL;
+}
+
+// Starts a new current block for at least size bytes, unless another thread did it since full was seen full
+static void add_block(t_arena* arena, t_arena_block* full, size_t size)
+{
+    lock_arena(arena);
+    if (atomic_load_explicit(&arena->current, memory_order_relaxed) == full)
+    {
+        t_arena_block* block = create_block(arena, (size > arena->next_block_size) ? size : arena->next_block_size);
+        if (arena->next_block_size < ARENA_BLOCK_SIZE)
+        {
+            arena->next_block_size *= 2;
+        }
+        block->next = full;
+        atomic_store_explicit(&arena->current, block, memory_order_release);
+    }
+    unlock_arena(arena);
+}
+
+// Large allocations get a block of their own, behind the current one (which keeps being filled)
+static void* add_large_block(t_arena* arena, size_t size)
+{
+    lock_arena(arena);
+    t_arena_block* block = create_block(arena, size);
+    block->large = 1;
+    atomic_store_explicit(&block->used, size, memory_order_relaxed);
+    t_arena_block* current = atomic_load_explicit(&arena->current, memory_order_relaxed);
+    if (current == NULL)
+    {
+        atomic_store_explicit(&arena->current, block, memory_order_release);
+    }
+    else
+    {
+        block->next = current->next;
+        current->next = block;
+    }
+    unlock_arena(arena);
+    return block_data(block, 0);
+}
+
+void* arena_alloc(t_arena* arena, size_t size)
+{
+    if (arena == NULL)
+    {
+        void* block = malloc(size > 0 ? size : 1);
+        if (block == NULL)
+        {
+            fatal_error("Could not allocate %zu bytes", size);
+        }
+        return block;
+    }
+
+    int size_class;
+    size = round_size(size, &size_class);
+    if (size_class >= 0)
+    {
+        lock_arena(arena);
+        void* block = arena->recycled[size_class];
+        if (block != NULL)
+        {
+            arena->recycled[size_class] = *(void**)block;
+        }
+        unlock_arena(arena);
+        if (block != NULL)
+        {
+            return block;
+        }
+    }
+    atomic_fetch_add_explicit(&arena->used, size, memory_order_relaxed);
+    if (size > ARENA_BLOCK_SIZE / 4)
+    {
+        return add_large_block(arena, size);
+    }
+    for (;;)
+    {
+        t_arena_block* block = atomic_load_explicit(&arena->current, memory_order_acquire);
+        if (block != NULL)
+        {
+            void* data = bump(arena, block, size);
+            if (data != NULL)
+            {
+                return data;
+            }
+        }
+        add_block(arena, block, size);
+    }
+}
+
+void* arena_realloc(t_arena* arena, void* block, size_t old_size, size_t new_size)
+{
+    if (arena == NULL)
+    {
+        void* grown = realloc(block, new_size > 0 ? new_size : 1);
+        if (grown == NULL)
+        {
+            fatal_error("Could not allocate %zu bytes", new_size);
+        }
+        return grown;
+    }
+    void* grown = arena_alloc(arena, new_size);
+    if (block != NULL)
+    {
+        memcpy(grown, block, (old_size < new_size) ? old_size : new_size);
+        arena_release(arena, block, old_size);
+    }
+    return grown;
+}
+
+void arena_release(t_arena* arena, void* block, size_t size)
+{
+    if (arena == NULL)
+    {
+        free(block);
+        return;
+    }
+    int size_class;
+    round_size(size, &size_class);
+    if (block == NULL || size_class < 0)
+    {
+        return;
+    }
+    lock_arena(arena);
+    *(void**)block = arena->recycled[size_class];
+    arena->recycled[size_class] = block;
+    unlock_arena(arena);
+}
+
+static void free_blocks(t_arena_block* block)
+{
+    while (block != NULL)
+    {
+        t_arena_block* next = block->next;
+        free(block);
+        block = next;
+    }
+}
+
+void arena_reset(t_arena* arena)
+{
+    if (arena == NULL)
+    {
+        return;
+    }
+    size_t used = atomic_load_explicit(&arena->used, memory_order_relaxed);
+    if (used > arena->peak)
+    {
+        arena->peak = used;
+    }
+    atomic_store_explicit(&arena->used, 0, memory_order_relaxed);
+    memset(arena->recycled, 0, sizeof(arena->recycled));
+
+    // The current block is the largest one filled so far
+    t_arena_block* last = atomic_load_explicit(&arena->current, memory_order_relaxed);
+    if (last != NULL && !last->large)
+    {
+        free_blocks(last->next);
+        last->next = NULL;
+        atomic_store_explicit(&last->used, 0, memory_order_relaxed);
+        arena->reserved = last->size;
+    }
+    else
+    {
+        free_blocks(last);
+        atomic_store_explicit(&arena->current, NULL, memory_order_relaxed);
+        arena->reserved = 0;
+    }
+}
+
+void free_arena(t_arena* arena)
+{
+    if (arena == NULL)
+    {
+        return;
+    }
+    free_blocks(atomic_load_explicit(&arena->current, memory_order_relaxed));
+    pthread_mutex_destroy(&arena->lock);
+    free(arena);
+}
+
+size_t arena_peak_bytes(const t_arena* arena)
+{
+    size_t used = atomic_load_explicit(&((t_arena*)arena)->used, memory_order_relaxed);
+    return (used > arena->peak) ? used : arena->peak;
+}
+
+size_t arena_reserved_bytes(const t_arena* arena)
+{
+    return arena->reserved;
+}
+
+void set_run_arena(t_arena* arena)
+{
+    run_arena = arena;
+}
+
+t_arena* set_thread_arena(t_arena* arena)
+{
+    t_arena* previous = thread_arena;
+    thread_arena = arena;
+    return previous;
+}
+
+t_arena* current_arena(void)
+{
+    return (thread_arena != NULL) ? thread_arena : run_arena;
+}
@@ -0,0 +1,59 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// Sizes of the blocks of an arena: the first one is small, the next ones double up to the largest
+// (allocations above a quarter of it get a block of their own)
+#define ARENA_FIRST_BLOCK_SIZE ((size_t)64 << 10)
+#define ARENA_BLOCK_SIZE ((size_t)1 << 20)
+
+// Allocations from this size on are recycled when released (rounded up to a power of two)
+#define ARENA_RECYCLE_SIZE ((size_t)4096)
+
+// Bump allocator for the structures of one run (graph cells and lists, classes, links, matrices)
+// Allocating moves a pointer in the current block; everything is freed at once by
+// arena_reset or free_arena, so the structures are not freed one by one.
+// A shared arena can be used by several threads at the same time (atomic bump),
+// a private one by one thread only (used by the batch workers and the library contexts).
+typedef struct arena t_arena;
+
+// Function to create an arena (shared = 1 for several threads)
+t_arena* create_arena(int shared);
+
+// Function to allocate size bytes, aligned for any type (arena NULL: malloc)
+// Ends the program (fatal_error) when the memory runs out
+void* arena_alloc(t_arena* arena, size_t size);
+
+// Function to grow an allocation, keeping its first old_size bytes (arena NULL: realloc)
+void* arena_realloc(t_arena* arena, void* block, size_t old_size, size_t new_size);
+
+// Function to give back an allocation of size bytes (arena NULL: free)
+// Large blocks are kept for the next allocations of the same size class, small ones
+// only come back with arena_reset
+void arena_release(t_arena* arena, void* block, size_t size);
+
+// Function to forget every allocation: the last block is kept for the next run, the others are freed
+// (a private arena only, or a shared one that no other thread uses any more)
+void arena_reset(t_arena* arena);
+
+// Function to free the arena and all its blocks
+void free_arena(t_arena* arena);
+
+// Function to get the most bytes taken from the blocks between two resets
+size_t arena_peak_bytes(const t_arena* arena);
+
+// Function to get the bytes of the blocks held by the arena now
+size_t arena_reserved_bytes(const t_arena* arena);
+
+// Function to set the arena used by every thread (NULL: malloc)
+void set_run_arena(t_arena* arena);
+
+// Function to set the arena of the calling thread, before the run arena (NULL: back to the run arena)
+// Returns the previous one. The tasks the thread runs while it waits for a pool use the run arena.
+t_arena* set_thread_arena(t_arena* arena);
+
+// Function to get the arena of the calling thread, or the run arena (NULL: malloc)
+t_arena* current_arena(void);
+
+#endif
@@ -0,0 +1,580 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <setjmp.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "batch.h"
+#include "graph_io.h"
+#include "graph_analysis.h"
+#include "hasse.h"
+#include "class_view.h"
+#include "planner.h"
+#include "class_analysis.h"
+#include "export.h"
+#include "json_writer.h"
+#include "thread_pool.h"
+
+#define BATCH_PATH_SIZE 1024
+
+// Every part of the analysis: a cache entry is only used if it holds all of them
+#define BATCH_CACHED_PARTS (CACHED_PARTITION | CACHED_LINKS | CACHED_HASSE | CACHED_CHARACTERISTICS | \
+                            CACHED_STATIONARY | CACHED_PERIODS)
+
+static void* allocate(size_t size)
+{
+    void* block = malloc(size > 0 ? size : 1);
+    if (block == NULL)
+    {
+        fatal_error("Could not allocate memory for the batch");
+    }
+    return block;
+}
+
+static char* copy_string(const char* text, size_t length)
+{
+    char* copy = (char*)allocate(length + 1);
+    memcpy(copy, text, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+// ---------------------------------------------------------------------------------------------
+// Inputs
+
+static int compare_names(const void* a, const void* b)
+{
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+static void add_input(char*** inputs, int* count, int* capacity, char* path)
+{
+    if (*count == *capacity)
+    {
+        *capacity = (*capacity > 0) ? *capacity * 2 : 64;
+        char** grown = (char**)realloc(*inputs, (size_t)*capacity * sizeof(char*));
+        if (grown == NULL)
+        {
+            fatal_error("Could not allocate memory for the batch");
+        }
+        *inputs = grown;
+    }
+    (*inputs)[(*count)++] = path;
+}
+
+static char** list_directory(const char* path, int* count)
+{
+    DIR* directory = opendir(path);
+    if (directory == NULL)
+    {
+        printf("Error: Could not open directory '%s'\n", path);
+        return NULL;
+    }
+    char** inputs = NULL;
+    int capacity = 0;
+    *count = 0;
+    char file_path[BATCH_PATH_SIZE];
+    struct dirent* item;
+    while ((item = readdir(directory)) != NULL)
+    {
+        if (item->d_name[0] == '.')
+        {
+            continue;
+        }
+        struct stat status;
+        snprintf(file_path, sizeof(file_path), "%s/%s", path, item->d_name);
+        if (stat(file_path, &status) == 0 && S_ISREG(status.st_mode))
+        {
+            add_input(&inputs, count, &capacity, copy_string(file_path, strlen(file_path)));
+        }
+    }
+    closedir(directory);
+    qsort(inputs, (size_t)*count, sizeof(char*), compare_names);
+    return (inputs != NULL) ? inputs : (char**)allocate(sizeof(char*));
+}
+
+static char** read_manifest(const char* path, int* count)
+{
+    FILE* file = fopen(path, "rt");
+    if (file == NULL)
+    {
+        printf("Error: Could not find file '%s'\n", path);
+        return NULL;
+    }
+    char** inputs = NULL;
+    int capacity = 0;
+    *count = 0;
+    char* line = NULL;
+    size_t line_capacity = 0;
+    ssize_t length;
+    while ((length = getline(&line, &line_capacity, file)) >= 0)
+    {
+        // Paths as given (relative to the current directory), without the surrounding spaces
+        const char* start = line;
+        while (*start == ' ' || *start == '\t')
+        {
+            start++;
+        }
+        const char* end = line + length;
+        while (end > start && (end[-1] == '\n' || end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t'))
+        {
+            end--;
+        }
+        if (end > start && *start != '#')
+        {
+            add_input(&inputs, count, &capacity, copy_string(start, (size_t)(end - start)));
+        }
+    }
+    free(line);
+    fclose(file);
+    return (inputs != NULL) ? inputs : (char**)allocate(sizeof(char*));
+}
+
+char** list_batch_inputs(const char* path, int* count)
+{
+    struct stat status;
+    if (stat(path, &status) == 0 && S_ISDIR(status.st_mode))
+    {
+        return list_directory(path, count);
+    }
+    return read_manifest(path, count);
+}
+
+void free_batch_inputs(char** inputs, int count)
+{
+    if (inputs == NULL)
+    {
+        return;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        free(inputs[i]);
+    }
+    free(inputs);
+}
+
+// ---------------------------------------------------------------------------------------------
+// Workers
+
+// JSON document of one file, waiting for its turn in the aggregated output
+typedef struct
+{
+    char* text;                // NULL if the file failed before its document was made
+    size_t length;
+    int done;
+} t_batch_document;
+
+// Shared by the workers
+typedef struct
+{
+    char** inputs;
+    int count;
+    const t_batch_options* options;
+    t_thread_pool* pool;
+    pthread_mutex_t lock;      // Protects everything below
+    int next_input;            // Next file to analyse
+    t_batch_document* documents;
+    int next_document;         // Next document of the aggregated output
+    FILE* aggregate;
+    int write_failed;
+    t_batch_stats stats;
+} t_batch_job;
+
+// Scratch kept by a worker from one file to the next
+typedef struct
+{
+    t_batch_job* job;
+    t_scanner scanner;         // File buffer, only grown when a file does not fit
+    int scanner_open;
+    t_arena* arena;            // Graph and analysis of the current file (NULL: malloc)
+} t_batch_worker;
+
+// Reads a graph into the buffer of the worker; returns -1 (after printing the error) if the file
+// cannot be read or is malformed (the lists and cells of a malformed graph read before the error
+// go with the arena of the worker, its state names are not freed)
+static int read_batch_graph(t_batch_worker* worker, const char* filename, adjacency_list* graph)
+{
+    int status = worker->scanner_open ? refill_scanner(&worker->scanner, filename)
+                                      : open_scanner(&worker->scanner, filename);
+    if (status != 0)
+    {
+        printf("Error: Could not find file '%s'\n", filename);
+        return -1;
+    }
+    worker->scanner_open = 1;
+
+    jmp_buf recovery;
+    if (setjmp(recovery) != 0)
+    {
+        printf("Error: %s\n", last_error_message());  // The next file goes on
+        return -1;
+    }
+    set_error_recovery(&recovery);
+    *graph = read_graph_scanner(&worker->scanner, filename, worker->job->options->intern_labels);
+    set_error_recovery(NULL);
+    return 0;
+}
+
+// Whole analysis of a graph, or the results of a previous run on the same graph
+static void analyse_graph(const t_batch_job* job, const adjacency_list* graph, t_cache_entry* results)
+{
+    const t_batch_options* options = job->options;
+    t_cache_key key;
+    if (options->cache != NULL)
+    {
+        key = hash_analysis_input(graph, options->epsilon, options->max_iterations, options->memory_budget);
+        if (load_cache_entry(options->cache, key, results))
+        {
+            if ((results->contents & BATCH_CACHED_PARTS) == BATCH_CACHED_PARTS &&
+                results->num_vertices == graph->num_vertices)
+            {
+                return;
+            }
+            free_cache_entry(results);
+        }
+    }
+
+    memset(results, 0, sizeof(t_cache_entry));
+    results->contents = BATCH_CACHED_PARTS;
+    results->num_vertices = graph->num_vertices;
+    results->partition = tarjan_partition_graph(graph, &results->vertex_to_class);
+    results->direct_links = build_link_array(&results->partition, graph, results->vertex_to_class);
+    results->hasse_links = clone_link_array(&results->direct_links);
+    removeTransitiveLinks(&results->hasse_links);
+    results->characteristics = compute_graph_characteristics(&results->partition, &results->direct_links);
+
+    t_plan own_plan = plan_representation(&results->partition, graph, results->vertex_to_class,
+                                          &results->characteristics, options->memory_budget);
+    int* positions = build_class_positions(&results->partition, graph->num_vertices);
+    analyze_classes(graph, &results->partition, results->vertex_to_class, positions, &results->characteristics,
+                    &own_plan, options->epsilon, options->max_iterations, job->pool, &results->class_results);
+    free(positions);
+    free_plan(&own_plan);
+
+    if (options->cache != NULL)
+    {
+        store_cache_entry(options->cache, key, results);
+    }
+}
+
+// "dir/name.txt" -> "name", in place: returns its start and sets its length
+static const char* stem_span(const char* filename, size_t* length)
+{
+    const char* start = strrchr(filename, '/');
+    start = (start != NULL) ? start + 1 : filename;
+    const char* dot = strrchr(start, '.');
+    *length = (dot != NULL && dot > start) ? (size_t)(dot - start) : strlen(start);
+    return start;
+}
+
+static void file_stem(const char* filename, char* stem, size_t size)
+{
+    size_t length;
+    const char* start = stem_span(filename, &length);
+    snprintf(stem, size, "%.*s", (int)length, start);
+}
+
+// Input files sorted by stem, to find the ones that would write the same outputs
+static int compare_stems(const void* a, const void* b)
+{
+    size_t length_a;
+    size_t length_b;
+    const char* stem_a = stem_span(*(char* const*)a, &length_a);
+    const char* stem_b = stem_span(*(char* const*)b, &length_b);
+    int order = memcmp(stem_a, stem_b, (length_a < length_b) ? length_a : length_b);
+    if (order != 0)
+    {
+        return order;
+    }
+    return (length_a > length_b) - (length_a < length_b);
+}
+
+// Outputs are named after the stems of the files: two files with the same stem would overwrite
+// each other's documents. Returns -1 (after printing the error) if two inputs share a stem.
+static int check_output_names(char** inputs, int count, const char* directory)
+{
+    char** sorted = (char**)allocate((size_t)count * sizeof(char*));
+    memcpy(sorted, inputs, (size_t)count * sizeof(char*));
+    qsort(sorted, (size_t)count, sizeof(char*), compare_stems);
+    int status = 0;
+    for (int i = 1; i < count && status == 0; i++)
+    {
+        if (compare_stems(&sorted[i - 1], &sorted[i]) == 0)
+        {
+            char stem[256];
+            file_stem(sorted[i], stem, sizeof(stem));
+            printf("Error: '%s' and '%s' would both be written to '%s/%s.json' "
+                   "(rename one, or use --export FILE for one document)\n", sorted[i - 1], sorted[i], directory, stem);
+            status = -1;
+        }
+    }
+    free(sorted);
+    return status;
+}
+
+// Document of a file that could not be analysed
+static void failed_document(const char* filename, char** text, size_t* length)
+{
+    FILE* stream = open_memstream(text, length);
+    if (stream == NULL)
+    {
+        *text = NULL;
+        return;
+    }
+    t_json_writer writer;
+    json_open_stream(&writer, stream);
+    json_begin_object(&writer, "graph");
+    json_string(&writer, "file", filename);
+    json_end_object(&writer);
+    json_string(&writer, "error", "cannot be read");
+    json_close(&writer);
+}
+
+// Writes the documents of the aggregated output that are next in input order
+static void write_ready_documents(t_batch_job* job)
+{
+    while (job->next_document < job->count && job->documents[job->next_document].done)
+    {
+        t_batch_document* document = &job->documents[job->next_document];
+        if (document->text != NULL)
+        {
+            // Without the last line break: the separator comes after it
+            size_t length = document->length;
+            while (length > 0 && document->text[length - 1] == '\n')
+            {
+                length--;
+            }
+            if (fputs(job->next_document > 0 ? ",\n" : "", job->aggregate) == EOF ||
+                fwrite(document->text, 1, length, job->aggregate) != length)
+            {
+                job->write_failed = 1;
+            }
+            free(document->text);
+            document->text = NULL;
+        }
+        job->next_document++;
+    }
+}
+
+static void analyse_file(t_batch_worker* worker, int index)
+{
+    t_batch_job* job = worker->job;
+    const t_batch_options* options = job->options;
+    const char* filename = job->inputs[index];
+
+    char stem[256];
+    char json_filename[BATCH_PATH_SIZE];
+    char csv_filename[BATCH_PATH_SIZE];
+    file_stem(filename, stem, sizeof(stem));
+    if (job->aggregate != NULL)
+    {
+        // "all.json" -> "all_<n>_stationary.csv" for the large vectors of the n-th file
+        char aggregate_stem[256];
+        file_stem(options->aggregate_filename, aggregate_stem, sizeof(aggregate_stem));
+        const char* slash = strrchr(options->aggregate_filename, '/');
+        int directory_length = (slash != NULL) ? (int)(slash - options->aggregate_filename + 1) : 0;
+        snprintf(csv_filename, sizeof(csv_filename), "%.*s%s_%d_stationary.csv", directory_length,
+                 options->aggregate_filename, aggregate_stem, index + 1);
+    }
+    else
+    {
+        snprintf(json_filename, sizeof(json_filename), "%s/%s.json", options->output_directory, stem);
+        snprintf(csv_filename, sizeof(csv_filename), "%s/%s_stationary.csv", options->output_directory, stem);
+    }
+
+    char* text = NULL;
+    size_t length = 0;
+    int status;
+    long states = 0;
+    long classes = 0;
+    adjacency_list graph;
+    t_arena* previous_arena = set_thread_arena(worker->arena);
+    if (read_batch_graph(worker, filename, &graph) == 0)
+    {
+        t_cache_entry results;
+        analyse_graph(job, &graph, &results);
+        t_plan plan = plan_representation(&results.partition, &graph, results.vertex_to_class,
+                                          &results.characteristics, options->memory_budget);
+
+        t_export_data data;
+        data.graph_filename = filename;
+        data.graph = &graph;
+        data.partition = &results.partition;
+        data.links = &results.direct_links;
+        data.hasse_links = &results.hasse_links;
+        data.characteristics = &results.characteristics;
+        data.plan = &plan;
+        data.class_results = results.class_results;
+        if (job->aggregate != NULL)
+        {
+            FILE* stream = open_memstream(&text, &length);
+            status = (stream != NULL) ? export_results_to_stream(&data, stream, csv_filename) : -1;
+        }
+        else
+        {
+            status = export_results(&data, json_filename, csv_filename);
+        }
+        states = graph.num_vertices;
+        classes = results.partition.class_count;
+
+        free_plan(&plan);
+        free_cache_entry(&results);
+        free_adjacency_list(&graph);
+    }
+    else
+    {
+        status = -1;
+        if (job->aggregate != NULL)
+        {
+            failed_document(filename, &text, &length);
+        }
+    }
+    set_thread_arena(previous_arena);
+    size_t arena_peak = 0;
+    if (worker->arena != NULL)
+    {
+        arena_peak = arena_peak_bytes(worker->arena);
+        arena_reset(worker->arena);
+    }
+
+    pthread_mutex_lock(&job->lock);
+    job->stats.files++;
+    job->stats.failed += (status != 0);
+    job->stats.states += states;
+    job->stats.classes += classes;
+    if (arena_peak > job->stats.arena_peak)
+    {
+        job->stats.arena_peak = arena_peak;
+    }
+    if (job->aggregate != NULL)
+    {
+        job->documents[index].text = text;
+        job->documents[index].length = length;
+        job->documents[index].done = 1;
+        write_ready_documents(job);
+    }
+    pthread_mutex_unlock(&job->lock);
+}
+
+static void batch_worker(void* argument)
+{
+    t_batch_worker* worker = (t_batch_worker*)argument;
+    t_batch_job* job = worker->job;
+    for (;;)
+    {
+        pthread_mutex_lock(&job->lock);
+        int index = job->next_input++;
+        pthread_mutex_unlock(&job->lock);
+        if (index >= job->count)
+        {
+            break;
+        }
+        analyse_file(worker, index);
+    }
+}
+
+int run_batch(char** inputs, int count, const t_batch_options* options, t_batch_stats* stats)
+{
+    struct timespec started, finished;
+    timespec_get(&started, TIME_UTC);
+
+    t_batch_job job;
+    memset(&job, 0, sizeof(job));
+    memset(stats, 0, sizeof(*stats));  // Also what the caller prints when the run cannot start
+    job.inputs = inputs;
+    job.count = count;
+    job.options = options;
+    pthread_mutex_init(&job.lock, NULL);
+    if (options->aggregate_filename != NULL)
+    {
+        job.aggregate = fopen(options->aggregate_filename, "wt");
+        if (job.aggregate == NULL)
+        {
+            printf("Error: cannot open '%s' for writing.\n", options->aggregate_filename);
+            pthread_mutex_destroy(&job.lock);
+            return -1;
+        }
+        job.documents = (t_batch_document*)calloc(count > 0 ? (size_t)count : 1, sizeof(t_batch_document));
+        if (job.documents == NULL)
+        {
+            fatal_error("Could not allocate memory for the batch");
+        }
+        fputs("[\n", job.aggregate);
+    }
+    else if (check_output_names(inputs, count, options->output_directory) != 0)
+    {
+        pthread_mutex_destroy(&job.lock);
+        return -1;
+    }
+    else if (mkdir(options->output_directory, 0777) != 0 && errno != EEXIST)
+    {
+        printf("Error: cannot create the directory '%s'\n", options->output_directory);
+        pthread_mutex_destroy(&job.lock);
+        return -1;
+    }
+
+    // One worker per thread, never more than files
+    int worker_count = (options->thread_count < count) ? options->thread_count : count;
+    worker_count = (worker_count > 0) ? worker_count : 1;
+    job.pool = create_thread_pool(options->thread_count);
+    t_batch_worker* workers = (t_batch_worker*)calloc((size_t)worker_count, sizeof(t_batch_worker));
+    if (workers == NULL)
+    {
+        fatal_error("Could not allocate memory for the batch");
+    }
+    t_task_group group = {0};
+    for (int w = 0; w < worker_count; w++)
+    {
+        workers[w].job = &job;
+        workers[w].arena = options->use_arena ? create_arena(0) : NULL;
+        thread_pool_submit(job.pool, &group, batch_worker, &workers[w]);
+    }
+    thread_pool_wait(job.pool, &group);
+    free_thread_pool(job.pool);
+
+    for (int w = 0; w < worker_count; w++)
+    {
+        if (workers[w].scanner_open)
+        {
+            close_scanner(&workers[w].scanner);
+        }
+        free_arena(workers[w].arena);
+    }
+    free(workers);
+
+    if (job.aggregate != NULL)
+    {
+        fputs(count > 0 ? "\n]\n" : "]\n", job.aggregate);
+        if (ferror(job.aggregate) || job.write_failed)
+        {
+            job.write_failed = 1;
+        }
+        if (fclose(job.aggregate) != 0 || job.write_failed)
+        {
+            printf("Error: cannot write to '%s'.\n", options->aggregate_filename);
+            job.write_failed = 1;
+        }
+        free(job.documents);
+    }
+    pthread_mutex_destroy(&job.lock);
+
+    timespec_get(&finished, TIME_UTC);
+    job.stats.seconds = (double)(finished.tv_sec - started.tv_sec) + (finished.tv_nsec - started.tv_nsec) * 1e-9;
+    *stats = job.stats;
+    return (job.stats.failed > 0 || job.write_failed) ? -1 : 0;
+}
+
+void print_batch_stats(const t_batch_stats* stats)
+{
+    printf("Batch: %d files analysed (%d failed), %ld states, %ld classes in %.3f s (%.0f files/s)\n",
+           stats->files, stats->failed, stats->states, stats->classes, stats->seconds,
+           stats->seconds > 0.0 ? stats->files / stats->seconds : 0.0);
+    if (stats->arena_peak > 0)
+    {
+        printf("Arena: %zu KB peak for one file (--no-arena to use malloc)\n", (stats->arena_peak + 1023) >> 10);
+    }
+}
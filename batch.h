@@ -0,0 +1,50 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stddef.h>
+
+#include "cache.h"
+
+// Options of a batch run
+typedef struct
+{
+    int thread_count;              // Files analysed at the same time (threads of the pool)
+    const char* output_directory;  // One JSON document per file, <directory>/<name>.json...
+    const char* aggregate_filename;// ...or all of them in one JSON array (in input order) if not NULL
+    int intern_labels;
+    float epsilon;
+    int max_iterations;
+    size_t memory_budget;
+    const t_cache* cache;          // Results of previous runs (NULL = no cache)
+    int use_arena;                 // Each worker allocates a file's structures from its own arena
+} t_batch_options;
+
+typedef struct
+{
+    int files;
+    int failed;                    // Files that could not be read or written
+    long states;
+    long classes;
+    double seconds;
+    size_t arena_peak;             // Most arena bytes used for one file (0 without arenas)
+} t_batch_stats;
+
+// Function to list the graph files of a batch: the regular files of a directory (sorted by name,
+// hidden files left out), or the lines of a manifest file (one path per line, '#' comments)
+// Returns NULL (after printing the error) if the path cannot be read
+char** list_batch_inputs(const char* path, int* count);
+void free_batch_inputs(char** inputs, int count);
+
+// Function to analyse every file: classes, links, Hasse links, characteristics, stationary
+// distributions and periods, exported as JSON (the same document as --export).
+// thread_count workers share one pool; each takes the next file when it is done with its current
+// one and keeps its file buffer and its arena (emptied after each file) from one file to the next.
+// The class analysis of a file runs on the same pool. A file that cannot be read is reported and
+// skipped, the others go on. With one document per file, two inputs of the same name (without
+// their directory and extension) are refused before anything runs.
+// Returns 0 if every file was analysed and written, -1 otherwise (stats count what was done).
+int run_batch(char** inputs, int count, const t_batch_options* options, t_batch_stats* stats);
+
+void print_batch_stats(const t_batch_stats* stats);
+
+#endif
@@ -0,0 +1,542 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <utime.h>
+#include <sys/stat.h>
+
+#include "cache.h"
+
+// Entries are written in the byte order of the machine: the cache is local to it
+#define CACHE_MAGIC "MKVC"
+#define CACHE_END "END."
+#define CACHE_VERSION 2            // 2: class names of 16 bytes
+#define CACHE_EXTENSION ".mkc"
+#define CACHE_PATH_SIZE 1024
+
+// Numbers the temporary files of the threads of this process
+static atomic_long temporary_count;
+
+// ---------------------------------------------------------------------------------------------
+// Key
+
+// Finalizer of MurmurHash3: every bit of the input changes about half the bits of the output
+static uint64_t mix64(uint64_t hash)
+{
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+// Two independent lanes over the same 64-bit words make the 128-bit key
+static void hash_word(t_cache_key* key, uint64_t word)
+{
+    key->high = (key->high ^ word) * 1099511628211ull;
+    key->low = (key->low + mix64(word)) * 0x9e3779b97f4a7c15ull;
+    key->low ^= key->low >> 29;
+}
+
+static uint64_t float_bits(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+t_cache_key hash_analysis_input(const adjacency_list* graph, float epsilon, int max_iterations,
+                                size_t memory_budget)
+{
+    t_cache_key key = {14695981039346656037ull, 0x243f6a8885a308d3ull};
+    hash_word(&key, CACHE_VERSION);
+    hash_word(&key, float_bits(epsilon));
+    hash_word(&key, (uint64_t)max_iterations);
+    hash_word(&key, (uint64_t)memory_budget);
+    hash_word(&key, (uint64_t)graph->num_vertices);
+
+    // The edge count of each row separates the rows: the same edges split differently give another key
+    for (int i = 0; i < graph->num_vertices; i++)
+    {
+        uint64_t count = 0;
+        for (cell* edge = graph->lists[i].head; edge != NULL; edge = edge->next)
+        {
+            hash_word(&key, ((uint64_t)(uint32_t)edge->arrival_vertex << 32) | float_bits(edge->probability));
+            count++;
+        }
+        hash_word(&key, count);
+    }
+    key.high = mix64(key.high);
+    key.low = mix64(key.low ^ key.high);
+    return key;
+}
+
+void format_cache_key(t_cache_key key, char* buffer)
+{
+    snprintf(buffer, 33, "%016llx%016llx", (unsigned long long)key.high, (unsigned long long)key.low);
+}
+
+static void entry_path(const t_cache* cache, t_cache_key key, char* path)
+{
+    char hex[33];
+    format_cache_key(key, hex);
+    snprintf(path, CACHE_PATH_SIZE, "%s/%s%s", cache->directory, hex, CACHE_EXTENSION);
+}
+
+// ---------------------------------------------------------------------------------------------
+// Writing
+
+typedef struct
+{
+    unsigned char* data;
+    size_t size;
+    size_t capacity;
+} t_cache_buffer;
+
+static void put(t_cache_buffer* buffer, const void* data, size_t size)
+{
+    if (size == 0)
+    {
+        return;  // data may be NULL (a class without a stationary vector)
+    }
+    if (buffer->size + size > buffer->capacity)
+    {
+        size_t capacity = (buffer->capacity > 0) ? buffer->capacity * 2 : 4096;
+        while (capacity < buffer->size + size)
+        {
+            capacity *= 2;
+        }
+        unsigned char* grown = (unsigned char*)realloc(buffer->data, capacity);
+        if (grown == NULL)
+        {
+            fatal_error("Could not allocate memory for the cache entry");
+        }
+        buffer->data = grown;
+        buffer->capacity = capacity;
+    }
+    memcpy(buffer->data + buffer->size, data, size);
+    buffer->size += size;
+}
+
+static void put_int(t_cache_buffer* buffer, int value)
+{
+    int32_t stored = value;
+    put(buffer, &stored, sizeof(stored));
+}
+
+static void put_links(t_cache_buffer* buffer, const t_link_array* links)
+{
+    put_int(buffer, links->size);
+    for (int l = 0; l < links->size; l++)
+    {
+        put_int(buffer, links->links[l].from);
+        put_int(buffer, links->links[l].to);
+    }
+}
+
+static void serialise_entry(t_cache_buffer* buffer, t_cache_key key, const t_cache_entry* entry)
+{
+    int class_count = entry->partition.class_count;
+    put(buffer, CACHE_MAGIC, 4);
+    put_int(buffer, CACHE_VERSION);
+    put(buffer, &key.high, sizeof(key.high));
+    put(buffer, &key.low, sizeof(key.low));
+    put_int(buffer, entry->num_vertices);
+    put_int(buffer, entry->contents);
+    put_int(buffer, class_count);
+
+    if (entry->contents & CACHED_PARTITION)
+    {
+        for (int c = 0; c < class_count; c++)
+        {
+            const t_class* cls = &entry->partition.classes[c];
+            put(buffer, cls->name, sizeof(cls->name));
+            put_int(buffer, cls->member_count);
+            for (int m = 0; m < cls->member_count; m++)
+            {
+                put_int(buffer, cls->members[m]);
+            }
+        }
+        for (int v = 0; v < entry->num_vertices; v++)
+        {
+            put_int(buffer, entry->vertex_to_class[v]);
+        }
+    }
+    if (entry->contents & CACHED_LINKS)
+    {
+        put_links(buffer, &entry->direct_links);
+    }
+    if (entry->contents & CACHED_HASSE)
+    {
+        put_links(buffer, &entry->hasse_links);
+    }
+    if (entry->contents & CACHED_CHARACTERISTICS)
+    {
+        put_int(buffer, entry->characteristics.has_absorbing_state);
+        put_int(buffer, entry->characteristics.is_irreducible);
+        for (int c = 0; c < class_count; c++)
+        {
+            put_int(buffer, entry->characteristics.class_is_persistent[c]);
+        }
+    }
+    if (entry->contents & (CACHED_STATIONARY | CACHED_PERIODS))
+    {
+        for (int c = 0; c < class_count; c++)
+        {
+            const t_class_result* result = &entry->class_results[c];
+            put_int(buffer, result->period);
+            if (entry->contents & CACHED_STATIONARY)
+            {
+                const t_stationary_result* stationary = &result->stationary;
+                int size = (stationary->stationary != NULL) ? stationary->size : 0;
+                put_int(buffer, size);
+                put_int(buffer, stationary->iterations);
+                put_int(buffer, stationary->converged);
+                put(buffer, stationary->stationary, (size_t)size * sizeof(float));
+            }
+        }
+    }
+    put(buffer, CACHE_END, 4);
+}
+
+typedef struct
+{
+    char name[64];
+    off_t size;
+    time_t used;
+} t_cache_file;
+
+static int compare_cache_files(const void* a, const void* b)
+{
+    const t_cache_file* first = (const t_cache_file*)a;
+    const t_cache_file* second = (const t_cache_file*)b;
+    if (first->used != second->used)
+    {
+        return (first->used < second->used) ? -1 : 1;
+    }
+    return strcmp(first->name, second->name);
+}
+
+// Removes the least recently used entries (oldest modification time: hits touch their entry)
+// until the entries fit in the size limit; the most recent entry is always kept
+static void enforce_size_limit(const t_cache* cache)
+{
+    DIR* directory = opendir(cache->directory);
+    if (directory == NULL)
+    {
+        return;
+    }
+
+    t_cache_file* files = NULL;
+    int count = 0;
+    int capacity = 0;
+    off_t total = 0;
+    char path[CACHE_PATH_SIZE];
+    struct dirent* item;
+    while ((item = readdir(directory)) != NULL)
+    {
+        size_t length = strlen(item->d_name);
+        if (length >= sizeof(files->name) || length <= strlen(CACHE_EXTENSION) ||
+            strcmp(item->d_name + length - strlen(CACHE_EXTENSION), CACHE_EXTENSION) != 0)
+        {
+            continue;
+        }
+        struct stat status;
+        snprintf(path, sizeof(path), "%s/%s", cache->directory, item->d_name);
+        if (stat(path, &status) != 0)
+        {
+            continue;
+        }
+        if (count == capacity)
+        {
+            capacity = (capacity > 0) ? capacity * 2 : 64;
+            t_cache_file* grown = (t_cache_file*)realloc(files, (size_t)capacity * sizeof(t_cache_file));
+            if (grown == NULL)
+            {
+                break;
+            }
+            files = grown;
+        }
+        strcpy(files[count].name, item->d_name);
+        files[count].size = status.st_size;
+        files[count].used = status.st_mtime;
+        total += status.st_size;
+        count++;
+    }
+    closedir(directory);
+
+    if ((size_t)total > cache->size_limit)
+    {
+        qsort(files, (size_t)count, sizeof(t_cache_file), compare_cache_files);
+        for (int f = 0; f < count - 1 && (size_t)total > cache->size_limit; f++)
+        {
+            snprintf(path, sizeof(path), "%s/%s", cache->directory, files[f].name);
+            if (unlink(path) == 0)
+            {
+                total -= files[f].size;
+            }
+        }
+    }
+    free(files);
+}
+
+int store_cache_entry(const t_cache* cache, t_cache_key key, const t_cache_entry* entry)
+{
+    if (mkdir(cache->directory, 0777) != 0 && errno != EEXIST)
+    {
+        return -1;
+    }
+
+    t_cache_buffer buffer = {NULL, 0, 0};
+    serialise_entry(&buffer, key, entry);
+
+    // Written under a temporary name, then renamed: readers see the old entry or the whole new one
+    char path[CACHE_PATH_SIZE];
+    char temporary[CACHE_PATH_SIZE + 48];  // Room for ".<pid>.<count>.tmp"
+    entry_path(cache, key, path);
+    snprintf(temporary, sizeof(temporary), "%s.%ld.%ld.tmp", path, (long)getpid(),
+             atomic_fetch_add(&temporary_count, 1));
+    FILE* file = fopen(temporary, "wb");
+    if (file == NULL)
+    {
+        free(buffer.data);
+        return -1;
+    }
+    size_t written = fwrite(buffer.data, 1, buffer.size, file);
+    int closed = fclose(file);
+    free(buffer.data);
+    if (written != buffer.size || closed != 0 || rename(temporary, path) != 0)
+    {
+        remove(temporary);
+        return -1;
+    }
+
+    enforce_size_limit(cache);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------------------------
+// Reading
+
+typedef struct
+{
+    const unsigned char* cursor;
+    const unsigned char* end;
+    int failed;
+} t_cache_reader;
+
+static void get(t_cache_reader* reader, void* data, size_t size)
+{
+    if (size == 0)
+    {
+        return;
+    }
+    if (reader->failed || (size_t)(reader->end - reader->cursor) < size)
+    {
+        reader->failed = 1;
+        memset(data, 0, size);
+        return;
+    }
+    memcpy(data, reader->cursor, size);
+    reader->cursor += size;
+}
+
+static int get_int(t_cache_reader* reader)
+{
+    int32_t value;
+    get(reader, &value, sizeof(value));
+    return value;
+}
+
+// Count of items of item_size bytes that the rest of the entry can hold (or failure)
+static int get_count(t_cache_reader* reader, size_t item_size)
+{
+    int count = get_int(reader);
+    if (count < 0 || (size_t)count > (size_t)(reader->end - reader->cursor) / item_size)
+    {
+        reader->failed = 1;
+        return 0;
+    }
+    return count;
+}
+
+static void* allocate_items(int count, size_t item_size)
+{
+    void* block = calloc(count > 0 ? (size_t)count : 1, item_size);
+    if (block == NULL)
+    {
+        fatal_error("Could not allocate memory for the cache entry");
+    }
+    return block;
+}
+
+static void get_links(t_cache_reader* reader, t_link_array* links, int class_count)
+{
+    int size = get_count(reader, 2 * sizeof(int32_t));
+    links->links = (t_link*)allocate_items(size, sizeof(t_link));
+    links->size = size;
+    links->capacity = size;
+    links->arena = NULL;
+    for (int l = 0; l < size; l++)
+    {
+        links->links[l].from = get_int(reader);
+        links->links[l].to = get_int(reader);
+        if (links->links[l].from < 0 || links->links[l].from >= class_count ||
+            links->links[l].to < 0 || links->links[l].to >= class_count)
+        {
+            reader->failed = 1;
+        }
+    }
+}
+
+void free_cache_entry(t_cache_entry* entry)
+{
+    free_class_results(entry->class_results, entry->partition.class_count);
+    free_graph_characteristics(&entry->characteristics);
+    free_link_array(&entry->direct_links);
+    free_link_array(&entry->hasse_links);
+    free(entry->vertex_to_class);
+    free_partition(&entry->partition);
+    memset(entry, 0, sizeof(t_cache_entry));
+}
+
+static int parse_entry(t_cache_reader* reader, t_cache_key key, t_cache_entry* entry)
+{
+    char magic[4];
+    t_cache_key stored;
+    get(reader, magic, 4);
+    int version = get_int(reader);
+    get(reader, &stored.high, sizeof(stored.high));
+    get(reader, &stored.low, sizeof(stored.low));
+    if (reader->failed || memcmp(magic, CACHE_MAGIC, 4) != 0 || version != CACHE_VERSION ||
+        stored.high != key.high || stored.low != key.low)
+    {
+        return 0;
+    }
+
+    int vertices = get_int(reader);
+    entry->contents = get_int(reader);
+    int class_count = get_count(reader, sizeof(int32_t));
+    if (reader->failed || vertices < 0)
+    {
+        return 0;
+    }
+    entry->num_vertices = vertices;
+    entry->partition.classes = (t_class*)allocate_items(class_count, sizeof(t_class));
+    entry->partition.class_count = class_count;
+    entry->partition.capacity = class_count;
+    entry->partition.arena = NULL;
+
+    if (entry->contents & CACHED_PARTITION)
+    {
+        for (int c = 0; c < class_count && !reader->failed; c++)
+        {
+            t_class* cls = &entry->partition.classes[c];
+            get(reader, cls->name, sizeof(cls->name));
+            cls->name[sizeof(cls->name) - 1] = '\0';
+            cls->member_count = get_count(reader, sizeof(int32_t));
+            cls->capacity = cls->member_count;
+            cls->members = (int*)allocate_items(cls->member_count, sizeof(int));
+            for (int m = 0; m < cls->member_count; m++)
+            {
+                cls->members[m] = get_int(reader);
+                if (cls->members[m] < 1 || cls->members[m] > vertices)
+                {
+                    reader->failed = 1;
+                }
+            }
+        }
+        entry->vertex_to_class = (int*)allocate_items(vertices, sizeof(int));
+        for (int v = 0; v < vertices; v++)
+        {
+            entry->vertex_to_class[v] = get_int(reader);
+            if (entry->vertex_to_class[v] < 0 || entry->vertex_to_class[v] >= class_count)
+            {
+                reader->failed = 1;
+            }
+        }
+    }
+    if (entry->contents & CACHED_LINKS)
+    {
+        get_links(reader, &entry->direct_links, class_count);
+    }
+    if (entry->contents & CACHED_HASSE)
+    {
+        get_links(reader, &entry->hasse_links, class_count);
+    }
+    if (entry->contents & CACHED_CHARACTERISTICS)
+    {
+        entry->characteristics.has_absorbing_state = get_int(reader);
+        entry->characteristics.is_irreducible = get_int(reader);
+        entry->characteristics.class_is_persistent = (int*)allocate_items(class_count, sizeof(int));
+        for (int c = 0; c < class_count; c++)
+        {
+            entry->characteristics.class_is_persistent[c] = get_int(reader);
+        }
+    }
+    if (entry->contents & (CACHED_STATIONARY | CACHED_PERIODS))
+    {
+        entry->class_results = (t_class_result*)allocate_items(class_count, sizeof(t_class_result));
+        for (int c = 0; c < class_count && !reader->failed; c++)
+        {
+            t_class_result* result = &entry->class_results[c];
+            result->period = get_int(reader);
+            if (!(entry->contents & CACHED_STATIONARY))
+            {
+                continue;
+            }
+            t_stationary_result* stationary = &result->stationary;
+            int size = get_count(reader, sizeof(float));
+            stationary->iterations = get_int(reader);
+            stationary->converged = get_int(reader);
+            if (size > 0)
+            {
+                stationary->size = size;
+                stationary->stationary = (float*)allocate_items(size, sizeof(float));
+                get(reader, stationary->stationary, (size_t)size * sizeof(float));
+            }
+        }
+    }
+
+    char end[4];
+    get(reader, end, 4);
+    return !reader->failed && memcmp(end, CACHE_END, 4) == 0 && reader->cursor == reader->end;
+}
+
+int load_cache_entry(const t_cache* cache, t_cache_key key, t_cache_entry* entry)
+{
+    memset(entry, 0, sizeof(t_cache_entry));
+    char path[CACHE_PATH_SIZE];
+    entry_path(cache, key, path);
+    FILE* file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        return 0;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    unsigned char* data = (unsigned char*)malloc(size > 0 ? (size_t)size : 1);
+    if (size <= 0 || data == NULL || fread(data, 1, (size_t)size, file) != (size_t)size)
+    {
+        free(data);
+        fclose(file);
+        return 0;
+    }
+    fclose(file);
+
+    t_cache_reader reader = {data, data + size, 0};
+    int hit = parse_entry(&reader, key, entry);
+    free(data);
+    if (!hit)
+    {
+        free_cache_entry(entry);
+        return 0;
+    }
+    utime(path, NULL);  // Most recently used
+    return 1;
+}
@@ -0,0 +1,69 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdint.h>
+
+#include "utils.h"
+#include "graph_analysis.h"
+#include "class_analysis.h"
+
+#define CACHE_DEFAULT_DIRECTORY ".markov_cache"
+#define CACHE_DEFAULT_SIZE ((size_t)256 << 20)
+
+// What a cache entry holds
+#define CACHED_PARTITION       (1 << 0)   // Partition and vertex_to_class
+#define CACHED_LINKS           (1 << 1)   // Direct links between classes
+#define CACHED_HASSE           (1 << 2)   // Links without the transitive ones
+#define CACHED_CHARACTERISTICS (1 << 3)   // Transient / persistent classes
+#define CACHED_STATIONARY      (1 << 4)   // Stationary distribution of each persistent class
+#define CACHED_PERIODS         (1 << 5)   // Period of each persistent class
+
+// Directory of the entries, one file per key; the least recently used ones are removed
+// when the files add up to more than size_limit bytes
+typedef struct
+{
+    const char* directory;
+    size_t size_limit;
+} t_cache;
+
+// 128-bit hash of the graph (edges in order, probabilities to the bit) and of the options the
+// results depend on: two graphs with the same key get the same partition and distributions
+typedef struct
+{
+    uint64_t high;
+    uint64_t low;
+} t_cache_key;
+
+// Results of an analysis, as stored in an entry
+// Loaded entries own their arrays; entries given to store_cache_entry are only read.
+typedef struct
+{
+    int contents;              // CACHED_* flags
+    int num_vertices;
+    t_partition partition;
+    int* vertex_to_class;
+    t_link_array direct_links;
+    t_link_array hasse_links;
+    graph_characteristics characteristics;
+    t_class_result* class_results;  // One per class (periods and stationary distributions)
+} t_cache_entry;
+
+// Function to compute the key of a graph analysed with the given options
+t_cache_key hash_analysis_input(const adjacency_list* graph, float epsilon, int max_iterations,
+                                size_t memory_budget);
+
+// Function to write a key as 32 hex digits (buffer of at least 33 chars)
+void format_cache_key(t_cache_key key, char* buffer);
+
+// Function to load the entry of a key; returns 1 on a hit, 0 if there is no usable entry
+// (missing, truncated or from another version of the format)
+int load_cache_entry(const t_cache* cache, t_cache_key key, t_cache_entry* entry);
+
+// Function to free a loaded entry whose results were not used
+void free_cache_entry(t_cache_entry* entry);
+
+// Function to write the entry of a key (atomically: other runs never see half an entry),
+// then remove the least recently used entries above the size limit. Returns 0, or -1 on error.
+int store_cache_entry(const t_cache* cache, t_cache_key key, const t_cache_entry* entry);
+
+#endif
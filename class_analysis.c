@@ -0,0 +1,368 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "class_analysis.h"
+#include "matrix.h"
+#include "tiny_kernels.h"
+
+static float* allocate_distribution(int size)
+{
+    float* values = (float*)malloc((size > 0 ? size : 1) * sizeof(float));
+    if (values == NULL)
+    {
+        fatal_error("cannot allocate stationary distribution");
+    }
+    return values;
+}
+
+// Powers of the dense submatrix, exactly as the original Part 3 loop
+static void solve_dense_powers(const t_class_view* view, float epsilon, int max_iterations,
+                               t_stationary_result* result)
+{
+    t_matrix sub = view_to_dense(view);
+    t_matrix sub_power = createEmptyMatrix(sub.rows);
+    t_matrix sub_result = createEmptyMatrix(sub.rows);
+    t_matrix sub_prev = createEmptyMatrix(sub.rows);
+
+    copyMatrix(sub_power, sub);
+    copyMatrix(sub_prev, sub);
+
+    float sub_diff = 1.0f;
+    int sub_n = 1;
+    while (sub_diff > epsilon && sub_n < max_iterations)
+    {
+        multiplyMatrices(sub_power, sub, sub_result);
+        copyMatrix(sub_prev, sub_power);
+        copyMatrix(sub_power, sub_result);
+
+        sub_diff = matrixDifference(sub_power, sub_prev);
+        sub_n++;
+    }
+
+    result->iterations = sub_n;
+    if (sub_n < max_iterations)
+    {
+        result->converged = 1;
+        result->stationary = allocate_distribution(sub.cols);
+        for (int j = 0; j < sub.cols; j++)
+        {
+            result->stationary[j] = sub_power.data[0][j];
+        }
+    }
+
+    freeMatrix(&sub);
+    freeMatrix(&sub_power);
+    freeMatrix(&sub_result);
+    freeMatrix(&sub_prev);
+}
+
+// B = I - P + J of the class, row-major (k x k)
+static double* build_direct_system(const t_class_view* view)
+{
+    int k = view->size;
+    double* system = (double*)calloc((size_t)k * k > 0 ? (size_t)k * k : 1, sizeof(double));
+    if (system == NULL)
+    {
+        fatal_error("cannot allocate stationary system");
+    }
+    for (int i = 0; i < k; i++)
+    {
+        for (int j = 0; j < k; j++)
+        {
+            system[(size_t)i * k + j] = (i == j) ? 2.0 : 1.0;
+        }
+        // Duplicate edges: keep the first line of the file, like the dense matrices
+        for (cell* edge = view_row(view, i); edge != NULL; edge = view_next(view, edge))
+        {
+            int j = view_column(view, edge);
+            system[(size_t)i * k + j] = ((i == j) ? 2.0 : 1.0) - edge->probability;
+        }
+    }
+    return system;
+}
+
+// pi^T B = 1^T with B = I - P + J (J = all-ones), one factorisation and one transposed solve
+static void solve_direct(const t_class_view* view, t_stationary_result* result)
+{
+    int k = view->size;
+    double* system = build_direct_system(view);
+    double* solution = (double*)malloc((k > 0 ? (size_t)k : 1) * sizeof(double));
+    if (solution == NULL)
+    {
+        free(system);
+        fatal_error("cannot allocate stationary system");
+    }
+    for (int i = 0; i < k; i++)
+    {
+        solution[i] = 1.0;
+    }
+
+    t_lu lu = luFactorize(system, k);
+    free(system);
+    if (!lu.singular)
+    {
+        luSolveTranspose(&lu, solution, solution);
+        double sum = 0.0;
+        for (int i = 0; i < k; i++)
+        {
+            sum += solution[i];
+        }
+        result->stationary = allocate_distribution(k);
+        for (int i = 0; i < k; i++)
+        {
+            result->stationary[i] = (float)(solution[i] / sum);
+        }
+        result->converged = 1;
+    }
+    result->iterations = 0;
+    freeLU(&lu);
+    free(solution);
+}
+
+// Power iteration of the lazy chain (I + P) / 2, directly over the edges of the class
+static void solve_sparse_iteration(const t_class_view* view, float epsilon, int max_steps,
+                                   t_stationary_result* result)
+{
+    int k = view->size;
+    float* current = allocate_distribution(k);
+    float* next = allocate_distribution(k);
+    for (int i = 0; i < k; i++)
+    {
+        current[i] = 1.0f / (float)k;
+    }
+
+    float tolerance = epsilon * epsilon;
+    float diff = 1.0f;
+    int step = 0;
+    while (diff > tolerance && step < max_steps)
+    {
+        for (int i = 0; i < k; i++)
+        {
+            next[i] = 0.0f;
+        }
+        for (int i = 0; i < k; i++)
+        {
+            for (cell* edge = view_row(view, i); edge != NULL; edge = view_next(view, edge))
+            {
+                next[view_column(view, edge)] += current[i] * edge->probability;
+            }
+        }
+        diff = 0.0f;
+        for (int i = 0; i < k; i++)
+        {
+            next[i] = 0.5f * (current[i] + next[i]);
+            diff += fabsf(next[i] - current[i]);
+        }
+        float* temp = current;
+        current = next;
+        next = temp;
+        step++;
+    }
+
+    result->iterations = step;
+    if (diff <= tolerance)
+    {
+        result->converged = 1;
+        result->stationary = current;
+    }
+    else
+    {
+        free(current);
+    }
+    free(next);
+}
+
+static void solve_closed_form(const t_class_view* view, t_stationary_result* result)
+{
+    float values[2];
+    if (tiny_closed_form(view, values))
+    {
+        result->stationary = allocate_distribution(view->size);
+        for (int i = 0; i < view->size; i++)
+        {
+            result->stationary[i] = values[i];
+        }
+        result->converged = 1;
+    }
+}
+
+// Same iteration as solve_dense_powers, through the fixed-size kernel of the class size
+static void solve_tiny_kernel(const t_class_view* view, float epsilon, int max_iterations,
+                              t_stationary_result* result)
+{
+    float matrix[TINY_MAX_SIZE * TINY_MAX_SIZE];
+    float values[TINY_MAX_SIZE];
+    tiny_load_view(view, matrix);
+
+    t_tiny_powers_kernel kernel = tiny_powers_kernel(view->size);
+    if (kernel(matrix, epsilon, max_iterations, values, &result->iterations))
+    {
+        result->stationary = allocate_distribution(view->size);
+        for (int i = 0; i < view->size; i++)
+        {
+            result->stationary[i] = values[i];
+        }
+        result->converged = 1;
+    }
+}
+
+t_stationary_result solve_class_stationary(const t_class_view* view, const t_class_plan* plan,
+                                           float epsilon, int max_iterations)
+{
+    t_stationary_result result;
+    result.stationary = NULL;
+    result.size = view->size;
+    result.iterations = 0;
+    result.converged = 0;
+
+    switch (plan->solver)
+    {
+        case SOLVER_DENSE_POWERS:
+            solve_dense_powers(view, epsilon, max_iterations, &result);
+            break;
+        case SOLVER_DIRECT_LU:
+            solve_direct(view, &result);
+            break;
+        case SOLVER_CLOSED_FORM:
+            solve_closed_form(view, &result);
+            break;
+        case SOLVER_TINY_KERNEL:
+            solve_tiny_kernel(view, epsilon, max_iterations, &result);
+            break;
+        case SOLVER_SPARSE_ITERATION:
+            solve_sparse_iteration(view, epsilon, max_iterations * SPARSE_ITERATION_FACTOR, &result);
+            break;
+        default:
+            // Transient or over budget: nothing to solve
+            break;
+    }
+    return result;
+}
+
+void free_stationary_result(t_stationary_result* result)
+{
+    free(result->stationary);
+    result->stationary = NULL;
+    result->size = 0;
+    result->converged = 0;
+}
+
+// Shared input of the class tasks
+typedef struct
+{
+    const adjacency_list* graph;
+    const t_partition* partition;
+    const int* vertex_to_class;
+    const int* positions;
+    const t_plan* plan;
+    float epsilon;
+    int max_iterations;
+    t_class_result* results;
+} t_class_job;
+
+typedef struct
+{
+    const t_class_job* job;
+    int class_index;
+} t_class_task;
+
+static void analyze_class_task(void* argument)
+{
+    t_class_task* task = (t_class_task*)argument;
+    const t_class_job* job = task->job;
+    int c = task->class_index;
+
+    t_class_view view = make_class_view(job->graph, job->partition, job->vertex_to_class, job->positions, c);
+    if (job->plan != NULL)
+    {
+        job->results[c].stationary = solve_class_stationary(&view, &job->plan->classes[c],
+                                                            job->epsilon, job->max_iterations);
+    }
+    job->results[c].period = view_period(&view);
+}
+
+typedef struct
+{
+    int size;
+    int index;
+} t_class_order;
+
+// Largest class first, then class order
+static int compare_class_size(const void* a, const void* b)
+{
+    const t_class_order* first = (const t_class_order*)a;
+    const t_class_order* second = (const t_class_order*)b;
+    if (first->size != second->size)
+    {
+        return (first->size > second->size) ? -1 : 1;
+    }
+    return first->index - second->index;
+}
+
+void analyze_classes(const adjacency_list* graph, const t_partition* partition,
+                     const int* vertex_to_class, const int* positions,
+                     const graph_characteristics* characteristics, const t_plan* plan,
+                     float epsilon, int max_iterations, t_thread_pool* pool, t_class_result** results_out)
+{
+    int count = partition->class_count;
+    t_class_result* results = (t_class_result*)calloc(count > 0 ? count : 1, sizeof(t_class_result));
+    if (results == NULL)
+    {
+        fatal_error("cannot allocate class results");
+    }
+    *results_out = results;
+
+    // Scratch arrays from the current arena: an error in a task leaves them there
+    t_arena* arena = current_arena();
+    t_class_task* tasks = (t_class_task*)arena_alloc(arena, (count > 0 ? count : 1) * sizeof(t_class_task));
+    t_class_order* order = (t_class_order*)arena_alloc(arena, (count > 0 ? count : 1) * sizeof(t_class_order));
+
+    int persistent = 0;
+    for (int c = 0; c < count; c++)
+    {
+        if (characteristics->class_is_persistent[c])
+        {
+            order[persistent].size = partition->classes[c].member_count;
+            order[persistent].index = c;
+            persistent++;
+        }
+    }
+    qsort(order, persistent, sizeof(t_class_order), compare_class_size);
+
+    t_class_job job;
+    job.graph = graph;
+    job.partition = partition;
+    job.vertex_to_class = vertex_to_class;
+    job.positions = positions;
+    job.plan = plan;
+    job.epsilon = epsilon;
+    job.max_iterations = max_iterations;
+    job.results = results;
+
+    // Own group: the analysis may itself run as a task of the same pool
+    t_task_group group = {0};
+    for (int i = 0; i < persistent; i++)
+    {
+        tasks[i].job = &job;
+        tasks[i].class_index = order[i].index;
+        thread_pool_submit(pool, &group, analyze_class_task, &tasks[i]);
+    }
+    thread_pool_wait(pool, &group);
+
+    arena_release(arena, tasks, (count > 0 ? count : 1) * sizeof(t_class_task));
+    arena_release(arena, order, (count > 0 ? count : 1) * sizeof(t_class_order));
+}
+
+void free_class_results(t_class_result* results, int class_count)
+{
+    if (results == NULL)
+    {
+        return;
+    }
+    for (int c = 0; c < class_count; c++)
+    {
+        free_stationary_result(&results[c].stationary);
+    }
+    free(results);
+}
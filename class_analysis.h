@@ -0,0 +1,55 @@
+#ifndef CLASS_ANALYSIS_H
+#define CLASS_ANALYSIS_H
+
+#include "graph_analysis.h"
+#include "class_view.h"
+#include "planner.h"
+#include "thread_pool.h"
+
+// A vector power iteration needs many more (but much cheaper) steps than
+// the matrix powers: its step limit is max_iterations times this factor
+#define SPARSE_ITERATION_FACTOR 100
+
+// Stationary distribution of one class
+typedef struct
+{
+    float* stationary;     // One value per member of the class (NULL if not found)
+    int size;              // Number of members
+    int iterations;        // Power reached (dense powers) or number of steps (sparse iteration)
+    int converged;         // 1 if a distribution was found
+} t_stationary_result;
+
+// Solves the stationary distribution of a persistent class with the solver chosen by the plan.
+// Works on the view of the class: the sparse iteration reads the parent graph directly,
+// and the dense solvers build their k x k matrix once from the view.
+// Dense powers: rows of M^n until sum |M^n - M^(n-1)| < epsilon, the result is row 0.
+// Closed form: pi = (1) for one state, pi = (b, a) / (a + b) for two states.
+// Fixed-size kernel: same as dense powers, on the stack (classes of at most TINY_MAX_SIZE states).
+// Direct LU: solves pi^T (I - P + J) = 1^T.
+// Sparse iteration: x <- x (I + P) / 2 from the uniform vector until sum |x_t - x_(t-1)| < epsilon^2
+// (the lazy chain has the same stationary distribution and also converges on periodic classes).
+t_stationary_result solve_class_stationary(const t_class_view* view, const t_class_plan* plan,
+                                           float epsilon, int max_iterations);
+void free_stationary_result(t_stationary_result* result);
+
+// Everything computed for one class (only filled for persistent classes)
+typedef struct
+{
+    t_stationary_result stationary;
+    int period;
+} t_class_result;
+
+// Computes the stationary distribution and the period of every persistent class on the pool.
+// Classes are independent: each one is a task, submitted largest first so that the big
+// classes start early and the small ones fill the gaps. Each task writes only its own slot,
+// so the results are the same for any number of threads and can be printed in class order.
+// With plan == NULL only the periods are computed.
+// *results is set before the first class is solved: after an error (set_error_recovery)
+// the classes solved so far can still be freed with free_class_results.
+void analyze_classes(const adjacency_list* graph, const t_partition* partition,
+                     const int* vertex_to_class, const int* positions,
+                     const graph_characteristics* characteristics, const t_plan* plan,
+                     float epsilon, int max_iterations, t_thread_pool* pool, t_class_result** results);
+void free_class_results(t_class_result* results, int class_count);
+
+#endif
@@ -0,0 +1,196 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "class_view.h"
+#include "tiny_kernels.h"
+#include "output.h"
+
+int* build_class_positions(const t_partition* partition, int num_vertices)
+{
+    int* position = (int*)malloc((num_vertices > 0 ? num_vertices : 1) * sizeof(int));
+    if (position == NULL)
+    {
+        fatal_error("cannot allocate class positions");
+    }
+    for (int c = 0; c < partition->class_count; c++)
+    {
+        const t_class* cls = &partition->classes[c];
+        for (int i = 0; i < cls->member_count; i++)
+        {
+            position[cls->members[i] - 1] = i;
+        }
+    }
+    return position;
+}
+
+t_class_view make_class_view(const adjacency_list* graph, const t_partition* partition,
+                             const int* vertex_to_class, const int* position, int class_index)
+{
+    t_class_view view;
+    view.graph = graph;
+    view.vertex_to_class = vertex_to_class;
+    view.position = position;
+    view.members = partition->classes[class_index].members;
+    view.size = partition->classes[class_index].member_count;
+    view.class_index = class_index;
+    return view;
+}
+
+// Skips the edges that leave the class
+static cell* skip_outside(const t_class_view* view, cell* edge)
+{
+    while (edge != NULL && view->vertex_to_class[edge->arrival_vertex - 1] != view->class_index)
+    {
+        edge = edge->next;
+    }
+    return edge;
+}
+
+cell* view_row(const t_class_view* view, int r)
+{
+    return skip_outside(view, view->graph->lists[view->members[r] - 1].head);
+}
+
+cell* view_next(const t_class_view* view, cell* edge)
+{
+    return skip_outside(view, edge->next);
+}
+
+int view_column(const t_class_view* view, const cell* edge)
+{
+    return view->position[edge->arrival_vertex - 1];
+}
+
+long view_edge_count(const t_class_view* view)
+{
+    long count = 0;
+    for (int r = 0; r < view->size; r++)
+    {
+        for (cell* edge = view_row(view, r); edge != NULL; edge = view_next(view, edge))
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+t_matrix view_to_dense(const t_class_view* view)
+{
+    t_matrix sub = createEmptyMatrix(view->size);
+    for (int r = 0; r < view->size; r++)
+    {
+        // Lists are in reverse file order: writing every edge keeps the first line of the file,
+        // exactly like createTransitionMatrix
+        for (cell* edge = view_row(view, r); edge != NULL; edge = view_next(view, edge))
+        {
+            sub.data[r][view_column(view, edge)] = edge->probability;
+        }
+    }
+    return sub;
+}
+
+void print_class_view(const t_class_view* view)
+{
+    float* row = (float*)malloc((view->size > 0 ? view->size : 1) * sizeof(float));
+    if (row == NULL)
+    {
+        fatal_error("cannot allocate memory for class row");
+    }
+
+    printf("Matrix (%d x %d):\n", view->size, view->size);
+    int shown = output_preview(view->size);
+    for (int r = 0; r < shown; r++)
+    {
+        for (int j = 0; j < view->size; j++)
+        {
+            row[j] = 0.0f;
+        }
+        for (cell* edge = view_row(view, r); edge != NULL; edge = view_next(view, edge))
+        {
+            row[view_column(view, edge)] = edge->probability;
+        }
+        printf("  ");
+        for (int j = 0; j < shown; j++)
+        {
+            printf("%.4f  ", row[j]);
+        }
+        if (shown < view->size)
+        {
+            printf("... (%d more)", view->size - shown);
+        }
+        printf("\n");
+    }
+    print_omitted(shown, view->size, "rows");
+    printf("\n");
+    free(row);
+}
+
+int view_period(const t_class_view* view)
+{
+    int k = view->size;
+    if (k == 0)
+    {
+        return 0;
+    }
+
+    // Tiny classes use the stack: no allocation per class
+    int small_level[TINY_MAX_SIZE];
+    int small_queue[TINY_MAX_SIZE];
+    int* level = small_level;
+    int* queue = small_queue;
+    if (k > TINY_MAX_SIZE)
+    {
+        level = (int*)malloc(k * sizeof(int));
+        queue = (int*)malloc(k * sizeof(int));
+    }
+    if (level == NULL || queue == NULL)
+    {
+        fatal_error("cannot allocate memory for period search");
+    }
+    for (int i = 0; i < k; i++)
+    {
+        level[i] = -1;
+    }
+
+    int head = 0;
+    int tail = 0;
+    level[0] = 0;
+    queue[tail++] = 0;
+    int period = 0;
+    while (head < tail)
+    {
+        int u = queue[head++];
+        for (cell* edge = view_row(view, u); edge != NULL; edge = view_next(view, edge))
+        {
+            int v = view_column(view, edge);
+            if (level[v] < 0)
+            {
+                level[v] = level[u] + 1;
+                queue[tail++] = v;
+                continue;
+            }
+            int jump = level[u] + 1 - level[v];
+            if (jump < 0)
+            {
+                jump = -jump;
+            }
+            // Euclidean algorithm, as in gcd()
+            int a = period;
+            int b = jump;
+            while (b != 0)
+            {
+                int temp = b;
+                b = a % b;
+                a = temp;
+            }
+            period = a;
+        }
+    }
+
+    if (k > TINY_MAX_SIZE)
+    {
+        free(level);
+        free(queue);
+    }
+    return period;
+}
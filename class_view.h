@@ -0,0 +1,53 @@
+#ifndef CLASS_VIEW_H
+#define CLASS_VIEW_H
+
+#include "utils.h"
+#include "graph_analysis.h"
+#include "matrix.h"
+
+// Lightweight view of one class over the parent graph
+// Nothing is copied: the local-to-global mapping is the member list of the class,
+// and the global-to-local mapping is a position table shared by all the views
+typedef struct
+{
+    const adjacency_list* graph;   // Parent graph
+    const int* vertex_to_class;    // Class of each vertex (0-based)
+    const int* position;           // Position of each vertex inside its class
+    const int* members;            // Local index -> vertex number (1-based)
+    int size;                      // Number of states of the class
+    int class_index;               // Index of the class in the partition
+} t_class_view;
+
+// Function to compute the position of every vertex inside its class
+// Computed once per partition, O(n), and shared by all the views
+int* build_class_positions(const t_partition* partition, int num_vertices);
+
+// Function to create the view of one class (O(1), nothing is allocated)
+t_class_view make_class_view(const adjacency_list* graph, const t_partition* partition,
+                             const int* vertex_to_class, const int* position, int class_index);
+
+// Function to get the first edge of local row r that stays inside the class (NULL if none)
+// Iterate with: for (cell* e = view_row(&view, r); e != NULL; e = view_next(&view, e))
+cell* view_row(const t_class_view* view, int r);
+
+// Function to get the next edge inside the class after the given one (NULL if none)
+cell* view_next(const t_class_view* view, cell* edge);
+
+// Function to get the local column of an edge returned by view_row / view_next
+int view_column(const t_class_view* view, const cell* edge);
+
+// Function to count the edges inside the class
+long view_edge_count(const t_class_view* view);
+
+// Function to build the dense submatrix of the class (same content as subMatrix)
+// Only for the solvers that need a flat matrix (dense GEMM, LU)
+t_matrix view_to_dense(const t_class_view* view);
+
+// Function to print the submatrix of the class in the printMatrix layout, row by row (O(k) memory)
+void print_class_view(const t_class_view* view);
+
+// Function to calculate the period of the class with a breadth-first search on the view
+// The period is the GCD of level[u] + 1 - level[v] over the edges u -> v of the class
+int view_period(const t_class_view* view);
+
+#endif
@@ -0,0 +1,790 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include "dynamic.h"
+#include "scanner.h"
+
+#define PAIR_INITIAL_SLOTS 1024
+
+static void* allocate(size_t size)
+{
+    void* block = calloc(1, size > 0 ? size : 1);
+    if (block == NULL)
+    {
+        fatal_error("Could not allocate memory for the dynamic graph");
+    }
+    return block;
+}
+
+static void* grow(void* block, size_t size)
+{
+    void* grown = realloc(block, size);
+    if (grown == NULL)
+    {
+        fatal_error("Could not allocate memory for the dynamic graph");
+    }
+    return grown;
+}
+
+// ---------------------------------------------------------------------------------------------
+// Class pairs: number of edges from one class to another
+
+static uint64_t pair_key(int from, int to)
+{
+    return ((uint64_t)(uint32_t)(from + 1) << 32) | (uint32_t)(to + 1);
+}
+
+static size_t pair_home(uint64_t key, size_t mask)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdull;
+    key ^= key >> 33;
+    return (size_t)key & mask;
+}
+
+static size_t find_pair(const t_dynamic_graph* dynamic, uint64_t key)
+{
+    size_t mask = dynamic->pair_slots - 1;
+    size_t slot = pair_home(key, mask);
+    while (dynamic->pairs[slot].key != 0 && dynamic->pairs[slot].key != key)
+    {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+static void grow_pairs(t_dynamic_graph* dynamic)
+{
+    t_class_pair* old_pairs = dynamic->pairs;
+    size_t old_slots = dynamic->pair_slots;
+    dynamic->pair_slots = old_slots * 2;
+    dynamic->pairs = (t_class_pair*)allocate(dynamic->pair_slots * sizeof(t_class_pair));
+    for (size_t s = 0; s < old_slots; s++)
+    {
+        if (old_pairs[s].key != 0)
+        {
+            dynamic->pairs[find_pair(dynamic, old_pairs[s].key)] = old_pairs[s];
+        }
+    }
+    free(old_pairs);
+}
+
+// Adds delta edges to the pair from -> to; a pair that appears or disappears is a link of the class
+static void change_pair(t_dynamic_graph* dynamic, int from, int to, int delta)
+{
+    uint64_t key = pair_key(from, to);
+    size_t slot = find_pair(dynamic, key);
+    t_class_pair* pairs = dynamic->pairs;
+    if (pairs[slot].key == 0)
+    {
+        pairs[slot].key = key;
+        pairs[slot].count = delta;
+        dynamic->pair_count++;
+        dynamic->classes[from].out_links++;
+        if (dynamic->pair_count * 2 > dynamic->pair_slots)
+        {
+            grow_pairs(dynamic);
+        }
+        return;
+    }
+
+    pairs[slot].count += delta;
+    if (pairs[slot].count > 0)
+    {
+        return;
+    }
+    dynamic->classes[from].out_links--;
+    dynamic->pair_count--;
+
+    // Backward shift: the following entries move into the hole if it is on their probe path
+    size_t mask = dynamic->pair_slots - 1;
+    size_t hole = slot;
+    size_t next = (slot + 1) & mask;
+    while (pairs[next].key != 0)
+    {
+        size_t home = pair_home(pairs[next].key, mask);
+        if (((next - home) & mask) >= ((next - hole) & mask))
+        {
+            pairs[hole] = pairs[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+    pairs[hole].key = 0;
+    pairs[hole].count = 0;
+}
+
+static int pair_exists(const t_dynamic_graph* dynamic, int from, int to)
+{
+    return dynamic->pairs[find_pair(dynamic, pair_key(from, to))].key != 0;
+}
+
+// ---------------------------------------------------------------------------------------------
+// Classes and predecessors
+
+static int new_class(t_dynamic_graph* dynamic)
+{
+    int slot = (dynamic->free_count > 0) ? dynamic->free_slots[--dynamic->free_count] : dynamic->class_slots++;
+    t_dynamic_class* cls = &dynamic->classes[slot];
+    cls->member_count = 0;
+    cls->out_links = 0;
+    cls->alive = 1;
+    dynamic->class_count++;
+    return slot;
+}
+
+static void delete_class(t_dynamic_graph* dynamic, int slot)
+{
+    dynamic->classes[slot].alive = 0;
+    dynamic->classes[slot].member_count = 0;
+    dynamic->free_slots[dynamic->free_count++] = slot;
+    dynamic->class_count--;
+}
+
+static void add_member(t_dynamic_graph* dynamic, int slot, int vertex)
+{
+    t_dynamic_class* cls = &dynamic->classes[slot];
+    if (cls->member_count == cls->capacity)
+    {
+        cls->capacity = (cls->capacity > 0) ? cls->capacity * 2 : 4;
+        cls->members = (int*)grow(cls->members, (size_t)cls->capacity * sizeof(int));
+    }
+    cls->members[cls->member_count++] = vertex;
+    dynamic->vertex_to_class[vertex - 1] = slot;
+}
+
+static void add_predecessor(t_dynamic_graph* dynamic, int vertex, int predecessor)
+{
+    int v = vertex - 1;
+    if (dynamic->predecessor_count[v] == dynamic->predecessor_capacity[v])
+    {
+        dynamic->predecessor_capacity[v] = (dynamic->predecessor_capacity[v] > 0) ? dynamic->predecessor_capacity[v] * 2 : 4;
+        dynamic->predecessors[v] = (int*)grow(dynamic->predecessors[v],
+                                              (size_t)dynamic->predecessor_capacity[v] * sizeof(int));
+    }
+    dynamic->predecessors[v][dynamic->predecessor_count[v]++] = predecessor;
+}
+
+static void remove_predecessor(t_dynamic_graph* dynamic, int vertex, int predecessor)
+{
+    int v = vertex - 1;
+    for (int p = 0; p < dynamic->predecessor_count[v]; p++)
+    {
+        if (dynamic->predecessors[v][p] == predecessor)
+        {
+            dynamic->predecessors[v][p] = dynamic->predecessors[v][--dynamic->predecessor_count[v]];
+            return;
+        }
+    }
+}
+
+// Adds (sign = 1) or removes (sign = -1) the class pairs of every edge touching the classes of set
+// The classes of set must be marked in class_set with set_stamp: an edge between two of them
+// is counted once, from its tail
+static void count_set_edges(t_dynamic_graph* dynamic, const int* set, int set_size, int set_stamp, int sign)
+{
+    for (int s = 0; s < set_size; s++)
+    {
+        int slot = set[s];
+        const t_dynamic_class* cls = &dynamic->classes[slot];
+        for (int m = 0; m < cls->member_count; m++)
+        {
+            int vertex = cls->members[m];
+            for (cell* current = dynamic->graph->lists[vertex - 1].head; current != NULL; current = current->next)
+            {
+                int to = dynamic->vertex_to_class[current->arrival_vertex - 1];
+                if (to != slot)
+                {
+                    change_pair(dynamic, slot, to, sign);
+                }
+            }
+            for (int p = 0; p < dynamic->predecessor_count[vertex - 1]; p++)
+            {
+                int from = dynamic->vertex_to_class[dynamic->predecessors[vertex - 1][p] - 1];
+                if (from != slot && dynamic->class_set[from] != set_stamp)
+                {
+                    change_pair(dynamic, from, slot, sign);
+                }
+            }
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------------------------
+// Creation
+
+t_dynamic_graph* create_dynamic_graph(adjacency_list* graph)
+{
+    int n = graph->num_vertices;
+    t_dynamic_graph* dynamic = (t_dynamic_graph*)allocate(sizeof(t_dynamic_graph));
+    dynamic->graph = graph;
+    dynamic->predecessors = (int**)allocate((size_t)n * sizeof(int*));
+    dynamic->predecessor_count = (int*)allocate((size_t)n * sizeof(int));
+    dynamic->predecessor_capacity = (int*)allocate((size_t)n * sizeof(int));
+    dynamic->vertex_to_class = (int*)allocate((size_t)n * sizeof(int));
+    dynamic->classes = (t_dynamic_class*)allocate((size_t)n * sizeof(t_dynamic_class));
+    dynamic->free_slots = (int*)allocate((size_t)n * sizeof(int));
+    dynamic->class_mark = (int*)allocate((size_t)n * sizeof(int));
+    dynamic->class_set = (int*)allocate((size_t)n * sizeof(int));
+    dynamic->class_stack = (int*)allocate((size_t)n * sizeof(int));
+    dynamic->tarjan_index = (int*)allocate((size_t)n * sizeof(int));
+    dynamic->tarjan_low = (int*)allocate((size_t)n * sizeof(int));
+    dynamic->tarjan_on_stack = (unsigned char*)allocate((size_t)n);
+    dynamic->pair_slots = PAIR_INITIAL_SLOTS;
+    dynamic->pairs = (t_class_pair*)allocate(dynamic->pair_slots * sizeof(t_class_pair));
+    for (int v = 0; v < n; v++)
+    {
+        dynamic->tarjan_index[v] = -1;
+    }
+
+    for (int v = 0; v < n; v++)
+    {
+        for (cell* current = graph->lists[v].head; current != NULL; current = current->next)
+        {
+            add_predecessor(dynamic, current->arrival_vertex, v + 1);
+        }
+    }
+
+    // Tarjan once on the whole graph, then the links of every class
+    int* vertex_to_class = NULL;
+    t_partition partition = tarjan_partition_graph(graph, &vertex_to_class);
+    for (int c = 0; c < partition.class_count; c++)
+    {
+        int slot = new_class(dynamic);
+        for (int m = 0; m < partition.classes[c].member_count; m++)
+        {
+            add_member(dynamic, slot, partition.classes[c].members[m]);
+        }
+    }
+    free(vertex_to_class);
+    free_partition(&partition);
+
+    for (int v = 0; v < n; v++)
+    {
+        int from = dynamic->vertex_to_class[v];
+        for (cell* current = graph->lists[v].head; current != NULL; current = current->next)
+        {
+            int to = dynamic->vertex_to_class[current->arrival_vertex - 1];
+            if (to != from)
+            {
+                change_pair(dynamic, from, to, 1);
+            }
+        }
+    }
+    return dynamic;
+}
+
+// ---------------------------------------------------------------------------------------------
+// Edge insertion: merge of the classes on a new cycle
+
+// Marks (class_mark = stamp) the classes reachable from start; returns 1 if target is one of them
+static int mark_reachable(t_dynamic_graph* dynamic, int start, int target, int stamp)
+{
+    int top = 0;
+    int found = 0;
+    dynamic->class_stack[top++] = start;
+    dynamic->class_mark[start] = stamp;
+    while (top > 0)
+    {
+        int slot = dynamic->class_stack[--top];
+        found |= (slot == target);
+        const t_dynamic_class* cls = &dynamic->classes[slot];
+        for (int m = 0; m < cls->member_count; m++)
+        {
+            for (cell* current = dynamic->graph->lists[cls->members[m] - 1].head; current != NULL; current = current->next)
+            {
+                int next = dynamic->vertex_to_class[current->arrival_vertex - 1];
+                if (dynamic->class_mark[next] != stamp)
+                {
+                    dynamic->class_mark[next] = stamp;
+                    dynamic->class_stack[top++] = next;
+                }
+            }
+        }
+    }
+    return found;
+}
+
+// Merges the classes reachable from the class of head that lead back to the class of tail
+static void merge_cycle(t_dynamic_graph* dynamic, int tail_class, int reach_stamp)
+{
+    // Backward search from the tail class, inside the classes reachable from the head
+    int set_stamp = ++dynamic->stamp;
+    int* set = (int*)allocate((size_t)dynamic->class_slots * sizeof(int));
+    int set_size = 0;
+    set[set_size++] = tail_class;
+    dynamic->class_set[tail_class] = set_stamp;
+    for (int s = 0; s < set_size; s++)
+    {
+        const t_dynamic_class* cls = &dynamic->classes[set[s]];
+        for (int m = 0; m < cls->member_count; m++)
+        {
+            int vertex = cls->members[m];
+            for (int p = 0; p < dynamic->predecessor_count[vertex - 1]; p++)
+            {
+                int previous = dynamic->vertex_to_class[dynamic->predecessors[vertex - 1][p] - 1];
+                if (dynamic->class_mark[previous] == reach_stamp && dynamic->class_set[previous] != set_stamp)
+                {
+                    dynamic->class_set[previous] = set_stamp;
+                    set[set_size++] = previous;
+                }
+            }
+        }
+    }
+
+    // The links of the merged classes are counted again for the merged class
+    count_set_edges(dynamic, set, set_size, set_stamp, -1);
+    for (int s = 1; s < set_size; s++)
+    {
+        t_dynamic_class* cls = &dynamic->classes[set[s]];
+        for (int m = 0; m < cls->member_count; m++)
+        {
+            add_member(dynamic, tail_class, cls->members[m]);
+        }
+        delete_class(dynamic, set[s]);
+        dynamic->merges++;
+    }
+    int merged_stamp = ++dynamic->stamp;
+    dynamic->class_set[tail_class] = merged_stamp;
+    count_set_edges(dynamic, &tail_class, 1, merged_stamp, 1);
+    free(set);
+}
+
+void dynamic_add_edge(t_dynamic_graph* dynamic, int from, int to, float probability)
+{
+    add_cell_to_list(&dynamic->graph->lists[from - 1], to, probability);
+    add_predecessor(dynamic, to, from);
+
+    int from_class = dynamic->vertex_to_class[from - 1];
+    int to_class = dynamic->vertex_to_class[to - 1];
+    if (from_class == to_class)
+    {
+        return;
+    }
+    int known = pair_exists(dynamic, from_class, to_class);
+    change_pair(dynamic, from_class, to_class, 1);
+    if (known)
+    {
+        return;  // Nothing new is reachable
+    }
+
+    // A cycle appears if the tail class is reachable from the head class
+    int reach_stamp = ++dynamic->stamp;
+    if (mark_reachable(dynamic, to_class, from_class, reach_stamp))
+    {
+        merge_cycle(dynamic, from_class, reach_stamp);
+    }
+}
+
+// ---------------------------------------------------------------------------------------------
+// Edge removal: Tarjan on the class of the edge only
+
+// Strongly connected components of the members of one class, using the edges inside the class
+// Returns their number; the members are reordered component by component, ends[c] is the end of component c
+static int class_components(t_dynamic_graph* dynamic, int slot, int* ends)
+{
+    t_dynamic_class* cls = &dynamic->classes[slot];
+    int size = cls->member_count;
+    int* order = (int*)allocate((size_t)size * sizeof(int));
+    int* stack = (int*)allocate((size_t)size * sizeof(int));
+    int* frame_vertex = (int*)allocate((size_t)size * sizeof(int));
+    cell** frame_cell = (cell**)allocate((size_t)size * sizeof(cell*));
+    int* index = dynamic->tarjan_index;
+    int* low = dynamic->tarjan_low;
+    unsigned char* on_stack = dynamic->tarjan_on_stack;
+    int counter = 0;
+    int stack_top = 0;
+    int popped = 0;
+    int components = 0;
+
+    for (int m = 0; m < size; m++)
+    {
+        int root = cls->members[m] - 1;
+        if (index[root] != -1)
+        {
+            continue;
+        }
+        int frames = 0;
+        frame_vertex[frames] = root;
+        frame_cell[frames++] = dynamic->graph->lists[root].head;
+        index[root] = low[root] = counter++;
+        stack[stack_top++] = root;
+        on_stack[root] = 1;
+
+        while (frames > 0)
+        {
+            int v = frame_vertex[frames - 1];
+            cell* current = frame_cell[frames - 1];
+            int descended = 0;
+            while (current != NULL && !descended)
+            {
+                int w = current->arrival_vertex - 1;
+                current = current->next;
+                if (dynamic->vertex_to_class[w] != slot)
+                {
+                    continue;
+                }
+                if (index[w] == -1)
+                {
+                    frame_cell[frames - 1] = current;
+                    frame_vertex[frames] = w;
+                    frame_cell[frames++] = dynamic->graph->lists[w].head;
+                    index[w] = low[w] = counter++;
+                    stack[stack_top++] = w;
+                    on_stack[w] = 1;
+                    descended = 1;
+                }
+                else if (on_stack[w] && index[w] < low[v])
+                {
+                    low[v] = index[w];
+                }
+            }
+            if (descended)
+            {
+                continue;
+            }
+
+            frames--;
+            if (low[v] == index[v])
+            {
+                int w;
+                do
+                {
+                    w = stack[--stack_top];
+                    on_stack[w] = 0;
+                    order[popped++] = w + 1;
+                } while (w != v);
+                ends[components++] = popped;
+            }
+            if (frames > 0 && low[v] < low[frame_vertex[frames - 1]])
+            {
+                low[frame_vertex[frames - 1]] = low[v];
+            }
+        }
+    }
+
+    for (int m = 0; m < size; m++)
+    {
+        index[order[m] - 1] = -1;
+        cls->members[m] = order[m];
+    }
+    free(order);
+    free(stack);
+    free(frame_vertex);
+    free(frame_cell);
+    return components;
+}
+
+static void split_class(t_dynamic_graph* dynamic, int slot)
+{
+    int* ends = (int*)allocate((size_t)dynamic->classes[slot].member_count * sizeof(int));
+    int components = class_components(dynamic, slot, ends);
+    if (components == 1)
+    {
+        free(ends);
+        return;
+    }
+
+    int old_stamp = ++dynamic->stamp;
+    dynamic->class_set[slot] = old_stamp;
+    count_set_edges(dynamic, &slot, 1, old_stamp, -1);
+
+    // The first component keeps the slot, the others get new ones
+    t_dynamic_class* cls = &dynamic->classes[slot];
+    int size = cls->member_count;
+    int* members = (int*)allocate((size_t)size * sizeof(int));
+    memcpy(members, cls->members, (size_t)size * sizeof(int));
+    int* set = (int*)allocate((size_t)components * sizeof(int));
+    int new_stamp = ++dynamic->stamp;
+    set[0] = slot;
+    cls->member_count = ends[0];
+    for (int c = 1; c < components; c++)
+    {
+        set[c] = new_class(dynamic);
+        for (int m = ends[c - 1]; m < ends[c]; m++)
+        {
+            add_member(dynamic, set[c], members[m]);
+        }
+        dynamic->splits++;
+    }
+    for (int c = 0; c < components; c++)
+    {
+        dynamic->class_set[set[c]] = new_stamp;
+    }
+    count_set_edges(dynamic, set, components, new_stamp, 1);
+
+    free(members);
+    free(set);
+    free(ends);
+}
+
+int dynamic_remove_edge(t_dynamic_graph* dynamic, int from, int to)
+{
+    cell** link = &dynamic->graph->lists[from - 1].head;
+    while (*link != NULL && (*link)->arrival_vertex != to)
+    {
+        link = &(*link)->next;
+    }
+    if (*link == NULL)
+    {
+        return 0;
+    }
+    cell* removed = *link;
+    *link = removed->next;
+    arena_release(dynamic->graph->arena, removed, sizeof(cell));
+    remove_predecessor(dynamic, to, from);
+
+    int from_class = dynamic->vertex_to_class[from - 1];
+    int to_class = dynamic->vertex_to_class[to - 1];
+    if (from_class != to_class)
+    {
+        change_pair(dynamic, from_class, to_class, -1);
+    }
+    else
+    {
+        split_class(dynamic, from_class);  // The class may fall apart
+    }
+    return 1;
+}
+
+int dynamic_set_probability(t_dynamic_graph* dynamic, int from, int to, float probability)
+{
+    for (cell* current = dynamic->graph->lists[from - 1].head; current != NULL; current = current->next)
+    {
+        if (current->arrival_vertex == to)
+        {
+            current->probability = probability;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------------------------------------
+// Delta files
+
+static void delta_error(const char* filename, const t_scanner* scanner, const char* format, ...)
+{
+    char message[256];
+    va_list arguments;
+    va_start(arguments, format);
+    vsnprintf(message, sizeof(message), format, arguments);
+    va_end(arguments);
+    fatal_error("%s, line %d: %s", filename, scanner->line, message);
+}
+
+// Next field of the current line (it must be there)
+static void expect_field(t_scanner* scanner, const char* filename, const char* what)
+{
+    skip_blanks(scanner);
+    if (scanner->cursor >= scanner->end || *scanner->cursor == '\n' || *scanner->cursor == '\r')
+    {
+        delta_error(filename, scanner, "missing %s", what);
+    }
+}
+
+static int read_delta_state(t_dynamic_graph* dynamic, t_scanner* scanner, const char* filename)
+{
+    expect_field(scanner, filename, "state");
+    int state = 0;
+    if (dynamic->graph->labels != NULL)
+    {
+        const char* token;
+        size_t length = scan_token(scanner, &token);
+        state = find_label(dynamic->graph->labels, token, length);
+        if (state == 0)
+        {
+            delta_error(filename, scanner, "unknown state '%.*s'", (int)length, token);
+        }
+        return state;
+    }
+    if (!scan_int(scanner, &state) || state < 1 || state > dynamic->graph->num_vertices)
+    {
+        delta_error(filename, scanner, "expected a state in 1..%d", dynamic->graph->num_vertices);
+    }
+    return state;
+}
+
+static float read_delta_probability(t_scanner* scanner, const char* filename)
+{
+    expect_field(scanner, filename, "probability");
+    float probability;
+    if (!scan_float(scanner, &probability) || probability < 0.0f)
+    {
+        delta_error(filename, scanner, "expected a probability");
+    }
+    return probability;
+}
+
+long apply_delta_file(t_dynamic_graph* dynamic, const char* filename)
+{
+    t_scanner scanner;
+    if (open_scanner(&scanner, filename) != 0)
+    {
+        fatal_error("Could not find file '%s'", filename);
+    }
+
+    long changes = 0;
+    for (;;)
+    {
+        skip_spaces(&scanner);
+        if (scanner_at_end(&scanner))
+        {
+            break;
+        }
+        char operation = *scanner.cursor++;
+        if (operation == '#')
+        {
+            skip_line(&scanner);
+            continue;
+        }
+        if (operation != '+' && operation != '-' && operation != '=')
+        {
+            delta_error(filename, &scanner, "unknown change '%c' (expected +, - or =)", operation);
+        }
+
+        int from = read_delta_state(dynamic, &scanner, filename);
+        int to = read_delta_state(dynamic, &scanner, filename);
+        if (operation == '+')
+        {
+            float probability = read_delta_probability(&scanner, filename);
+            if (!dynamic_set_probability(dynamic, from, to, probability))
+            {
+                dynamic_add_edge(dynamic, from, to, probability);
+            }
+        }
+        else if (operation == '-')
+        {
+            if (!dynamic_remove_edge(dynamic, from, to))
+            {
+                delta_error(filename, &scanner, "no edge to remove");
+            }
+        }
+        else
+        {
+            float probability = read_delta_probability(&scanner, filename);
+            if (!dynamic_set_probability(dynamic, from, to, probability))
+            {
+                delta_error(filename, &scanner, "no edge to update");
+            }
+        }
+        changes++;
+        skip_line(&scanner);
+    }
+
+    close_scanner(&scanner);
+    return changes;
+}
+
+// ---------------------------------------------------------------------------------------------
+// Snapshot
+
+static int compare_ints(const void* a, const void* b)
+{
+    int first = *(const int*)a;
+    int second = *(const int*)b;
+    return (first > second) - (first < second);
+}
+
+static int compare_links(const void* a, const void* b)
+{
+    const t_link* first = (const t_link*)a;
+    const t_link* second = (const t_link*)b;
+    if (first->from != second->from)
+    {
+        return (first->from > second->from) - (first->from < second->from);
+    }
+    return (first->to > second->to) - (first->to < second->to);
+}
+
+void dynamic_snapshot(const t_dynamic_graph* dynamic, t_partition* partition, int** vertex_to_class,
+                      t_link_array* links, graph_characteristics* characteristics)
+{
+    int n = dynamic->graph->num_vertices;
+
+    // Live slots numbered in slot order
+    int* class_of_slot = (int*)allocate((size_t)(dynamic->class_slots > 0 ? dynamic->class_slots : 1) * sizeof(int));
+    partition->class_count = 0;
+    partition->capacity = dynamic->class_count > 0 ? dynamic->class_count : 1;
+    partition->classes = (t_class*)allocate((size_t)partition->capacity * sizeof(t_class));
+    partition->arena = NULL;
+    characteristics->class_is_persistent = (int*)allocate((size_t)partition->capacity * sizeof(int));
+    characteristics->has_absorbing_state = 0;
+    for (int slot = 0; slot < dynamic->class_slots; slot++)
+    {
+        const t_dynamic_class* source = &dynamic->classes[slot];
+        if (!source->alive)
+        {
+            continue;
+        }
+        int c = partition->class_count++;
+        class_of_slot[slot] = c;
+        t_class* cls = &partition->classes[c];
+        snprintf(cls->name, sizeof(cls->name), "C%d", c + 1);
+        cls->member_count = source->member_count;
+        cls->capacity = source->member_count;
+        cls->members = (int*)allocate((size_t)source->member_count * sizeof(int));
+        memcpy(cls->members, source->members, (size_t)source->member_count * sizeof(int));
+        qsort(cls->members, (size_t)cls->member_count, sizeof(int), compare_ints);
+
+        characteristics->class_is_persistent[c] = (source->out_links == 0);
+        if (source->out_links == 0 && source->member_count == 1)
+        {
+            characteristics->has_absorbing_state = 1;
+        }
+    }
+    characteristics->is_irreducible = (partition->class_count == 1);
+
+    *vertex_to_class = (int*)allocate((size_t)n * sizeof(int));
+    for (int v = 0; v < n; v++)
+    {
+        (*vertex_to_class)[v] = class_of_slot[dynamic->vertex_to_class[v]];
+    }
+
+    links->size = 0;
+    links->capacity = dynamic->pair_count > 0 ? (int)dynamic->pair_count : 1;
+    links->links = (t_link*)allocate((size_t)links->capacity * sizeof(t_link));
+    links->arena = NULL;
+    for (size_t s = 0; s < dynamic->pair_slots; s++)
+    {
+        uint64_t key = dynamic->pairs[s].key;
+        if (key != 0)
+        {
+            links->links[links->size].from = class_of_slot[(int)(key >> 32) - 1];
+            links->links[links->size].to = class_of_slot[(int)(key & 0xffffffffu) - 1];
+            links->size++;
+        }
+    }
+    qsort(links->links, (size_t)links->size, sizeof(t_link), compare_links);
+    free(class_of_slot);
+}
+
+void free_dynamic_graph(t_dynamic_graph* dynamic)
+{
+    if (dynamic == NULL)
+    {
+        return;
+    }
+    int n = dynamic->graph->num_vertices;
+    for (int v = 0; v < n; v++)
+    {
+        free(dynamic->predecessors[v]);
+        free(dynamic->classes[v].members);
+    }
+    free(dynamic->predecessors);
+    free(dynamic->predecessor_count);
+    free(dynamic->predecessor_capacity);
+    free(dynamic->vertex_to_class);
+    free(dynamic->classes);
+    free(dynamic->free_slots);
+    free(dynamic->pairs);
+    free(dynamic->class_mark);
+    free(dynamic->class_set);
+    free(dynamic->class_stack);
+    free(dynamic->tarjan_index);
+    free(dynamic->tarjan_low);
+    free(dynamic->tarjan_on_stack);
+    free(dynamic);
+}
@@ -0,0 +1,90 @@
+#ifndef DYNAMIC_H
+#define DYNAMIC_H
+
+#include <stdint.h>
+
+#include "utils.h"
+#include "graph_analysis.h"
+
+// Class of a dynamic graph; the slots of merged or split classes are reused
+typedef struct
+{
+    int* members;              // In no particular order (sorted by dynamic_snapshot)
+    int member_count;
+    int capacity;
+    int out_links;             // Number of other classes this class leads to (0 = persistent)
+    int alive;
+} t_dynamic_class;
+
+// Number of edges between two classes, keyed by (from slot << 32) | to slot
+typedef struct
+{
+    uint64_t key;              // 0 = empty (slot numbers are stored + 1)
+    int count;
+} t_class_pair;
+
+// Graph whose classes are kept up to date while its edges change
+// Adding an edge between two classes only looks at the classes reachable from its head,
+// and merges the ones on a new cycle; removing an edge inside a class runs Tarjan on
+// that class only, and splits it if needed. The class links (with their number of edges)
+// and the persistent / transient flags are updated for the classes involved only.
+typedef struct
+{
+    adjacency_list* graph;     // Edited in place
+    int** predecessors;        // Vertices with an edge to vertex v at predecessors[v - 1] (with repeats)
+    int* predecessor_count;
+    int* predecessor_capacity;
+    int* vertex_to_class;      // Slot of vertex v at vertex_to_class[v - 1]
+    t_dynamic_class* classes;  // num_vertices slots (there are never more classes than vertices)
+    int class_slots;           // Slots used so far (live or free)
+    int* free_slots;           // Slots of the classes that disappeared, reused first
+    int free_count;
+    int class_count;           // Live classes
+    t_class_pair* pairs;       // Open addressing, at most half full
+    size_t pair_slots;
+    size_t pair_count;
+
+    // Scratch space of the searches (marks are stamps, so nothing is cleared between searches)
+    int* class_mark;
+    int* class_set;            // Second mark: the classes of the current merge or split
+    int stamp;
+    int* class_stack;
+    int* tarjan_index;         // -1 outside the current search
+    int* tarjan_low;
+    unsigned char* tarjan_on_stack;
+
+    // What the updates did
+    long merges;               // Classes merged into another one
+    long splits;               // New classes created by splits
+} t_dynamic_graph;
+
+// Function to build the classes of a graph (Tarjan once) and keep them up to date afterwards
+t_dynamic_graph* create_dynamic_graph(adjacency_list* graph);
+
+// Function to add an edge from -> to (1-based states); the classes are updated
+void dynamic_add_edge(t_dynamic_graph* dynamic, int from, int to, float probability);
+
+// Function to remove the edge from -> to; returns 0 if there is no such edge
+int dynamic_remove_edge(t_dynamic_graph* dynamic, int from, int to);
+
+// Function to change the probability of the edge from -> to; returns 0 if there is no such edge
+// (a probability change never changes the classes)
+int dynamic_set_probability(t_dynamic_graph* dynamic, int from, int to, float probability);
+
+// Function to apply a delta file, one change per line ('#' starts a comment):
+//   + from to probability    add the edge (or set its probability if it exists)
+//   - from to                remove the edge
+//   = from to probability    change the probability of the edge
+// The states are numbers, or names if the graph has labels. Errors are fatal, with the line.
+// Returns the number of changes applied.
+long apply_delta_file(t_dynamic_graph* dynamic, const char* filename);
+
+// Function to write the classes as a partition, vertex_to_class, class links and characteristics
+// (same structures as tarjan_partition_graph, build_link_array and compute_graph_characteristics)
+void dynamic_snapshot(const t_dynamic_graph* dynamic, t_partition* partition, int** vertex_to_class,
+                      t_link_array* links, graph_characteristics* characteristics);
+
+// Function to free the dynamic graph (not the graph itself)
+void free_dynamic_graph(t_dynamic_graph* dynamic);
+
+#endif
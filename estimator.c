@@ -0,0 +1,593 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "estimator.h"
+
+#define COUNT_INITIAL_SLOTS 1024
+
+// Below this many bytes per thread, fewer threads are started
+#define ESTIMATOR_MIN_PART ((long long)1 << 16)
+
+// Number of times each transition was seen, keyed by (from << 32) | to
+// Open addressing with linear probing; key 0 is an empty slot (states start at 1)
+typedef struct
+{
+    uint64_t key;
+    long count;
+} t_count_slot;
+
+typedef struct
+{
+    t_count_slot* slots;
+    size_t slot_count;         // Power of two, at least twice used
+    size_t used;
+} t_count_map;
+
+// First and last event of a session (in one part of the file, or so far for the merge)
+typedef struct
+{
+    int first_state;
+    int last_state;
+    double first_time;
+    double last_time;
+} t_session_span;
+
+// One reader thread: the lines that start in [begin, end), with its own tables
+// (local state and session numbers, translated during the merge)
+typedef struct
+{
+    const t_estimator_options* options;
+    int fd;
+    long long begin;
+    long long end;
+    t_label_table* states;
+    t_label_table* sessions;
+    t_session_span* spans;     // Span of local session s at spans[s - 1]
+    int span_capacity;
+    t_count_map counts;
+    long events;
+    long transitions;
+    long out_of_order;
+    long malformed;
+    int failed;
+} t_estimator_worker;
+
+// Transition of a sorted row
+typedef struct
+{
+    int to;
+    long count;
+} t_row_entry;
+
+static void* allocate(size_t size)
+{
+    void* block = calloc(1, size > 0 ? size : 1);
+    if (block == NULL)
+    {
+        fatal_error("Could not allocate memory for the estimator");
+    }
+    return block;
+}
+
+static uint64_t transition_key(int from, int to)
+{
+    return ((uint64_t)(uint32_t)from << 32) | (uint32_t)to;
+}
+
+// The keys are two small integers: mixed so that consecutive states spread over the table
+static size_t key_slot(uint64_t key, size_t mask)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdull;
+    key ^= key >> 33;
+    return (size_t)key & mask;
+}
+
+static void create_count_map(t_count_map* map, size_t slot_count)
+{
+    map->slots = (t_count_slot*)allocate(slot_count * sizeof(t_count_slot));
+    map->slot_count = slot_count;
+    map->used = 0;
+}
+
+static void add_count(t_count_map* map, uint64_t key, long count);
+
+static void grow_count_map(t_count_map* map)
+{
+    t_count_map grown;
+    create_count_map(&grown, map->slot_count * 2);
+    for (size_t s = 0; s < map->slot_count; s++)
+    {
+        if (map->slots[s].key != 0)
+        {
+            add_count(&grown, map->slots[s].key, map->slots[s].count);
+        }
+    }
+    free(map->slots);
+    *map = grown;
+}
+
+static void add_count(t_count_map* map, uint64_t key, long count)
+{
+    size_t mask = map->slot_count - 1;
+    size_t slot = key_slot(key, mask);
+    while (map->slots[slot].key != 0 && map->slots[slot].key != key)
+    {
+        slot = (slot + 1) & mask;
+    }
+    if (map->slots[slot].key == 0)
+    {
+        map->slots[slot].key = key;
+        map->used++;
+    }
+    map->slots[slot].count += count;
+
+    // At most half full, so that the probes stay short
+    if (map->used * 2 > map->slot_count)
+    {
+        grow_count_map(map);
+    }
+}
+
+// Room for the span of session number session (1-based)
+static t_session_span* session_span(t_session_span** spans, int* capacity, int session)
+{
+    if (session > *capacity)
+    {
+        int grown = (*capacity > 0) ? *capacity * 2 : 1024;
+        *spans = (t_session_span*)realloc(*spans, (size_t)grown * sizeof(t_session_span));
+        if (*spans == NULL)
+        {
+            fatal_error("Could not allocate memory for the estimator");
+        }
+        *capacity = grown;
+    }
+    return &(*spans)[session - 1];
+}
+
+// Next field of a line: a run of characters up to a space, tab or comma, or a double-quoted string
+// Returns its length (0 if the line has no more fields)
+static size_t next_field(const char** cursor, const char* end, const char** field)
+{
+    const char* c = *cursor;
+    while (c < end && (*c == ' ' || *c == '\t' || *c == ',' || *c == '\r'))
+    {
+        c++;
+    }
+    const char* start = c;
+    if (c < end && *c == '"')
+    {
+        start = ++c;
+        while (c < end && *c != '"')
+        {
+            c++;
+        }
+        *field = start;
+        *cursor = (c < end) ? c + 1 : c;
+        return (size_t)(c - start);
+    }
+    while (c < end && *c != ' ' && *c != '\t' && *c != ',' && *c != '\r')
+    {
+        c++;
+    }
+    *field = start;
+    *cursor = c;
+    return (size_t)(c - start);
+}
+
+int parse_log_event(const char* line, const char* end, t_log_event* event)
+{
+    const char* cursor = line;
+    const char* time_text;
+    event->session_length = next_field(&cursor, end, &event->session);
+    if (event->session_length == 0 || event->session[0] == '#')
+    {
+        return 0;  // Blank line or comment
+    }
+    size_t time_length = next_field(&cursor, end, &time_text);
+    event->state_length = next_field(&cursor, end, &event->state);
+
+    // The character after a field always stops strtod (separator, quote, line break or '\0')
+    char* time_end = NULL;
+    event->time = (time_length > 0) ? strtod(time_text, &time_end) : 0.0;
+    if (time_length == 0 || event->state_length == 0 || time_end != time_text + time_length)
+    {
+        return -1;  // Header line, missing field, timestamp that is not a number
+    }
+    return 1;
+}
+
+// One line "session timestamp state": the transition from the previous state of the session is counted
+static void count_event(t_estimator_worker* worker, const char* line, const char* end)
+{
+    t_log_event event;
+    int status = parse_log_event(line, end, &event);
+    if (status <= 0)
+    {
+        worker->malformed += (status < 0);
+        return;
+    }
+    double time = event.time;
+
+    int known_sessions = worker->sessions->count;
+    int session = intern_label(worker->sessions, event.session, event.session_length);
+    int state = intern_label(worker->states, event.state, event.state_length);
+    worker->events++;
+
+    t_session_span* span = session_span(&worker->spans, &worker->span_capacity, session);
+    if (session > known_sessions)
+    {
+        span->first_state = state;
+        span->last_state = state;
+        span->first_time = time;
+        span->last_time = time;
+        return;
+    }
+    if (time < span->last_time)
+    {
+        worker->out_of_order++;
+        return;
+    }
+    add_count(&worker->counts, transition_key(span->last_state, state), 1);
+    worker->transitions++;
+    span->last_state = state;
+    span->last_time = time;
+}
+
+static void* estimator_thread(void* argument)
+{
+    t_estimator_worker* worker = (t_estimator_worker*)argument;
+    size_t capacity = worker->options->buffer_size;
+    char* buffer = (char*)malloc(capacity + 1);
+    if (buffer == NULL)
+    {
+        fatal_error("Could not allocate memory for the estimator");
+    }
+
+    // A part starts one byte early: if that byte is not a line break, the first line
+    // started in the previous part, which reads it in full
+    long long offset = (worker->begin > 0) ? worker->begin - 1 : 0;   // File offset of buffer[0]
+    int skip_line = (worker->begin > 0);
+    size_t used = 0;
+    int at_end = 0;
+    int done = 0;
+    while (!done && !at_end)
+    {
+        if (used == capacity)
+        {
+            // A line longer than the buffer
+            capacity *= 2;
+            buffer = (char*)realloc(buffer, capacity + 1);
+            if (buffer == NULL)
+            {
+                fatal_error("Could not allocate memory for the estimator");
+            }
+        }
+        ssize_t count = pread(worker->fd, buffer + used, capacity - used, (off_t)(offset + (long long)used));
+        if (count < 0)
+        {
+            worker->failed = 1;
+            break;
+        }
+        at_end = (count == 0);
+        used += (size_t)count;
+        buffer[used] = '\0';
+
+        // Complete lines (the last line of the file may have no line break)
+        char* line = buffer;
+        char* data_end = buffer + used;
+        while (line < data_end)
+        {
+            char* newline = (char*)memchr(line, '\n', (size_t)(data_end - line));
+            if (newline == NULL && !at_end)
+            {
+                break;
+            }
+            if (newline == NULL)
+            {
+                newline = data_end;
+            }
+            if (skip_line)
+            {
+                skip_line = 0;
+            }
+            else if (offset + (line - buffer) >= worker->end)
+            {
+                done = 1;
+                break;
+            }
+            else
+            {
+                count_event(worker, line, newline);
+            }
+            line = (newline < data_end) ? newline + 1 : data_end;
+        }
+
+        // The incomplete line goes to the start of the buffer
+        size_t consumed = (size_t)(line - buffer);
+        memmove(buffer, line, used - consumed);
+        used -= consumed;
+        offset += (long long)consumed;
+    }
+
+    free(buffer);
+    return NULL;
+}
+
+static int compare_row_entries(const void* a, const void* b)
+{
+    const t_row_entry* first = (const t_row_entry*)a;
+    const t_row_entry* second = (const t_row_entry*)b;
+    return (first->to > second->to) - (first->to < second->to);
+}
+
+t_estimator_options default_estimator_options(void)
+{
+    t_estimator_options options;
+    options.thread_count = 4;
+    options.smoothing = 0.0;
+    options.min_count = 0;
+    options.buffer_size = (size_t)4 << 20;
+    return options;
+}
+
+// Normalised rows of the merged counts, in increasing order of arrival state
+static adjacency_list build_estimated_graph(const t_count_map* counts, int n, const t_estimator_options* options,
+                                            t_estimator_stats* stats)
+{
+    // Rows of the kept transitions, stored flat: row i is entries[row_start[i - 1]] ... entries[row_start[i] - 1]
+    size_t* row_start = (size_t*)allocate((size_t)(n + 1) * sizeof(size_t));
+    long* row_total = (long*)allocate((size_t)(n + 1) * sizeof(long));
+    for (size_t s = 0; s < counts->slot_count; s++)
+    {
+        const t_count_slot* slot = &counts->slots[s];
+        if (slot->key == 0)
+        {
+            continue;
+        }
+        if (slot->count < options->min_count)
+        {
+            stats->dropped++;
+            continue;
+        }
+        int from = (int)(slot->key >> 32);
+        row_start[from]++;
+        row_total[from] += slot->count;
+    }
+    for (int i = 1; i <= n; i++)
+    {
+        row_start[i] += row_start[i - 1];
+    }
+
+    t_row_entry* entries = (t_row_entry*)allocate(row_start[n] * sizeof(t_row_entry));
+    size_t* fill = (size_t*)allocate((size_t)(n + 1) * sizeof(size_t));
+    for (size_t s = 0; s < counts->slot_count; s++)
+    {
+        const t_count_slot* slot = &counts->slots[s];
+        if (slot->key == 0 || slot->count < options->min_count)
+        {
+            continue;
+        }
+        int from = (int)(slot->key >> 32);
+        t_row_entry* entry = &entries[row_start[from - 1] + fill[from]++];
+        entry->to = (int)(slot->key & 0xffffffffu);
+        entry->count = slot->count;
+    }
+    free(fill);
+
+    // The cells are added at the head of the lists: last arrival state first
+    adjacency_list adj_list = create_empty_adjacency_list(n);
+    for (int i = 1; i <= n; i++)
+    {
+        t_row_entry* row = entries + row_start[i - 1];
+        size_t size = row_start[i] - row_start[i - 1];
+        qsort(row, size, sizeof(t_row_entry), compare_row_entries);
+        list* lst = &adj_list.lists[i - 1];
+        if (row_total[i] == 0)
+        {
+            stats->absorbing++;
+        }
+
+        if (options->smoothing > 0.0)
+        {
+            double denominator = (double)row_total[i] + options->smoothing * n;
+            size_t k = size;
+            for (int j = n; j >= 1; j--)
+            {
+                long count = (k > 0 && row[k - 1].to == j) ? row[--k].count : 0;
+                add_cell_to_list(lst, j, (float)(((double)count + options->smoothing) / denominator));
+            }
+        }
+        else if (row_total[i] == 0)
+        {
+            add_cell_to_list(lst, i, 1.0f);
+        }
+        else
+        {
+            for (size_t k = size; k > 0; k--)
+            {
+                add_cell_to_list(lst, row[k - 1].to, (float)((double)row[k - 1].count / (double)row_total[i]));
+            }
+        }
+    }
+
+    free(entries);
+    free(row_start);
+    free(row_total);
+    return adj_list;
+}
+
+adjacency_list estimate_graph(const char* log_filename, const t_estimator_options* options,
+                              t_estimator_stats* stats)
+{
+    t_estimator_stats local_stats;
+    if (stats == NULL)
+    {
+        stats = &local_stats;
+    }
+    memset(stats, 0, sizeof(*stats));
+
+    int fd = open(log_filename, O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0)
+    {
+        fatal_error("Could not find file '%s'", log_filename);
+    }
+    long long size = (long long)info.st_size;
+
+    // Small files are not worth many threads
+    int thread_count = options->thread_count > 0 ? options->thread_count : 1;
+    if (thread_count > size / ESTIMATOR_MIN_PART + 1)
+    {
+        thread_count = (int)(size / ESTIMATOR_MIN_PART + 1);
+    }
+
+    t_estimator_worker* workers = (t_estimator_worker*)allocate(thread_count * sizeof(t_estimator_worker));
+    pthread_t* threads = (pthread_t*)allocate(thread_count * sizeof(pthread_t));
+    for (int w = 0; w < thread_count; w++)
+    {
+        workers[w].options = options;
+        workers[w].fd = fd;
+        workers[w].begin = size * w / thread_count;
+        workers[w].end = size * (w + 1) / thread_count;
+        workers[w].states = create_label_table();
+        workers[w].sessions = create_label_table();
+        create_count_map(&workers[w].counts, COUNT_INITIAL_SLOTS);
+        if (pthread_create(&threads[w], NULL, estimator_thread, &workers[w]) != 0)
+        {
+            fatal_error("cannot start estimator thread");
+        }
+    }
+    for (int w = 0; w < thread_count; w++)
+    {
+        pthread_join(threads[w], NULL);
+    }
+    close(fd);
+    free(threads);
+
+    // Merge in file order: the states and sessions keep their order of first appearance,
+    // and each session of a part continues from where the previous parts left it
+    // (if its first event in the part is older than its last one before, only the joining transition is lost)
+    t_label_table* states = create_label_table();
+    t_label_table* sessions = create_label_table();
+    t_session_span* spans = NULL;
+    int span_capacity = 0;
+    t_count_map counts;
+    create_count_map(&counts, COUNT_INITIAL_SLOTS);
+    int failed = 0;
+    for (int w = 0; w < thread_count; w++)
+    {
+        t_estimator_worker* worker = &workers[w];
+        failed |= worker->failed;
+        stats->events += worker->events;
+        stats->transitions += worker->transitions;
+        stats->out_of_order += worker->out_of_order;
+        stats->malformed += worker->malformed;
+
+        char buffer[STATE_LABEL_SIZE];
+        int* state_map = (int*)allocate((size_t)(worker->states->count + 1) * sizeof(int));
+        for (int s = 1; s <= worker->states->count; s++)
+        {
+            const char* name = state_label(worker->states, s, buffer);
+            state_map[s] = intern_label(states, name, strlen(name));
+        }
+
+        for (int s = 1; s <= worker->sessions->count; s++)
+        {
+            const char* name = state_label(worker->sessions, s, buffer);
+            const t_session_span* part = &worker->spans[s - 1];
+            int known_sessions = sessions->count;
+            int session = intern_label(sessions, name, strlen(name));
+            t_session_span* span = session_span(&spans, &span_capacity, session);
+            if (session > known_sessions)
+            {
+                span->last_state = state_map[part->last_state];
+                span->last_time = part->last_time;
+                continue;
+            }
+            if (part->first_time < span->last_time)
+            {
+                stats->out_of_order++;
+            }
+            else
+            {
+                add_count(&counts, transition_key(span->last_state, state_map[part->first_state]), 1);
+                stats->transitions++;
+            }
+            if (part->last_time >= span->last_time)
+            {
+                span->last_state = state_map[part->last_state];
+                span->last_time = part->last_time;
+            }
+        }
+
+        for (size_t s = 0; s < worker->counts.slot_count; s++)
+        {
+            const t_count_slot* slot = &worker->counts.slots[s];
+            if (slot->key != 0)
+            {
+                int from = state_map[slot->key >> 32];
+                int to = state_map[slot->key & 0xffffffffu];
+                add_count(&counts, transition_key(from, to), slot->count);
+            }
+        }
+
+        free(state_map);
+        free_label_table(worker->states);
+        free_label_table(worker->sessions);
+        free(worker->spans);
+        free(worker->counts.slots);
+    }
+    free(workers);
+    stats->sessions = sessions->count;
+    free_label_table(sessions);
+    free(spans);
+
+    int n = states->count;
+    if (failed)
+    {
+        fatal_error("cannot read '%s'.", log_filename);
+    }
+    if (n == 0)
+    {
+        fatal_error("no events in '%s' (lines \"session timestamp state\")", log_filename);
+    }
+    if (options->smoothing > 0.0 && n > ESTIMATOR_DENSE_LIMIT)
+    {
+        fatal_error("smoothing over %d states would give %lld edges (at most %d states)",
+                    n, (long long)n * n, ESTIMATOR_DENSE_LIMIT);
+    }
+
+    adjacency_list adj_list = build_estimated_graph(&counts, n, options, stats);
+    adj_list.labels = states;
+    free(counts.slots);
+    return adj_list;
+}
+
+void print_estimator_stats(const t_estimator_stats* stats, int num_vertices)
+{
+    printf("Events: %ld in %ld sessions, %ld transitions counted, %d states\n",
+           stats->events, stats->sessions, stats->transitions, num_vertices);
+    if (stats->out_of_order > 0)
+    {
+        printf("Skipped: %ld events older than the previous event of their session\n", stats->out_of_order);
+    }
+    if (stats->malformed > 0)
+    {
+        printf("Skipped: %ld lines that are not \"session timestamp state\"\n", stats->malformed);
+    }
+    if (stats->dropped > 0)
+    {
+        printf("Dropped: %ld transitions seen fewer times than the minimum count\n", stats->dropped);
+    }
+    if (stats->absorbing > 0)
+    {
+        printf("%d states are never left (self-loop, or a uniform row with smoothing)\n", stats->absorbing);
+    }
+}
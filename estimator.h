@@ -0,0 +1,65 @@
+#ifndef ESTIMATOR_H
+#define ESTIMATOR_H
+
+#include "utils.h"
+
+// Largest number of states of a smoothed estimate (smoothing gives an edge to every pair of states)
+#define ESTIMATOR_DENSE_LIMIT 4096
+
+// Parameters of an estimation run
+typedef struct
+{
+    int thread_count;          // Number of reader threads (each one reads its own part of the file)
+    double smoothing;          // Pseudo-count added to every pair of states (0 = maximum likelihood)
+    long min_count;            // Transitions seen fewer times are dropped before normalising
+    size_t buffer_size;        // Read buffer of each thread (bytes)
+} t_estimator_options;
+
+// What the estimator found in the log
+typedef struct
+{
+    long events;               // Events read
+    long sessions;             // Distinct session IDs
+    long transitions;          // Consecutive events of a session (transitions counted)
+    long out_of_order;         // Events older than the previous event of their session (skipped)
+    long malformed;            // Lines that are not "session timestamp state" (skipped)
+    long dropped;              // Distinct transitions below min_count
+    int absorbing;             // States never left (self-loop, or a uniform row with smoothing)
+} t_estimator_stats;
+
+// One event of a trajectory log (the names point into the line, they are not '\0'-terminated)
+typedef struct
+{
+    const char* session;
+    size_t session_length;
+    const char* state;
+    size_t state_length;
+    double time;
+} t_log_event;
+
+// Function to read one line "session timestamp state" of a trajectory log (without its line break)
+// The character after the line must not be part of a number ('\n', '\0'...).
+// Returns 1 for an event, 0 for a blank or comment line, -1 if the line is malformed
+int parse_log_event(const char* line, const char* end, t_log_event* event);
+
+// Function to get the default options (4 threads, no smoothing, no threshold, 4 MiB buffers)
+t_estimator_options default_estimator_options(void);
+
+// Function to estimate the transition graph of a trajectory log
+// Each line is one event "session timestamp state" (separated by spaces, tabs or commas;
+// numeric timestamp; any names for the sessions and states; '#' starts a comment line).
+// The events of a session must be in time order, sessions may be interleaved.
+// The file is split into one part per thread: each thread counts the transitions of its part
+// into its own hash tables, then the tables are merged in file order, joining the sessions
+// that cross the parts. P(i -> j) = (count(i, j) + smoothing) / (count(i) + smoothing * n).
+// The states are numbered in order of first appearance (adj_list.labels holds their names);
+// a state never left gets a self-loop so that the result is a Markov graph.
+// Errors (unreadable file, no events, too many states to smooth) are fatal.
+// Parameters: log filename, the options, the statistics (may be NULL)
+adjacency_list estimate_graph(const char* log_filename, const t_estimator_options* options,
+                              t_estimator_stats* stats);
+
+// Function to display the statistics of an estimation
+void print_estimator_stats(const t_estimator_stats* stats, int num_vertices);
+
+#endif
@@ -0,0 +1,257 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "export.h"
+#include "json_writer.h"
+
+// A state is its number, or its name (a string) when the graph has labels
+static void export_state(t_json_writer* writer, const t_label_table* labels, int state)
+{
+    if (labels != NULL)
+    {
+        char buffer[STATE_LABEL_SIZE];
+        json_string(writer, NULL, state_label(labels, state, buffer));
+    }
+    else
+    {
+        json_int(writer, NULL, state);
+    }
+}
+
+// CSV field of a state, quoted if its name has a comma or a quote
+static void write_csv_state(FILE* file, const t_label_table* labels, int state)
+{
+    char buffer[STATE_LABEL_SIZE];
+    const char* name = state_label(labels, state, buffer);
+    if (strpbrk(name, ",\"\n") == NULL)
+    {
+        fputs(name, file);
+        return;
+    }
+    fputc('"', file);
+    for (const char* c = name; *c != '\0'; c++)
+    {
+        if (*c == '"')
+        {
+            fputc('"', file);
+        }
+        fputc(*c, file);
+    }
+    fputc('"', file);
+}
+
+static void export_graph(t_json_writer* writer, const t_export_data* data)
+{
+    long edge_count = 0;
+    for (int v = 0; v < data->graph->num_vertices; v++)
+    {
+        for (cell* current = data->graph->lists[v].head; current != NULL; current = current->next)
+        {
+            edge_count++;
+        }
+    }
+
+    json_begin_object(writer, "graph");
+    json_string(writer, "file", data->graph_filename);
+    json_int(writer, "states", data->graph->num_vertices);
+    json_int(writer, "edges", edge_count);
+    json_end_object(writer);
+}
+
+static void export_links(t_json_writer* writer, const char* key, const t_link_array* link_array,
+                         const t_partition* partition)
+{
+    json_begin_array(writer, key);
+    for (int i = 0; i < link_array->size; i++)
+    {
+        json_begin_object(writer, NULL);
+        json_string(writer, "from", partition->classes[link_array->links[i].from].name);
+        json_string(writer, "to", partition->classes[link_array->links[i].to].name);
+        json_end_object(writer);
+    }
+    json_end_array(writer);
+}
+
+// Stationary distribution of class i: inline if short, otherwise appended to the CSV file
+// (opened on the first long vector). Returns -1 if the CSV file cannot be written.
+static int export_stationary(t_json_writer* writer, const t_export_data* data, int i,
+                             const char* csv_filename, FILE** csv_file)
+{
+    const t_class* cls = &data->partition->classes[i];
+    const t_stationary_result* stationary = &data->class_results[i].stationary;
+
+    json_begin_object(writer, "stationary");
+    json_string(writer, "solver", solver_name(data->plan->classes[i].solver));
+    json_bool(writer, "converged", stationary->converged);
+    if (!stationary->converged)
+    {
+        json_end_object(writer);
+        return 0;
+    }
+    json_int(writer, "iterations", stationary->iterations);
+
+    if (stationary->size <= EXPORT_INLINE_VALUES)
+    {
+        json_begin_array(writer, "values");
+        for (int j = 0; j < stationary->size; j++)
+        {
+            json_number(writer, NULL, stationary->stationary[j]);
+        }
+        json_end_array(writer);
+        json_end_object(writer);
+        return 0;
+    }
+
+    if (*csv_file == NULL)
+    {
+        *csv_file = fopen(csv_filename, "wt");
+        if (*csv_file == NULL)
+        {
+            printf("Error: cannot open '%s' for writing.\n", csv_filename);
+            json_end_object(writer);
+            return -1;
+        }
+        setvbuf(*csv_file, NULL, _IOFBF, JSON_OUTPUT_BUFFER);
+        fprintf(*csv_file, "class,state,probability\n");
+    }
+    for (int j = 0; j < stationary->size; j++)
+    {
+        fprintf(*csv_file, "%s,", cls->name);
+        write_csv_state(*csv_file, data->graph->labels, cls->members[j]);
+        fprintf(*csv_file, ",%.9g\n", stationary->stationary[j]);
+    }
+    json_string(writer, "values_file", csv_filename);
+    json_end_object(writer);
+    return 0;
+}
+
+static int export_classes(t_json_writer* writer, const t_export_data* data, const char* csv_filename)
+{
+    const t_partition* partition = data->partition;
+    const int* persistent = (data->characteristics != NULL) ? data->characteristics->class_is_persistent : NULL;
+    FILE* csv_file = NULL;
+    int status = 0;
+
+    json_begin_array(writer, "classes");
+    for (int i = 0; i < partition->class_count; i++)
+    {
+        const t_class* cls = &partition->classes[i];
+
+        json_begin_object(writer, NULL);
+        json_string(writer, "name", cls->name);
+        json_begin_array(writer, "members");
+        for (int j = 0; j < cls->member_count; j++)
+        {
+            export_state(writer, data->graph->labels, cls->members[j]);
+        }
+        json_end_array(writer);
+
+        if (persistent != NULL)
+        {
+            json_bool(writer, "persistent", persistent[i]);
+        }
+        if (persistent != NULL && persistent[i] && data->class_results != NULL)
+        {
+            json_int(writer, "period", data->class_results[i].period);
+            if (data->plan != NULL &&
+                export_stationary(writer, data, i, csv_filename, &csv_file) != 0)
+            {
+                status = -1;
+            }
+        }
+        json_end_object(writer);
+    }
+    json_end_array(writer);
+
+    if (csv_file != NULL && (ferror(csv_file) || fclose(csv_file) != 0))
+    {
+        printf("Error: cannot write to '%s'.\n", csv_filename);
+        status = -1;
+    }
+    return status;
+}
+
+static void export_characteristics(t_json_writer* writer, const t_export_data* data)
+{
+    const t_partition* partition = data->partition;
+    const graph_characteristics* characteristics = data->characteristics;
+
+    int persistent_count = 0;
+    for (int i = 0; i < partition->class_count; i++)
+    {
+        persistent_count += (characteristics->class_is_persistent[i] != 0);
+    }
+
+    json_begin_object(writer, "characteristics");
+    json_bool(writer, "irreducible", characteristics->is_irreducible);
+    json_int(writer, "persistent_classes", persistent_count);
+    json_int(writer, "transient_classes", partition->class_count - persistent_count);
+
+    // An absorbing state is a persistent class of one state
+    json_begin_array(writer, "absorbing_states");
+    for (int i = 0; i < partition->class_count; i++)
+    {
+        if (characteristics->class_is_persistent[i] && partition->classes[i].member_count == 1)
+        {
+            export_state(writer, data->graph->labels, partition->classes[i].members[0]);
+        }
+    }
+    json_end_array(writer);
+    json_end_object(writer);
+}
+
+// Whole document, from the graph to the characteristics; returns -1 if the CSV file failed
+static int write_results(t_json_writer* writer, const t_export_data* data, const char* csv_filename)
+{
+    int status = 0;
+    export_graph(writer, data);
+    if (data->partition != NULL)
+    {
+        if (export_classes(writer, data, csv_filename) != 0)
+        {
+            status = -1;
+        }
+        if (data->links != NULL)
+        {
+            export_links(writer, "links", data->links, data->partition);
+        }
+        if (data->hasse_links != NULL)
+        {
+            export_links(writer, "hasse_links", data->hasse_links, data->partition);
+        }
+        if (data->characteristics != NULL)
+        {
+            export_characteristics(writer, data);
+        }
+    }
+    return status;
+}
+
+int export_results(const t_export_data* data, const char* json_filename, const char* csv_filename)
+{
+    t_json_writer writer;
+    if (json_open(&writer, json_filename) != 0)
+    {
+        return -1;
+    }
+
+    int status = write_results(&writer, data, csv_filename);
+    if (json_close(&writer) != 0)
+    {
+        printf("Error: cannot write to '%s'.\n", json_filename);
+        status = -1;
+    }
+    return status;
+}
+
+int export_results_to_stream(const t_export_data* data, FILE* stream, const char* csv_filename)
+{
+    t_json_writer writer;
+    json_open_stream(&writer, stream);
+    int status = write_results(&writer, data, csv_filename);
+    if (json_close(&writer) != 0)
+    {
+        status = -1;
+    }
+    return status;
+}
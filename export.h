@@ -0,0 +1,35 @@
+#ifndef EXPORT_H
+#define EXPORT_H
+
+#include "utils.h"
+#include "graph_analysis.h"
+#include "planner.h"
+#include "class_analysis.h"
+
+// Stationary vectors longer than this are written to the CSV file instead of the JSON document
+#define EXPORT_INLINE_VALUES 1024
+
+// Results of one run that can be exported (--export)
+// Parts that were not computed are NULL and left out of the document.
+typedef struct
+{
+    const char* graph_filename;
+    const adjacency_list* graph;
+    const t_partition* partition;
+    const t_link_array* links;                      // Direct links between classes
+    const t_link_array* hasse_links;                // Links without the transitive ones
+    const graph_characteristics* characteristics;
+    const t_plan* plan;                             // Solver of each class (stationary distributions)
+    const t_class_result* class_results;            // Stationary distributions and periods
+} t_export_data;
+
+// Writes the results as one JSON document, streamed to the file as they are visited.
+// Large stationary vectors go to csv_filename ("class,state,probability" lines, only
+// created if needed) and the JSON entry of their class names that file.
+// Returns 0 on success, -1 if a file cannot be written.
+int export_results(const t_export_data* data, const char* json_filename, const char* csv_filename);
+
+// Same document, written to a stream that is already open (and closed at the end)
+int export_results_to_stream(const t_export_data* data, FILE* stream, const char* csv_filename);
+
+#endif
@@ -3,24 +3,25 @@
 #include <string.h>
 
 #include "graph_analysis.h"
+#include "output.h"
 
 typedef struct
 {
     int* data;
     int top;
     int capacity;
+    t_arena* arena;
 } int_stack;
 
+// The structures of this file come from the current arena (see arena.h): growing them
+// takes a new block, freeing them gives the large blocks back for the next allocations
+
 static void stack_init(int_stack* stack, int start_capacity)
 {
     stack->top = -1;
     stack->capacity = (start_capacity > 0) ? start_capacity : 1;
-    stack->data = (int*)malloc(stack->capacity * sizeof(int));
-    if (stack->data == NULL)
-    {
-        printf("Error: cannot allocate memory for Tarjan stack\n");
-        exit(EXIT_FAILURE);
-    }
+    stack->arena = current_arena();
+    stack->data = (int*)arena_alloc(stack->arena, (size_t)stack->capacity * sizeof(int));
 }
 
 static void stack_push(int_stack* stack, int value)
@@ -28,13 +29,8 @@ static void stack_push(int_stack* stack, int value)
     if (stack->top + 1 >= stack->capacity)
     {
         int new_capacity = stack->capacity * 2;
-        int* new_data = (int*)realloc(stack->data, new_capacity * sizeof(int));
-        if (new_data == NULL)
-        {
-            printf("Error: cannot grow Tarjan stack\n");
-            exit(EXIT_FAILURE);
-        }
-        stack->data = new_data;
+        stack->data = (int*)arena_realloc(stack->arena, stack->data, (size_t)stack->capacity * sizeof(int),
+                                          (size_t)new_capacity * sizeof(int));
         stack->capacity = new_capacity;
     }
     stack->top++;
@@ -54,7 +50,7 @@ static int stack_pop(int_stack* stack)
 
 static void stack_free(int_stack* stack)
 {
-    free(stack->data);
+    arena_release(stack->arena, stack->data, (size_t)stack->capacity * sizeof(int));
     stack->data = NULL;
     stack->top = -1;
     stack->capacity = 0;
@@ -64,12 +60,8 @@ static void init_partition(t_partition* partition)
 {
     partition->class_count = 0;
     partition->capacity = 4;
-    partition->classes = (t_class*)malloc(partition->capacity * sizeof(t_class));
-    if (partition->classes == NULL)
-    {
-        printf("Error: cannot allocate memory for partition\n");
-        exit(EXIT_FAILURE);
-    }
+    partition->arena = current_arena();
+    partition->classes = (t_class*)arena_alloc(partition->arena, (size_t)partition->capacity * sizeof(t_class));
 }
 
 static void ensure_partition_capacity(t_partition* partition)
@@ -77,29 +69,20 @@ static void ensure_partition_capacity(t_partition* partition)
     if (partition->class_count >= partition->capacity)
     {
         int new_capacity = partition->capacity * 2;
-        t_class* new_classes = (t_class*)realloc(partition->classes, new_capacity * sizeof(t_class));
-        if (new_classes == NULL)
-        {
-            printf("Error: cannot grow partition\n");
-            exit(EXIT_FAILURE);
-        }
-        partition->classes = new_classes;
+        partition->classes = (t_class*)arena_realloc(partition->arena, partition->classes,
+                                                     (size_t)partition->capacity * sizeof(t_class),
+                                                     (size_t)new_capacity * sizeof(t_class));
         partition->capacity = new_capacity;
     }
 }
 
-static void ensure_class_capacity(t_class* cls)
+static void ensure_class_capacity(t_class* cls, t_arena* arena)
 {
     if (cls->member_count >= cls->capacity)
     {
         int new_capacity = cls->capacity * 2;
-        int* new_members = (int*)realloc(cls->members, new_capacity * sizeof(int));
-        if (new_members == NULL)
-        {
-            printf("Error: cannot grow class members\n");
-            exit(EXIT_FAILURE);
-        }
-        cls->members = new_members;
+        cls->members = (int*)arena_realloc(arena, cls->members, (size_t)cls->capacity * sizeof(int),
+                                           (size_t)new_capacity * sizeof(int));
         cls->capacity = new_capacity;
     }
 }
@@ -111,20 +94,15 @@ static int create_class(t_partition* partition)
     t_class* cls = &partition->classes[partition->class_count];
     cls->member_count = 0;
     cls->capacity = 4;
-    cls->members = (int*)malloc(cls->capacity * sizeof(int));
-    if (cls->members == NULL)
-    {
-        printf("Error: cannot allocate class members\n");
-        exit(EXIT_FAILURE);
-    }
+    cls->members = (int*)arena_alloc(partition->arena, (size_t)cls->capacity * sizeof(int));
     snprintf(cls->name, sizeof(cls->name), "C%d", partition->class_count + 1);
     partition->class_count++;
     return partition->class_count - 1;
 }
 
-static void add_member_to_class(t_class* cls, int vertex_number)
+static void add_member_to_class(t_class* cls, int vertex_number, t_arena* arena)
 {
-    ensure_class_capacity(cls);
+    ensure_class_capacity(cls, arena);
     cls->members[cls->member_count] = vertex_number;
     cls->member_count++;
 }
@@ -191,7 +169,7 @@ static void tarjan_visit(int vertex_index,
         {
             popped = stack_pop(stack);
             vertices[popped].on_stack = 0;
-            add_member_to_class(&partition->classes[class_index], popped + 1);
+            add_member_to_class(&partition->classes[class_index], popped + 1, partition->arena);
             vertex_to_class[popped] = class_index;
         } while (popped != vertex_index);
 
@@ -205,19 +183,15 @@ t_partition tarjan_partition_graph(const adjacency_list* graph, int** vertex_to_
     init_partition(&partition);
 
     int vertex_count = graph->num_vertices;
-    t_tarjan_vertex* vertices = (t_tarjan_vertex*)malloc(vertex_count * sizeof(t_tarjan_vertex));
-    if (vertices == NULL)
-    {
-        printf("Error: cannot allocate Tarjan vertices\n");
-        exit(EXIT_FAILURE);
-    }
+    t_tarjan_vertex* vertices = (t_tarjan_vertex*)arena_alloc(partition.arena,
+                                                              (size_t)vertex_count * sizeof(t_tarjan_vertex));
 
+    // Freed with free() by the callers
     *vertex_to_class = (int*)malloc(vertex_count * sizeof(int));
     if (*vertex_to_class == NULL)
     {
-        printf("Error: cannot allocate vertex-to-class array\n");
-        free(vertices);
-        exit(EXIT_FAILURE);
+        arena_release(partition.arena, vertices, (size_t)vertex_count * sizeof(t_tarjan_vertex));
+        fatal_error("cannot allocate vertex-to-class array");
     }
 
     for (int i = 0; i < vertex_count; i++)
@@ -242,28 +216,49 @@ t_partition tarjan_partition_graph(const adjacency_list* graph, int** vertex_to_
     }
 
     stack_free(&stack);
-    free(vertices);
+    arena_release(partition.arena, vertices, (size_t)vertex_count * sizeof(t_tarjan_vertex));
 
     return partition;
 }
 
-void print_partition(const t_partition* partition)
+void print_partition(const t_partition* partition, const t_label_table* labels)
 {
     printf("Strongly connected components:\n");
-    for (int i = 0; i < partition->class_count; i++)
+    if (output_level() == OUTPUT_SUMMARY)
+    {
+        int largest = 0;
+        for (int i = 0; i < partition->class_count; i++)
+        {
+            if (partition->classes[i].member_count > largest)
+            {
+                largest = partition->classes[i].member_count;
+            }
+        }
+        printf("%d components, the largest has %d states\n", partition->class_count, largest);
+    }
+
+    int shown = output_preview(partition->class_count);
+    for (int i = 0; i < shown; i++)
     {
         const t_class* cls = &partition->classes[i];
         printf("Component %s: {", cls->name);
-        for (int j = 0; j < cls->member_count; j++)
+        int shown_members = output_preview(cls->member_count);
+        for (int j = 0; j < shown_members; j++)
         {
-            printf("%d", cls->members[j]);
+            char buffer[STATE_LABEL_SIZE];
+            printf("%s", state_label(labels, cls->members[j], buffer));
             if (j < cls->member_count - 1)
             {
                 printf(", ");
             }
         }
+        if (shown_members < cls->member_count)
+        {
+            printf("... (%d states)", cls->member_count);
+        }
         printf("}\n");
     }
+    print_omitted(shown, partition->class_count, "components");
     printf("\n");
 }
 
@@ -273,17 +268,19 @@ void free_partition(t_partition* partition)
     {
         return;
     }
-    for (int i = 0; i < partition->class_count; i++)
+    // The members of an arena partition are freed with the arena
+    for (int i = 0; partition->arena == NULL && i < partition->class_count; i++)
     {
         free(partition->classes[i].members);
         partition->classes[i].members = NULL;
         partition->classes[i].member_count = 0;
         partition->classes[i].capacity = 0;
     }
-    free(partition->classes);
+    arena_release(partition->arena, partition->classes, (size_t)partition->capacity * sizeof(t_class));
     partition->classes = NULL;
     partition->class_count = 0;
     partition->capacity = 0;
+    partition->arena = NULL;
 }
 
 static void ensure_link_capacity(t_link_array* link_array)
@@ -291,13 +288,9 @@ static void ensure_link_capacity(t_link_array* link_array)
     if (link_array->size >= link_array->capacity)
     {
         int new_capacity = link_array->capacity * 2;
-        t_link* new_links = (t_link*)realloc(link_array->links, new_capacity * sizeof(t_link));
-        if (new_links == NULL)
-        {
-            printf("Error: cannot grow link array\n");
-            exit(EXIT_FAILURE);
-        }
-        link_array->links = new_links;
+        link_array->links = (t_link*)arena_realloc(link_array->arena, link_array->links,
+                                                   (size_t)link_array->capacity * sizeof(t_link),
+                                                   (size_t)new_capacity * sizeof(t_link));
         link_array->capacity = new_capacity;
     }
 }
@@ -321,12 +314,8 @@ t_link_array build_link_array(const t_partition* partition, const adjacency_list
     t_link_array link_array;
     link_array.size = 0;
     link_array.capacity = 8;
-    link_array.links = (t_link*)malloc(link_array.capacity * sizeof(t_link));
-    if (link_array.links == NULL)
-    {
-        printf("Error: cannot allocate link array\n");
-        exit(EXIT_FAILURE);
-    }
+    link_array.arena = current_arena();
+    link_array.links = (t_link*)arena_alloc(link_array.arena, (size_t)link_array.capacity * sizeof(t_link));
 
     for (int vertex = 0; vertex < graph->num_vertices; vertex++)
     {
@@ -358,12 +347,8 @@ t_link_array clone_link_array(const t_link_array* source)
     t_link_array clone;
     clone.size = source->size;
     clone.capacity = source->capacity;
-    clone.links = (t_link*)malloc(clone.capacity * sizeof(t_link));
-    if (clone.links == NULL)
-    {
-        printf("Error: cannot clone link array\n");
-        exit(EXIT_FAILURE);
-    }
+    clone.arena = current_arena();
+    clone.links = (t_link*)arena_alloc(clone.arena, (size_t)clone.capacity * sizeof(t_link));
     for (int i = 0; i < source->size; i++)
     {
         clone.links[i] = source->links[i];
@@ -373,10 +358,11 @@ t_link_array clone_link_array(const t_link_array* source)
 
 void free_link_array(t_link_array* link_array)
 {
-    free(link_array->links);
+    arena_release(link_array->arena, link_array->links, (size_t)link_array->capacity * sizeof(t_link));
     link_array->links = NULL;
     link_array->size = 0;
     link_array->capacity = 0;
+    link_array->arena = NULL;
 }
 
 void print_link_array(const t_link_array* link_array, const t_partition* partition)
@@ -388,7 +374,12 @@ void print_link_array(const t_link_array* link_array, const t_partition* partiti
     }
 
     printf("Links between classes:\n");
-    for (int i = 0; i < link_array->size; i++)
+    if (output_level() == OUTPUT_SUMMARY)
+    {
+        printf("%d links\n", link_array->size);
+    }
+    int shown = output_preview(link_array->size);
+    for (int i = 0; i < shown; i++)
     {
         int from = link_array->links[i].from;
         int to = link_array->links[i].to;
@@ -396,16 +387,18 @@ void print_link_array(const t_link_array* link_array, const t_partition* partiti
                partition->classes[from].name,
                partition->classes[to].name);
     }
+    print_omitted(shown, link_array->size, "links");
     printf("\n");
 }
 
-void export_hasse_mermaid(const t_partition* partition, const t_link_array* link_array, const char* filename)
+int export_hasse_mermaid(const t_partition* partition, const t_link_array* link_array, const char* filename,
+                         const t_label_table* labels)
 {
     FILE* file = fopen(filename, "wt");
     if (file == NULL)
     {
         printf("Error: cannot open '%s' for writing.\n", filename);
-        return;
+        return -1;
     }
 
     fprintf(file, "flowchart LR\n");
@@ -415,7 +408,8 @@ void export_hasse_mermaid(const t_partition* partition, const t_link_array* link
         fprintf(file, "%s[\"%s {", cls->name, cls->name);
         for (int j = 0; j < cls->member_count; j++)
         {
-            fprintf(file, "%d", cls->members[j]);
+            char buffer[STATE_LABEL_SIZE];
+            fprintf(file, "%s", state_label(labels, cls->members[j], buffer));
             if (j < cls->member_count - 1)
             {
                 fprintf(file, ",");
@@ -434,7 +428,50 @@ void export_hasse_mermaid(const t_partition* partition, const t_link_array* link
     }
 
     fclose(file);
-    printf("Hasse diagram saved in '%s'\n", filename);
+    return 0;
+}
+
+int export_hasse_dot(const t_partition* partition, const t_link_array* link_array, const char* filename,
+                     const t_label_table* labels)
+{
+    FILE* file = fopen(filename, "wt");
+    if (file == NULL)
+    {
+        printf("Error: cannot open '%s' for writing.\n", filename);
+        return -1;
+    }
+
+    fprintf(file, "digraph classes {\n");
+    fprintf(file, "  rankdir=LR;\n");
+    fprintf(file, "  node [shape=box];\n");
+    for (int i = 0; i < partition->class_count; i++)
+    {
+        const t_class* cls = &partition->classes[i];
+        fprintf(file, "  %s [label=\"%s {", cls->name, cls->name);
+        for (int j = 0; j < cls->member_count; j++)
+        {
+            char buffer[STATE_LABEL_SIZE];
+            fprintf(file, "%s", state_label(labels, cls->members[j], buffer));
+            if (j < cls->member_count - 1)
+            {
+                fprintf(file, ",");
+            }
+        }
+        fprintf(file, "}\"];\n");
+    }
+
+    for (int i = 0; i < link_array->size; i++)
+    {
+        int from = link_array->links[i].from;
+        int to = link_array->links[i].to;
+        fprintf(file, "  %s -> %s;\n",
+                partition->classes[from].name,
+                partition->classes[to].name);
+    }
+
+    fprintf(file, "}\n");
+    fclose(file);
+    return 0;
 }
 
 graph_characteristics compute_graph_characteristics(const t_partition* partition, const t_link_array* link_array)
@@ -443,8 +480,7 @@ graph_characteristics compute_graph_characteristics(const t_partition* partition
     characteristics.class_is_persistent = (int*)malloc(partition->class_count * sizeof(int));
     if (characteristics.class_is_persistent == NULL)
     {
-        printf("Error: cannot allocate characteristics array\n");
-        exit(EXIT_FAILURE);
+        fatal_error("cannot allocate characteristics array");
     }
 
     for (int i = 0; i < partition->class_count; i++)
@@ -472,29 +508,59 @@ graph_characteristics compute_graph_characteristics(const t_partition* partition
     return characteristics;
 }
 
-void print_graph_characteristics(const t_partition* partition, const graph_characteristics* characteristics)
+void print_graph_characteristics(const t_partition* partition, const graph_characteristics* characteristics,
+                                 const t_label_table* labels)
 {
     printf("Class properties:\n");
+    int persistent_count = 0;
+    int absorbing_count = 0;
     for (int i = 0; i < partition->class_count; i++)
+    {
+        if (characteristics->class_is_persistent[i])
+        {
+            persistent_count++;
+            if (partition->classes[i].member_count == 1)
+            {
+                absorbing_count++;
+            }
+        }
+    }
+    if (output_level() == OUTPUT_SUMMARY)
+    {
+        printf("%d persistent classes, %d transient classes\n",
+               persistent_count, partition->class_count - persistent_count);
+    }
+    int shown = output_preview(partition->class_count);
+    for (int i = 0; i < shown; i++)
     {
         printf("- %s is %s\n",
                partition->classes[i].name,
                characteristics->class_is_persistent[i] ? "persistent" : "transient");
     }
+    print_omitted(shown, partition->class_count, "classes");
     printf("\n");
 
     if (characteristics->has_absorbing_state)
     {
         printf("Absorbing states:\n");
-        for (int i = 0; i < partition->class_count; i++)
+        if (output_level() == OUTPUT_SUMMARY)
+        {
+            printf("%d absorbing states\n", absorbing_count);
+        }
+        int shown_absorbing = output_preview(absorbing_count);
+        int printed = 0;
+        for (int i = 0; i < partition->class_count && printed < shown_absorbing; i++)
         {
             if (characteristics->class_is_persistent[i] && partition->classes[i].member_count == 1)
             {
-                printf("* State %d (class %s)\n",
-                       partition->classes[i].members[0],
+                char buffer[STATE_LABEL_SIZE];
+                printf("* State %s (class %s)\n",
+                       state_label(labels, partition->classes[i].members[0], buffer),
                        partition->classes[i].name);
+                printed++;
             }
         }
+        print_omitted(printed, absorbing_count, "absorbing states");
     }
     else
     {
@@ -14,7 +14,7 @@ typedef struct
 
 typedef struct
 {
-    char name[8];
+    char name[16];             // "C" and the class number (any int fits)
     int* members;
     int member_count;
     int capacity;
@@ -25,6 +25,7 @@ typedef struct
     t_class* classes;
     int class_count;
     int capacity;
+    t_arena* arena;            // Arena of the classes and their members (NULL: malloc)
 } t_partition;
 
 typedef struct
@@ -35,17 +36,22 @@ typedef struct
 } graph_characteristics;
 
 t_partition tarjan_partition_graph(const adjacency_list* graph, int** vertex_to_class);
-void print_partition(const t_partition* partition);
+void print_partition(const t_partition* partition, const t_label_table* labels);
 void free_partition(t_partition* partition);
 
 t_link_array build_link_array(const t_partition* partition, const adjacency_list* graph, const int* vertex_to_class);
 t_link_array clone_link_array(const t_link_array* source);
 void free_link_array(t_link_array* link_array);
 void print_link_array(const t_link_array* link_array, const t_partition* partition);
-void export_hasse_mermaid(const t_partition* partition, const t_link_array* link_array, const char* filename);
+// The members are written with their names if labels is not NULL
+int export_hasse_mermaid(const t_partition* partition, const t_link_array* link_array, const char* filename,
+                         const t_label_table* labels);
+int export_hasse_dot(const t_partition* partition, const t_link_array* link_array, const char* filename,
+                     const t_label_table* labels);
 
 graph_characteristics compute_graph_characteristics(const t_partition* partition, const t_link_array* link_array);
-void print_graph_characteristics(const t_partition* partition, const graph_characteristics* characteristics);
+void print_graph_characteristics(const t_partition* partition, const graph_characteristics* characteristics,
+                                 const t_label_table* labels);
 void free_graph_characteristics(graph_characteristics* characteristics);
 
 #endif
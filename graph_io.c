@@ -0,0 +1,763 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+#include <stdarg.h>
+
+#include "graph_io.h"
+
+// Size of the buffer of the written files
+#define GRAPH_OUTPUT_BUFFER ((size_t)1 << 20)
+
+// Longest attribute value read as a number in a DOT file
+#define DOT_NUMBER_LENGTH 64
+
+// Largest node ID of a DOT file without --labels: the IDs are the state numbers, so the graph
+// gets as many states as the largest one (other IDs need --labels, which numbers the nodes seen)
+#define DOT_MAX_STATE (1 << 24)
+
+// Edge of a DOT file, kept until the whole file is read (the missing probabilities need the out-degrees)
+typedef struct
+{
+    int from;
+    int to;
+    float probability;
+    int has_probability;
+} t_parsed_edge;
+
+static void parse_error(const char* filename, const t_scanner* scanner, const char* format, ...)
+{
+    char message[256];
+    va_list arguments;
+    va_start(arguments, format);
+    vsnprintf(message, sizeof(message), format, arguments);
+    va_end(arguments);
+    fatal_error("%s, line %d: %s", filename, scanner->line, message);
+}
+
+// Same for an error found after the scanner went past the end of the line (line where it started)
+static void parse_error_at(const char* filename, int line, const char* message)
+{
+    fatal_error("%s, line %d: %s", filename, line, message);
+}
+
+// Case-insensitive comparison of a word of the file with an expected keyword
+static int word_is(const char* word, size_t length, const char* expected)
+{
+    size_t expected_length = strlen(expected);
+    if (length != expected_length)
+    {
+        return 0;
+    }
+    for (size_t i = 0; i < length; i++)
+    {
+        if (tolower((unsigned char)word[i]) != expected[i])
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int has_extension(const char* filename, const char* extension)
+{
+    const char* dot = strrchr(filename, '.');
+    return dot != NULL && word_is(dot, strlen(dot), extension);
+}
+
+adjacency_list read_graph_scanner(t_scanner* scanner, const char* filename, int intern_labels)
+{
+    // The format comes from the extension: .mtx (Matrix Market), .dot / .gv (Graphviz),
+    // anything else is the native format (number of vertices, then "start end probability" lines)
+    switch (graph_format_of(filename))
+    {
+        case GRAPH_FORMAT_MATRIX_MARKET:
+            return read_matrix_market(scanner, filename);
+        case GRAPH_FORMAT_DOT:
+            return read_dot_graph(scanner, filename, intern_labels);
+        default:
+            return intern_labels ? read_labeled_edge_list(scanner, filename) : read_edge_list(scanner, filename);
+    }
+}
+
+t_graph_format graph_format_of(const char* filename)
+{
+    if (has_extension(filename, ".mtx"))
+    {
+        return GRAPH_FORMAT_MATRIX_MARKET;
+    }
+    if (has_extension(filename, ".dot") || has_extension(filename, ".gv"))
+    {
+        return GRAPH_FORMAT_DOT;
+    }
+    return GRAPH_FORMAT_EDGE_LIST;
+}
+
+adjacency_list read_edge_list(t_scanner* scanner, const char* filename)
+{
+    int num_vertices;
+    int start, end;
+    float proba;
+
+    // Read the first line: number of vertices
+    if (!scan_int(scanner, &num_vertices) || num_vertices < 0)
+    {
+        parse_error(filename, scanner, "could not read the number of vertices");
+    }
+
+    // Create an empty adjacency list with the correct number of vertices
+    adjacency_list adj_list = create_empty_adjacency_list(num_vertices);
+
+    // Read each edge: start_vertex end_vertex probability
+    while (scan_int(scanner, &start) && scan_int(scanner, &end) && scan_float(scanner, &proba))
+    {
+        if (start < 1 || start > num_vertices || end < 1 || end > num_vertices)
+        {
+            parse_error(filename, scanner, "edge %d -> %d outside of the states 1..%d (use --labels for other state IDs)",
+                        start, end, num_vertices);
+        }
+        // Note: vertices in file are 1-based, arrays are 0-based, so we use start-1
+        add_cell_to_list(&(adj_list.lists[start - 1]), end, proba);
+    }
+
+    return adj_list;
+}
+
+static void add_parsed_edge(t_arena* arena, t_parsed_edge** edges, long* count, long* capacity, t_parsed_edge edge);
+
+adjacency_list read_labeled_edge_list(t_scanner* scanner, const char* filename)
+{
+    // The scratch arrays come from the current arena too: a parse error leaves nothing behind
+    t_arena* arena = current_arena();
+    t_label_table* labels = create_label_table();
+    t_parsed_edge* edges = NULL;
+    long edge_count = 0;
+    long edge_capacity = 0;
+
+    // Optional first line with the number of states only
+    skip_spaces(scanner);
+    const char* line_start = scanner->cursor;
+    int line = scanner->line;
+    const char* token;
+    scan_token(scanner, &token);
+    skip_blanks(scanner);
+    if (scanner->cursor < scanner->end && *scanner->cursor != '\n')
+    {
+        scanner->cursor = line_start;
+        scanner->line = line;
+    }
+
+    for (;;)
+    {
+        const char* from;
+        const char* to;
+        skip_spaces(scanner);
+        int edge_line = scanner->line;  // A short line is only noticed on the next one
+        size_t from_length = scan_token(scanner, &from);
+        if (from_length == 0)
+        {
+            break;
+        }
+        size_t to_length = scan_token(scanner, &to);
+        float probability;
+        if (to_length == 0 || !scan_float(scanner, &probability))
+        {
+            parse_error_at(filename, edge_line, "expected \"from to probability\"");
+        }
+        t_parsed_edge edge = {intern_label(labels, from, from_length), intern_label(labels, to, to_length),
+                              probability, 1};
+        add_parsed_edge(arena, &edges, &edge_count, &edge_capacity, edge);
+    }
+
+    adjacency_list adj_list = create_empty_adjacency_list(labels->count);
+    for (long e = 0; e < edge_count; e++)
+    {
+        add_cell_to_list(&adj_list.lists[edges[e].from - 1], edges[e].to, edges[e].probability);
+    }
+    adj_list.labels = labels;
+    arena_release(arena, edges, (size_t)edge_capacity * sizeof(t_parsed_edge));
+    return adj_list;
+}
+
+adjacency_list read_matrix_market(t_scanner* scanner, const char* filename)
+{
+    // Banner: %%MatrixMarket matrix coordinate <field> <symmetry>
+    const char* banner = "%%MatrixMarket";
+    if (strncmp(scanner->cursor, banner, strlen(banner)) != 0)
+    {
+        parse_error(filename, scanner, "missing %%%%MatrixMarket banner");
+    }
+    scanner->cursor += strlen(banner);
+
+    const char* words[4];
+    size_t lengths[4];
+    for (int w = 0; w < 4; w++)
+    {
+        skip_blanks(scanner);
+        lengths[w] = scan_word(scanner, &words[w]);
+    }
+    if (!word_is(words[0], lengths[0], "matrix") || !word_is(words[1], lengths[1], "coordinate"))
+    {
+        parse_error(filename, scanner, "only coordinate matrices are supported");
+    }
+    int pattern = word_is(words[2], lengths[2], "pattern");
+    if (!pattern && !word_is(words[2], lengths[2], "real") && !word_is(words[2], lengths[2], "integer") &&
+        !word_is(words[2], lengths[2], "double"))
+    {
+        parse_error(filename, scanner, "the values must be real, integer or pattern");
+    }
+    int symmetric = word_is(words[3], lengths[3], "symmetric");
+    if (!symmetric && !word_is(words[3], lengths[3], "general"))
+    {
+        parse_error(filename, scanner, "the matrix must be general or symmetric");
+    }
+    skip_line(scanner);
+
+    // Comment lines
+    skip_spaces(scanner);
+    while (scanner->cursor < scanner->end && *scanner->cursor == '%')
+    {
+        skip_line(scanner);
+        skip_spaces(scanner);
+    }
+
+    long rows, columns, entry_count;
+    if (!scan_long(scanner, &rows) || !scan_long(scanner, &columns) || !scan_long(scanner, &entry_count))
+    {
+        parse_error(filename, scanner, "could not read the size line");
+    }
+    if (rows != columns || rows < 0 || rows > INT_MAX || entry_count < 0)
+    {
+        parse_error(filename, scanner, "a transition matrix must be square");
+    }
+
+    int num_vertices = (int)rows;
+    adjacency_list adj_list = create_empty_adjacency_list(num_vertices);
+    for (long k = 0; k < entry_count; k++)
+    {
+        int from, to;
+        float value = 1.0f;
+        skip_spaces(scanner);
+        int entry_line = scanner->line;
+        if (!scan_int(scanner, &from) || !scan_int(scanner, &to) || (!pattern && !scan_float(scanner, &value)))
+        {
+            parse_error_at(filename, entry_line, "missing or malformed entry");
+        }
+        if (from < 1 || from > num_vertices || to < 1 || to > num_vertices)
+        {
+            parse_error_at(filename, entry_line, "entry outside of the matrix");
+        }
+        add_cell_to_list(&adj_list.lists[from - 1], to, value);
+        if (symmetric && from != to)
+        {
+            add_cell_to_list(&adj_list.lists[to - 1], from, value);
+        }
+    }
+
+    // Pattern matrix: uniform random walk on the edges
+    for (int v = 0; pattern && v < num_vertices; v++)
+    {
+        int degree = 0;
+        for (cell* current = adj_list.lists[v].head; current != NULL; current = current->next)
+        {
+            degree++;
+        }
+        for (cell* current = adj_list.lists[v].head; current != NULL; current = current->next)
+        {
+            current->probability = 1.0f / (float)degree;
+        }
+    }
+
+    return adj_list;
+}
+
+// Spaces and comments of a DOT file (//, /* */ and # lines)
+static void skip_dot_spaces(t_scanner* scanner, const char* filename)
+{
+    for (;;)
+    {
+        skip_spaces(scanner);
+        const char* c = scanner->cursor;
+        if (c + 1 < scanner->end && c[0] == '/' && c[1] == '*')
+        {
+            const char* close = strstr(c + 2, "*/");
+            if (close == NULL)
+            {
+                parse_error(filename, scanner, "unterminated comment");
+            }
+            for (; c < close; c++)
+            {
+                scanner->line += (*c == '\n');
+            }
+            scanner->cursor = close + 2;
+        }
+        else if (c < scanner->end && (*c == '#' || (c + 1 < scanner->end && c[0] == '/' && c[1] == '/')))
+        {
+            skip_line(scanner);
+        }
+        else
+        {
+            return;
+        }
+    }
+}
+
+// State number of a DOT node ID (interned if labels is not NULL)
+static int dot_state(t_scanner* scanner, const char* filename, t_label_table* labels, const char* word, size_t length)
+{
+    if (length > 0 && labels != NULL)
+    {
+        return intern_label(labels, word, length);
+    }
+    if (length == 0 || length > 9)
+    {
+        parse_error(filename, scanner, "node IDs must be state numbers (use --labels for names)");
+    }
+    int state = 0;
+    for (size_t i = 0; i < length; i++)
+    {
+        if (!isdigit((unsigned char)word[i]))
+        {
+            parse_error(filename, scanner, "node IDs must be state numbers (use --labels for names)");
+        }
+        state = state * 10 + (word[i] - '0');
+    }
+    if (state < 1)
+    {
+        parse_error(filename, scanner, "state numbers start at 1");
+    }
+    if (state > DOT_MAX_STATE)
+    {
+        parse_error(filename, scanner, "state %d above %d (use --labels for other state IDs)", state, DOT_MAX_STATE);
+    }
+    return state;
+}
+
+// Attribute lists [a=b, c="d"] ...; the probability is taken from prob, label or weight (in that order)
+static void parse_dot_attributes(t_scanner* scanner, const char* filename, float* probability, int* has_probability)
+{
+    int priority = 0;
+    skip_dot_spaces(scanner, filename);
+    while (scan_char(scanner, '['))
+    {
+        for (;;)
+        {
+            skip_dot_spaces(scanner, filename);
+            if (scan_char(scanner, ']'))
+            {
+                break;
+            }
+            if (scan_char(scanner, ',') || scan_char(scanner, ';'))
+            {
+                continue;
+            }
+
+            const char* key;
+            size_t key_length = scan_word(scanner, &key);
+            skip_dot_spaces(scanner, filename);
+            if (key_length == 0 || !scan_char(scanner, '='))
+            {
+                parse_error(filename, scanner, "malformed attribute list");
+            }
+            skip_dot_spaces(scanner, filename);
+            const char* value;
+            size_t value_length = scan_word(scanner, &value);
+
+            int key_priority = 0;
+            if (word_is(key, key_length, "prob") || word_is(key, key_length, "probability"))
+            {
+                key_priority = 3;
+            }
+            else if (word_is(key, key_length, "label"))
+            {
+                key_priority = 2;
+            }
+            else if (word_is(key, key_length, "weight"))
+            {
+                key_priority = 1;
+            }
+
+            // Only values that are a number as a whole count
+            if (key_priority > priority && value_length > 0 && value_length < DOT_NUMBER_LENGTH)
+            {
+                char number[DOT_NUMBER_LENGTH];
+                memcpy(number, value, value_length);
+                number[value_length] = '\0';
+                char* number_end;
+                float parsed = strtof(number, &number_end);
+                if (*number_end == '\0')
+                {
+                    *probability = parsed;
+                    *has_probability = 1;
+                    priority = key_priority;
+                }
+            }
+        }
+        skip_dot_spaces(scanner, filename);
+    }
+}
+
+static void add_parsed_edge(t_arena* arena, t_parsed_edge** edges, long* count, long* capacity, t_parsed_edge edge)
+{
+    if (*count == *capacity)
+    {
+        long grown = (*capacity > 0) ? *capacity * 2 : 1024;
+        *edges = (t_parsed_edge*)arena_realloc(arena, *edges, (size_t)*capacity * sizeof(t_parsed_edge),
+                                               (size_t)grown * sizeof(t_parsed_edge));
+        *capacity = grown;
+    }
+    (*edges)[(*count)++] = edge;
+}
+
+adjacency_list read_dot_graph(t_scanner* scanner, const char* filename, int intern_labels)
+{
+    t_arena* arena = current_arena();  // Labels and scratch arrays, as in read_labeled_edge_list
+    t_label_table* labels = intern_labels ? create_label_table() : NULL;
+
+    // Header: [strict] digraph|graph [name] {
+    const char* word;
+    size_t length;
+    skip_dot_spaces(scanner, filename);
+    length = scan_word(scanner, &word);
+    if (word_is(word, length, "strict"))
+    {
+        skip_dot_spaces(scanner, filename);
+        length = scan_word(scanner, &word);
+    }
+    int directed = word_is(word, length, "digraph");
+    if (!directed && !word_is(word, length, "graph"))
+    {
+        parse_error(filename, scanner, "expected 'digraph' or 'graph'");
+    }
+    skip_dot_spaces(scanner, filename);
+    if (!scan_char(scanner, '{'))
+    {
+        scan_word(scanner, &word);
+        skip_dot_spaces(scanner, filename);
+        if (!scan_char(scanner, '{'))
+        {
+            parse_error(filename, scanner, "expected '{'");
+        }
+    }
+
+    // Edges of the file and the largest state number
+    t_parsed_edge* edges = NULL;
+    long edge_count = 0;
+    long edge_capacity = 0;
+    int num_vertices = 0;
+
+    // States of an edge chain a -> b -> c
+    int* chain = NULL;
+    int chain_capacity = 0;
+
+    for (;;)
+    {
+        skip_dot_spaces(scanner, filename);
+        if (scan_char(scanner, '}'))
+        {
+            break;
+        }
+        if (scanner->cursor >= scanner->end)
+        {
+            parse_error(filename, scanner, "missing '}'");
+        }
+        if (scan_char(scanner, ';') || scan_char(scanner, ','))
+        {
+            continue;
+        }
+
+        length = scan_word(scanner, &word);
+        if (length == 0 || word_is(word, length, "subgraph"))
+        {
+            parse_error(filename, scanner, "unsupported statement (subgraphs are not supported)");
+        }
+
+        // Default attributes: node [...], edge [...], graph [...]
+        float probability = 0.0f;
+        int has_probability = 0;
+        if (word_is(word, length, "node") || word_is(word, length, "edge") || word_is(word, length, "graph"))
+        {
+            parse_dot_attributes(scanner, filename, &probability, &has_probability);
+            continue;
+        }
+
+        // Graph attribute: name = value
+        skip_dot_spaces(scanner, filename);
+        if (scan_char(scanner, '='))
+        {
+            skip_dot_spaces(scanner, filename);
+            scan_word(scanner, &word);
+            continue;
+        }
+
+        // Node statement or edge chain
+        int chain_length = 0;
+        int state = dot_state(scanner, filename, labels, word, length);
+        for (;;)
+        {
+            if (chain_length == chain_capacity)
+            {
+                int grown = (chain_capacity > 0) ? chain_capacity * 2 : 16;
+                chain = (int*)arena_realloc(arena, chain, (size_t)chain_capacity * sizeof(int),
+                                            (size_t)grown * sizeof(int));
+                chain_capacity = grown;
+            }
+            chain[chain_length++] = state;
+            if (state > num_vertices)
+            {
+                num_vertices = state;
+            }
+
+            skip_dot_spaces(scanner, filename);
+            const char* c = scanner->cursor;
+            if (c + 1 >= scanner->end || c[0] != '-' || (c[1] != '>' && c[1] != '-'))
+            {
+                break;
+            }
+            if ((c[1] == '>') != directed)
+            {
+                parse_error(filename, scanner, directed ? "use '->' in a digraph" : "use '--' in a graph");
+            }
+            scanner->cursor += 2;
+            skip_dot_spaces(scanner, filename);
+            length = scan_word(scanner, &word);
+            state = dot_state(scanner, filename, labels, word, length);
+        }
+
+        parse_dot_attributes(scanner, filename, &probability, &has_probability);
+        for (int k = 0; k + 1 < chain_length; k++)
+        {
+            t_parsed_edge edge = {chain[k], chain[k + 1], probability, has_probability};
+            add_parsed_edge(arena, &edges, &edge_count, &edge_capacity, edge);
+            if (!directed && chain[k] != chain[k + 1])
+            {
+                t_parsed_edge back = {chain[k + 1], chain[k], probability, has_probability};
+                add_parsed_edge(arena, &edges, &edge_count, &edge_capacity, back);
+            }
+        }
+    }
+    arena_release(arena, chain, (size_t)chain_capacity * sizeof(int));
+
+    // Edges without a probability share what the other edges of their state leave
+    float* given_mass = (float*)arena_alloc(arena, ((size_t)num_vertices + 1) * sizeof(float));
+    int* missing = (int*)arena_alloc(arena, ((size_t)num_vertices + 1) * sizeof(int));
+    memset(given_mass, 0, ((size_t)num_vertices + 1) * sizeof(float));
+    memset(missing, 0, ((size_t)num_vertices + 1) * sizeof(int));
+    for (long e = 0; e < edge_count; e++)
+    {
+        if (edges[e].has_probability)
+        {
+            given_mass[edges[e].from] += edges[e].probability;
+        }
+        else
+        {
+            missing[edges[e].from]++;
+        }
+    }
+
+    adjacency_list adj_list = create_empty_adjacency_list(num_vertices);
+    for (long e = 0; e < edge_count; e++)
+    {
+        float probability = edges[e].probability;
+        if (!edges[e].has_probability)
+        {
+            float remaining = 1.0f - given_mass[edges[e].from];
+            probability = (remaining > 0.0f ? remaining : 0.0f) / (float)missing[edges[e].from];
+        }
+        add_cell_to_list(&adj_list.lists[edges[e].from - 1], edges[e].to, probability);
+    }
+    adj_list.labels = labels;
+
+    arena_release(arena, given_mass, ((size_t)num_vertices + 1) * sizeof(float));
+    arena_release(arena, missing, ((size_t)num_vertices + 1) * sizeof(int));
+    arena_release(arena, edges, (size_t)edge_capacity * sizeof(t_parsed_edge));
+    return adj_list;
+}
+
+// Shortest representation that reads back the same float
+static void format_float(char* buffer, size_t size, float value)
+{
+    for (int precision = 6; precision < 9; precision++)
+    {
+        snprintf(buffer, size, "%.*g", precision, value);
+        if (strtof(buffer, NULL) == value)
+        {
+            return;
+        }
+    }
+    snprintf(buffer, size, "%.9g", value);
+}
+
+// The lists hold the edges in reverse file order: they are written back in file order
+// (cells is a scratch array grown as needed, returns the number of cells of the list)
+static int collect_cells(list lst, const cell*** cells, int* capacity)
+{
+    int count = 0;
+    for (const cell* current = lst.head; current != NULL; current = current->next)
+    {
+        if (count == *capacity)
+        {
+            *capacity = (*capacity > 0) ? *capacity * 2 : 64;
+            *cells = (const cell**)realloc((void*)*cells, (size_t)*capacity * sizeof(cell*));
+            if (*cells == NULL)
+            {
+                fatal_error("Could not allocate memory for the edges");
+            }
+        }
+        (*cells)[count++] = current;
+    }
+    return count;
+}
+
+static long count_edges(adjacency_list adj_list)
+{
+    long edge_count = 0;
+    for (int v = 0; v < adj_list.num_vertices; v++)
+    {
+        for (const cell* current = adj_list.lists[v].head; current != NULL; current = current->next)
+        {
+            edge_count++;
+        }
+    }
+    return edge_count;
+}
+
+static FILE* open_output(const char* filename)
+{
+    FILE* file = fopen(filename, "wt");
+    if (file == NULL)
+    {
+        printf("Error: cannot open '%s' for writing.\n", filename);
+        return NULL;
+    }
+    setvbuf(file, NULL, _IOFBF, GRAPH_OUTPUT_BUFFER);
+    return file;
+}
+
+static int close_output(FILE* file, const char* filename)
+{
+    if (ferror(file) | fclose(file))
+    {
+        printf("Error: cannot write to '%s'.\n", filename);
+        return -1;
+    }
+    return 0;
+}
+
+// Writes the name of a state: its number, or its label (between quotes if asked or if it has spaces)
+static void write_state(FILE* file, const t_label_table* labels, int state, int quote)
+{
+    char buffer[STATE_LABEL_SIZE];
+    const char* name = state_label(labels, state, buffer);
+    if (labels != NULL && !quote)
+    {
+        quote = (strpbrk(name, " \t\"") != NULL);
+    }
+    if (labels == NULL || !quote)
+    {
+        fputs(name, file);
+        return;
+    }
+    fputc('"', file);
+    for (const char* c = name; *c != '\0'; c++)
+    {
+        if (*c == '"' || *c == '\\')
+        {
+            fputc('\\', file);
+        }
+        fputc(*c, file);
+    }
+    fputc('"', file);
+}
+
+// Writes every edge in file order: "from to probability" lines, or DOT edge statements
+static void write_edges(FILE* file, adjacency_list adj_list, const t_label_table* labels, int dot)
+{
+    const cell** cells = NULL;
+    int capacity = 0;
+    char probability[32];
+    for (int v = 0; v < adj_list.num_vertices; v++)
+    {
+        int count = collect_cells(adj_list.lists[v], &cells, &capacity);
+        for (int k = count - 1; k >= 0; k--)
+        {
+            format_float(probability, sizeof(probability), cells[k]->probability);
+            fputs(dot ? "  " : "", file);
+            write_state(file, labels, v + 1, dot);
+            fputs(dot ? " -> " : " ", file);
+            write_state(file, labels, cells[k]->arrival_vertex, dot);
+            if (dot)
+            {
+                fprintf(file, " [label=\"%s\"];\n", probability);
+            }
+            else
+            {
+                fprintf(file, " %s\n", probability);
+            }
+        }
+    }
+    free((void*)cells);
+}
+
+int write_edge_list(adjacency_list adj_list, const char* filename)
+{
+    FILE* file = open_output(filename);
+    if (file == NULL)
+    {
+        return -1;
+    }
+    fprintf(file, "%d\n", adj_list.num_vertices);
+    write_edges(file, adj_list, adj_list.labels, 0);
+    return close_output(file, filename);
+}
+
+int write_matrix_market(adjacency_list adj_list, const char* filename)
+{
+    FILE* file = open_output(filename);
+    if (file == NULL)
+    {
+        return -1;
+    }
+    fprintf(file, "%%%%MatrixMarket matrix coordinate real general\n");
+    fprintf(file, "%% Markov graph: row = from state, column = to state, value = probability\n");
+    fprintf(file, "%d %d %ld\n", adj_list.num_vertices, adj_list.num_vertices, count_edges(adj_list));
+    write_edges(file, adj_list, NULL, 0);
+    return close_output(file, filename);
+}
+
+int write_dot_graph(adjacency_list adj_list, const char* filename)
+{
+    FILE* file = open_output(filename);
+    if (file == NULL)
+    {
+        return -1;
+    }
+    fprintf(file, "digraph markov {\n");
+    fprintf(file, "  rankdir=LR;\n");
+    fprintf(file, "  node [shape=circle];\n");
+
+    // Every state is declared, so that the states without edges are kept
+    for (int v = 1; v <= adj_list.num_vertices; v++)
+    {
+        fputs("  ", file);
+        write_state(file, adj_list.labels, v, 1);
+        fputs(";\n", file);
+    }
+    write_edges(file, adj_list, adj_list.labels, 1);
+    fprintf(file, "}\n");
+    return close_output(file, filename);
+}
+
+int write_graph_file(adjacency_list adj_list, const char* filename)
+{
+    switch (graph_format_of(filename))
+    {
+        case GRAPH_FORMAT_MATRIX_MARKET:
+            return write_matrix_market(adj_list, filename);
+        case GRAPH_FORMAT_DOT:
+            return write_dot_graph(adj_list, filename);
+        default:
+            return write_edge_list(adj_list, filename);
+    }
+}
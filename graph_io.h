@@ -0,0 +1,53 @@
+#ifndef GRAPH_IO_H
+#define GRAPH_IO_H
+
+#include "utils.h"
+#include "scanner.h"
+
+// Format of a graph file, chosen from its extension
+typedef enum
+{
+    GRAPH_FORMAT_EDGE_LIST,      // Native format: number of states, then "from to probability" lines
+    GRAPH_FORMAT_MATRIX_MARKET,  // .mtx: coordinate matrix, row = from state, column = to state
+    GRAPH_FORMAT_DOT             // .dot / .gv: Graphviz digraph
+} t_graph_format;
+
+// Function to get the format of a file from its extension (native format if unknown)
+t_graph_format graph_format_of(const char* filename);
+
+// Functions to build the graph from a file already loaded in a scanner
+// Errors (malformed file, state out of range) are fatal (fatal_error), with the line of the file.
+// Edges are added in file order, so the lists are in the same order for every format.
+
+// Native format; stops at the first line that is not an edge (like the original fscanf loop)
+// States outside 1..n are rejected.
+adjacency_list read_edge_list(t_scanner* scanner, const char* filename);
+
+// Edge list whose states are names ("from to probability" lines, any tokens without spaces
+// or double-quoted); a first line with a single token (the number of states) is skipped.
+// The names are interned into states 1..n in order of first appearance (adj_list.labels).
+adjacency_list read_labeled_edge_list(t_scanner* scanner, const char* filename);
+
+// Matrix Market coordinate format (real, integer or pattern; general or symmetric)
+// Values are the transition probabilities; pattern matrices get 1 / out-degree on each edge.
+adjacency_list read_matrix_market(t_scanner* scanner, const char* filename);
+
+// DOT digraph whose node IDs are the state numbers, or any names with intern_labels
+// The probability of an edge is its "prob" attribute, otherwise its "label", otherwise its "weight";
+// the edges of a state without any of them share its probability mass evenly.
+adjacency_list read_dot_graph(t_scanner* scanner, const char* filename, int intern_labels);
+
+// Function to build the graph from a file loaded in a scanner, in the format of its extension
+adjacency_list read_graph_scanner(t_scanner* scanner, const char* filename, int intern_labels);
+
+// Function to write the graph in the format of the file extension
+// Probabilities are written with the fewest digits that read back the same float.
+// Named states are written with their names (edge list and DOT; Matrix Market only has numbers).
+// Returns 0 on success, -1 if the file cannot be written.
+int write_graph_file(adjacency_list adj_list, const char* filename);
+
+int write_edge_list(adjacency_list adj_list, const char* filename);
+int write_matrix_market(adjacency_list adj_list, const char* filename);
+int write_dot_graph(adjacency_list adj_list, const char* filename);
+
+#endif
@@ -1,6 +1,8 @@
 #ifndef __HASSE_H__
 #define __HASSE_H__
 
+#include "arena.h"
+
 typedef struct
 {
     int from;
@@ -12,6 +14,7 @@ typedef struct
     t_link* links;
     int size;
     int capacity;
+    t_arena* arena;            // Arena of the links (NULL: malloc)
 } t_link_array;
 
 void removeTransitiveLinks(t_link_array* p_link_array);
@@ -0,0 +1,618 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "hitting.h"
+
+// Predecessor lists in compressed form: the predecessors of vertex v are
+// sources[offsets[v]] ... sources[offsets[v + 1] - 1] (0-based vertices)
+typedef struct
+{
+    int* offsets;
+    int* sources;
+} t_predecessors;
+
+static t_predecessors build_predecessors(const adjacency_list* graph)
+{
+    int n = graph->num_vertices;
+    t_predecessors preds;
+    preds.offsets = (int*)calloc(n + 1, sizeof(int));
+    if (preds.offsets == NULL)
+    {
+        fatal_error("cannot allocate predecessor offsets");
+    }
+
+    // Count the incoming edges of each vertex
+    int edge_count = 0;
+    for (int v = 0; v < n; v++)
+    {
+        for (cell* current = graph->lists[v].head; current != NULL; current = current->next)
+        {
+            preds.offsets[current->arrival_vertex]++;
+            edge_count++;
+        }
+    }
+    for (int v = 0; v < n; v++)
+    {
+        preds.offsets[v + 1] += preds.offsets[v];
+    }
+
+    preds.sources = (int*)malloc((edge_count > 0 ? edge_count : 1) * sizeof(int));
+    int* fill = (int*)malloc(n * sizeof(int));
+    if (preds.sources == NULL || fill == NULL)
+    {
+        fatal_error("cannot allocate predecessor lists");
+    }
+    for (int v = 0; v < n; v++)
+    {
+        fill[v] = preds.offsets[v];
+    }
+    for (int v = 0; v < n; v++)
+    {
+        for (cell* current = graph->lists[v].head; current != NULL; current = current->next)
+        {
+            int to = current->arrival_vertex - 1;
+            preds.sources[fill[to]] = v;
+            fill[to]++;
+        }
+    }
+    free(fill);
+    return preds;
+}
+
+static void free_predecessors(t_predecessors* preds)
+{
+    free(preds->offsets);
+    free(preds->sources);
+    preds->offsets = NULL;
+    preds->sources = NULL;
+}
+
+// Marks every vertex that can reach a marked vertex, walking predecessors backwards.
+// Only vertices with allowed[v] != 0 are expanded (NULL means all are allowed).
+static void mark_backwards(const t_predecessors* preds, int n, char* marked, const char* allowed)
+{
+    int* queue = (int*)malloc(n * sizeof(int));
+    if (queue == NULL)
+    {
+        fatal_error("cannot allocate search queue");
+    }
+    int head = 0;
+    int tail = 0;
+    for (int v = 0; v < n; v++)
+    {
+        if (marked[v])
+        {
+            queue[tail++] = v;
+        }
+    }
+    while (head < tail)
+    {
+        int v = queue[head++];
+        for (int k = preds->offsets[v]; k < preds->offsets[v + 1]; k++)
+        {
+            int u = preds->sources[k];
+            if (!marked[u] && (allowed == NULL || allowed[u]))
+            {
+                marked[u] = 1;
+                queue[tail++] = u;
+            }
+        }
+    }
+    free(queue);
+}
+
+// Solves x = b + Q x by Gauss-Seidel sweeps over a CSR block, where Q is the block
+// without the columns of the fixed states (kept at 0) and b_i = rhs[i] (1 when rhs is NULL).
+// The sweeps alternate their direction, so that a chain of states converges in a few
+// sweeps whichever way the block numbers it. Fills x with NAN and returns 0 when the
+// largest change is still above PASSAGE_TOLERANCE of the largest value after the last sweep.
+static int sweep_passage_block(const t_sparse_matrix* block, const double* rhs, const char* fixed, double* x)
+{
+    int k = block->rows;
+    for (int i = 0; i < k; i++)
+    {
+        x[i] = 0.0;
+    }
+    for (int sweep = 0; sweep < PASSAGE_MAX_SWEEPS; sweep++)
+    {
+        double change = 0.0;
+        double largest = 0.0;
+        for (int step = 0; step < k; step++)
+        {
+            int i = (sweep % 2 == 0) ? step : k - 1 - step;
+            if (fixed[i])
+            {
+                continue;
+            }
+            double value = (rhs != NULL) ? rhs[i] : 1.0;
+            for (uint32_t e = block->row_ptr[i]; e < block->row_ptr[i + 1]; e++)
+            {
+                value += block->values[e] * x[block->col_idx[e]];
+            }
+            change = fmax(change, fabs(value - x[i]));
+            largest = fmax(largest, fabs(value));
+            x[i] = value;
+        }
+        if (change <= PASSAGE_TOLERANCE * largest)
+        {
+            return 1;
+        }
+    }
+    for (int i = 0; i < k; i++)
+    {
+        x[i] = NAN;
+    }
+    return 0;
+}
+
+t_hitting_times computeHittingTimes(const t_sparse_matrix* matrix, const adjacency_list* graph, t_partition part,
+                                    const int* vertex_to_class, const int* targets, int target_count,
+                                    size_t memory_budget)
+{
+    int n = graph->num_vertices;
+    t_hitting_times hitting;
+    hitting.size = n;
+    hitting.times = (double*)malloc(n * sizeof(double));
+    char* is_target = (char*)calloc(n, sizeof(char));
+    char* reaches = (char*)calloc(n, sizeof(char));
+    char* doomed = (char*)calloc(n, sizeof(char));
+    char* not_target = (char*)malloc(n * sizeof(char));
+    if (hitting.times == NULL || is_target == NULL || reaches == NULL || doomed == NULL || not_target == NULL)
+    {
+        fatal_error("cannot allocate hitting time arrays");
+    }
+
+    for (int t = 0; t < target_count; t++)
+    {
+        if (targets[t] < 1 || targets[t] > n)
+        {
+            printf("Warning: target state %d does not exist, ignored\n", targets[t]);
+            continue;
+        }
+        is_target[targets[t] - 1] = 1;
+        reaches[targets[t] - 1] = 1;
+    }
+    for (int v = 0; v < n; v++)
+    {
+        not_target[v] = !is_target[v];
+    }
+
+    // A state has a finite expected hitting time only if the chain reaches the targets
+    // with probability 1 from it: it must reach them, and must not be able to wander
+    // (without meeting a target first) into a state from which they are unreachable
+    t_predecessors preds = build_predecessors(graph);
+    mark_backwards(&preds, n, reaches, NULL);
+    for (int v = 0; v < n; v++)
+    {
+        doomed[v] = !reaches[v];
+    }
+    mark_backwards(&preds, n, doomed, not_target);
+    free_predecessors(&preds);
+
+    for (int v = 0; v < n; v++)
+    {
+        hitting.times[v] = is_target[v] ? 0.0 : INFINITY;
+    }
+
+    // Tarjan emits a class only after every class it can reach, so walking the
+    // partition in order means the downstream values are always known already
+    for (int c = 0; c < part.class_count; c++)
+    {
+        const t_class* cls = &part.classes[c];
+        int k = cls->member_count;
+
+        // Number the unknowns of this class
+        int* unknown_index = (int*)malloc(k * sizeof(int));
+        if (unknown_index == NULL)
+        {
+            fatal_error("cannot allocate hitting time system");
+        }
+        int unknown_count = 0;
+        for (int i = 0; i < k; i++)
+        {
+            int v = cls->members[i] - 1;
+            unknown_index[i] = (!is_target[v] && !doomed[v]) ? unknown_count++ : -1;
+        }
+        if (unknown_count == 0)
+        {
+            free(unknown_index);
+            continue;
+        }
+
+        // (I - Q) m = 1 + (known downstream contributions), for this block only
+        t_sparse_matrix sub = sparseSubMatrix(matrix, part, c);
+        double* rhs = (double*)malloc(k * sizeof(double));
+        if (rhs == NULL)
+        {
+            fatal_error("cannot allocate hitting time system");
+        }
+        for (int i = 0; i < k; i++)
+        {
+            // Edges leaving the class: their targets are already solved
+            rhs[i] = 1.0;
+            int v = cls->members[i] - 1;
+            for (cell* current = graph->lists[v].head; current != NULL; current = current->next)
+            {
+                int w = current->arrival_vertex - 1;
+                if (vertex_to_class[w] != c && !is_target[w])
+                {
+                    rhs[i] += current->probability * hitting.times[w];
+                }
+            }
+        }
+
+        // The system and its factors are both unknown_count x unknown_count
+        size_t u = (size_t)unknown_count;
+        if (u <= memory_budget / (2 * u * sizeof(double)))
+        {
+            double* system = (double*)calloc(u * u, sizeof(double));
+            double* solution = (double*)malloc(u * sizeof(double));
+            if (system == NULL || solution == NULL)
+            {
+                fatal_error("cannot allocate hitting time system");
+            }
+            for (int i = 0; i < k; i++)
+            {
+                int row = unknown_index[i];
+                if (row < 0)
+                {
+                    continue;
+                }
+                system[(size_t)row * u + row] = 1.0;
+                for (uint32_t e = sub.row_ptr[i]; e < sub.row_ptr[i + 1]; e++)
+                {
+                    int col = unknown_index[sub.col_idx[e]];
+                    if (col >= 0)
+                    {
+                        system[(size_t)row * u + col] -= sub.values[e];
+                    }
+                }
+                solution[row] = rhs[i];
+            }
+
+            t_lu lu = luFactorize(system, unknown_count);
+            free(system);
+            if (!lu.singular)
+            {
+                luSolve(&lu, solution, solution);
+                for (int i = 0; i < k; i++)
+                {
+                    if (unknown_index[i] >= 0)
+                    {
+                        hitting.times[cls->members[i] - 1] = solution[unknown_index[i]];
+                    }
+                }
+            }
+            freeLU(&lu);
+            free(solution);
+        }
+        else
+        {
+            // Too large for a dense system: sweep the CSR block (the targets stay at 0, and no
+            // unknown has an edge to a doomed state, or it would be doomed itself)
+            char* fixed = (char*)malloc(k * sizeof(char));
+            double* solution = (double*)malloc(k * sizeof(double));
+            if (fixed == NULL || solution == NULL)
+            {
+                fatal_error("cannot allocate hitting time system");
+            }
+            for (int i = 0; i < k; i++)
+            {
+                fixed[i] = (unknown_index[i] < 0);
+            }
+            sweep_passage_block(&sub, rhs, fixed, solution);
+            for (int i = 0; i < k; i++)
+            {
+                if (unknown_index[i] >= 0)
+                {
+                    hitting.times[cls->members[i] - 1] = solution[i];
+                }
+            }
+            free(fixed);
+            free(solution);
+        }
+
+        freeSparseMatrix(&sub);
+        free(rhs);
+        free(unknown_index);
+    }
+
+    free(is_target);
+    free(reaches);
+    free(doomed);
+    free(not_target);
+    return hitting;
+}
+
+void freeHittingTimes(t_hitting_times* hitting)
+{
+    free(hitting->times);
+    hitting->times = NULL;
+    hitting->size = 0;
+}
+
+// Stationary distribution of a class from the class analysis, NULL if it has none
+static const t_stationary_result* analysed_stationary(const t_passage_engine* engine, int c)
+{
+    if (engine->class_results == NULL || !engine->class_results[c].stationary.converged)
+    {
+        return NULL;
+    }
+    return &engine->class_results[c].stationary;
+}
+
+t_passage_engine createPassageEngine(const t_sparse_matrix* matrix, const adjacency_list* graph, t_partition part,
+                                     const int* vertex_to_class, const graph_characteristics* characteristics,
+                                     const t_class_result* class_results, size_t memory_budget)
+{
+    t_passage_engine engine;
+    engine.matrix = matrix;
+    engine.graph = graph;
+    engine.partition = part;
+    engine.vertex_to_class = vertex_to_class;
+    engine.class_results = class_results;
+    engine.memory_budget = memory_budget;
+    engine.position = (int*)malloc(graph->num_vertices * sizeof(int));
+    engine.classes = (t_passage_class*)calloc(part.class_count, sizeof(t_passage_class));
+    if (engine.position == NULL || engine.classes == NULL)
+    {
+        fatal_error("cannot allocate first-passage engine");
+    }
+
+    // Nothing is solved here: a class is only prepared by the first query that needs it
+    for (int c = 0; c < part.class_count; c++)
+    {
+        const t_class* cls = &part.classes[c];
+        for (int i = 0; i < cls->member_count; i++)
+        {
+            engine.position[cls->members[i] - 1] = i;
+        }
+        if (characteristics->class_is_persistent[c])
+        {
+            engine.classes[c].size = cls->member_count;
+        }
+        // The rows of the input only sum to 1 within the file tolerance: the return times
+        // renormalise the distribution found by the class analysis
+        const t_stationary_result* stationary = analysed_stationary(&engine, c);
+        for (int i = 0; stationary != NULL && i < stationary->size; i++)
+        {
+            engine.classes[c].analysed_sum += stationary->stationary[i];
+        }
+    }
+
+    return engine;
+}
+
+// Chooses how the queries of a persistent class are solved, the first time one of them needs it:
+// one LU factorisation of I - P + J when the dense system fits the memory budget,
+// otherwise Gauss-Seidel sweeps over the CSR block of the class
+static void prepare_passage_class(t_passage_engine* engine, int c)
+{
+    t_passage_class* entry = &engine->classes[c];
+    if (entry->method != PASSAGE_UNPREPARED)
+    {
+        return;
+    }
+    size_t k = (size_t)entry->size;
+    t_sparse_matrix sub = sparseSubMatrix(engine->matrix, engine->partition, c);
+    entry->times = (double**)calloc(k, sizeof(double*));
+    if (entry->times == NULL)
+    {
+        fatal_error("cannot allocate first-passage class data");
+    }
+
+    // The system and its factors are both k x k
+    if (k <= engine->memory_budget / (2 * k * sizeof(double)))
+    {
+        // B = I - P + J, where J is the all-ones matrix
+        double* system = (double*)malloc(k * k * sizeof(double));
+        entry->stationary = (double*)malloc(k * sizeof(double));
+        if (system == NULL || entry->stationary == NULL)
+        {
+            fatal_error("cannot allocate first-passage system");
+        }
+        for (size_t i = 0; i < k; i++)
+        {
+            for (size_t j = 0; j < k; j++)
+            {
+                system[i * k + j] = (i == j ? 2.0 : 1.0);
+            }
+            for (uint32_t e = sub.row_ptr[i]; e < sub.row_ptr[i + 1]; e++)
+            {
+                system[i * k + sub.col_idx[e]] -= sub.values[e];
+            }
+        }
+        freeSparseMatrix(&sub);
+        entry->lu = luFactorize(system, entry->size);
+        free(system);
+        entry->method = entry->lu.singular ? PASSAGE_FAILED : PASSAGE_DENSE_LU;
+        if (entry->lu.singular)
+        {
+            return;
+        }
+
+        // pi^T B = pi^T - pi^T P + (pi^T 1) 1^T = 1^T, so pi solves B^T pi = 1
+        // (the first-passage formula needs pi in double precision, with the same factors as G)
+        for (size_t i = 0; i < k; i++)
+        {
+            entry->stationary[i] = 1.0;
+        }
+        luSolveTranspose(&entry->lu, entry->stationary, entry->stationary);
+        double sum = 0.0;
+        for (size_t i = 0; i < k; i++)
+        {
+            sum += entry->stationary[i];
+        }
+        // Renormalise: the rows of the input only sum to 1 within the file tolerance
+        for (size_t i = 0; i < k; i++)
+        {
+            entry->stationary[i] /= sum;
+        }
+    }
+    else
+    {
+        entry->block = sub;
+        entry->method = PASSAGE_ITERATION;
+    }
+}
+
+// Mean first-passage times to target j of a class by Gauss-Seidel sweeps of
+// m_i = 1 + sum_{l != j} P_il m_l over its CSR block, then m_jj (the return time to j)
+// The block of an irreducible class minus one state is strictly substochastic, so the sweeps converge
+static void iterate_passage_times(const t_sparse_matrix* block, int j, double* times)
+{
+    char* fixed = (char*)calloc(block->rows, sizeof(char));
+    if (fixed == NULL)
+    {
+        fatal_error("cannot allocate first-passage sweeps");
+    }
+    fixed[j] = 1;
+    if (sweep_passage_block(block, NULL, fixed, times))
+    {
+        times[j] = 1.0;
+        for (uint32_t e = block->row_ptr[j]; e < block->row_ptr[j + 1]; e++)
+        {
+            times[j] += block->values[e] * times[block->col_idx[e]];
+        }
+    }
+    free(fixed);
+}
+
+// Solves the mean first-passage times to a target (0-based vertex) from every state of its class
+// if not cached yet. Returns NULL when the class could not be solved.
+static const double* passage_times(t_passage_engine* engine, int vertex)
+{
+    int c = engine->vertex_to_class[vertex];
+    t_passage_class* entry = &engine->classes[c];
+    prepare_passage_class(engine, c);
+    if (entry->method == PASSAGE_FAILED)
+    {
+        return NULL;
+    }
+    int j = engine->position[vertex];
+    if (entry->times[j] == NULL)
+    {
+        double* times = (double*)calloc(entry->size, sizeof(double));
+        if (times == NULL)
+        {
+            fatal_error("cannot allocate first-passage column");
+        }
+        if (entry->method == PASSAGE_DENSE_LU)
+        {
+            // m_ij = (g_jj - g_ij) / pi_j with G = (I - P + J)^-1, and m_jj = 1 / pi_j
+            times[j] = 1.0;
+            luSolve(&entry->lu, times, times);
+            double g_jj = times[j];
+            for (int i = 0; i < entry->size; i++)
+            {
+                times[i] = (g_jj - times[i]) / entry->stationary[j];
+            }
+            times[j] = 1.0 / entry->stationary[j];
+        }
+        else
+        {
+            iterate_passage_times(&entry->block, j, times);
+        }
+        entry->times[j] = times;
+    }
+    return entry->times[j];
+}
+
+void passagePrepareTargets(t_passage_engine* engine, const int* targets, int target_count)
+{
+    for (int t = 0; t < target_count; t++)
+    {
+        int vertex = targets[t] - 1;
+        if (vertex < 0 || vertex >= engine->graph->num_vertices)
+        {
+            continue;
+        }
+        if (engine->classes[engine->vertex_to_class[vertex]].size > 0)
+        {
+            passage_times(engine, vertex);
+        }
+    }
+}
+
+double meanFirstPassageTime(t_passage_engine* engine, int from, int to)
+{
+    int n = engine->graph->num_vertices;
+    if (from < 1 || from > n || to < 1 || to > n)
+    {
+        return INFINITY;
+    }
+    if (from == to)
+    {
+        return expectedReturnTime(engine, to);
+    }
+
+    int class_from = engine->vertex_to_class[from - 1];
+    int class_to = engine->vertex_to_class[to - 1];
+    if (class_from == class_to && engine->classes[class_to].size > 0)
+    {
+        const double* times = passage_times(engine, to - 1);
+        return (times != NULL) ? times[engine->position[from - 1]] : INFINITY;
+    }
+
+    // Different classes (or a transient target): solve the hitting system of this target
+    t_hitting_times hitting = computeHittingTimes(engine->matrix, engine->graph, engine->partition,
+                                                  engine->vertex_to_class, &to, 1, engine->memory_budget);
+    double result = hitting.times[from - 1];
+    freeHittingTimes(&hitting);
+    return result;
+}
+
+double expectedReturnTime(t_passage_engine* engine, int state)
+{
+    if (state < 1 || state > engine->graph->num_vertices)
+    {
+        return INFINITY;
+    }
+    int c = engine->vertex_to_class[state - 1];
+    if (engine->classes[c].size == 0)
+    {
+        return INFINITY;
+    }
+
+    // 1 / pi_j, from the distribution the class analysis already found
+    const t_stationary_result* stationary = analysed_stationary(engine, c);
+    if (stationary != NULL && engine->classes[c].analysed_sum > 0.0)
+    {
+        return engine->classes[c].analysed_sum / stationary->stationary[engine->position[state - 1]];
+    }
+    const double* times = passage_times(engine, state - 1);
+    return (times != NULL) ? times[engine->position[state - 1]] : INFINITY;
+}
+
+void freePassageEngine(t_passage_engine* engine)
+{
+    if (engine->classes != NULL)
+    {
+        for (int c = 0; c < engine->partition.class_count; c++)
+        {
+            t_passage_class* entry = &engine->classes[c];
+            if (entry->times != NULL)
+            {
+                for (int j = 0; j < entry->size; j++)
+                {
+                    free(entry->times[j]);
+                }
+            }
+            free(entry->times);
+            free(entry->stationary);
+            if (entry->method == PASSAGE_DENSE_LU || entry->method == PASSAGE_FAILED)
+            {
+                freeLU(&entry->lu);
+            }
+            if (entry->method == PASSAGE_ITERATION)
+            {
+                freeSparseMatrix(&entry->block);
+            }
+        }
+    }
+    free(engine->classes);
+    free(engine->position);
+    engine->classes = NULL;
+    engine->position = NULL;
+}
@@ -0,0 +1,161 @@
+#ifndef HITTING_H
+#define HITTING_H
+
+#include "utils.h"
+#include "graph_analysis.h"
+#include "matrix.h"
+#include "sparse.h"
+#include "class_analysis.h"
+
+// Gauss-Seidel sweeps of a class too large for its dense system: stop when no time moves
+// by more than this fraction of the largest one, or give up (NAN times) after the last sweep
+#define PASSAGE_TOLERANCE 1e-10
+#define PASSAGE_MAX_SWEEPS 100000
+
+// Expected hitting times for a set of target states
+// times[v] is E[T | X_0 = v+1] where T is the first time the chain is in the target set:
+// 0 for target states, INFINITY when the chain is not certain to reach the set
+typedef struct
+{
+    double* times;     // One value per vertex (0-based index)
+    int size;          // Number of vertices
+} t_hitting_times;
+
+// How the first-passage times of a persistent class are solved
+typedef enum
+{
+    PASSAGE_UNPREPARED,  // No query has needed the class yet
+    PASSAGE_DENSE_LU,    // One LU factorisation of I - P + J (fits the memory budget)
+    PASSAGE_ITERATION,   // Gauss-Seidel sweeps over the CSR block, one target at a time
+    PASSAGE_FAILED       // Singular system
+} t_passage_method;
+
+// First-passage data kept for one class of the partition
+// Only persistent classes have a size, transient ones keep size = 0
+typedef struct
+{
+    int size;                 // Number of states in the class (0 for a transient class)
+    t_passage_method method;
+    double analysed_sum;      // Sum of the distribution from the class results (0 if none)
+    t_lu lu;                  // Dense LU: factorisation of I - P + J (J = all-ones matrix)
+    double* stationary;       // Dense LU: stationary distribution solved with the same factors
+    t_sparse_matrix block;    // Iteration: CSR block of the class
+    double** times;           // times[j][i] = mean first-passage time from member i to member j, solved on demand
+} t_passage_class;
+
+// Query engine for mean first-passage and return times
+// The engine borrows the matrix, graph and partition: they must outlive it
+typedef struct
+{
+    const t_sparse_matrix* matrix; // Transition matrix of the whole graph
+    const adjacency_list* graph;   // Graph the matrix was built from
+    t_partition partition;         // Partition into classes
+    const int* vertex_to_class;    // Class of each vertex (0-based)
+    int* position;                 // Position of each vertex inside its class
+    t_passage_class* classes;      // One entry per class of the partition
+    const t_class_result* class_results; // Stationary distributions already found (NULL if none)
+    size_t memory_budget;          // Largest dense system (and its factors) a class may use
+} t_passage_engine;
+
+/**
+ * @brief Computes the expected hitting times of a set of target states
+ *
+ * Solves m_i = 1 + sum_j P_ij m_j for the states that reach the target set with
+ * probability 1. The system is solved class by class in the order given by Tarjan
+ * (sink classes first), so each class only needs the LU factorisation of its own
+ * block (extracted with sparseSubMatrix) and reads the already solved downstream values
+ * through the adjacency list. No dense inverse is formed. A class whose dense system
+ * does not fit the memory budget is solved by Gauss-Seidel sweeps over its CSR block
+ * instead (NAN times if they do not converge).
+ *
+ * @param matrix The transition matrix of the graph
+ * @param graph The adjacency list of the graph
+ * @param part The partition of the graph into classes
+ * @param vertex_to_class The class of each vertex (0-based)
+ * @param targets The target states (1-based vertex numbers)
+ * @param target_count The number of target states
+ * @param memory_budget The largest dense system, in bytes, one class may factorise
+ * @return t_hitting_times The expected hitting time from every state
+ */
+t_hitting_times computeHittingTimes(const t_sparse_matrix* matrix, const adjacency_list* graph, t_partition part,
+                                    const int* vertex_to_class, const int* targets, int target_count,
+                                    size_t memory_budget);
+
+/**
+ * @brief Frees the memory allocated for hitting times
+ *
+ * @param hitting The hitting times to free
+ */
+void freeHittingTimes(t_hitting_times* hitting);
+
+/**
+ * @brief Builds a first-passage query engine
+ *
+ * Nothing is solved up front: a persistent class is prepared by the first query
+ * that needs it. When its dense system fits the memory budget it gets one LU
+ * factorisation of I - P + J, which gives the stationary distribution (transposed
+ * solve) and, for any target j, the column of the fundamental matrix needed by
+ * m_ij = (g_jj - g_ij) / pi_j. Larger classes solve each target with Gauss-Seidel
+ * sweeps over their CSR block instead.
+ * Return times are 1 / pi_j from the class results when they have the distribution.
+ *
+ * @param matrix The transition matrix of the graph
+ * @param graph The adjacency list of the graph
+ * @param part The partition of the graph into classes
+ * @param vertex_to_class The class of each vertex (0-based)
+ * @param characteristics The persistent/transient flags of the classes
+ * @param class_results The stationary distributions of the classes (NULL if not computed)
+ * @param memory_budget The largest dense system, in bytes, one class may factorise
+ * @return t_passage_engine The engine, ready for queries
+ */
+t_passage_engine createPassageEngine(const t_sparse_matrix* matrix, const adjacency_list* graph, t_partition part,
+                                     const int* vertex_to_class, const graph_characteristics* characteristics,
+                                     const t_class_result* class_results, size_t memory_budget);
+
+/**
+ * @brief Prepares many targets at once
+ *
+ * Solves the first-passage times to all the given targets within their class,
+ * so that later queries are O(1).
+ * Targets in transient classes are ignored (they go through computeHittingTimes).
+ *
+ * @param engine The engine
+ * @param targets The target states (1-based vertex numbers)
+ * @param target_count The number of targets
+ */
+void passagePrepareTargets(t_passage_engine* engine, const int* targets, int target_count);
+
+/**
+ * @brief Mean first-passage time from one state to another
+ *
+ * For two states of the same persistent class this is an O(1) lookup once the
+ * target is prepared (NAN if the sweeps of a large class did not converge). Otherwise the hitting times of the target are computed
+ * with computeHittingTimes.
+ *
+ * @param engine The engine
+ * @param from The starting state (1-based)
+ * @param to The target state (1-based)
+ * @return double E[T_to | X_0 = from] (the return time when from == to), INFINITY if not certain
+ */
+double meanFirstPassageTime(t_passage_engine* engine, int from, int to);
+
+/**
+ * @brief Expected return time to a state
+ *
+ * 1 / pi_j for a state of a persistent class, INFINITY for a transient state.
+ * Without a distribution from the class results, the class is prepared as for a query.
+ *
+ * @param engine The engine
+ * @param state The state (1-based)
+ * @return double The expected return time
+ */
+double expectedReturnTime(t_passage_engine* engine, int state);
+
+/**
+ * @brief Frees the memory allocated by a first-passage engine
+ *
+ * @param engine The engine to free
+ */
+void freePassageEngine(t_passage_engine* engine);
+
+#endif // HITTING_H
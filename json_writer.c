@@ -0,0 +1,202 @@
+#include <math.h>
+
+#include "json_writer.h"
+
+static void write_string(t_json_writer* writer, const char* text)
+{
+    fputc('"', writer->file);
+    for (const unsigned char* c = (const unsigned char*)text; *c != '\0'; c++)
+    {
+        if (*c == '"' || *c == '\\')
+        {
+            fputc('\\', writer->file);
+            fputc(*c, writer->file);
+        }
+        else if (*c == '\n')
+        {
+            fputs("\\n", writer->file);
+        }
+        else if (*c < 0x20)
+        {
+            fprintf(writer->file, "\\u%04x", *c);
+        }
+        else
+        {
+            fputc(*c, writer->file);
+        }
+    }
+    fputc('"', writer->file);
+}
+
+static void write_indent(t_json_writer* writer, int depth)
+{
+    fputc('\n', writer->file);
+    for (int d = 0; d < depth; d++)
+    {
+        fputs("  ", writer->file);
+    }
+}
+
+// Separator, line break and key in front of a new item of the current container
+static void begin_item(t_json_writer* writer, const char* key)
+{
+    if (writer->depth == 0)
+    {
+        writer->failed = 1;
+        return;
+    }
+
+    int* count = &writer->item_count[writer->depth - 1];
+    if (*count > 0)
+    {
+        fputc(',', writer->file);
+        if (writer->depth > JSON_INDENT_DEPTH)
+        {
+            fputc(' ', writer->file);
+        }
+    }
+    if (writer->depth <= JSON_INDENT_DEPTH)
+    {
+        write_indent(writer, writer->depth);
+    }
+    (*count)++;
+
+    if (key != NULL)
+    {
+        write_string(writer, key);
+        fputs(": ", writer->file);
+    }
+}
+
+static void begin_container(t_json_writer* writer, const char* key, char opening)
+{
+    if (writer->depth > 0)
+    {
+        begin_item(writer, key);
+    }
+    if (writer->depth == JSON_MAX_DEPTH)
+    {
+        writer->failed = 1;
+        return;
+    }
+    fputc(opening, writer->file);
+    writer->item_count[writer->depth] = 0;
+    writer->closing[writer->depth] = (opening == '{') ? '}' : ']';
+    writer->depth++;
+}
+
+static void end_container(t_json_writer* writer, char closing)
+{
+    if (writer->depth == 0 || writer->closing[writer->depth - 1] != closing)
+    {
+        writer->failed = 1;
+        return;
+    }
+    writer->depth--;
+    if (writer->item_count[writer->depth] > 0 && writer->depth < JSON_INDENT_DEPTH)
+    {
+        write_indent(writer, writer->depth);
+    }
+    fputc(closing, writer->file);
+}
+
+int json_open(t_json_writer* writer, const char* filename)
+{
+    writer->depth = 0;
+    writer->failed = 0;
+    writer->file = fopen(filename, "wt");
+    if (writer->file == NULL)
+    {
+        printf("Error: cannot open '%s' for writing.\n", filename);
+        return -1;
+    }
+    setvbuf(writer->file, NULL, _IOFBF, JSON_OUTPUT_BUFFER);
+    begin_container(writer, NULL, '{');
+    return 0;
+}
+
+void json_open_stream(t_json_writer* writer, FILE* stream)
+{
+    writer->depth = 0;
+    writer->failed = 0;
+    writer->file = stream;
+    begin_container(writer, NULL, '{');
+}
+
+void json_begin_object(t_json_writer* writer, const char* key)
+{
+    begin_container(writer, key, '{');
+}
+
+void json_end_object(t_json_writer* writer)
+{
+    end_container(writer, '}');
+}
+
+void json_begin_array(t_json_writer* writer, const char* key)
+{
+    begin_container(writer, key, '[');
+}
+
+void json_end_array(t_json_writer* writer)
+{
+    end_container(writer, ']');
+}
+
+void json_int(t_json_writer* writer, const char* key, long value)
+{
+    begin_item(writer, key);
+    fprintf(writer->file, "%ld", value);
+}
+
+void json_number(t_json_writer* writer, const char* key, double value)
+{
+    begin_item(writer, key);
+    if (isfinite(value))
+    {
+        // Enough digits to read back the same float
+        fprintf(writer->file, "%.9g", value);
+    }
+    else
+    {
+        fputs("null", writer->file);
+    }
+}
+
+void json_bool(t_json_writer* writer, const char* key, int value)
+{
+    begin_item(writer, key);
+    fputs(value ? "true" : "false", writer->file);
+}
+
+void json_string(t_json_writer* writer, const char* key, const char* value)
+{
+    begin_item(writer, key);
+    write_string(writer, value);
+}
+
+void json_null(t_json_writer* writer, const char* key)
+{
+    begin_item(writer, key);
+    fputs("null", writer->file);
+}
+
+int json_close(t_json_writer* writer)
+{
+    while (writer->depth > 1)
+    {
+        // Unbalanced document: close what is open so that the file stays readable
+        writer->failed = 1;
+        end_container(writer, writer->closing[writer->depth - 1]);
+    }
+    end_container(writer, '}');
+    fputc('\n', writer->file);
+
+    int status = (writer->failed || ferror(writer->file)) ? -1 : 0;
+    if (fclose(writer->file) != 0)
+    {
+        status = -1;
+    }
+    writer->file = NULL;
+    return status;
+}
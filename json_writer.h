@@ -0,0 +1,47 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <stdio.h>
+
+// Deepest nesting of objects and arrays
+#define JSON_MAX_DEPTH 16
+
+// Containers up to this depth put each item on its own line, deeper ones are written on one line
+#define JSON_INDENT_DEPTH 3
+
+// Size of the file buffer: the document is written in chunks of this size
+#define JSON_OUTPUT_BUFFER ((size_t)1 << 20)
+
+// Streaming JSON writer: every value goes straight to the file, the document is never held in memory
+// Inside an object every value needs a key, inside an array the key must be NULL.
+typedef struct
+{
+    FILE* file;
+    int depth;                         // Number of open objects and arrays
+    int item_count[JSON_MAX_DEPTH];    // Items already written in each open container
+    char closing[JSON_MAX_DEPTH];      // '}' or ']' for each open container
+    int failed;                        // 1 after a write error or a nesting error
+} t_json_writer;
+
+// Function to open the file and start the top-level object; returns -1 if the file cannot be opened
+int json_open(t_json_writer* writer, const char* filename);
+
+// Function to start the top-level object on a stream that is already open (json_close closes it)
+void json_open_stream(t_json_writer* writer, FILE* stream);
+
+void json_begin_object(t_json_writer* writer, const char* key);
+void json_end_object(t_json_writer* writer);
+void json_begin_array(t_json_writer* writer, const char* key);
+void json_end_array(t_json_writer* writer);
+
+void json_int(t_json_writer* writer, const char* key, long value);
+// NaN and infinities have no JSON representation: they are written as null
+void json_number(t_json_writer* writer, const char* key, double value);
+void json_bool(t_json_writer* writer, const char* key, int value);
+void json_string(t_json_writer* writer, const char* key, const char* value);
+void json_null(t_json_writer* writer, const char* key);
+
+// Function to close the top-level object and the file; returns -1 if anything failed
+int json_close(t_json_writer* writer);
+
+#endif
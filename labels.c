@@ -0,0 +1,165 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "labels.h"
+#include "utils.h"
+
+#define LABEL_INITIAL_SLOTS 1024
+
+
+// FNV-1a, then a finalizer: on their own the low bits of FNV-1a (the slot) barely depend on
+// the first characters, so labels like "1000001", "1000002"... would pile up in a few runs
+static uint64_t hash_label(const char* text, size_t length)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash ^= (unsigned char)text[i];
+        hash *= 1099511628211ull;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+// Slot of the label, or the empty slot where it would go (linear probing)
+static size_t find_slot(const t_label_table* labels, const char* text, size_t length, uint64_t hash)
+{
+    size_t mask = labels->slot_count - 1;
+    size_t slot = (size_t)hash & mask;
+    uint32_t tag = (uint32_t)(hash >> 32);
+    for (;;)
+    {
+        const t_label_slot* entry = &labels->slots[slot];
+        if (entry->state == 0)
+        {
+            return slot;
+        }
+        if (entry->hash == tag)
+        {
+            const char* label = labels->arena + entry->offset;
+            if (strncmp(label, text, length) == 0 && label[length] == '\0')
+            {
+                return slot;
+            }
+        }
+        slot = (slot + 1) & mask;
+    }
+}
+
+static void rehash(t_label_table* labels, size_t slot_count)
+{
+    t_label_slot* old_slots = labels->slots;
+    size_t old_count = labels->slot_count;
+
+    labels->slot_count = slot_count;
+    labels->slots = (t_label_slot*)arena_alloc(labels->owner, slot_count * sizeof(t_label_slot));
+    memset(labels->slots, 0, slot_count * sizeof(t_label_slot));
+
+    // The full hash is recomputed from the label (the slots only keep its upper bits)
+    size_t mask = slot_count - 1;
+    for (size_t old = 0; old < old_count; old++)
+    {
+        if (old_slots[old].state == 0)
+        {
+            continue;
+        }
+        const char* label = labels->arena + old_slots[old].offset;
+        size_t slot = (size_t)hash_label(label, strlen(label)) & mask;
+        while (labels->slots[slot].state != 0)
+        {
+            slot = (slot + 1) & mask;
+        }
+        labels->slots[slot] = old_slots[old];
+    }
+    arena_release(labels->owner, old_slots, old_count * sizeof(t_label_slot));
+}
+
+t_label_table* create_label_table(void)
+{
+    // The table comes from the current arena, like the graph it names (a parse error leaves it there)
+    t_arena* owner = current_arena();
+    t_label_table* labels = (t_label_table*)arena_alloc(owner, sizeof(t_label_table));
+    memset(labels, 0, sizeof(t_label_table));
+    labels->owner = owner;
+    rehash(labels, LABEL_INITIAL_SLOTS);
+    return labels;
+}
+
+int find_label(const t_label_table* labels, const char* text, size_t length)
+{
+    size_t slot = find_slot(labels, text, length, hash_label(text, length));
+    return labels->slots[slot].state;
+}
+
+int intern_label(t_label_table* labels, const char* text, size_t length)
+{
+    uint64_t hash = hash_label(text, length);
+    size_t slot = find_slot(labels, text, length, hash);
+    if (labels->slots[slot].state != 0)
+    {
+        return labels->slots[slot].state;
+    }
+
+    // New state: label appended to the arena
+    if (labels->count == labels->capacity)
+    {
+        int capacity = (labels->capacity > 0) ? labels->capacity * 2 : 1024;
+        labels->offsets = (size_t*)arena_realloc(labels->owner, labels->offsets,
+                                                 (size_t)labels->capacity * sizeof(size_t),
+                                                 (size_t)capacity * sizeof(size_t));
+        labels->capacity = capacity;
+    }
+    if (labels->arena_size + length + 1 > labels->arena_capacity)
+    {
+        size_t capacity = (labels->arena_capacity > 0) ? labels->arena_capacity * 2 : 16384;
+        while (capacity < labels->arena_size + length + 1)
+        {
+            capacity *= 2;
+        }
+        labels->arena = (char*)arena_realloc(labels->owner, labels->arena, labels->arena_capacity, capacity);
+        labels->arena_capacity = capacity;
+    }
+    memcpy(labels->arena + labels->arena_size, text, length);
+    labels->arena[labels->arena_size + length] = '\0';
+    labels->offsets[labels->count] = labels->arena_size;
+    labels->arena_size += length + 1;
+    labels->count++;
+    labels->slots[slot].offset = labels->offsets[labels->count - 1];
+    labels->slots[slot].hash = (uint32_t)(hash >> 32);
+    labels->slots[slot].state = labels->count;
+
+    // At most half full, so that the probes stay short
+    if ((size_t)labels->count * 2 > labels->slot_count)
+    {
+        rehash(labels, labels->slot_count * 2);
+    }
+    return labels->count;
+}
+
+const char* state_label(const t_label_table* labels, int state, char* buffer)
+{
+    if (labels != NULL && state >= 1 && state <= labels->count)
+    {
+        return labels->arena + labels->offsets[state - 1];
+    }
+    snprintf(buffer, STATE_LABEL_SIZE, "%d", state);
+    return buffer;
+}
+
+void free_label_table(t_label_table* labels)
+{
+    if (labels == NULL)
+    {
+        return;
+    }
+    t_arena* owner = labels->owner;
+    arena_release(owner, labels->arena, labels->arena_capacity);
+    arena_release(owner, labels->offsets, (size_t)labels->capacity * sizeof(size_t));
+    arena_release(owner, labels->slots, labels->slot_count * sizeof(t_label_slot));
+    arena_release(owner, labels, sizeof(t_label_table));
+}
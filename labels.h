@@ -0,0 +1,53 @@
+#ifndef LABELS_H
+#define LABELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arena.h"
+
+// Room for the decimal form of any state number
+#define STATE_LABEL_SIZE 12
+
+// Slot of the hash table: the hash and the position of the label are kept next to the state,
+// so that a probe reads the label only when the hashes match (and nothing else)
+typedef struct
+{
+    size_t offset;             // Start of the label in the arena
+    uint32_t hash;             // Upper bits of the hash of the label
+    int state;                 // 0 = empty
+} t_label_slot;
+
+// Names of the states when the input file does not number them 1..n (--labels)
+// Each new label gets the next state number, in order of first appearance.
+// The labels are stored one after the other in one block (arena); an open-addressing
+// hash table of state numbers gives the state of a label without any allocation.
+typedef struct t_label_table
+{
+    char* arena;               // All the labels, each one followed by '\0'
+    size_t arena_size;
+    size_t arena_capacity;
+    size_t* offsets;           // Start of the label of state s at arena + offsets[s - 1]
+    int count;                 // Number of states
+    int capacity;              // Room in offsets
+    t_label_slot* slots;
+    size_t slot_count;         // Power of two, at least twice count
+    t_arena* owner;            // Arena of the table and its arrays (NULL: malloc)
+} t_label_table;
+
+// Function to create an empty table, in the current arena (see arena.h)
+t_label_table* create_label_table(void);
+
+// Function to get the state number of a label, a new one if it was never seen (1-based)
+int intern_label(t_label_table* labels, const char* text, size_t length);
+
+// Function to get the state number of a label, 0 if it was never seen
+int find_label(const t_label_table* labels, const char* text, size_t length);
+
+// Function to get the name of a state: its label, or its number if labels is NULL
+// (buffer holds the number, at least STATE_LABEL_SIZE chars)
+const char* state_label(const t_label_table* labels, int state, char* buffer);
+
+void free_label_table(t_label_table* labels);
+
+#endif
@@ -1,319 +1,551 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
+#include <time.h>
 #include "utils.h"
 #include "graph_analysis.h"
 #include "matrix.h"
+#include "hitting.h"
+#include "transient.h"
+#include "simulation.h"
+#include "walks.h"
+#include "sparse.h"
+#include "planner.h"
+#include "class_analysis.h"
+#include "class_view.h"
+#include "thread_pool.h"
+#include "pipeline.h"
+#include "output.h"
+#include "export.h"
+#include "graph_io.h"
+#include "estimator.h"
+#include "online.h"
+#include "dynamic.h"
+#include "cache.h"
+#include "batch.h"
+#include "server.h"
 
-int main(int argc, char* argv[])
+// Entries of the matrix powers below this value are not stored (fill-in control)
+#define SPARSE_DROP_TOLERANCE 1e-7f
+
+// Largest number of powers that can be printed with --powers
+#define MAX_PRINTED_POWERS 16
+
+// Largest number of horizons of --transient (--horizons)
+#define MAX_TRANSIENT_HORIZONS 16
+
+// Start of --transient standing for every state (0 stands for the uniform distribution)
+#define TRANSIENT_ALL_STATES -1
+
+// Parts of the analysis a command needs; each stage only runs if its part is selected
+#define RUN_DISPLAY         (1 << 0)   // Adjacency list and validation
+#define RUN_MERMAID         (1 << 1)   // Mermaid file of the graph
+#define RUN_CLASSES         (1 << 2)   // Tarjan partition
+#define RUN_LINKS           (1 << 3)   // Links between classes
+#define RUN_HASSE           (1 << 4)   // Hasse diagram file
+#define RUN_CHARACTERISTICS (1 << 5)   // Transient / persistent classes
+#define RUN_POWERS          (1 << 6)   // Transition matrix, printed powers and convergence
+#define RUN_STATIONARY      (1 << 7)   // Stationary distribution of each class
+#define RUN_PERIOD          (1 << 8)   // Period of each class
+#define RUN_PASSAGE         (1 << 9)   // Mean first-passage and return times
+#define RUN_TRANSIENT       (1 << 10)  // Transient distributions (--transient)
+#define RUN_SIMULATION      (1 << 11)  // Monte Carlo run (--simulate)
+#define RUN_ALL             ((1 << 10) - 1)  // Every part but the optional runs (--transient, --simulate)
+
+typedef struct
 {
-    char filename[256];  // Array to store the filename
-    
-    // Check if a filename was provided as command line argument
-    if (argc >= 2)
+    const char* name;
+    int parts;
+    const char* description;
+} t_command;
+
+// First argument of the program; without a command, everything is run
+static const t_command commands[] = {
+    {"all", RUN_ALL, "every step (default)"},
+    {"validate", RUN_DISPLAY, "display the graph and check that it is a Markov graph"},
+    {"scc", RUN_CLASSES, "strongly connected classes (Tarjan)"},
+    {"hasse", RUN_CLASSES | RUN_LINKS | RUN_HASSE, "class links and Hasse diagram file"},
+    {"stationary", RUN_CLASSES | RUN_LINKS | RUN_CHARACTERISTICS | RUN_STATIONARY,
+     "stationary distribution of each persistent class"},
+    {"period", RUN_CLASSES | RUN_LINKS | RUN_CHARACTERISTICS | RUN_PERIOD, "period of each persistent class"},
+    {"powers", RUN_POWERS, "transition matrix, printed powers and convergence"},
+    {"convert", 0, "only read the graph (with --convert FILE)"},
+};
+
+static const t_command* find_command(const char* name)
+{
+    for (size_t c = 0; c < sizeof(commands) / sizeof(commands[0]); c++)
     {
-        // If filename provided, use it
-        strcpy(filename, argv[1]);
+        if (strcmp(commands[c].name, name) == 0)
+        {
+            return &commands[c];
+        }
     }
-    else
+    return NULL;
+}
+
+// Everything the stages of the pipeline share
+// Each field is written by one stage and only read by the stages that depend on it
+typedef struct
+{
+    // Input and options
+    adjacency_list graph;
+    char output_filename[256];
+    char hasse_filename[256];
+    const char* graph_filename;
+    const char* export_filename;    // --export (NULL = no export)
+    char export_csv_filename[256];  // Large vectors of the export
+    const char* convert_filename;   // --convert (NULL = no conversion)
+    const char* hasse_dot_filename; // --hasse-dot (NULL = Mermaid only)
+    const t_simulation_options* simulation;
+    const int* transient_starts;    // --transient: states, 0 (uniform) or TRANSIENT_ALL_STATES
+    int transient_start_count;
+    const int* transient_horizons;  // --horizons, increasing
+    int transient_horizon_count;
+    const char* transient_filename; // --transient-file (NULL = no file)
+    size_t memory_budget;
+    t_thread_pool* pool;
+    int parts;                  // RUN_* flags of the command
+    int part3_started;          // Part 3 banner already printed
+    int ready;                  // RUN_* parts already computed (by --delta or the cache); RUN_HASSE
+                                // stands for the Hasse links
+
+    // Part 1
+    int is_valid;
+    long mermaid_limit;         // --mermaid-limit
+    int mermaid_status;         // -1 on error, otherwise number of edges left out
+
+    // Part 2
+    int* vertex_to_class;
+    t_partition partition;
+    t_link_array direct_links;
+    t_link_array hasse_links;
+    int hasse_status;
+    int hasse_dot_status;
+    int convert_status;
+    graph_characteristics characteristics;
+
+    // Part 3
+    t_sparse_matrix M;
+    int printed_powers[MAX_PRINTED_POWERS];     // Increasing exponents (--powers)
+    int printed_power_count;
+    t_sparse_matrix powers[MAX_PRINTED_POWERS];
+    t_sparse_matrix M_power;
+    float epsilon;              // --epsilon
+    int max_iterations;         // --max-iterations
+    int n;
+    float diff;
+    int* class_positions;
+    t_plan plan;
+    t_class_result* class_results;
+    int* transient_states;      // Start of each distribution of the block (0 = uniform)
+    t_distribution_block distributions;
+    int transient_status;
+    t_simulation_result estimates;
+    int simulated;
+    int export_status;
+} t_run;
+
+// Part 3 title, before the first Part 3 report of the command
+static void print_part3_banner(t_run* run)
+{
+    if (run->part3_started)
     {
-        // If no filename provided, ask the user to enter it
-        printf("Enter the name of the input file: ");
-        scanf("%255s", filename);  // Read filename from user (max 255 characters)
+        return;
     }
-    
+    run->part3_started = 1;
     printf("\n========================================\n");
-    printf("  Markov Graph Project - Part 1\n");
+    printf("  Markov Graph Project - Part 3\n");
     printf("========================================\n\n");
-    
-    // STEP 1: Create a graph from file and display it
-    printf("STEP 1: Creating graph from file '%s'...\n", filename);
-    printf("----------------------------------------\n");
-    
-    adjacency_list graph = read_graph(filename);
-    
-    printf("\nGraph loaded successfully!\n");
-    printf("Number of vertices: %d\n", graph.num_vertices);
-    
+}
+
+// Part 1, STEP 1 to 3: display and validation (the Mermaid file is written by its own stage)
+static void stage_display(void* argument)
+{
+    t_run* run = (t_run*)argument;
+
     // Display the adjacency list
-    display_adjacency_list(graph);
-    
+    display_adjacency_list(run->graph);
+
     // STEP 2: Check if it's a valid Markov graph
     printf("STEP 2: Checking if graph is a valid Markov graph...\n");
     printf("----------------------------------------\n");
-    
-    int is_valid = is_markov_graph(graph);
-    
+
+    run->is_valid = is_markov_graph(run->graph);
+
     printf("\n");
-    
+
+    if (!(run->parts & RUN_MERMAID))
+    {
+        return;
+    }
+
     // STEP 3: Generate Mermaid file for visualization
     printf("STEP 3: Generating Mermaid visualization file...\n");
     printf("----------------------------------------\n");
-    
-    // Create output filename: extract just the filename part and add .mmd
-    // We write to the current directory (where the program runs from)
-    char output_filename[256];
-    
-    // Find the last slash in the filename (to get just the filename part)
-    // Example: "data/exemple1.txt" -> we want "exemple1.mmd"
-    const char* last_slash = strrchr(filename, '/');
-    const char* last_backslash = strrchr(filename, '\\');
-    const char* name_start = filename;  // Start with whole filename
-    
-    // If we found a slash, start after it
-    if (last_slash != NULL)
-    {
-        name_start = last_slash + 1;  // Point to character after the slash
-    }
-    if (last_backslash != NULL)
-    {
-        const char* after_backslash = last_backslash + 1;
-        // Use whichever comes later (slash or backslash)
-        if (after_backslash > name_start)
-        {
-            name_start = after_backslash;
-        }
-    }
-    
-    // Copy the filename part (without the path)
-    strcpy(output_filename, name_start);
-    
-    // Find the dot and replace .txt with .mmd
-    // Simple loop to find the dot
-    int i = 0;
-    while (output_filename[i] != '\0' && output_filename[i] != '.')
-    {
-        i++;
-    }
-    
-    // If we found a dot, replace everything after it with .mmd
-    if (output_filename[i] == '.')
-    {
-        output_filename[i] = '\0';  // Cut the string at the dot
-    }
-    
-    // Add .mmd extension
-    strcat(output_filename, ".mmd");
-    
-    generate_mermaid_file(graph, output_filename);
-    
+    printf("Mermaid file '%s' is written in the background\n", run->output_filename);
+
     printf("\n========================================\n");
     printf("  Steps 1 to 3 completed!\n");
     printf("========================================\n");
     printf("\nTo visualize the graph:\n");
     printf("1. Open https://www.mermaidchart.com/\n");
-    printf("2. Copy the contents of '%s'\n", output_filename);
+    printf("2. Copy the contents of '%s'\n", run->output_filename);
     printf("3. Paste into the Mermaid code editor\n");
     printf("4. View your graph!\n\n");
+}
+
+static void stage_mermaid_export(void* argument)
+{
+    t_run* run = (t_run*)argument;
+    run->mermaid_status = generate_mermaid_file(run->graph, run->output_filename, run->mermaid_limit);
+}
+
+// Part 2, STEP 4
+static void stage_tarjan(void* argument)
+{
+    t_run* run = (t_run*)argument;
 
     printf("STEP 4: Grouping vertices into strongly connected classes (Tarjan)...\n");
     printf("------------------------------------------------------------------\n");
 
-    int* vertex_to_class = NULL;
-    t_partition partition = tarjan_partition_graph(&graph, &vertex_to_class);
-    print_partition(&partition);
+    if (!(run->ready & RUN_CLASSES))
+    {
+        run->vertex_to_class = NULL;
+        run->partition = tarjan_partition_graph(&run->graph, &run->vertex_to_class);
+    }
+    print_partition(&run->partition, run->graph.labels);
+}
+
+// Part 2, STEP 5 (the Hasse file is written by its own stage)
+static void stage_links(void* argument)
+{
+    t_run* run = (t_run*)argument;
 
     printf("STEP 5: Building class links and Hasse diagram...\n");
     printf("-----------------------------------------------\n");
 
-    t_link_array direct_links = build_link_array(&partition, &graph, vertex_to_class);
-    print_link_array(&direct_links, &partition);
+    if (!(run->ready & RUN_LINKS))
+    {
+        run->direct_links = build_link_array(&run->partition, &run->graph, run->vertex_to_class);
+    }
+    print_link_array(&run->direct_links, &run->partition);
+
+    if (!(run->ready & RUN_HASSE))
+    {
+        run->hasse_links = clone_link_array(&run->direct_links);
+        removeTransitiveLinks(&run->hasse_links);
+    }
+}
 
-    t_link_array hasse_links = clone_link_array(&direct_links);
-    removeTransitiveLinks(&hasse_links);
+static void stage_hasse_export(void* argument)
+{
+    t_run* run = (t_run*)argument;
+    run->hasse_status = export_hasse_mermaid(&run->partition, &run->hasse_links, run->hasse_filename,
+                                             run->graph.labels);
+    if (run->hasse_dot_filename != NULL)
+    {
+        run->hasse_dot_status = export_hasse_dot(&run->partition, &run->hasse_links, run->hasse_dot_filename,
+                                                 run->graph.labels);
+    }
+}
 
-    char hasse_filename[256];
-    snprintf(hasse_filename, sizeof(hasse_filename), "classes_%s", output_filename);
-    export_hasse_mermaid(&partition, &hasse_links, hasse_filename);
+// Graph written in another format (--convert): only needs the graph
+static void stage_graph_conversion(void* argument)
+{
+    t_run* run = (t_run*)argument;
+    run->convert_status = write_graph_file(run->graph, run->convert_filename);
+}
+
+// Part 2, STEP 6
+static void stage_characteristics(void* argument)
+{
+    t_run* run = (t_run*)argument;
 
     printf("\nSTEP 6: Analysing class and graph properties...\n");
     printf("----------------------------------------------\n");
 
-    graph_characteristics characteristics = compute_graph_characteristics(&partition, &direct_links);
-    print_graph_characteristics(&partition, &characteristics);
+    if (!(run->ready & RUN_CHARACTERISTICS))
+    {
+        run->characteristics = compute_graph_characteristics(&run->partition, &run->direct_links);
+    }
+    print_graph_characteristics(&run->partition, &run->characteristics, run->graph.labels);
 
     printf("\n========================================\n");
     printf("  Part 2 analysis completed!\n");
     printf("========================================\n\n");
+}
+
+// Part 3, STEP 1 computations: only needs the graph, so it overlaps with Part 2
+static void stage_matrix_powers(void* argument)
+{
+    t_run* run = (t_run*)argument;
+
+    // Create the transition probability matrix from the graph
+    // It is stored in CSR form: only the edges are kept, never a dense n x n array
+    run->M = createSparseTransitionMatrix(&run->graph);
+
+    // Each printed power is computed from the previous one: M^3 = M^2 * M, then M^4 ... M^7
+    t_sparse_matrix M_power = copySparseMatrix(&run->M);
+    int exponent = 1;
+    for (int p = 0; p < run->printed_power_count; p++)
+    {
+        while (exponent < run->printed_powers[p])
+        {
+            t_sparse_matrix M_next = sparseMultiply(&M_power, &run->M, SPARSE_DROP_TOLERANCE, 0);
+            freeSparseMatrix(&M_power);
+            M_power = M_next;
+            exponent++;
+        }
+        run->powers[p] = copySparseMatrix(&M_power);
+    }
+    freeSparseMatrix(&M_power);
+
+    // Find convergence: calculate M^n until difference between M^n and M^(n-1) < epsilon
+    run->n = 1;
+    run->M_power = copySparseMatrix(&run->M);
+    run->diff = 1.0f;
+
+    while (run->diff > run->epsilon && run->n < run->max_iterations)
+    {
+        // Calculate next power: M^n = M^(n-1) * M
+        t_sparse_matrix M_next = sparseMultiply(&run->M_power, &run->M, SPARSE_DROP_TOLERANCE, 0);
+
+        // Calculate difference between M^n and M^(n-1)
+        run->diff = sparseMatrixDifference(&M_next, &run->M_power);
+
+        // Update for next iteration
+        freeSparseMatrix(&run->M_power);
+        run->M_power = M_next;
+        run->n++;
+    }
+}
+
+// Part 3, STEP 1 report
+static void stage_matrix_report(void* argument)
+{
+    t_run* run = (t_run*)argument;
+
+    print_part3_banner(run);
 
-    // ========================================
-    // PART 3: Matrix calculations and distributions
-    // ========================================
-    
-    printf("\n========================================\n");
-    printf("  Markov Graph Project - Part 3\n");
-    printf("========================================\n\n");
-    
     // STEP 1: Matrix calculations
     printf("STEP 1: Matrix calculations...\n");
     printf("-------------------------------\n");
-    
-    // Create the transition probability matrix from the graph
+
     printf("Creating transition probability matrix M...\n");
-    t_matrix M = createTransitionMatrix(&graph);
     printf("Transition matrix M:\n");
-    printMatrix(M);
-    
-    // Calculate M^3
-    printf("Calculating M^3...\n");
-    t_matrix M_power = createEmptyMatrix(graph.num_vertices);
-    t_matrix M_temp = createEmptyMatrix(graph.num_vertices);
-    t_matrix M_result = createEmptyMatrix(graph.num_vertices);
-    
-    // Start with M^1
-    copyMatrix(M_power, M);
-    
-    // Calculate M^2 = M * M
-    multiplyMatrices(M_power, M, M_result);
-    copyMatrix(M_temp, M_result);
-    
-    // Calculate M^3 = M^2 * M
-    multiplyMatrices(M_temp, M, M_result);
-    copyMatrix(M_power, M_result);
-    
-    printf("Matrix M^3:\n");
-    printMatrix(M_power);
-    
-    // Calculate M^7
-    printf("Calculating M^7...\n");
-    // We already have M^3, so we need M^4, M^5, M^6, M^7
-    // M^4 = M^3 * M
-    multiplyMatrices(M_power, M, M_result);
-    copyMatrix(M_power, M_result);
-    // M^5 = M^4 * M
-    multiplyMatrices(M_power, M, M_result);
-    copyMatrix(M_power, M_result);
-    // M^6 = M^5 * M
-    multiplyMatrices(M_power, M, M_result);
-    copyMatrix(M_power, M_result);
-    // M^7 = M^6 * M
-    multiplyMatrices(M_power, M, M_result);
-    copyMatrix(M_power, M_result);
-    
-    printf("Matrix M^7:\n");
-    printMatrix(M_power);
-    
-    // Find convergence: calculate M^n until difference between M^n and M^(n-1) < epsilon
-    printf("Finding convergence (difference < 0.01)...\n");
-    float epsilon = 0.01f;
-    int n = 1;
-    t_matrix M_prev = createEmptyMatrix(graph.num_vertices);
-    copyMatrix(M_prev, M);
-    copyMatrix(M_power, M);
-    
-    float diff = 1.0f;
-    int max_iterations = 100;  // Safety limit to avoid infinite loops
-    
-    while (diff > epsilon && n < max_iterations)
+    printSparseMatrix(&run->M);
+
+    for (int p = 0; p < run->printed_power_count; p++)
     {
-        // Calculate next power: M_power = M_power * M
-        multiplyMatrices(M_power, M, M_result);
-        copyMatrix(M_temp, M_power);  // Save current M_power before updating
-        copyMatrix(M_power, M_result);  // Update M_power to next power
-        
-        // Calculate difference between M^n and M^(n-1)
-        diff = matrixDifference(M_power, M_temp);
-        
-        // Update for next iteration
-        copyMatrix(M_prev, M_power);
-        n++;
+        printf("Calculating M^%d...\n", run->printed_powers[p]);
+        printf("Matrix M^%d:\n", run->printed_powers[p]);
+        printSparseMatrix(&run->powers[p]);
     }
-    
-    if (n < max_iterations)
+
+    printf("Finding convergence (difference < %g)...\n", run->epsilon);
+    if (run->n < run->max_iterations)
     {
-        printf("Convergence reached at M^%d (difference = %.6f)\n", n, diff);
-        printf("Converged matrix M^%d:\n", n);
-        printMatrix(M_power);
+        printf("Convergence reached at M^%d (difference = %.6f)\n", run->n, run->diff);
+        printf("Converged matrix M^%d:\n", run->n);
+        printSparseMatrix(&run->M_power);
     }
     else
     {
-        printf("Warning: Convergence not reached after %d iterations (difference = %.6f)\n", 
-               max_iterations, diff);
+        printf("Warning: Convergence not reached after %d iterations (difference = %.6f)\n",
+               run->max_iterations, run->diff);
         printf("This graph may not have a stationary distribution.\n");
     }
-    
+
+    // The printed powers are not needed anymore
+    for (int p = 0; p < run->printed_power_count; p++)
+    {
+        freeSparseMatrix(&run->powers[p]);
+    }
+}
+
+// Part 3, STEP 2 and 3 computations: classes are independent, they run on the shared pool
+static void stage_class_analysis(void* argument)
+{
+    t_run* run = (t_run*)argument;
+
+    // Position of each vertex inside its class, shared by all the class views
+    run->class_positions = build_class_positions(&run->partition, run->graph.num_vertices);
+
+    // Choose the storage and the solver of each class from its size and density
+    // (without the stationary distributions only the periods are computed)
+    const t_plan* plan = NULL;
+    if (run->parts & RUN_STATIONARY)
+    {
+        run->plan = plan_representation(&run->partition, &run->graph, run->vertex_to_class,
+                                        &run->characteristics, run->memory_budget);
+        plan = &run->plan;
+    }
+
+    // Results from the cache are only used if they hold everything the command needs
+    int needed = run->parts & (RUN_STATIONARY | RUN_PERIOD);
+    if ((run->ready & needed) == needed)
+    {
+        return;
+    }
+    free_class_results(run->class_results, run->partition.class_count);
+    run->ready &= ~(RUN_STATIONARY | RUN_PERIOD);
+    analyze_classes(&run->graph, &run->partition, run->vertex_to_class, run->class_positions, &run->characteristics,
+                    plan, run->epsilon, run->max_iterations, run->pool, &run->class_results);
+}
+
+// End of STEP 2: how many classes were not printed, and the totals in summary mode
+static void print_stationary_summary(const t_run* run, int shown_classes)
+{
+    const t_partition* partition = &run->partition;
+    print_omitted(shown_classes, partition->class_count, "classes");
+    if (output_level() != OUTPUT_SUMMARY)
+    {
+        return;
+    }
+
+    int found = 0;
+    int skipped = 0;
+    int failed = 0;
+    for (int i = 0; i < partition->class_count; i++)
+    {
+        if (!run->characteristics.class_is_persistent[i])
+        {
+            continue;
+        }
+        if (run->class_results[i].stationary.converged)
+        {
+            found++;
+        }
+        else if (run->plan.classes[i].solver == SOLVER_SKIPPED)
+        {
+            skipped++;
+        }
+        else
+        {
+            failed++;
+        }
+    }
+    printf("Stationary distributions: %d found, %d not found, %d skipped (memory budget)\n",
+           found, failed, skipped);
+}
+
+// Part 3, STEP 2 and 3 report, in class order
+static void stage_class_report(void* argument)
+{
+    t_run* run = (t_run*)argument;
+    t_partition* partition = &run->partition;
+    char label[STATE_LABEL_SIZE];
+
+    print_part3_banner(run);
+
     // STEP 2: Properties of Markov graphs - Stationary distributions
-    printf("\nSTEP 2: Calculating stationary distributions for each class...\n");
-    printf("------------------------------------------------------------\n");
-    
-    // For each persistent class, calculate the stationary distribution
-    for (int i = 0; i < partition.class_count; i++)
-    {
-        if (characteristics.class_is_persistent[i])
-        {
-            printf("\nClass %s (persistent):\n", partition.classes[i].name);
-            
-            // Extract submatrix for this class
-            t_matrix sub = subMatrix(M, partition, i);
-            printf("Submatrix for class %s:\n", partition.classes[i].name);
-            printMatrix(sub);
-            
-            // Calculate powers until convergence
-            t_matrix sub_power = createEmptyMatrix(sub.rows);
-            t_matrix sub_result = createEmptyMatrix(sub.rows);
-            t_matrix sub_prev = createEmptyMatrix(sub.rows);
-            
-            copyMatrix(sub_power, sub);
-            copyMatrix(sub_prev, sub);
-            
-            float sub_diff = 1.0f;
-            int sub_n = 1;
-            
-            while (sub_diff > epsilon && sub_n < max_iterations)
+    if (run->parts & RUN_STATIONARY)
+    {
+        printf("\nSTEP 2: Calculating stationary distributions for each class...\n");
+        printf("------------------------------------------------------------\n");
+
+        print_plan(&run->plan, partition);
+    }
+
+    // For each class, print the stationary distribution (only the first classes of a large partition)
+    int shown_classes = output_preview(partition->class_count);
+    for (int i = 0; (run->parts & RUN_STATIONARY) && i < shown_classes; i++)
+    {
+        if (run->characteristics.class_is_persistent[i])
+        {
+            printf("\nClass %s (persistent):\n", partition->classes[i].name);
+
+            // View of the class over the graph: nothing is copied
+            t_class_view view = make_class_view(&run->graph, partition, run->vertex_to_class, run->class_positions, i);
+            t_solver_kind solver = run->plan.classes[i].solver;
+            if (solver == SOLVER_DENSE_POWERS || solver == SOLVER_TINY_KERNEL)
             {
-                multiplyMatrices(sub_power, sub, sub_result);
-                copyMatrix(sub_prev, sub_power);
-                copyMatrix(sub_power, sub_result);
-                
-                sub_diff = matrixDifference(sub_power, sub_prev);
-                sub_n++;
+                printf("Submatrix for class %s:\n", partition->classes[i].name);
+                print_class_view(&view);
             }
-            
-            if (sub_n < max_iterations)
+
+            t_stationary_result stationary = run->class_results[i].stationary;
+
+            if (stationary.converged)
             {
-                printf("Stationary distribution for class %s (from row 0 of M^%d):\n", 
-                       partition.classes[i].name, sub_n);
+                if (solver == SOLVER_DENSE_POWERS || solver == SOLVER_TINY_KERNEL)
+                {
+                    printf("Stationary distribution for class %s (from row 0 of M^%d):\n",
+                           partition->classes[i].name, stationary.iterations);
+                }
+                else if (solver == SOLVER_CLOSED_FORM)
+                {
+                    printf("Stationary distribution for class %s (closed form):\n", partition->classes[i].name);
+                }
+                else if (solver == SOLVER_DIRECT_LU)
+                {
+                    printf("Stationary distribution for class %s (direct LU solve):\n", partition->classes[i].name);
+                }
+                else
+                {
+                    printf("Stationary distribution for class %s (sparse iteration, %d steps):\n",
+                           partition->classes[i].name, stationary.iterations);
+                }
                 printf("  ");
-                for (int j = 0; j < sub_power.cols; j++)
+                int shown_states = output_preview(stationary.size);
+                for (int j = 0; j < shown_states; j++)
                 {
-                    printf("State %d: %.4f  ", partition.classes[i].members[j], sub_power.data[0][j]);
+                    printf("State %s: %.4f  ", state_label(run->graph.labels, partition->classes[i].members[j], label),
+                           stationary.stationary[j]);
                 }
                 printf("\n");
+                print_omitted(shown_states, stationary.size, "states");
+            }
+            else if (solver == SOLVER_SKIPPED)
+            {
+                printf("Warning: class %s does not fit in the memory budget, skipped\n",
+                       partition->classes[i].name);
             }
             else
             {
-                printf("Warning: Could not find stationary distribution for class %s\n", 
-                       partition.classes[i].name);
+                printf("Warning: Could not find stationary distribution for class %s\n",
+                       partition->classes[i].name);
             }
-            
-            freeMatrix(&sub);
-            freeMatrix(&sub_power);
-            freeMatrix(&sub_result);
-            freeMatrix(&sub_prev);
         }
         else
         {
-            printf("\nClass %s (transient): limiting distribution is zero\n", 
-                   partition.classes[i].name);
+            printf("\nClass %s (transient): limiting distribution is zero\n",
+                   partition->classes[i].name);
         }
     }
-    
+    if (run->parts & RUN_STATIONARY)
+    {
+        print_stationary_summary(run, shown_classes);
+    }
+
     // STEP 3 (bonus): Periodicity
-    printf("\nSTEP 3 (bonus): Calculating periods for each class...\n");
-    printf("------------------------------------------------------\n");
-    
-    for (int i = 0; i < partition.class_count; i++)
-    {
-        if (characteristics.class_is_persistent[i])
-        {
-            // Extract submatrix for this class
-            t_matrix sub = subMatrix(M, partition, i);
-            
-            // Calculate period
-            int period = getPeriod(sub);
-            
-            printf("Class %s: period = %d\n", partition.classes[i].name, period);
-            
+    if (run->parts & RUN_PERIOD)
+    {
+        printf("\nSTEP 3 (bonus): Calculating periods for each class...\n");
+        printf("------------------------------------------------------\n");
+    }
+
+    int periodic_count = 0;
+    int persistent_count = 0;
+    for (int i = 0; (run->parts & RUN_PERIOD) && i < partition->class_count; i++)
+    {
+        if (run->characteristics.class_is_persistent[i])
+        {
+            persistent_count++;
+            periodic_count += (run->class_results[i].period != 1);
+        }
+    }
+    for (int i = 0; (run->parts & RUN_PERIOD) && i < shown_classes; i++)
+    {
+        if (run->characteristics.class_is_persistent[i])
+        {
+            // Breadth-first search on the view of the class, computed with the distributions
+            int period = run->class_results[i].period;
+
+            printf("Class %s: period = %d\n", partition->classes[i].name, period);
+
             if (period == 1)
             {
                 printf("  -> This class is aperiodic (has a unique stationary distribution)\n");
@@ -323,30 +555,1383 @@ int main(int argc, char* argv[])
                 printf("  -> This class is periodic with period %d\n", period);
                 printf("  -> It may have multiple periodic stationary distributions\n");
             }
-            
-            freeMatrix(&sub);
         }
     }
-    
-    // Free matrix memory
-    freeMatrix(&M);
-    freeMatrix(&M_power);
-    freeMatrix(&M_temp);
-    freeMatrix(&M_result);
-    freeMatrix(&M_prev);
-    
+
+    if (run->parts & RUN_PERIOD)
+    {
+        print_omitted(shown_classes, partition->class_count, "classes");
+        if (output_level() == OUTPUT_SUMMARY)
+        {
+            printf("%d aperiodic classes, %d periodic classes\n", persistent_count - periodic_count, periodic_count);
+        }
+    }
+
+}
+
+// Part 3, STEP 4
+static void stage_passage_times(void* argument)
+{
+    t_run* run = (t_run*)argument;
+    adjacency_list* graph = &run->graph;
+    t_partition partition = run->partition;
+    int* vertex_to_class = run->vertex_to_class;
+    graph_characteristics* characteristics = &run->characteristics;
+    char label[STATE_LABEL_SIZE];
+
+    print_part3_banner(run);
+
+    // STEP 4: Mean first-passage and return times
+    printf("\nSTEP 4: Calculating mean first-passage and return times...\n");
+    printf("----------------------------------------------------------\n");
+
+    t_passage_engine passage = createPassageEngine(&run->M, graph, partition, vertex_to_class, characteristics,
+                                                   run->class_results, run->memory_budget);
+
+    // Times are only computed for the classes and states that are printed
+    int shown_classes = output_preview(partition.class_count);
+    for (int i = 0; i < shown_classes; i++)
+    {
+        if (!characteristics->class_is_persistent[i])
+        {
+            continue;
+        }
+
+        t_class* cls = &partition.classes[i];
+        printf("\nClass %s: expected return times\n  ", cls->name);
+        int shown_states = output_preview(cls->member_count);
+        for (int j = 0; j < shown_states; j++)
+        {
+            printf("State %s: %.4f  ", state_label(graph->labels, cls->members[j], label),
+                   expectedReturnTime(&passage, cls->members[j]));
+        }
+        printf("\n");
+        print_omitted(shown_states, cls->member_count, "states");
+
+        // The full table is only readable for small classes
+        if (cls->member_count > 1 && cls->member_count <= 10)
+        {
+            // All the targets of the class share one factorisation
+            passagePrepareTargets(&passage, cls->members, cls->member_count);
+            printf("Mean first-passage times (row = from, column = to):\n");
+            for (int a = 0; a < cls->member_count; a++)
+            {
+                printf("  %3s:", state_label(graph->labels, cls->members[a], label));
+                for (int b = 0; b < cls->member_count; b++)
+                {
+                    printf("  %8.4f", meanFirstPassageTime(&passage, cls->members[a], cls->members[b]));
+                }
+                printf("\n");
+            }
+        }
+    }
+
+    // Expected time spent before entering a persistent class
+    if (!characteristics->is_irreducible)
+    {
+        int* persistent_states = (int*)malloc(graph->num_vertices * sizeof(int));
+        int persistent_count = 0;
+        for (int v = 0; v < graph->num_vertices; v++)
+        {
+            if (characteristics->class_is_persistent[vertex_to_class[v]])
+            {
+                persistent_states[persistent_count] = v + 1;
+                persistent_count++;
+            }
+        }
+
+        t_hitting_times absorption = computeHittingTimes(&run->M, graph, partition, vertex_to_class,
+                                                         persistent_states, persistent_count, run->memory_budget);
+        printf("\nExpected number of steps before reaching a persistent class:\n");
+        int transient_count = graph->num_vertices - persistent_count;
+        int shown_states = output_preview(transient_count);
+        int printed = 0;
+        for (int v = 0; v < graph->num_vertices && printed < shown_states; v++)
+        {
+            if (!characteristics->class_is_persistent[vertex_to_class[v]])
+            {
+                printf("  State %s: %.4f\n", state_label(graph->labels, v + 1, label), absorption.times[v]);
+                printed++;
+            }
+        }
+        print_omitted(printed, transient_count, "transient states");
+
+        freeHittingTimes(&absorption);
+        free(persistent_states);
+    }
+
+    print_omitted(shown_classes, partition.class_count, "classes");
+
+    freePassageEngine(&passage);
+}
+
+// Part 3, STEP 5 computations and export (--transient): only needs the transition matrix
+static void stage_transient(void* argument)
+{
+    t_run* run = (t_run*)argument;
+    int n = run->graph.num_vertices;
+
+    // One distribution per start that is a state of the graph, or the uniform distribution
+    int start_count = 0;
+    for (int s = 0; s < run->transient_start_count; s++)
+    {
+        int start = run->transient_starts[s];
+        start_count += (start == TRANSIENT_ALL_STATES) ? n : (start <= n);
+    }
+    run->transient_status = -1;
+    run->transient_states = NULL;
+    run->distributions.values = NULL;
+    if (start_count == 0)
+    {
+        return;
+    }
+    run->transient_states = (int*)malloc(start_count * sizeof(int));
+    if (run->transient_states == NULL)
+    {
+        fatal_error("Could not allocate memory for the transient starts");
+    }
+    int d = 0;
+    for (int s = 0; s < run->transient_start_count; s++)
+    {
+        int start = run->transient_starts[s];
+        for (int v = 1; start == TRANSIENT_ALL_STATES && v <= n; v++)
+        {
+            run->transient_states[d++] = v;
+        }
+        if (start >= 0 && start <= n)
+        {
+            run->transient_states[d++] = start;
+        }
+    }
+
+    run->distributions = createDistributionBlock(n, start_count);
+    for (d = 0; d < start_count; d++)
+    {
+        if (run->transient_states[d] == 0)
+        {
+            setUniformDistribution(&run->distributions, d);
+        }
+        else
+        {
+            setPointDistribution(&run->distributions, d, run->transient_states[d]);
+        }
+    }
+
+    // The matrix powers stage already built M when the command prints the powers
+    t_sparse_matrix matrix = run->M;
+    if (!(run->parts & RUN_POWERS))
+    {
+        matrix = createSparseTransitionMatrix(&run->graph);
+    }
+    t_power_cache power_cache = createPowerCache();
+    run->transient_status = computeTransientDistributions(&matrix, &power_cache, &run->distributions,
+                                                          run->transient_horizons, run->transient_horizon_count,
+                                                          run->transient_filename);
+    freePowerCache(&power_cache);
+    if (!(run->parts & RUN_POWERS))
+    {
+        freeSparseMatrix(&matrix);
+    }
+}
+
+// Part 3, STEP 5 report
+static void stage_transient_report(void* argument)
+{
+    t_run* run = (t_run*)argument;
+    int n = run->graph.num_vertices;
+    char label[STATE_LABEL_SIZE];
+
+    print_part3_banner(run);
+
+    // STEP 5: Transient distributions
+    printf("\nSTEP 5: Calculating transient distributions...\n");
+    printf("----------------------------------------------\n");
+
+    for (int s = 0; s < run->transient_start_count; s++)
+    {
+        if (run->transient_starts[s] > n)
+        {
+            printf("Warning: transient start state %d does not exist, ignored\n", run->transient_starts[s]);
+        }
+    }
+
+    if (run->transient_status == 0)
+    {
+        int start_count = run->distributions.count;
+        int last = run->transient_horizons[run->transient_horizon_count - 1];
+        if (run->transient_filename != NULL)
+        {
+            printf("Distributions at t =");
+            for (int h = 0; h < run->transient_horizon_count; h++)
+            {
+                printf("%s %d", (h > 0) ? "," : "", run->transient_horizons[h]);
+            }
+            printf(" from %d starting points saved in '%s'\n", start_count, run->transient_filename);
+        }
+
+        int shown_starts = output_preview(start_count);
+        int shown_states = output_preview(n);
+        for (int d = 0; d < shown_starts && shown_states > 0; d++)
+        {
+            if (run->transient_states[d] == 0)
+            {
+                printf("Distribution after %d steps from the uniform distribution:\n  ", last);
+            }
+            else
+            {
+                printf("Distribution after %d steps from state %s:\n  ", last,
+                       state_label(run->graph.labels, run->transient_states[d], label));
+            }
+            for (int v = 0; v < shown_states; v++)
+            {
+                printf("State %s: %.4f  ", state_label(run->graph.labels, v + 1, label),
+                       run->distributions.values[(size_t)v * start_count + d]);
+            }
+            printf("\n");
+            print_omitted(shown_states, n, "states");
+        }
+        print_omitted(shown_starts, start_count, "starting points");
+    }
+    freeDistributionBlock(&run->distributions);
+    free(run->transient_states);
+}
+
+// First target of the simulation that is not a state of the graph (0 if they all are)
+static int missing_target(const t_simulation_options* simulation, int num_vertices)
+{
+    for (int t = 0; t < simulation->target_count; t++)
+    {
+        if (simulation->targets[t] < 1 || simulation->targets[t] > num_vertices)
+        {
+            return simulation->targets[t];
+        }
+    }
+    return 0;
+}
+
+// Part 3, STEP 6 (optional) computations: only needs the graph
+static void stage_simulation(void* argument)
+{
+    t_run* run = (t_run*)argument;
+    const t_simulation_options* simulation = run->simulation;
+
+    run->simulated = 0;
+    if (simulation->start_state >= 1 && simulation->start_state <= run->graph.num_vertices &&
+        missing_target(simulation, run->graph.num_vertices) == 0)
+    {
+        t_alias_table alias_table = build_alias_table(&run->graph);
+        run->estimates = simulate_trajectories(&alias_table, simulation);
+        free_alias_table(&alias_table);
+        run->simulated = 1;
+    }
+}
+
+// Part 3, STEP 6 (optional) report
+static void stage_simulation_report(void* argument)
+{
+    t_run* run = (t_run*)argument;
+
+    if (run->simulated)
+    {
+        printf("\nSTEP 6: Simulating trajectories...\n");
+        printf("----------------------------------\n");
+
+        print_simulation_result(&run->estimates, run->simulation, run->graph.labels);
+        free_simulation_result(&run->estimates);
+    }
+    else if (run->simulation->start_state < 1 || run->simulation->start_state > run->graph.num_vertices)
+    {
+        if (run->simulation->start_state != 0)
+        {
+            printf("\nWarning: simulation start state %d does not exist, simulation skipped\n",
+                   run->simulation->start_state);
+        }
+    }
+    else
+    {
+        printf("\nWarning: simulation target %d does not exist, simulation skipped\n",
+               missing_target(run->simulation, run->graph.num_vertices));
+    }
+}
+
+// Structured results (--export): runs alongside the reports, once the last result it needs is computed
+static void stage_results_export(void* argument)
+{
+    t_run* run = (t_run*)argument;
+
+    t_export_data data;
+    memset(&data, 0, sizeof(data));
+    data.graph_filename = run->graph_filename;
+    data.graph = &run->graph;
+    if (run->parts & RUN_CLASSES)
+    {
+        data.partition = &run->partition;
+    }
+    if (run->parts & RUN_LINKS)
+    {
+        data.links = &run->direct_links;
+        data.hasse_links = &run->hasse_links;
+    }
+    if (run->parts & RUN_CHARACTERISTICS)
+    {
+        data.characteristics = &run->characteristics;
+    }
+    if (run->parts & (RUN_STATIONARY | RUN_PERIOD))
+    {
+        data.class_results = run->class_results;
+    }
+    if (run->parts & RUN_STATIONARY)
+    {
+        data.plan = &run->plan;
+    }
+
+    run->export_status = export_results(&data, run->export_filename, run->export_csv_filename);
+}
+
+// Adds a report stage after the previous one (if any), so that the reports keep their order
+static int add_report_stage(t_pipeline* pipeline, const char* name, t_task_function run, void* argument,
+                            int previous)
+{
+    int stage = pipeline_add_stage(pipeline, name, run, argument);
+    if (previous >= 0)
+    {
+        pipeline_depends(pipeline, stage, previous);
+    }
+    return stage;
+}
+
+// Reads a comma separated list of states (room for strlen(text) / 2 + 1 of them)
+// Returns the number of states, -1 if one is not a number
+static int parse_targets(const char* text, int* targets)
+{
+    int count = 0;
+    const char* cursor = text;
+    while (*cursor != '\0')
+    {
+        char* end;
+        long value = strtol(cursor, &end, 10);
+        if (end == cursor || (*end != ',' && *end != '\0') || value < INT_MIN || value > INT_MAX)
+        {
+            return -1;
+        }
+        targets[count++] = (int)value;
+        cursor = end;
+        while (*cursor == ',')
+        {
+            cursor++;
+        }
+    }
+    return count;
+}
+
+// Reads a count of --steps or --trajectories: a number from 0 to INT_MAX - 1
+// Returns 0, -1 if the text is not such a number
+static int parse_count(const char* text, int* count)
+{
+    char* end;
+    long value = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || value < 0 || value >= INT_MAX)
+    {
+        return -1;
+    }
+    *count = (int)value;
+    return 0;
+}
+
+// Reads the comma separated starts of --transient: states, "uniform" (0) or "all" (TRANSIENT_ALL_STATES)
+// Returns the number of starts (room for strlen(text) / 2 + 1 of them), -1 if one is not valid
+static int parse_transient_starts(const char* text, int* starts)
+{
+    int count = 0;
+    const char* cursor = text;
+    while (*cursor != '\0')
+    {
+        char* end;
+        long value = strtol(cursor, &end, 10);
+        if (strncmp(cursor, "uniform", 7) == 0)
+        {
+            value = 0;
+            end = (char*)cursor + 7;
+        }
+        else if (strncmp(cursor, "all", 3) == 0)
+        {
+            value = TRANSIENT_ALL_STATES;
+            end = (char*)cursor + 3;
+        }
+        else if (end == cursor || value < 1 || value > INT_MAX)
+        {
+            return -1;
+        }
+        if (*end != ',' && *end != '\0')
+        {
+            return -1;
+        }
+        starts[count++] = (int)value;
+        cursor = end;
+        while (*cursor == ',')
+        {
+            cursor++;
+        }
+    }
+    return count;
+}
+
+// Reads a comma separated list of exponents, sorted and without duplicates
+// Returns the number of exponents kept (at most max_count), -1 if one is not positive
+static int parse_powers(const char* text, int* powers, int max_count)
+{
+    int count = 0;
+    const char* cursor = text;
+    while (*cursor != '\0')
+    {
+        char* end;
+        long value = strtol(cursor, &end, 10);
+        if (end == cursor || value < 1)
+        {
+            return -1;
+        }
+        cursor = end;
+        while (*cursor == ',')
+        {
+            cursor++;
+        }
+
+        // Insertion in increasing order
+        int position = count;
+        while (position > 0 && powers[position - 1] > value)
+        {
+            position--;
+        }
+        if ((position > 0 && powers[position - 1] == value) || count == max_count)
+        {
+            continue;
+        }
+        for (int k = count; k > position; k--)
+        {
+            powers[k] = powers[k - 1];
+        }
+        powers[position] = (int)value;
+        count++;
+    }
+    return count;
+}
+
+// Same parts, as RUN_* flags and as CACHED_* flags
+static const int cached_parts[][2] = {
+    {RUN_CLASSES, CACHED_PARTITION},
+    {RUN_LINKS, CACHED_LINKS},
+    {RUN_HASSE, CACHED_HASSE},
+    {RUN_CHARACTERISTICS, CACHED_CHARACTERISTICS},
+    {RUN_STATIONARY, CACHED_STATIONARY},
+    {RUN_PERIOD, CACHED_PERIODS},
+};
+
+// Moves the results of a cache entry into the run; the stages then skip their computations
+static void use_cached_results(t_run* run, t_cache_entry* entry)
+{
+    run->partition = entry->partition;
+    run->vertex_to_class = entry->vertex_to_class;
+    run->direct_links = entry->direct_links;
+    run->hasse_links = entry->hasse_links;
+    run->characteristics = entry->characteristics;
+    run->class_results = entry->class_results;
+    for (size_t p = 0; p < sizeof(cached_parts) / sizeof(cached_parts[0]); p++)
+    {
+        if (entry->contents & cached_parts[p][1])
+        {
+            run->ready |= cached_parts[p][0];
+        }
+    }
+}
+
+// Writes everything the run has computed or loaded, if it computed something new
+static void store_cached_results(const t_run* run, const t_cache* cache, t_cache_key key)
+{
+    int computed = run->parts & (RUN_CLASSES | RUN_CHARACTERISTICS);
+    if (run->parts & RUN_LINKS)
+    {
+        computed |= RUN_LINKS | RUN_HASSE;
+    }
+    if ((run->parts & (RUN_STATIONARY | RUN_PERIOD)) && !(run->ready & RUN_PERIOD))
+    {
+        computed |= RUN_PERIOD | (run->parts & RUN_STATIONARY);
+    }
+    if ((computed | run->ready) == run->ready || !((computed | run->ready) & RUN_CLASSES))
+    {
+        return;
+    }
+
+    t_cache_entry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.num_vertices = run->graph.num_vertices;
+    entry.partition = run->partition;
+    entry.vertex_to_class = run->vertex_to_class;
+    entry.direct_links = run->direct_links;
+    entry.hasse_links = run->hasse_links;
+    entry.characteristics = run->characteristics;
+    entry.class_results = run->class_results;
+    for (size_t p = 0; p < sizeof(cached_parts) / sizeof(cached_parts[0]); p++)
+    {
+        if ((computed | run->ready) & cached_parts[p][0])
+        {
+            entry.contents |= cached_parts[p][1];
+        }
+    }
+    if (store_cache_entry(cache, key, &entry) != 0)
+    {
+        printf("Warning: could not write the results in the cache '%s'\n", cache->directory);
+    }
+}
+
+// Online mode: reads a trajectory log line by line until its end (a pipe can stay open for ever)
+// and re-analyses the decayed graph every analysis_interval events
+static int follow_log(const char* filename, const t_online_options* options)
+{
+    FILE* input = (strcmp(filename, "-") == 0) ? stdin : fopen(filename, "rt");
+    if (input == NULL)
+    {
+        printf("Error: Could not find file '%s'\n", filename);
+        return EXIT_FAILURE;
+    }
+
+    t_online_estimator* estimator = create_online_estimator(options);
+    char* line = NULL;
+    size_t capacity = 0;
+    ssize_t length;
+    while ((length = getline(&line, &capacity, input)) >= 0)
+    {
+        if (length > 0 && line[length - 1] == '\n')
+        {
+            length--;
+        }
+        if (online_add_line(estimator, line, line + length))
+        {
+            online_analyse(estimator);
+        }
+    }
+    if (estimator->pending_events > 0 || estimator->rebuilds + estimator->reuses == 0)
+    {
+        online_analyse(estimator);
+    }
+
+    printf("\n%ld analyses: %ld rebuilt the classes, %ld kept them (probabilities only)\n",
+           estimator->rebuilds + estimator->reuses, estimator->rebuilds, estimator->reuses);
+    if (estimator->out_of_order > 0)
+    {
+        printf("Skipped: %ld events older than the previous event of their session\n", estimator->out_of_order);
+    }
+    if (estimator->malformed > 0)
+    {
+        printf("Skipped: %ld lines that are not \"session timestamp state\"\n", estimator->malformed);
+    }
+
+    free(line);
+    free_online_estimator(estimator);
+    if (input != stdin)
+    {
+        fclose(input);
+    }
+    return 0;
+}
+
+// Batch mode: every graph of a directory or manifest, analysed on a pool of workers
+static int analyse_batch(const char* path, const t_batch_options* options)
+{
+    int count = 0;
+    char** inputs = list_batch_inputs(path, &count);
+    if (inputs == NULL)
+    {
+        return EXIT_FAILURE;
+    }
+    if (count == 0)
+    {
+        printf("Warning: no graph file in '%s'\n", path);
+    }
+
+    t_batch_stats stats;
+    int status = run_batch(inputs, count, options, &stats);
+    // Nothing to report when the run could not start (run_batch printed why)
+    if (stats.files > 0 || count == 0)
+    {
+        print_batch_stats(&stats);
+        if (options->aggregate_filename != NULL)
+        {
+            printf("Results written to '%s'\n", options->aggregate_filename);
+        }
+        else
+        {
+            printf("Results written to '%s/'\n", options->output_directory);
+        }
+    }
+    free_batch_inputs(inputs, count);
+    return (status == 0) ? 0 : EXIT_FAILURE;
+}
+
+static void print_usage(const char* program)
+{
+    printf("Usage: %s [command] <graph file> [options]\n\nCommands:\n", program);
+    for (size_t c = 0; c < sizeof(commands) / sizeof(commands[0]); c++)
+    {
+        printf("  %-12s %s\n", commands[c].name, commands[c].description);
+    }
+    printf("\nOptions:\n");
+    printf("  --epsilon E           convergence threshold of the matrix powers (default 0.01)\n");
+    printf("  --max-iterations N    limit of the convergence loops (default 100)\n");
+    printf("  --powers 3,7          powers of M that are printed (default 3,7)\n");
+    printf("  --output LEVEL        summary, normal (previews of large results) or full\n");
+    printf("  --mermaid-limit N     edges of the Mermaid file, a sample above it (default %d, 0 = all)\n",
+           MERMAID_EDGE_LIMIT);
+    printf("  --labels              states are names, numbered in order of appearance (edge list, DOT)\n");
+    printf("  --log                 the file is a trajectory log \"session timestamp state\": the graph is estimated\n");
+    printf("  --smoothing A         with --log, pseudo-count added to every transition (default 0)\n");
+    printf("  --min-count N         with --log, transitions seen fewer times are dropped (default 0)\n");
+    printf("  --follow              the file (or - for stdin) is a trajectory log read as it grows, with\n");
+    printf("                        decayed counts (--half-life T, --prune W, --analysis-every N)\n");
+    printf("  --stationary-updates  with --follow, keep the stationary distributions, with rank-one updates\n");
+    printf("                        of the rows that changed\n");
+    printf("  --delta FILE          edge changes (+ from to p, - from to, = from to p) applied with the\n");
+    printf("                        classes updated incrementally\n");
+    printf("  --convert FILE        write the graph as FILE (.mtx Matrix Market, .dot Graphviz, else edge list)\n");
+    printf("  --hasse-dot FILE      Hasse diagram as a Graphviz file too\n");
+    printf("  --export FILE         JSON file of the classes, links, stationary distributions and periods\n");
+    printf("  --no-cache            neither read nor write the results of previous runs on the same graph\n");
+    printf("  --cache-dir DIR       directory of the cached results (default %s)\n", CACHE_DEFAULT_DIRECTORY);
+    printf("  --cache-size MB       the least recently used results are removed above this size (default %zu)\n",
+           CACHE_DEFAULT_SIZE >> 20);
+    printf("  --batch               the file is a directory of graphs, or a manifest (one graph file per line):\n");
+    printf("                        each graph is analysed fully and exported as JSON (as with --export)\n");
+    printf("  --batch-output DIR    with --batch, directory of the JSON files (default .); with --export FILE,\n");
+    printf("                        all the results go to FILE as one JSON array instead\n");
+    printf("  --serve SOCKET        keep the graph (or every graph of a directory) loaded and answer requests\n");
+    printf("                        on a Unix socket (CLASS, STATIONARY, PERIOD, REACH, LOAD..., see server.h)\n");
+    printf("  --no-arena            allocate the graph and analysis structures one by one with malloc\n");
+    printf("                        instead of from one arena (for memory debugging tools)\n");
+    printf("  --memory-budget MB    memory budget of one class analysis\n");
+    printf("  --threads T           number of threads (default 4)\n");
+    printf("  --transient LIST      distributions after each of --horizons steps (default 3,7) from the starts\n");
+    printf("                        of LIST: states, uniform (uniform distribution), all (every state)\n");
+    printf("  --transient-file FILE with --transient, binary file of the distributions at every horizon\n");
+    printf("  --simulate S          Monte Carlo run from state S (--targets, --trajectories, --steps, --seed)\n");
+    printf("  --walks FILE          random walk corpus only (--walk-length, --walks-per-vertex, --walk-format)\n");
+}
+
+int main(int argc, char* argv[])
+{
+    char filename[256];  // Array to store the filename
+    
+    // One large stdout buffer, written in chunks
+    init_output();
+    
+    // Optional command before the file name: only the stages it needs are run
+    const t_command* command = &commands[0];
+    int file_argument = 1;
+    if (argc >= 2 && (strcmp(argv[1], "help") == 0 || strcmp(argv[1], "--help") == 0))
+    {
+        print_usage(argv[0]);
+        return 0;
+    }
+    if (argc >= 2 && find_command(argv[1]) != NULL)
+    {
+        command = find_command(argv[1]);
+        file_argument = 2;
+    }
+    
+    // Check if a filename was provided as command line argument
+    if (argc > file_argument)
+    {
+        // If filename provided, use it
+        strncpy(filename, argv[file_argument], sizeof(filename) - 1);
+        filename[sizeof(filename) - 1] = '\0';
+    }
+    else
+    {
+        // If no filename provided, ask the user to enter it
+        printf("Enter the name of the input file: ");
+        flush_output();
+        scanf("%255s", filename);  // Read filename from user (max 255 characters)
+    }
+    
+    // Optional Monte Carlo run: --simulate <start> [--targets 3,4] [--trajectories N]
+    // [--steps L] [--threads T] [--seed S]
+    // --threads also sets the number of threads of the per-class analysis
+    t_simulation_options simulation;
+    simulation.start_state = 0;  // 0 = no simulation
+    simulation.targets = NULL;
+    simulation.target_count = 0;
+    simulation.trajectory_count = 100000;
+    simulation.max_steps = 100;
+    simulation.thread_count = 4;
+    simulation.seed = 1;
+    int* simulation_targets = NULL;
+
+    // Optional transient distributions: --transient <3,uniform> [--horizons 3,7] [--transient-file FILE]
+    int* transient_starts = NULL;
+    int transient_start_count = 0;
+    int transient_horizons[MAX_TRANSIENT_HORIZONS] = {3, 7};
+    int transient_horizon_count = 2;
+    const char* transient_filename = NULL;
+    
+    // Optional walk generation mode: --walks <file> [--walk-length L]
+    // [--walks-per-vertex R] [--walk-format text|binary] (uses --threads and --seed too)
+    const char* walks_filename = NULL;
+    t_walk_options walk_options = default_walk_options();
+    
+    // Memory budget of one class analysis: --memory-budget <MB>
+    size_t memory_budget = DEFAULT_MEMORY_BUDGET;
+    
+    // Matrix powers: --epsilon <E> --max-iterations <N> --powers <3,7>
+    float epsilon = 0.01f;
+    int max_iterations = 100;  // Safety limit to avoid infinite loops
+    int printed_powers[MAX_PRINTED_POWERS] = {3, 7};
+    int printed_power_count = 2;
+    
+    // Mermaid file: --mermaid-limit <edges>
+    long mermaid_limit = MERMAID_EDGE_LIMIT;
+    
+    // Structured results: --export <file.json>
+    const char* export_filename = NULL;
+    
+    // State names instead of numbers 1..n: --labels (edge list and DOT files)
+    int intern_labels = 0;
+    
+    // Trajectory log instead of a graph: --log [--smoothing A] [--min-count N] (uses --threads too)
+    int from_log = 0;
+    t_estimator_options estimator_options = default_estimator_options();
+    
+    // Online estimation: --follow [--half-life T] [--prune W] [--analysis-every N] [--stationary-updates]
+    int follow = 0;
+    t_online_options online_options = default_online_options();
+    
+    // Changes to the graph, classes updated incrementally: --delta <file>
+    const char* delta_filename = NULL;
+    
+    // Results of previous runs: [--no-cache] [--cache-dir DIR] [--cache-size MB]
+    int use_cache = 1;
+    t_cache cache = {CACHE_DEFAULT_DIRECTORY, CACHE_DEFAULT_SIZE};
+    
+    // Many graphs: --batch [--batch-output DIR] (the file is a directory or a manifest)
+    int batch = 0;
+    const char* batch_output = ".";
+    
+    // Resident chains answering requests: --serve <socket> (uses --threads and --labels too)
+    const char* socket_path = NULL;
+    
+    // Graph and analysis structures taken from one arena, freed at once: --no-arena to use malloc
+    int use_arena = 1;
+    
+    // Other formats: --convert <file.mtx|file.dot|file.txt> --hasse-dot <file.dot>
+    const char* convert_filename = NULL;
+    const char* hasse_dot_filename = NULL;
+    
+    // Options come in pairs "--name value", except the flags
+    for (int arg = file_argument + 1; arg < argc; arg += 2)
+    {
+        if (strcmp(argv[arg], "--labels") == 0)
+        {
+            intern_labels = 1;
+            arg--;  // No value
+        }
+        else if (strcmp(argv[arg], "--follow") == 0)
+        {
+            follow = 1;
+            arg--;  // No value
+        }
+        else if (strcmp(argv[arg], "--stationary-updates") == 0)
+        {
+            online_options.track_stationary = 1;
+            arg--;  // No value
+        }
+        else if (strcmp(argv[arg], "--log") == 0)
+        {
+            from_log = 1;
+            arg--;  // No value
+        }
+        else if (strcmp(argv[arg], "--no-cache") == 0)
+        {
+            use_cache = 0;
+            arg--;  // No value
+        }
+        else if (strcmp(argv[arg], "--batch") == 0)
+        {
+            batch = 1;
+            arg--;  // No value
+        }
+        else if (strcmp(argv[arg], "--no-arena") == 0)
+        {
+            use_arena = 0;
+            arg--;  // No value
+        }
+        else if (arg + 1 == argc)
+        {
+            printf("Warning: option '%s' without a value ignored\n", argv[arg]);
+        }
+        else if (strcmp(argv[arg], "--simulate") == 0)
+        {
+            simulation.start_state = atoi(argv[arg + 1]);
+        }
+        else if (strcmp(argv[arg], "--targets") == 0)
+        {
+            // Comma separated list of states (checked against the graph once it is read)
+            free(simulation_targets);
+            simulation_targets = (int*)malloc((strlen(argv[arg + 1]) / 2 + 1) * sizeof(int));
+            if (simulation_targets == NULL)
+            {
+                fatal_error("Could not allocate memory for the targets");
+            }
+            simulation.target_count = parse_targets(argv[arg + 1], simulation_targets);
+            if (simulation.target_count < 0)
+            {
+                printf("Error: invalid list of targets '%s' (state numbers separated by commas)\n", argv[arg + 1]);
+                free(simulation_targets);
+                return EXIT_FAILURE;
+            }
+            simulation.targets = simulation_targets;
+        }
+        else if (strcmp(argv[arg], "--trajectories") == 0 || strcmp(argv[arg], "--steps") == 0)
+        {
+            int* count = (strcmp(argv[arg], "--steps") == 0) ? &simulation.max_steps : &simulation.trajectory_count;
+            if (parse_count(argv[arg + 1], count) != 0)
+            {
+                printf("Error: invalid number of %s '%s' (a number from 0 on)\n", argv[arg] + 2, argv[arg + 1]);
+                free(transient_starts);
+                free(simulation_targets);
+                return EXIT_FAILURE;
+            }
+        }
+        else if (strcmp(argv[arg], "--threads") == 0)
+        {
+            simulation.thread_count = atoi(argv[arg + 1]);
+        }
+        else if (strcmp(argv[arg], "--seed") == 0)
+        {
+            simulation.seed = strtoull(argv[arg + 1], NULL, 10);
+        }
+        else if (strcmp(argv[arg], "--epsilon") == 0)
+        {
+            epsilon = strtof(argv[arg + 1], NULL);
+        }
+        else if (strcmp(argv[arg], "--max-iterations") == 0)
+        {
+            max_iterations = atoi(argv[arg + 1]);
+        }
+        else if (strcmp(argv[arg], "--transient") == 0)
+        {
+            free(transient_starts);
+            transient_starts = (int*)malloc((strlen(argv[arg + 1]) / 2 + 1) * sizeof(int));
+            if (transient_starts == NULL)
+            {
+                fatal_error("Could not allocate memory for the transient starts");
+            }
+            transient_start_count = parse_transient_starts(argv[arg + 1], transient_starts);
+            if (transient_start_count < 0)
+            {
+                printf("Error: invalid list of transient starts '%s' (states, uniform or all separated by commas)\n",
+                       argv[arg + 1]);
+                free(transient_starts);
+                free(simulation_targets);
+                return EXIT_FAILURE;
+            }
+        }
+        else if (strcmp(argv[arg], "--horizons") == 0)
+        {
+            int count = parse_powers(argv[arg + 1], transient_horizons, MAX_TRANSIENT_HORIZONS);
+            if (count < 0)
+            {
+                printf("Warning: invalid list of horizons '%s' ignored\n", argv[arg + 1]);
+            }
+            else
+            {
+                transient_horizon_count = count;
+            }
+        }
+        else if (strcmp(argv[arg], "--transient-file") == 0)
+        {
+            transient_filename = argv[arg + 1];
+        }
+        else if (strcmp(argv[arg], "--powers") == 0)
+        {
+            int count = parse_powers(argv[arg + 1], printed_powers, MAX_PRINTED_POWERS);
+            if (count < 0)
+            {
+                printf("Warning: invalid list of powers '%s' ignored\n", argv[arg + 1]);
+            }
+            else
+            {
+                printed_power_count = count;
+            }
+        }
+        else if (strcmp(argv[arg], "--output") == 0)
+        {
+            t_output_level level;
+            if (parse_output_level(argv[arg + 1], &level))
+            {
+                set_output_level(level);
+            }
+            else
+            {
+                printf("Warning: unknown output level '%s' ignored\n", argv[arg + 1]);
+            }
+        }
+        else if (strcmp(argv[arg], "--mermaid-limit") == 0)
+        {
+            mermaid_limit = strtol(argv[arg + 1], NULL, 10);
+        }
+        else if (strcmp(argv[arg], "--delta") == 0)
+        {
+            delta_filename = argv[arg + 1];
+        }
+        else if (strcmp(argv[arg], "--cache-dir") == 0)
+        {
+            cache.directory = argv[arg + 1];
+        }
+        else if (strcmp(argv[arg], "--cache-size") == 0)
+        {
+            cache.size_limit = (size_t)strtoull(argv[arg + 1], NULL, 10) << 20;
+        }
+        else if (strcmp(argv[arg], "--batch-output") == 0)
+        {
+            batch_output = argv[arg + 1];
+        }
+        else if (strcmp(argv[arg], "--serve") == 0)
+        {
+            socket_path = argv[arg + 1];
+        }
+        else if (strcmp(argv[arg], "--convert") == 0)
+        {
+            convert_filename = argv[arg + 1];
+        }
+        else if (strcmp(argv[arg], "--hasse-dot") == 0)
+        {
+            hasse_dot_filename = argv[arg + 1];
+        }
+        else if (strcmp(argv[arg], "--export") == 0)
+        {
+            export_filename = argv[arg + 1];
+        }
+        else if (strcmp(argv[arg], "--smoothing") == 0)
+        {
+            estimator_options.smoothing = strtod(argv[arg + 1], NULL);
+        }
+        else if (strcmp(argv[arg], "--min-count") == 0)
+        {
+            estimator_options.min_count = strtol(argv[arg + 1], NULL, 10);
+        }
+        else if (strcmp(argv[arg], "--half-life") == 0)
+        {
+            online_options.half_life = strtod(argv[arg + 1], NULL);
+        }
+        else if (strcmp(argv[arg], "--prune") == 0)
+        {
+            online_options.prune_weight = strtod(argv[arg + 1], NULL);
+        }
+        else if (strcmp(argv[arg], "--analysis-every") == 0)
+        {
+            online_options.analysis_interval = strtol(argv[arg + 1], NULL, 10);
+        }
+        else if (strcmp(argv[arg], "--memory-budget") == 0)
+        {
+            memory_budget = (size_t)strtoull(argv[arg + 1], NULL, 10) << 20;
+        }
+        else if (strcmp(argv[arg], "--walks") == 0)
+        {
+            walks_filename = argv[arg + 1];
+        }
+        else if (strcmp(argv[arg], "--walk-length") == 0)
+        {
+            walk_options.walk_length = atoi(argv[arg + 1]);
+        }
+        else if (strcmp(argv[arg], "--walks-per-vertex") == 0)
+        {
+            walk_options.walks_per_vertex = atoi(argv[arg + 1]);
+        }
+        else if (strcmp(argv[arg], "--walk-format") == 0)
+        {
+            walk_options.format = (strcmp(argv[arg + 1], "binary") == 0) ? WALK_FORMAT_BINARY : WALK_FORMAT_TEXT;
+        }
+        else
+        {
+            printf("Warning: unknown option '%s' ignored\n", argv[arg]);
+        }
+    }
+    
+    if (follow)
+    {
+        free(simulation_targets);
+        return follow_log(filename, &online_options);
+    }
+    
+    if (batch)
+    {
+        t_batch_options batch_options;
+        batch_options.thread_count = simulation.thread_count;
+        batch_options.output_directory = batch_output;
+        batch_options.aggregate_filename = export_filename;
+        batch_options.intern_labels = intern_labels;
+        batch_options.epsilon = epsilon;
+        batch_options.max_iterations = max_iterations;
+        batch_options.memory_budget = memory_budget;
+        batch_options.cache = use_cache ? &cache : NULL;
+        batch_options.use_arena = use_arena;
+        free(simulation_targets);
+        return analyse_batch(filename, &batch_options);
+    }
+    
+    if (socket_path != NULL)
+    {
+        t_server_options server_options;
+        server_options.socket_path = socket_path;
+        server_options.thread_count = simulation.thread_count;
+        server_options.intern_labels = intern_labels;
+        server_options.epsilon = epsilon;
+        server_options.max_iterations = max_iterations;
+        server_options.memory_budget = memory_budget;
+        free(simulation_targets);
+        return (run_server(filename, &server_options) == 0) ? 0 : EXIT_FAILURE;
+    }
+    
+    // Everything the run allocates for the graph and its analysis comes from this arena
+    // (the stages run in parallel: a shared one)
+    t_arena* arena = use_arena ? create_arena(1) : NULL;
+    set_run_arena(arena);
+    
     printf("\n========================================\n");
-    printf("  Part 3 analysis completed!\n");
+    printf("  Markov Graph Project - Part 1\n");
     printf("========================================\n\n");
 
-    free(vertex_to_class);
-    free_link_array(&direct_links);
-    free_link_array(&hasse_links);
-    free_partition(&partition);
-    free_graph_characteristics(&characteristics);
-    free_adjacency_list(&graph);
+    // STEP 1: Create a graph from file and display it
+    printf("STEP 1: Creating graph from file '%s'...\n", filename);
+    printf("----------------------------------------\n");
+
+    adjacency_list graph;
+    if (from_log)
+    {
+        // Maximum likelihood estimate of the transitions seen in the log
+        t_estimator_stats estimator_stats;
+        estimator_options.thread_count = simulation.thread_count;
+        graph = estimate_graph(filename, &estimator_options, &estimator_stats);
+        print_estimator_stats(&estimator_stats, graph.num_vertices);
+    }
+    else
+    {
+        graph = read_graph_file(filename, intern_labels);
+    }
+
+    printf("\nGraph loaded successfully!\n");
+    printf("Number of vertices: %d\n", graph.num_vertices);
+
+    // Edge changes: the classes found once are updated change by change instead of recomputed
+    t_dynamic_graph* dynamic = NULL;
+    if (delta_filename != NULL)
+    {
+        dynamic = create_dynamic_graph(&graph);
+        long changes = apply_delta_file(dynamic, delta_filename);
+        printf("Delta '%s': %ld changes applied, %d classes (%ld merged into others, %ld split off)\n",
+               delta_filename, changes, dynamic->class_count, dynamic->merges, dynamic->splits);
+    }
+
+    // Walk generation mode: only the alias tables are needed, skip the analysis
+    if (walks_filename != NULL)
+    {
+        walk_options.thread_count = simulation.thread_count;
+        walk_options.seed = simulation.seed;
+
+        struct timespec started, finished;
+        timespec_get(&started, TIME_UTC);
+        t_alias_table alias_table = build_alias_table(&graph);
+        long walk_count = generate_walks(&alias_table, &walk_options, walks_filename);
+        timespec_get(&finished, TIME_UTC);
+        double seconds = (double)(finished.tv_sec - started.tv_sec) + (finished.tv_nsec - started.tv_nsec) * 1e-9;
+
+        if (walk_count >= 0)
+        {
+            printf("%ld walks of length %d written to '%s' in %.3f s (%.0f walks/s)\n",
+                   walk_count, walk_options.walk_length, walks_filename, seconds,
+                   seconds > 0.0 ? walk_count / seconds : 0.0);
+        }
+
+        free_alias_table(&alias_table);
+        free_dynamic_graph(dynamic);
+        free_adjacency_list(&graph);
+        free(simulation_targets);
+        set_run_arena(NULL);
+        free_arena(arena);
+        return (walk_count >= 0) ? 0 : EXIT_FAILURE;
+    }
+
+    t_run run;
+    memset(&run, 0, sizeof(run));
+    run.graph = graph;
+    run.simulation = &simulation;
+    run.memory_budget = memory_budget;
+    run.epsilon = epsilon;
+    run.max_iterations = max_iterations;
+    memcpy(run.printed_powers, printed_powers, sizeof(printed_powers));
+    run.printed_power_count = printed_power_count;
+    run.parts = command->parts;
+    run.graph_filename = filename;
+    run.export_filename = export_filename;
+    run.mermaid_limit = mermaid_limit;
+    run.convert_filename = convert_filename;
+    run.hasse_dot_filename = hasse_dot_filename;
+    if (dynamic != NULL)
+    {
+        dynamic_snapshot(dynamic, &run.partition, &run.vertex_to_class, &run.direct_links, &run.characteristics);
+        run.ready = RUN_CLASSES | RUN_LINKS | RUN_CHARACTERISTICS;
+        free_dynamic_graph(dynamic);
+    }
+    if (simulation.start_state != 0)
+    {
+        run.parts |= RUN_SIMULATION;
+    }
+    if (transient_start_count > 0)
+    {
+        run.parts |= RUN_TRANSIENT;
+        run.transient_starts = transient_starts;
+        run.transient_start_count = transient_start_count;
+        run.transient_horizons = transient_horizons;
+        run.transient_horizon_count = transient_horizon_count;
+        run.transient_filename = transient_filename;
+    }
+
+    // Results of a previous run on the same graph with the same options
+    // (not with --delta: the classes it keeps up to date are not numbered like Tarjan's)
+    t_cache_key cache_key;
+    use_cache = use_cache && delta_filename == NULL && (run.parts & RUN_CLASSES);
+    if (use_cache)
+    {
+        cache_key = hash_analysis_input(&run.graph, epsilon, max_iterations, memory_budget);
+        t_cache_entry entry;
+        if (load_cache_entry(&cache, cache_key, &entry))
+        {
+            if (entry.num_vertices == run.graph.num_vertices && (entry.contents & CACHED_PARTITION))
+            {
+                use_cached_results(&run, &entry);
+                char key_text[33];
+                format_cache_key(cache_key, key_text);
+                printf("Results of a previous run loaded from the cache (key %s)\n", key_text);
+            }
+            else
+            {
+                free_cache_entry(&entry);
+            }
+        }
+    }
+
+    // Create output filename: extract just the filename part and add .mmd
+    // We write to the current directory (where the program runs from)
+    char* output_filename = run.output_filename;
+
+    // Find the last slash in the filename (to get just the filename part)
+    // Example: "data/exemple1.txt" -> we want "exemple1.mmd"
+    const char* last_slash = strrchr(filename, '/');
+    const char* last_backslash = strrchr(filename, '\\');
+    const char* name_start = filename;  // Start with whole filename
+
+    // If we found a slash, start after it
+    if (last_slash != NULL)
+    {
+        name_start = last_slash + 1;  // Point to character after the slash
+    }
+    if (last_backslash != NULL)
+    {
+        const char* after_backslash = last_backslash + 1;
+        // Use whichever comes later (slash or backslash)
+        if (after_backslash > name_start)
+        {
+            name_start = after_backslash;
+        }
+    }
+
+    // Copy the filename part (without the path)
+    strcpy(output_filename, name_start);
+
+    // Find the dot and replace .txt with .mmd
+    // Simple loop to find the dot
+    int i = 0;
+    while (output_filename[i] != '\0' && output_filename[i] != '.')
+    {
+        i++;
+    }
+
+    // If we found a dot, replace everything after it with .mmd
+    if (output_filename[i] == '.')
+    {
+        output_filename[i] = '\0';  // Cut the string at the dot
+    }
+
+    // Add .mmd extension
+    strcat(output_filename, ".mmd");
+
+    snprintf(run.hasse_filename, sizeof(run.hasse_filename), "classes_%s", output_filename);
+    if (export_filename != NULL)
+    {
+        // "results.json" -> "results_stationary.csv" (next to the JSON file)
+        const char* extension = strrchr(export_filename, '.');
+        int stem_length = (extension != NULL && strchr(extension, '/') == NULL) ?
+                          (int)(extension - export_filename) : (int)strlen(export_filename);
+        snprintf(run.export_csv_filename, sizeof(run.export_csv_filename), "%.*s_stationary.csv",
+                 stem_length, export_filename);
+    }
+
+    // The analysis is a small graph of stages on one shared pool (uses --threads).
+    // The report stages are chained so that the console output keeps its order;
+    // the exports and the computations that only need the graph run alongside them.
+    run.pool = create_thread_pool(simulation.thread_count);
+    t_pipeline pipeline;
+    init_pipeline(&pipeline, run.pool);
+
+    // Report stages, in the order of the console output
+    int report = -1;
+    int links = -1;
+    int characteristics = -1;
+    int powers = -1;
+    int results = -1;   // Last stage computing a result of the export
+    if (run.parts & RUN_DISPLAY)
+    {
+        report = add_report_stage(&pipeline, "display and validation", stage_display, &run, report);
+    }
+    if (run.parts & RUN_MERMAID)
+    {
+        pipeline_add_stage(&pipeline, "Mermaid export", stage_mermaid_export, &run);
+    }
+    if (convert_filename != NULL)
+    {
+        pipeline_add_stage(&pipeline, "graph conversion", stage_graph_conversion, &run);
+    }
+    if (run.parts & RUN_CLASSES)
+    {
+        results = report = add_report_stage(&pipeline, "Tarjan classes", stage_tarjan, &run, report);
+    }
+    if (run.parts & RUN_LINKS)
+    {
+        results = links = report = add_report_stage(&pipeline, "class links", stage_links, &run, report);
+    }
+    if (run.parts & RUN_HASSE)
+    {
+        int hasse = pipeline_add_stage(&pipeline, "Hasse export", stage_hasse_export, &run);
+        pipeline_depends(&pipeline, hasse, links);
+    }
+    if (run.parts & RUN_CHARACTERISTICS)
+    {
+        results = characteristics = report =
+            add_report_stage(&pipeline, "characteristics", stage_characteristics, &run, report);
+    }
+    if (run.parts & RUN_POWERS)
+    {
+        powers = pipeline_add_stage(&pipeline, "matrix powers", stage_matrix_powers, &run);
+        report = add_report_stage(&pipeline, "matrix report", stage_matrix_report, &run, report);
+        pipeline_depends(&pipeline, report, powers);
+    }
+    if (run.parts & (RUN_STATIONARY | RUN_PERIOD))
+    {
+        int classes = results = pipeline_add_stage(&pipeline, "class analysis", stage_class_analysis, &run);
+        pipeline_depends(&pipeline, classes, characteristics);
+        report = add_report_stage(&pipeline, "class report", stage_class_report, &run, report);
+        pipeline_depends(&pipeline, report, classes);
+    }
+    if (run.parts & RUN_PASSAGE)
+    {
+        report = add_report_stage(&pipeline, "passage times", stage_passage_times, &run, report);
+        pipeline_depends(&pipeline, report, powers);
+        pipeline_depends(&pipeline, report, characteristics);
+    }
+    if (run.parts & RUN_TRANSIENT)
+    {
+        int transient = pipeline_add_stage(&pipeline, "transient distributions", stage_transient, &run);
+        if (powers >= 0)
+        {
+            pipeline_depends(&pipeline, transient, powers);
+        }
+        report = add_report_stage(&pipeline, "transient report", stage_transient_report, &run, report);
+        pipeline_depends(&pipeline, report, transient);
+    }
+    if (run.parts & RUN_SIMULATION)
+    {
+        int simulate = pipeline_add_stage(&pipeline, "simulation", stage_simulation, &run);
+        report = add_report_stage(&pipeline, "simulation report", stage_simulation_report, &run, report);
+        pipeline_depends(&pipeline, report, simulate);
+    }
+
+    if (export_filename != NULL)
+    {
+        int export = pipeline_add_stage(&pipeline, "results export", stage_results_export, &run);
+        if (results >= 0)
+        {
+            pipeline_depends(&pipeline, export, results);
+        }
+    }
+
+    pipeline_run(&pipeline);
+    if (use_cache)
+    {
+        store_cached_results(&run, &cache, cache_key);
+    }
+
+    if (run.part3_started)
+    {
+        printf("\n========================================\n");
+        printf("  Part 3 analysis completed!\n");
+        printf("========================================\n\n");
+    }
+
+    // Files written in the background
+    if ((run.parts & RUN_MERMAID) && run.mermaid_status == 0)
+    {
+        printf("Mermaid file '%s' generated successfully!\n", run.output_filename);
+    }
+    else if ((run.parts & RUN_MERMAID) && run.mermaid_status > 0)
+    {
+        printf("Mermaid file '%s' generated with a sample of the graph (%d edges left out, see --mermaid-limit)\n",
+               run.output_filename, run.mermaid_status);
+    }
+    if ((run.parts & RUN_HASSE) && run.hasse_status == 0)
+    {
+        printf("Hasse diagram saved in '%s'\n", run.hasse_filename);
+    }
+    if ((run.parts & RUN_HASSE) && hasse_dot_filename != NULL && run.hasse_dot_status == 0)
+    {
+        printf("Hasse diagram saved in '%s'\n", hasse_dot_filename);
+    }
+    if (convert_filename != NULL && run.convert_status == 0)
+    {
+        printf("Graph written to '%s'\n", convert_filename);
+    }
+    if (export_filename != NULL && run.export_status == 0)
+    {
+        printf("Results exported to '%s'\n", export_filename);
+    }
+    printf("\n");
+    print_pipeline_timings(&pipeline);
+    if (arena != NULL)
+    {
+        printf("Arena: %zu KB peak, %zu KB reserved (--no-arena to use malloc)\n",
+               (arena_peak_bytes(arena) + 1023) >> 10, arena_reserved_bytes(arena) >> 10);
+    }
+
+    free_pipeline(&pipeline);
+    free_thread_pool(run.pool);
+    free(simulation_targets);
+    free(transient_starts);
+
+    // Free matrix memory
+    freeSparseMatrix(&run.M);
+    freeSparseMatrix(&run.M_power);
+
+    // Class results (read by the class report and the export)
+    free_class_results(run.class_results, run.partition.class_count);
+    free_plan(&run.plan);
+    free(run.class_positions);
+
+    free(run.vertex_to_class);
+    free_link_array(&run.direct_links);
+    free_link_array(&run.hasse_links);
+    free_partition(&run.partition);
+    free_graph_characteristics(&run.characteristics);
+    free_adjacency_list(&run.graph);
+    set_run_arena(NULL);
+    free_arena(arena);
 
-    printf("Program finished.\n\n");
+    printf("\nProgram finished.\n\n");
 
     return 0;
 }
@@ -0,0 +1,402 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+
+#include "markov.h"
+#include "utils.h"
+#include "scanner.h"
+#include "graph_io.h"
+#include "graph_analysis.h"
+#include "class_view.h"
+#include "planner.h"
+#include "class_analysis.h"
+#include "thread_pool.h"
+
+struct markov_context
+{
+    // Options of the analysis
+    float epsilon;
+    int max_iterations;
+    size_t memory_budget;
+
+    // Kept from one graph to the next
+    t_scanner scanner;         // File buffer, only grown when a file does not fit
+    t_thread_pool* pool;       // One thread: the classes are solved on the calling thread
+    t_arena* arena;            // Lists, cells, classes and links of the graph, emptied on each load
+
+    // Current graph and its analysis
+    adjacency_list graph;      // num_vertices = 0 when nothing is loaded
+    int analysed;
+    t_partition partition;
+    int* vertex_to_class;
+    t_link_array links;
+    int* successor_offsets;    // Links of class c: successors[successor_offsets[c]..successor_offsets[c + 1])
+    int* successors;
+    graph_characteristics characteristics;
+    int* positions;            // Position of each state in its class
+    t_plan plan;
+    t_class_result* class_results;
+
+    char error[256];
+};
+
+t_markov_context* markov_create_context(void)
+{
+    t_markov_context* context = (t_markov_context*)calloc(1, sizeof(t_markov_context));
+    if (context == NULL)
+    {
+        return NULL;
+    }
+    context->epsilon = 0.01f;
+    context->max_iterations = 100;
+    context->memory_budget = DEFAULT_MEMORY_BUDGET;
+    context->arena = create_arena(0);
+    return context;
+}
+
+void markov_set_options(t_markov_context* context, float epsilon, int max_iterations, size_t memory_budget)
+{
+    context->epsilon = epsilon;
+    context->max_iterations = max_iterations;
+    context->memory_budget = memory_budget;
+}
+
+static t_markov_status fail(t_markov_context* context, t_markov_status status, const char* message)
+{
+    snprintf(context->error, sizeof(context->error), "%s", message);
+    return status;
+}
+
+// Also frees what a failed analysis left (every field is NULL or complete)
+static void free_analysis(t_markov_context* context)
+{
+    free_class_results(context->class_results, context->partition.class_count);
+    free_plan(&context->plan);
+    free(context->positions);
+    free(context->successor_offsets);
+    free(context->successors);
+    free_graph_characteristics(&context->characteristics);
+    free_link_array(&context->links);
+    free(context->vertex_to_class);
+    free_partition(&context->partition);
+    context->class_results = NULL;
+    context->positions = NULL;
+    context->successor_offsets = NULL;
+    context->successors = NULL;
+    context->vertex_to_class = NULL;
+    context->analysed = 0;
+}
+
+static void free_graph(t_markov_context* context)
+{
+    free_analysis(context);
+    if (context->graph.lists != NULL)
+    {
+        free_adjacency_list(&context->graph);
+    }
+    memset(&context->graph, 0, sizeof(adjacency_list));
+    arena_reset(context->arena);
+}
+
+// The parse errors come back here instead of ending the program; the graph being read is lost
+// (its lists, cells, labels and the scratch arrays of the parser are in the arena, emptied by the next load)
+static t_markov_status parse_loaded(t_markov_context* context, const char* name, int intern_labels)
+{
+    t_arena* previous_arena = set_thread_arena(context->arena);
+    jmp_buf recovery;
+    if (setjmp(recovery) != 0)
+    {
+        set_thread_arena(previous_arena);
+        memset(&context->graph, 0, sizeof(adjacency_list));
+        return fail(context, MARKOV_ERROR_INPUT, last_error_message());
+    }
+    set_error_recovery(&recovery);
+    context->graph = read_graph_scanner(&context->scanner, name, intern_labels);
+    set_error_recovery(NULL);
+    set_thread_arena(previous_arena);
+    context->error[0] = '\0';
+    return MARKOV_OK;
+}
+
+t_markov_status markov_load_file(t_markov_context* context, const char* filename, int intern_labels)
+{
+    if (context == NULL || filename == NULL)
+    {
+        return MARKOV_ERROR_ARGUMENT;
+    }
+    free_graph(context);
+    if (refill_scanner(&context->scanner, filename) != 0)
+    {
+        snprintf(context->error, sizeof(context->error), "Could not find file '%s'", filename);
+        return MARKOV_ERROR_FILE;
+    }
+    return parse_loaded(context, filename, intern_labels);
+}
+
+t_markov_status markov_load_text(t_markov_context* context, const char* text, size_t size, const char* name,
+                                 int intern_labels)
+{
+    if (context == NULL || (text == NULL && size > 0) || name == NULL)
+    {
+        return MARKOV_ERROR_ARGUMENT;
+    }
+    free_graph(context);
+
+    jmp_buf recovery;
+    if (setjmp(recovery) != 0)
+    {
+        return fail(context, MARKOV_ERROR_INPUT, last_error_message());
+    }
+    set_error_recovery(&recovery);
+    refill_scanner_text(&context->scanner, text, size, name);
+    set_error_recovery(NULL);
+    return parse_loaded(context, name, intern_labels);
+}
+
+t_markov_status markov_set_edges(t_markov_context* context, int state_count, const int* from, const int* to,
+                                 const float* probability, long edge_count)
+{
+    if (context == NULL || state_count <= 0 || edge_count < 0 ||
+        (edge_count > 0 && (from == NULL || to == NULL || probability == NULL)))
+    {
+        return MARKOV_ERROR_ARGUMENT;
+    }
+    free_graph(context);
+    for (long e = 0; e < edge_count; e++)
+    {
+        if (from[e] < 1 || from[e] > state_count || to[e] < 1 || to[e] > state_count)
+        {
+            snprintf(context->error, sizeof(context->error), "edge %ld: %d -> %d outside of the states 1..%d",
+                     e, from[e], to[e], state_count);
+            return MARKOV_ERROR_ARGUMENT;
+        }
+    }
+
+    t_arena* previous_arena = set_thread_arena(context->arena);
+    jmp_buf recovery;
+    if (setjmp(recovery) != 0)
+    {
+        set_thread_arena(previous_arena);
+        memset(&context->graph, 0, sizeof(adjacency_list));
+        return fail(context, MARKOV_ERROR_INPUT, last_error_message());
+    }
+    set_error_recovery(&recovery);
+    // Same order as the files: one edge after the other
+    context->graph = create_empty_adjacency_list(state_count);
+    for (long e = 0; e < edge_count; e++)
+    {
+        add_cell_to_list(&context->graph.lists[from[e] - 1], to[e], probability[e]);
+    }
+    set_error_recovery(NULL);
+    set_thread_arena(previous_arena);
+    context->error[0] = '\0';
+    return MARKOV_OK;
+}
+
+// Links grouped by class, in link order (counting sort)
+static void build_successors(t_markov_context* context)
+{
+    int class_count = context->partition.class_count;
+    const t_link_array* links = &context->links;
+    context->successor_offsets = (int*)calloc((size_t)class_count + 1, sizeof(int));
+    context->successors = (int*)malloc((links->size > 0 ? (size_t)links->size : 1) * sizeof(int));
+    if (context->successor_offsets == NULL || context->successors == NULL)
+    {
+        fatal_error("Could not allocate memory for the class links");
+    }
+    for (int l = 0; l < links->size; l++)
+    {
+        context->successor_offsets[links->links[l].from + 1]++;
+    }
+    for (int c = 0; c < class_count; c++)
+    {
+        context->successor_offsets[c + 1] += context->successor_offsets[c];
+    }
+    int* next = (int*)malloc(((size_t)class_count + 1) * sizeof(int));
+    if (next == NULL)
+    {
+        fatal_error("Could not allocate memory for the class links");
+    }
+    memcpy(next, context->successor_offsets, ((size_t)class_count + 1) * sizeof(int));
+    for (int l = 0; l < links->size; l++)
+    {
+        context->successors[next[links->links[l].from]++] = links->links[l].to;
+    }
+    free(next);
+}
+
+t_markov_status markov_analyse(t_markov_context* context)
+{
+    if (context == NULL)
+    {
+        return MARKOV_ERROR_ARGUMENT;
+    }
+    if (context->graph.num_vertices == 0)
+    {
+        return fail(context, MARKOV_ERROR_NO_GRAPH, "no graph loaded");
+    }
+    free_analysis(context);
+
+    // On an error the structures of this analysis are freed (those in the arena are released to it),
+    // and so is the pool (its tasks did not finish): the next analysis starts a new one
+    t_arena* previous_arena = set_thread_arena(context->arena);
+    jmp_buf recovery;
+    if (setjmp(recovery) != 0)
+    {
+        set_thread_arena(previous_arena);
+        abandon_thread_pool(context->pool);
+        context->pool = NULL;
+        free_analysis(context);
+        return fail(context, MARKOV_ERROR_ANALYSIS, last_error_message());
+    }
+    set_error_recovery(&recovery);
+    if (context->pool == NULL)
+    {
+        context->pool = create_thread_pool(1);
+    }
+    const adjacency_list* graph = &context->graph;
+    context->partition = tarjan_partition_graph(graph, &context->vertex_to_class);
+    context->links = build_link_array(&context->partition, graph, context->vertex_to_class);
+    build_successors(context);
+    context->characteristics = compute_graph_characteristics(&context->partition, &context->links);
+    context->positions = build_class_positions(&context->partition, graph->num_vertices);
+    context->plan = plan_representation(&context->partition, graph, context->vertex_to_class,
+                                        &context->characteristics, context->memory_budget);
+    analyze_classes(graph, &context->partition, context->vertex_to_class, context->positions,
+                    &context->characteristics, &context->plan, context->epsilon, context->max_iterations,
+                    context->pool, &context->class_results);
+    set_error_recovery(NULL);
+    set_thread_arena(previous_arena);
+    context->analysed = 1;
+    context->error[0] = '\0';
+    return MARKOV_OK;
+}
+
+int markov_state_count(const t_markov_context* context)
+{
+    return (context != NULL) ? context->graph.num_vertices : -1;
+}
+
+int markov_class_count(const t_markov_context* context)
+{
+    return (context != NULL && context->analysed) ? context->partition.class_count : -1;
+}
+
+static int valid_state(const t_markov_context* context, int state)
+{
+    return context != NULL && context->analysed && state >= 1 && state <= context->graph.num_vertices;
+}
+
+static int valid_class(const t_markov_context* context, int class_index)
+{
+    return context != NULL && context->analysed && class_index >= 0 &&
+           class_index < context->partition.class_count;
+}
+
+int markov_class_of(const t_markov_context* context, int state)
+{
+    return valid_state(context, state) ? context->vertex_to_class[state - 1] : -1;
+}
+
+int markov_class_size(const t_markov_context* context, int class_index)
+{
+    return valid_class(context, class_index) ? context->partition.classes[class_index].member_count : -1;
+}
+
+const int* markov_class_members(const t_markov_context* context, int class_index)
+{
+    return valid_class(context, class_index) ? context->partition.classes[class_index].members : NULL;
+}
+
+const char* markov_class_name(const t_markov_context* context, int class_index)
+{
+    return valid_class(context, class_index) ? context->partition.classes[class_index].name : NULL;
+}
+
+int markov_class_is_persistent(const t_markov_context* context, int class_index)
+{
+    return valid_class(context, class_index) ? context->characteristics.class_is_persistent[class_index] : -1;
+}
+
+int markov_class_period(const t_markov_context* context, int class_index)
+{
+    if (!valid_class(context, class_index))
+    {
+        return -1;
+    }
+    return context->characteristics.class_is_persistent[class_index] ? context->class_results[class_index].period : 0;
+}
+
+const int* markov_class_successors(const t_markov_context* context, int class_index, int* count)
+{
+    if (!valid_class(context, class_index))
+    {
+        return NULL;
+    }
+    *count = context->successor_offsets[class_index + 1] - context->successor_offsets[class_index];
+    return context->successors + context->successor_offsets[class_index];
+}
+
+int markov_is_irreducible(const t_markov_context* context)
+{
+    return (context != NULL && context->analysed) ? context->characteristics.is_irreducible : -1;
+}
+
+int markov_has_absorbing_state(const t_markov_context* context)
+{
+    return (context != NULL && context->analysed) ? context->characteristics.has_absorbing_state : -1;
+}
+
+double markov_stationary_probability(const t_markov_context* context, int state)
+{
+    if (!valid_state(context, state))
+    {
+        return -1.0;
+    }
+    int c = context->vertex_to_class[state - 1];
+    if (!context->characteristics.class_is_persistent[c])
+    {
+        return 0.0;
+    }
+    const t_stationary_result* result = &context->class_results[c].stationary;
+    if (result->stationary == NULL)
+    {
+        return -1.0;
+    }
+    return result->stationary[context->positions[state - 1]];
+}
+
+int markov_find_state(const t_markov_context* context, const char* name, size_t length)
+{
+    if (context == NULL || name == NULL || context->graph.labels == NULL)
+    {
+        return -1;
+    }
+    int state = find_label(context->graph.labels, name, length);
+    return (state > 0) ? state : -1;
+}
+
+const char* markov_error_message(const t_markov_context* context)
+{
+    return (context != NULL) ? context->error : "";
+}
+
+void markov_free_context(t_markov_context* context)
+{
+    if (context == NULL)
+    {
+        return;
+    }
+    free_graph(context);
+    if (context->scanner.data != NULL)
+    {
+        close_scanner(&context->scanner);
+    }
+    if (context->pool != NULL)
+    {
+        free_thread_pool(context->pool);
+    }
+    free_arena(context->arena);
+    free(context);
+}
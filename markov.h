@@ -0,0 +1,78 @@
+#ifndef MARKOV_H
+#define MARKOV_H
+
+#include <stddef.h>
+
+// libmarkov: the analysis of the command-line tool as an in-process library
+// A context holds one graph and its analysis (classes, characteristics, stationary distributions,
+// periods) and keeps its buffers from one call to the next, so one context can analyse many
+// graphs in turn. The graph and its classes and links come from an arena of the context, emptied
+// at once when the next graph is loaded (analysing the same graph again keeps the previous ones
+// there until then). Errors are returned as status codes: the library never ends the program and
+// prints nothing.
+// A context is changed by one thread at a time; contexts used by different threads are independent.
+// Once analysed, the functions taking a const context can be called from several threads at once.
+// States are numbered 1..n, classes 0..class_count - 1 (in the order of the partition).
+
+typedef struct markov_context t_markov_context;
+
+typedef enum
+{
+    MARKOV_OK = 0,
+    MARKOV_ERROR_ARGUMENT = -1,    // NULL pointer, state or class out of range, edge outside of the states
+    MARKOV_ERROR_FILE = -2,        // The file cannot be read
+    MARKOV_ERROR_INPUT = -3,       // Malformed graph (the message gives the line)
+    MARKOV_ERROR_NO_GRAPH = -4,    // Nothing loaded, or not analysed yet
+    MARKOV_ERROR_ANALYSIS = -5     // Out of memory during the analysis
+} t_markov_status;
+
+// Function to create an empty context (NULL if out of memory)
+// Default options: epsilon 0.01, 100 iterations, memory budget of 512 MB for a class.
+t_markov_context* markov_create_context(void);
+
+// Function to set the options of the next analyses (see --epsilon, --max-iterations, --memory-budget)
+void markov_set_options(t_markov_context* context, float epsilon, int max_iterations, size_t memory_budget);
+
+// Functions to load a graph, which replaces the previous one and its analysis
+// The format comes from the extension of the name (edge list, .mtx, .dot/.gv); with intern_labels
+// the states are names, numbered in order of first appearance (see --labels).
+t_markov_status markov_load_file(t_markov_context* context, const char* filename, int intern_labels);
+// Same from text in memory (copied: the caller keeps it); name picks the format and appears in the messages
+t_markov_status markov_load_text(t_markov_context* context, const char* text, size_t size, const char* name,
+                                 int intern_labels);
+// Same from arrays of edges: edge e goes from from[e] to to[e] (1..state_count) with probability[e]
+t_markov_status markov_set_edges(t_markov_context* context, int state_count, const int* from, const int* to,
+                                 const float* probability, long edge_count);
+
+// Function to compute the classes, their characteristics, and the stationary distribution and
+// period of every persistent class (the same results as the "all" command)
+t_markov_status markov_analyse(t_markov_context* context);
+
+// Results of the last analysis; they stay valid until the next load
+// Functions returning a count or an index return -1 on a bad argument or before the analysis.
+int markov_state_count(const t_markov_context* context);
+int markov_class_count(const t_markov_context* context);
+int markov_class_of(const t_markov_context* context, int state);
+int markov_class_size(const t_markov_context* context, int class_index);
+const int* markov_class_members(const t_markov_context* context, int class_index);  // NULL on a bad argument
+const char* markov_class_name(const t_markov_context* context, int class_index);      // "C1"..., NULL on a bad argument
+int markov_class_is_persistent(const t_markov_context* context, int class_index);
+int markov_class_period(const t_markov_context* context, int class_index);          // 0 for a transient class
+// Classes reached by a direct link from a class (count set to their number; NULL on a bad argument)
+const int* markov_class_successors(const t_markov_context* context, int class_index, int* count);
+int markov_is_irreducible(const t_markov_context* context);
+int markov_has_absorbing_state(const t_markov_context* context);
+
+// Function to get the stationary probability of a state in its class
+// 0 for a transient state, -1 on a bad argument or if the distribution of its class was not found
+double markov_stationary_probability(const t_markov_context* context, int state);
+
+// Function to get the state of a name (graphs loaded with intern_labels), -1 if there is none
+int markov_find_state(const t_markov_context* context, const char* name, size_t length);
+
+// Function to get the message of the last error of the context ("" if there was none)
+const char* markov_error_message(const t_markov_context* context);
+
+void markov_free_context(t_markov_context* context);
+
+#endif
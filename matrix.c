@@ -1,5 +1,7 @@
 #include "matrix.h"
+#include "output.h"
 #include <math.h>
+#include <string.h>
 
 // Function to create a transition probability matrix from an adjacency list
 // We go through each vertex and its outgoing edges, and fill the matrix
@@ -32,18 +34,31 @@ t_matrix createTransitionMatrix(const adjacency_list* graph)
 
 // Function to create an empty matrix filled with zeros
 // We allocate a 2D array and initialize all values to 0.0
+// With an arena (see arena.h) the rows are taken one after the other from a single block
 t_matrix createEmptyMatrix(int n)
 {
     t_matrix matrix;
     matrix.rows = n;
     matrix.cols = n;
+    matrix.arena = current_arena();
+    
+    if (matrix.arena != NULL)
+    {
+        matrix.data = (float**)arena_alloc(matrix.arena, (size_t)n * sizeof(float*));
+        float* values = (float*)arena_alloc(matrix.arena, (size_t)n * n * sizeof(float));
+        memset(values, 0, (size_t)n * n * sizeof(float));
+        for (int i = 0; i < n; i++)
+        {
+            matrix.data[i] = values + (size_t)i * n;
+        }
+        return matrix;
+    }
     
     // Allocate memory for the array of row pointers
     matrix.data = (float**)malloc(n * sizeof(float*));
     if (matrix.data == NULL)
     {
-        printf("Error: cannot allocate memory for matrix rows\n");
-        exit(EXIT_FAILURE);
+        fatal_error("cannot allocate memory for matrix rows");
     }
     
     // Allocate memory for each row
@@ -52,8 +67,7 @@ t_matrix createEmptyMatrix(int n)
         matrix.data[i] = (float*)malloc(n * sizeof(float));
         if (matrix.data[i] == NULL)
         {
-            printf("Error: cannot allocate memory for matrix row %d\n", i);
-            exit(EXIT_FAILURE);
+            fatal_error("cannot allocate memory for matrix row %d", i);
         }
         
         // Initialize all values to 0.0
@@ -238,8 +252,7 @@ int getPeriod(t_matrix sub_matrix)
     int* periods = (int*)malloc(n * sizeof(int));
     if (periods == NULL)
     {
-        printf("Error: cannot allocate memory for periods array\n");
-        exit(EXIT_FAILURE);
+        fatal_error("cannot allocate memory for periods array");
     }
     
     int period_count = 0;  // How many periods we've found
@@ -295,19 +308,201 @@ int getPeriod(t_matrix sub_matrix)
     return period;
 }
 
+// Function to compute the LU factorisation of a dense square matrix
+// Classic Gaussian elimination: at each column we pick the largest pivot,
+// swap it to the diagonal, and store the elimination multipliers below it
+t_lu luFactorize(const double* values, int size)
+{
+    t_lu lu;
+    lu.size = size;
+    lu.singular = 0;
+    lu.factors = (double*)malloc((size_t)size * size * sizeof(double));
+    lu.pivots = (int*)malloc(size * sizeof(int));
+    if (lu.factors == NULL || lu.pivots == NULL)
+    {
+        fatal_error("cannot allocate memory for LU factorisation");
+    }
+    
+    // Work on a copy so that the caller keeps its matrix
+    for (size_t i = 0; i < (size_t)size * size; i++)
+    {
+        lu.factors[i] = values[i];
+    }
+    for (int i = 0; i < size; i++)
+    {
+        lu.pivots[i] = i;
+    }
+    
+    double* a = lu.factors;
+    for (int k = 0; k < size; k++)
+    {
+        // Find the row with the largest value in column k (partial pivoting)
+        int pivot_row = k;
+        double pivot_abs = fabs(a[(size_t)k * size + k]);
+        for (int i = k + 1; i < size; i++)
+        {
+            double candidate = fabs(a[(size_t)i * size + k]);
+            if (candidate > pivot_abs)
+            {
+                pivot_abs = candidate;
+                pivot_row = i;
+            }
+        }
+        
+        if (pivot_abs < 1e-12)
+        {
+            // Nothing usable in this column: the matrix is singular
+            lu.singular = 1;
+            continue;
+        }
+        
+        // Swap the pivot row into place
+        if (pivot_row != k)
+        {
+            for (int j = 0; j < size; j++)
+            {
+                double temp = a[(size_t)k * size + j];
+                a[(size_t)k * size + j] = a[(size_t)pivot_row * size + j];
+                a[(size_t)pivot_row * size + j] = temp;
+            }
+            int temp_index = lu.pivots[k];
+            lu.pivots[k] = lu.pivots[pivot_row];
+            lu.pivots[pivot_row] = temp_index;
+        }
+        
+        // Eliminate below the pivot, keeping the multipliers in place (this is L)
+        for (int i = k + 1; i < size; i++)
+        {
+            double factor = a[(size_t)i * size + k] / a[(size_t)k * size + k];
+            a[(size_t)i * size + k] = factor;
+            if (factor != 0.0)
+            {
+                for (int j = k + 1; j < size; j++)
+                {
+                    a[(size_t)i * size + j] -= factor * a[(size_t)k * size + j];
+                }
+            }
+        }
+    }
+    
+    return lu;
+}
+
+// Function to solve A * x = b from the LU factors
+// P * A = L * U, so we solve L * y = P * b (forward) then U * x = y (backward)
+void luSolve(const t_lu* lu, const double* rhs, double* solution)
+{
+    int n = lu->size;
+    const double* a = lu->factors;
+    double* y = (double*)malloc(n * sizeof(double));
+    if (y == NULL)
+    {
+        fatal_error("cannot allocate memory for LU solve");
+    }
+    
+    // Forward substitution with the unit lower triangle
+    for (int i = 0; i < n; i++)
+    {
+        double sum = rhs[lu->pivots[i]];
+        for (int j = 0; j < i; j++)
+        {
+            sum -= a[(size_t)i * n + j] * y[j];
+        }
+        y[i] = sum;
+    }
+    
+    // Backward substitution with the upper triangle
+    for (int i = n - 1; i >= 0; i--)
+    {
+        double sum = y[i];
+        for (int j = i + 1; j < n; j++)
+        {
+            sum -= a[(size_t)i * n + j] * y[j];
+        }
+        y[i] = sum / a[(size_t)i * n + i];
+    }
+    
+    for (int i = 0; i < n; i++)
+    {
+        solution[i] = y[i];
+    }
+    free(y);
+}
+
+// Function to solve A^T * x = b from the LU factors of A
+// A^T = U^T * L^T * P, so we solve U^T * w = b, then L^T * z = w, then x = P^T * z
+void luSolveTranspose(const t_lu* lu, const double* rhs, double* solution)
+{
+    int n = lu->size;
+    const double* a = lu->factors;
+    double* w = (double*)malloc(n * sizeof(double));
+    if (w == NULL)
+    {
+        fatal_error("cannot allocate memory for LU solve");
+    }
+    
+    // U^T is lower triangular: forward substitution
+    for (int i = 0; i < n; i++)
+    {
+        double sum = rhs[i];
+        for (int j = 0; j < i; j++)
+        {
+            sum -= a[(size_t)j * n + i] * w[j];
+        }
+        w[i] = sum / a[(size_t)i * n + i];
+    }
+    
+    // L^T is unit upper triangular: backward substitution
+    for (int i = n - 1; i >= 0; i--)
+    {
+        double sum = w[i];
+        for (int j = i + 1; j < n; j++)
+        {
+            sum -= a[(size_t)j * n + i] * w[j];
+        }
+        w[i] = sum;
+    }
+    
+    // Undo the row permutation
+    for (int i = 0; i < n; i++)
+    {
+        solution[lu->pivots[i]] = w[i];
+    }
+    free(w);
+}
+
+// Function to free the memory allocated for an LU factorisation
+void freeLU(t_lu* lu)
+{
+    free(lu->factors);
+    free(lu->pivots);
+    lu->factors = NULL;
+    lu->pivots = NULL;
+    lu->size = 0;
+    lu->singular = 0;
+}
+
 // Function to print a matrix (for debugging and validation)
+// Large matrices only show their top-left corner (see output.h)
 void printMatrix(t_matrix matrix)
 {
     printf("Matrix (%d x %d):\n", matrix.rows, matrix.cols);
-    for (int i = 0; i < matrix.rows; i++)
+    int shown_rows = output_preview(matrix.rows);
+    int shown_cols = output_preview(matrix.cols);
+    for (int i = 0; i < shown_rows; i++)
     {
         printf("  ");
-        for (int j = 0; j < matrix.cols; j++)
+        for (int j = 0; j < shown_cols; j++)
         {
             printf("%.4f  ", matrix.data[i][j]);
         }
+        if (shown_cols < matrix.cols)
+        {
+            printf("... (%d more)", matrix.cols - shown_cols);
+        }
         printf("\n");
     }
+    print_omitted(shown_rows, matrix.rows, "rows");
     printf("\n");
 }
 
@@ -319,6 +514,19 @@ void freeMatrix(t_matrix* matrix)
         return;
     }
     
+    // Give the block of the rows back to the arena
+    if (matrix->arena != NULL)
+    {
+        size_t n = (size_t)matrix->rows;
+        arena_release(matrix->arena, (n > 0) ? matrix->data[0] : NULL, n * n * sizeof(float));
+        arena_release(matrix->arena, matrix->data, n * sizeof(float*));
+        matrix->data = NULL;
+        matrix->rows = 0;
+        matrix->cols = 0;
+        matrix->arena = NULL;
+        return;
+    }
+    
     // Free each row
     for (int i = 0; i < matrix->rows; i++)
     {
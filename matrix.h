@@ -13,6 +13,7 @@ typedef struct
     float** data;      // 2D array: data[i][j] is the element at row i, column j
     int rows;          // Number of rows
     int cols;          // Number of columns (should equal rows for square matrices)
+    t_arena* arena;    // Arena of the rows (NULL: each row is malloc'd)
 } t_matrix;
 
 // Step 1: Matrix calculation functions
@@ -118,12 +119,66 @@ int gcd(int* vals, int nbvals);
  */
 int getPeriod(t_matrix sub_matrix);
 
+// Linear solvers (used by the first-passage module)
+
+// Structure to hold an LU factorisation with partial pivoting
+// The factors are stored packed in one row-major size x size array:
+// U on and above the diagonal, L (unit diagonal, not stored) below it
+typedef struct
+{
+    double* factors;   // Packed L and U factors
+    int* pivots;       // pivots[i] is the original row used as row i
+    int size;          // Dimension of the factorised matrix
+    int singular;      // 1 if a zero pivot was met (the solves are then meaningless)
+} t_lu;
+
+/**
+ * @brief Computes the LU factorisation of a dense square matrix
+ * 
+ * Gaussian elimination with partial pivoting: P * A = L * U.
+ * The input array is not modified. No inverse is ever formed, the factors
+ * are reused by luSolve / luSolveTranspose for as many right-hand sides as needed.
+ * 
+ * @param values The matrix in row-major order (size x size doubles)
+ * @param size The dimension of the matrix
+ * @return t_lu The factorisation (check the singular flag)
+ */
+t_lu luFactorize(const double* values, int size);
+
+/**
+ * @brief Solves A * x = b using a factorisation from luFactorize
+ * 
+ * @param lu The factorisation of A
+ * @param rhs The right-hand side b (size doubles)
+ * @param solution Where x is written (size doubles, may be the same array as rhs)
+ */
+void luSolve(const t_lu* lu, const double* rhs, double* solution);
+
+/**
+ * @brief Solves A^T * x = b using a factorisation of A
+ * 
+ * Useful for left eigenvectors (stationary distributions) without factorising A^T.
+ * 
+ * @param lu The factorisation of A
+ * @param rhs The right-hand side b (size doubles)
+ * @param solution Where x is written (size doubles, may be the same array as rhs)
+ */
+void luSolveTranspose(const t_lu* lu, const double* rhs, double* solution);
+
+/**
+ * @brief Frees the memory allocated for an LU factorisation
+ * 
+ * @param lu The factorisation to free
+ */
+void freeLU(t_lu* lu);
+
 // Utility functions
 
 /**
  * @brief Prints a matrix to the console
  * 
- * Displays the matrix in a readable format for debugging and validation
+ * Displays the matrix in a readable format for debugging and validation.
+ * Large matrices only show their top-left corner, depending on the output level (see output.h).
  * 
  * @param matrix The matrix to print
  */
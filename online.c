@@ -0,0 +1,376 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "online.h"
+#include "estimator.h"
+#include "output.h"
+
+// Above this exponent the scaled weights of a row are brought back to the current time
+#define ONLINE_MAX_EXPONENT 500.0
+
+static void* grow(void* block, size_t size)
+{
+    void* grown = realloc(block, size);
+    if (grown == NULL)
+    {
+        fatal_error("Could not allocate memory for the online estimator");
+    }
+    return grown;
+}
+
+t_online_options default_online_options(void)
+{
+    t_online_options options;
+    options.half_life = 3600.0;
+    options.prune_weight = 0.01;
+    options.analysis_interval = 100000;
+    options.track_stationary = 0;
+    return options;
+}
+
+t_online_estimator* create_online_estimator(const t_online_options* options)
+{
+    t_online_estimator* estimator = (t_online_estimator*)calloc(1, sizeof(t_online_estimator));
+    if (estimator == NULL)
+    {
+        fatal_error("Could not allocate memory for the online estimator");
+    }
+    estimator->options = *options;
+    estimator->decay_rate = (options->half_life > 0.0) ? log(2.0) / options->half_life : 0.0;
+    estimator->now = -HUGE_VAL;
+    estimator->sessions = create_label_table();
+    estimator->graph.lists = NULL;  // Grows with the states
+    estimator->graph.arena = NULL;  // Kept as long as the log is followed: malloc (no arena in this mode)
+    estimator->graph.num_vertices = 0;
+    estimator->graph.labels = create_label_table();
+    if (options->track_stationary)
+    {
+        estimator->stationary = create_stationary_tracker();
+    }
+    return estimator;
+}
+
+static void mark_dirty(t_online_estimator* estimator, int state)
+{
+    t_online_row* row = &estimator->rows[state - 1];
+    if (row->dirty)
+    {
+        return;
+    }
+    row->dirty = 1;
+    estimator->dirty_rows[estimator->dirty_count++] = state;
+}
+
+// State of a name, with a new empty row (and list) for a new name
+static int online_state(t_online_estimator* estimator, const char* name, size_t length)
+{
+    int state = intern_label(estimator->graph.labels, name, length);
+    if (state <= estimator->graph.num_vertices)
+    {
+        return state;
+    }
+
+    if (state > estimator->row_capacity)
+    {
+        int capacity = (estimator->row_capacity > 0) ? estimator->row_capacity * 2 : 1024;
+        estimator->rows = (t_online_row*)grow(estimator->rows, (size_t)capacity * sizeof(t_online_row));
+        estimator->dirty_rows = (int*)grow(estimator->dirty_rows, (size_t)capacity * sizeof(int));
+        estimator->graph.lists = (list*)grow(estimator->graph.lists, (size_t)capacity * sizeof(list));
+        estimator->row_capacity = capacity;
+    }
+    memset(&estimator->rows[state - 1], 0, sizeof(t_online_row));
+    estimator->graph.lists[state - 1] = create_empty_list();
+    estimator->graph.num_vertices = state;
+    estimator->structure_changed = 1;
+    mark_dirty(estimator, state);  // Gets its self-loop at the next refresh
+    return state;
+}
+
+// Adds one observed transition, O(1) apart from finding the edge in its row
+static void add_transition(t_online_estimator* estimator, int from, int to, double time)
+{
+    t_online_row* row = &estimator->rows[from - 1];
+    if (row->size == 0 && row->total == 0.0)
+    {
+        row->origin = time;
+    }
+
+    // Scaled weight of one observation now; the row is rescaled when the scale gets too large
+    double exponent = estimator->decay_rate * (time - row->origin);
+    if (exponent > ONLINE_MAX_EXPONENT)
+    {
+        double factor = exp(-exponent);
+        for (int e = 0; e < row->size; e++)
+        {
+            row->edges[e].weight *= factor;
+        }
+        row->total *= factor;
+        row->origin = time;
+        exponent = 0.0;
+    }
+    double weight = exp(exponent);
+
+    int e = 0;
+    while (e < row->size && row->edges[e].to != to)
+    {
+        e++;
+    }
+    if (e == row->size)
+    {
+        if (row->size == row->capacity)
+        {
+            row->capacity = (row->capacity > 0) ? row->capacity * 2 : 4;
+            row->edges = (t_online_edge*)grow(row->edges, (size_t)row->capacity * sizeof(t_online_edge));
+        }
+        row->edges[e].to = to;
+        row->edges[e].weight = 0.0;
+        row->size++;
+        estimator->edge_count++;
+        estimator->structure_changed = 1;
+    }
+    row->edges[e].weight += weight;
+    row->total += weight;
+    mark_dirty(estimator, from);
+}
+
+int online_add_line(t_online_estimator* estimator, const char* line, const char* end)
+{
+    t_log_event event;
+    int status = parse_log_event(line, end, &event);
+    if (status <= 0)
+    {
+        estimator->malformed += (status < 0);
+        return 0;
+    }
+
+    int known_sessions = estimator->sessions->count;
+    int session = intern_label(estimator->sessions, event.session, event.session_length);
+    int state = online_state(estimator, event.state, event.state_length);
+    estimator->events++;
+    estimator->pending_events++;
+    if (event.time > estimator->now)
+    {
+        estimator->now = event.time;
+    }
+
+    if (session > estimator->session_capacity)
+    {
+        int capacity = (estimator->session_capacity > 0) ? estimator->session_capacity * 2 : 1024;
+        estimator->session_state = (int*)grow(estimator->session_state, (size_t)capacity * sizeof(int));
+        estimator->session_time = (double*)grow(estimator->session_time, (size_t)capacity * sizeof(double));
+        estimator->session_capacity = capacity;
+    }
+    if (session <= known_sessions)
+    {
+        if (event.time < estimator->session_time[session - 1])
+        {
+            estimator->out_of_order++;
+            return estimator->pending_events >= estimator->options.analysis_interval;
+        }
+        add_transition(estimator, estimator->session_state[session - 1], state, event.time);
+        estimator->transitions++;
+    }
+    estimator->session_state[session - 1] = state;
+    estimator->session_time[session - 1] = event.time;
+    return estimator->pending_events >= estimator->options.analysis_interval;
+}
+
+// Rebuilds the list of one state from its row, after forgetting the transitions that decayed away
+static void renormalise_row(t_online_estimator* estimator, int state)
+{
+    t_online_row* row = &estimator->rows[state - 1];
+    row->dirty = 0;
+
+    // Decayed count now = scaled weight * exp(-rate * (now - origin))
+    double decay = exp(-estimator->decay_rate * (estimator->now - row->origin));
+    int kept = 0;
+    double total = 0.0;
+    for (int e = 0; e < row->size; e++)
+    {
+        if (row->edges[e].weight * decay >= estimator->options.prune_weight)
+        {
+            row->edges[kept++] = row->edges[e];
+            total += row->edges[e].weight;
+        }
+    }
+    if (kept < row->size)
+    {
+        estimator->edge_count -= row->size - kept;
+        estimator->structure_changed = 1;
+    }
+    row->size = kept;
+    row->total = total;
+
+    list* lst = &estimator->graph.lists[state - 1];
+    cell* current = lst->head;
+    while (current != NULL)
+    {
+        cell* next = current->next;
+        free(current);
+        current = next;
+    }
+    lst->head = NULL;
+
+    // Cells are added at the head: last edge first, so the list keeps the order of appearance
+    if (row->size == 0)
+    {
+        add_cell_to_list(lst, state, 1.0f);  // Never left (yet): absorbing
+        return;
+    }
+    for (int e = row->size - 1; e >= 0; e--)
+    {
+        add_cell_to_list(lst, row->edges[e].to, (float)(row->edges[e].weight / row->total));
+    }
+}
+
+int online_refresh(t_online_estimator* estimator)
+{
+    int count = estimator->dirty_count;
+    for (int d = 0; d < count; d++)
+    {
+        renormalise_row(estimator, estimator->dirty_rows[d]);
+    }
+    estimator->dirty_count = 0;
+    return count;
+}
+
+static void free_analysis(t_online_estimator* estimator)
+{
+    if (!estimator->analysed)
+    {
+        return;
+    }
+    free_graph_characteristics(&estimator->characteristics);
+    free_link_array(&estimator->links);
+    free_partition(&estimator->partition);
+    free(estimator->vertex_to_class);
+    estimator->vertex_to_class = NULL;
+    estimator->analysed = 0;
+}
+
+// Stationary distribution of the first persistent classes
+static void print_tracked_stationary(const t_online_estimator* estimator)
+{
+    char label[STATE_LABEL_SIZE];
+    const t_partition* partition = &estimator->partition;
+    int shown_classes = output_preview(partition->class_count);
+    for (int c = 0; c < shown_classes; c++)
+    {
+        if (!estimator->characteristics.class_is_persistent[c])
+        {
+            continue;
+        }
+        const t_class* cls = &partition->classes[c];
+        if (tracked_probability(estimator->stationary, cls->members[0]) < 0.0)
+        {
+            printf("Class %s: stationary distribution not tracked\n", cls->name);
+            continue;
+        }
+        printf("Stationary distribution for class %s:\n  ", cls->name);
+        int shown_states = output_preview(cls->member_count);
+        for (int j = 0; j < shown_states; j++)
+        {
+            printf("State %s: %.4f  ", state_label(estimator->graph.labels, cls->members[j], label),
+                   tracked_probability(estimator->stationary, cls->members[j]));
+        }
+        printf("\n");
+        print_omitted(shown_states, cls->member_count, "states");
+    }
+    print_omitted(shown_classes, partition->class_count, "classes");
+}
+
+void online_analyse(t_online_estimator* estimator)
+{
+    int renormalised = online_refresh(estimator);
+    estimator->pending_events = 0;
+    if (estimator->graph.num_vertices == 0)
+    {
+        printf("No events yet\n");
+        return;
+    }
+
+    // Probability drift alone does not change the classes, their links or their nature
+    int rebuilt = !estimator->analysed || estimator->structure_changed;
+    if (rebuilt)
+    {
+        free_analysis(estimator);
+        estimator->partition = tarjan_partition_graph(&estimator->graph, &estimator->vertex_to_class);
+        estimator->links = build_link_array(&estimator->partition, &estimator->graph, estimator->vertex_to_class);
+        estimator->characteristics = compute_graph_characteristics(&estimator->partition, &estimator->links);
+        estimator->analysed = 1;
+        estimator->structure_changed = 0;
+        estimator->rebuilds++;
+    }
+    else
+    {
+        estimator->reuses++;
+    }
+
+    // The rows renormalised by the refresh are still listed at the start of dirty_rows
+    t_stationary_tracker* tracker = estimator->stationary;
+    long updates = 0;
+    long factorisations = 0;
+    if (tracker != NULL)
+    {
+        updates = tracker->updates;
+        factorisations = tracker->factorisations;
+        if (rebuilt)
+        {
+            track_partition(tracker, &estimator->graph, &estimator->partition, &estimator->characteristics);
+        }
+        stationary_rows_changed(tracker, &estimator->graph, estimator->dirty_rows, renormalised);
+    }
+
+    int persistent = 0;
+    for (int i = 0; i < estimator->partition.class_count; i++)
+    {
+        persistent += (estimator->characteristics.class_is_persistent[i] != 0);
+    }
+    printf("t=%.10g: %ld events, %d states, %ld edges, %d rows renormalised, %d classes (%d persistent)%s, %s",
+           estimator->now, estimator->events, estimator->graph.num_vertices, estimator->edge_count, renormalised,
+           estimator->partition.class_count, persistent,
+           estimator->characteristics.is_irreducible ? ", irreducible" : "",
+           rebuilt ? "classes rebuilt" : "same structure");
+    if (tracker != NULL)
+    {
+        printf(", %ld rank-one updates, %ld classes factorised", tracker->updates - updates,
+               tracker->factorisations - factorisations);
+    }
+    printf("\n");
+    if (output_level() == OUTPUT_FULL)
+    {
+        if (rebuilt)
+        {
+            print_partition(&estimator->partition, estimator->graph.labels);
+            print_graph_characteristics(&estimator->partition, &estimator->characteristics, estimator->graph.labels);
+        }
+        if (tracker != NULL)
+        {
+            print_tracked_stationary(estimator);
+        }
+    }
+    flush_output();
+}
+
+void free_online_estimator(t_online_estimator* estimator)
+{
+    if (estimator == NULL)
+    {
+        return;
+    }
+    free_analysis(estimator);
+    for (int i = 0; i < estimator->graph.num_vertices; i++)
+    {
+        free(estimator->rows[i].edges);
+    }
+    free(estimator->rows);
+    free(estimator->dirty_rows);
+    free(estimator->session_state);
+    free(estimator->session_time);
+    free_label_table(estimator->sessions);
+    free_stationary_tracker(estimator->stationary);
+    free_adjacency_list(&estimator->graph);
+    free(estimator);
+}
@@ -0,0 +1,97 @@
+#ifndef ONLINE_H
+#define ONLINE_H
+
+#include "utils.h"
+#include "graph_analysis.h"
+#include "stationary_update.h"
+
+// Parameters of the online estimator
+typedef struct
+{
+    double half_life;          // Timestamp units after which a count weighs half (0 = no decay)
+    double prune_weight;       // Transitions whose decayed count falls below this are forgotten
+    long analysis_interval;    // Events between two re-analyses
+    int track_stationary;      // Keep the stationary distributions of the persistent classes
+} t_online_options;
+
+// Outgoing transition of a state, with its decayed count
+// The counts of a row are stored scaled by exp(rate * (time - row origin)), so that decaying
+// the whole row costs nothing: only the ratios matter for the probabilities.
+typedef struct
+{
+    int to;
+    double weight;
+} t_online_edge;
+
+typedef struct
+{
+    t_online_edge* edges;      // In order of first appearance
+    int size;
+    int capacity;
+    double total;              // Sum of the scaled weights
+    double origin;             // Time of the scale of the weights
+    int dirty;                 // Changed since the last renormalisation
+} t_online_row;
+
+// Long-running estimator: transitions come in one event at a time, the graph and its analysis
+// are refreshed on demand. Only the rows that changed are renormalised, and the Tarjan partition,
+// class links and characteristics are only rebuilt when the edge structure changed
+// (new state, new transition, forgotten transition).
+typedef struct
+{
+    t_online_options options;
+    double decay_rate;         // ln 2 / half_life
+    double now;                // Latest timestamp seen
+    t_label_table* sessions;
+    int* session_state;        // Last state of session s at session_state[s - 1]
+    double* session_time;
+    int session_capacity;
+    t_online_row* rows;        // Row of state i at rows[i - 1]
+    int row_capacity;
+    int* dirty_rows;           // States whose row changed since the last refresh
+    int dirty_count;
+    adjacency_list graph;      // Normalised rows (graph.labels holds the state names)
+    long edge_count;
+    int structure_changed;
+
+    // Counters
+    long events;
+    long transitions;
+    long out_of_order;
+    long malformed;
+    long pending_events;       // Events since the last analysis
+
+    // Analysis of the last structure
+    int analysed;
+    int* vertex_to_class;
+    t_partition partition;
+    t_link_array links;
+    graph_characteristics characteristics;
+    long rebuilds;             // Analyses that ran Tarjan again
+    long reuses;               // Analyses that kept the previous partition
+
+    // Stationary distributions of the persistent classes (NULL unless track_stationary): the
+    // renormalised rows are rank-one updates of their classes, only changed classes are factorised again
+    t_stationary_tracker* stationary;
+} t_online_estimator;
+
+// Function to get the default options (half-life 3600, prune below 0.01, analysis every 100000 events,
+// no stationary distributions)
+t_online_options default_online_options(void);
+
+t_online_estimator* create_online_estimator(const t_online_options* options);
+
+// Function to add one line "session timestamp state" of a trajectory log
+// Returns 1 when analysis_interval events arrived since the last analysis (time to call online_analyse)
+int online_add_line(t_online_estimator* estimator, const char* line, const char* end);
+
+// Function to renormalise the rows that changed; returns their number
+int online_refresh(t_online_estimator* estimator);
+
+// Function to refresh the graph and its analysis, and print one report line
+// (with the partition, characteristics and stationary distributions in full output mode)
+void online_analyse(t_online_estimator* estimator);
+
+void free_online_estimator(t_online_estimator* estimator);
+
+#endif
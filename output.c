@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "output.h"
+
+static t_output_level current_level = OUTPUT_NORMAL;
+
+// Lives as long as stdout: stdio keeps using it until the program exits
+static char output_buffer[OUTPUT_BUFFER_SIZE];
+
+void init_output(void)
+{
+    // Fully buffered: one write per OUTPUT_BUFFER_SIZE bytes instead of one per line on a terminal
+    setvbuf(stdout, output_buffer, _IOFBF, sizeof(output_buffer));
+}
+
+void set_output_level(t_output_level level)
+{
+    current_level = level;
+}
+
+t_output_level output_level(void)
+{
+    return current_level;
+}
+
+int parse_output_level(const char* name, t_output_level* level)
+{
+    if (strcmp(name, "summary") == 0)
+    {
+        *level = OUTPUT_SUMMARY;
+    }
+    else if (strcmp(name, "normal") == 0)
+    {
+        *level = OUTPUT_NORMAL;
+    }
+    else if (strcmp(name, "full") == 0)
+    {
+        *level = OUTPUT_FULL;
+    }
+    else
+    {
+        return 0;
+    }
+    return 1;
+}
+
+int output_preview(int total)
+{
+    switch (current_level)
+    {
+        case OUTPUT_SUMMARY:
+            return 0;
+        case OUTPUT_NORMAL:
+            return (total <= OUTPUT_PREVIEW_LIMIT) ? total : OUTPUT_PREVIEW_ITEMS;
+        default:
+            return total;
+    }
+}
+
+void print_omitted(int shown, int total, const char* what)
+{
+    // Summary mode already printed the counts
+    if (current_level != OUTPUT_SUMMARY && shown < total)
+    {
+        printf("  ... %d more %s\n", total - shown, what);
+    }
+}
+
+void flush_output(void)
+{
+    fflush(stdout);
+}
@@ -0,0 +1,42 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+// How much of the results is printed (--output summary|normal|full)
+typedef enum
+{
+    OUTPUT_SUMMARY,    // Sizes and counts only
+    OUTPUT_NORMAL,     // Everything for small results, a preview of the large ones
+    OUTPUT_FULL        // Everything
+} t_output_level;
+
+// Size of the stdout buffer: the console output is written in chunks of this size
+#define OUTPUT_BUFFER_SIZE ((size_t)4 << 20)
+
+// In normal mode, lists and matrices up to this size are printed in full...
+#define OUTPUT_PREVIEW_LIMIT 64
+
+// ...and only their first OUTPUT_PREVIEW_ITEMS rows / columns / entries above it
+#define OUTPUT_PREVIEW_ITEMS 16
+
+// Function to give stdout one large buffer (must be called before anything is printed)
+void init_output(void);
+
+// Function to set the output level (normal by default)
+void set_output_level(t_output_level level);
+
+// Function to get the current output level
+t_output_level output_level(void);
+
+// Function to read an output level name; returns 0 if the name is unknown
+int parse_output_level(const char* name, t_output_level* level);
+
+// Function to get how many of total items should be printed at the current level
+int output_preview(int total);
+
+// Function to print "  ... N more <what>" when only shown of total items were printed (not in summary mode)
+void print_omitted(int shown, int total, const char* what);
+
+// Function to write the buffered output
+void flush_output(void);
+
+#endif
@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "pipeline.h"
+#include "utils.h"
+
+static double now_seconds(void)
+{
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return (double)now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+void init_pipeline(t_pipeline* pipeline, t_thread_pool* pool)
+{
+    pipeline->stage_count = 0;
+    pipeline->pool = pool;
+    pipeline->group.pending = 0;
+    pipeline->started = 0.0;
+    pipeline->seconds = 0.0;
+    pthread_mutex_init(&pipeline->lock, NULL);
+}
+
+int pipeline_add_stage(t_pipeline* pipeline, const char* name, t_task_function run, void* argument)
+{
+    if (pipeline->stage_count >= PIPELINE_MAX_STAGES)
+    {
+        fatal_error("too many pipeline stages");
+    }
+    t_stage* stage = &pipeline->stages[pipeline->stage_count];
+    stage->pipeline = pipeline;
+    stage->name = name;
+    stage->run = run;
+    stage->argument = argument;
+    stage->dependency_count = 0;
+    stage->remaining = 0;
+    stage->start = 0.0;
+    stage->seconds = 0.0;
+    return pipeline->stage_count++;
+}
+
+void pipeline_depends(t_pipeline* pipeline, int stage, int dependency)
+{
+    t_stage* entry = &pipeline->stages[stage];
+    // Dependencies always point backwards: the graph cannot have a cycle
+    if (dependency < 0 || dependency >= stage || entry->dependency_count >= PIPELINE_MAX_DEPENDENCIES)
+    {
+        fatal_error("invalid dependency of stage '%s'", entry->name);
+    }
+    entry->dependencies[entry->dependency_count++] = dependency;
+}
+
+static void run_stage(void* argument)
+{
+    t_stage* stage = (t_stage*)argument;
+    t_pipeline* pipeline = stage->pipeline;
+    int index = (int)(stage - pipeline->stages);
+
+    double start = now_seconds();
+    stage->run(stage->argument);
+    stage->start = start - pipeline->started;
+    stage->seconds = now_seconds() - start;
+
+    // Release the stages that were only waiting for this one
+    int ready[PIPELINE_MAX_STAGES];
+    int ready_count = 0;
+    pthread_mutex_lock(&pipeline->lock);
+    for (int s = index + 1; s < pipeline->stage_count; s++)
+    {
+        t_stage* next = &pipeline->stages[s];
+        for (int d = 0; d < next->dependency_count; d++)
+        {
+            if (next->dependencies[d] == index)
+            {
+                next->remaining--;
+                if (next->remaining == 0)
+                {
+                    ready[ready_count++] = s;
+                }
+            }
+        }
+    }
+    pthread_mutex_unlock(&pipeline->lock);
+
+    for (int r = 0; r < ready_count; r++)
+    {
+        thread_pool_submit(pipeline->pool, &pipeline->group, run_stage, &pipeline->stages[ready[r]]);
+    }
+}
+
+void pipeline_run(t_pipeline* pipeline)
+{
+    pipeline->started = now_seconds();
+    for (int s = 0; s < pipeline->stage_count; s++)
+    {
+        pipeline->stages[s].remaining = pipeline->stages[s].dependency_count;
+    }
+    for (int s = 0; s < pipeline->stage_count; s++)
+    {
+        if (pipeline->stages[s].dependency_count == 0)
+        {
+            thread_pool_submit(pipeline->pool, &pipeline->group, run_stage, &pipeline->stages[s]);
+        }
+    }
+    thread_pool_wait(pipeline->pool, &pipeline->group);
+    pipeline->seconds = now_seconds() - pipeline->started;
+}
+
+void print_pipeline_timings(const t_pipeline* pipeline)
+{
+    printf("Stage timings (%d threads, %.3f s in total):\n", pipeline->pool->thread_count, pipeline->seconds);
+    double busy = 0.0;
+    for (int s = 0; s < pipeline->stage_count; s++)
+    {
+        const t_stage* stage = &pipeline->stages[s];
+        printf("  %-22s start %8.3f s  duration %8.3f s\n", stage->name, stage->start, stage->seconds);
+        busy += stage->seconds;
+    }
+    printf("  Sum of the stage durations: %.3f s\n", busy);
+}
+
+void free_pipeline(t_pipeline* pipeline)
+{
+    pthread_mutex_destroy(&pipeline->lock);
+    pipeline->stage_count = 0;
+}
@@ -0,0 +1,56 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "thread_pool.h"
+
+#define PIPELINE_MAX_STAGES 32
+#define PIPELINE_MAX_DEPENDENCIES 8
+
+struct t_pipeline;
+
+// One stage of the pipeline: runs once all the stages it depends on are finished
+typedef struct
+{
+    struct t_pipeline* pipeline;
+    const char* name;
+    t_task_function run;
+    void* argument;
+    int dependencies[PIPELINE_MAX_DEPENDENCIES];
+    int dependency_count;
+    int remaining;             // Dependencies not finished yet (protected by the pipeline lock)
+    double start;              // Seconds since pipeline_run, when the stage started
+    double seconds;            // Duration of the stage
+} t_stage;
+
+// Small DAG of stages run on a shared thread pool
+// A stage is submitted to the pool as soon as its last dependency finishes,
+// so independent stages (exports, background computations) overlap.
+typedef struct t_pipeline
+{
+    t_stage stages[PIPELINE_MAX_STAGES];
+    int stage_count;
+    t_thread_pool* pool;
+    t_task_group group;
+    pthread_mutex_t lock;
+    double started;            // Start time of pipeline_run (seconds)
+    double seconds;            // Wall time of pipeline_run
+} t_pipeline;
+
+// Function to create an empty pipeline running on the given pool
+void init_pipeline(t_pipeline* pipeline, t_thread_pool* pool);
+
+// Function to add a stage; returns its index, to be used in pipeline_depends
+int pipeline_add_stage(t_pipeline* pipeline, const char* name, t_task_function run, void* argument);
+
+// Function to declare that stage must wait for dependency (dependency must be added before stage)
+void pipeline_depends(t_pipeline* pipeline, int stage, int dependency);
+
+// Function to run every stage and wait for the last one
+void pipeline_run(t_pipeline* pipeline);
+
+// Function to print the start time and the duration of each stage
+void print_pipeline_timings(const t_pipeline* pipeline);
+
+void free_pipeline(t_pipeline* pipeline);
+
+#endif
@@ -0,0 +1,198 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "planner.h"
+#include "tiny_kernels.h"
+#include "output.h"
+
+// Number of class decisions printed one by one before switching to a summary
+#define PLAN_LOG_LIMIT 20
+
+static size_t dense_powers_bytes(long k)
+{
+    // sub, power, result and previous power: four k x k float matrices with their row pointers
+    return (size_t)4 * ((size_t)k * k * sizeof(float) + (size_t)k * sizeof(float*));
+}
+
+static size_t direct_lu_bytes(long k)
+{
+    // The double system and its packed factors
+    return (size_t)2 * (size_t)k * k * sizeof(double) + (size_t)k * sizeof(int);
+}
+
+static size_t sparse_iteration_bytes(long k, long nnz)
+{
+    // CSR submatrix plus three vectors
+    return (size_t)nnz * (sizeof(unsigned int) + sizeof(float)) + (size_t)(k + 1) * sizeof(unsigned int)
+           + (size_t)3 * k * sizeof(float);
+}
+
+t_plan plan_representation(const t_partition* partition, const adjacency_list* graph, const int* vertex_to_class,
+                           const graph_characteristics* characteristics, size_t memory_budget)
+{
+    t_plan plan;
+    plan.class_count = partition->class_count;
+    plan.memory_budget = memory_budget;
+    plan.classes = (t_class_plan*)calloc(partition->class_count > 0 ? partition->class_count : 1, sizeof(t_class_plan));
+    if (plan.classes == NULL)
+    {
+        fatal_error("cannot allocate representation plan");
+    }
+
+    // Count the edges that stay inside their class, in one pass over the graph
+    for (int v = 0; v < graph->num_vertices; v++)
+    {
+        int c = vertex_to_class[v];
+        for (cell* current = graph->lists[v].head; current != NULL; current = current->next)
+        {
+            if (vertex_to_class[current->arrival_vertex - 1] == c)
+            {
+                plan.classes[c].nnz++;
+            }
+        }
+    }
+
+    for (int c = 0; c < partition->class_count; c++)
+    {
+        t_class_plan* entry = &plan.classes[c];
+        long k = partition->classes[c].member_count;
+        entry->size = (int)k;
+        entry->density = (double)entry->nnz / ((double)k * (double)k);
+
+        if (!characteristics->class_is_persistent[c])
+        {
+            entry->storage = STORAGE_NONE;
+            entry->solver = SOLVER_NONE;
+            entry->estimated_bytes = 0;
+            continue;
+        }
+
+        size_t dense_bytes = dense_powers_bytes(k);
+        size_t lu_bytes = direct_lu_bytes(k);
+        size_t sparse_bytes = sparse_iteration_bytes(k, entry->nnz);
+
+        if (k <= 2)
+        {
+            // Absorbing state or pair of states: no matrix work at all
+            entry->storage = STORAGE_DENSE;
+            entry->solver = SOLVER_CLOSED_FORM;
+            entry->estimated_bytes = 0;
+        }
+        else if (k <= TINY_MAX_SIZE)
+        {
+            // Fixed-size kernel: everything stays on the stack
+            entry->storage = STORAGE_DENSE;
+            entry->solver = SOLVER_TINY_KERNEL;
+            entry->estimated_bytes = 0;
+        }
+        else if (k <= PLANNER_SMALL_CLASS && dense_bytes <= memory_budget)
+        {
+            // Tiny classes: the flat GEMM path has the least overhead
+            entry->storage = STORAGE_DENSE;
+            entry->solver = SOLVER_DENSE_POWERS;
+            entry->estimated_bytes = dense_bytes;
+        }
+        else if (entry->density >= PLANNER_DENSE_DENSITY && lu_bytes <= memory_budget)
+        {
+            // Dense enough that CSR saves nothing: one factorisation beats repeated k^3 products
+            entry->storage = STORAGE_DENSE;
+            entry->solver = SOLVER_DIRECT_LU;
+            entry->estimated_bytes = lu_bytes;
+        }
+        else if (sparse_bytes <= memory_budget)
+        {
+            entry->storage = STORAGE_SPARSE;
+            entry->solver = SOLVER_SPARSE_ITERATION;
+            entry->estimated_bytes = sparse_bytes;
+        }
+        else
+        {
+            entry->storage = STORAGE_NONE;
+            entry->solver = SOLVER_SKIPPED;
+            entry->estimated_bytes = sparse_bytes;
+        }
+    }
+
+    return plan;
+}
+
+const char* storage_name(t_storage_kind storage)
+{
+    switch (storage)
+    {
+        case STORAGE_DENSE:
+            return "dense";
+        case STORAGE_SPARSE:
+            return "sparse";
+        default:
+            return "none";
+    }
+}
+
+const char* solver_name(t_solver_kind solver)
+{
+    switch (solver)
+    {
+        case SOLVER_DENSE_POWERS:
+            return "dense powers";
+        case SOLVER_DIRECT_LU:
+            return "direct LU";
+        case SOLVER_SPARSE_ITERATION:
+            return "sparse power iteration";
+        case SOLVER_CLOSED_FORM:
+            return "closed form";
+        case SOLVER_TINY_KERNEL:
+            return "fixed-size kernel";
+        case SOLVER_SKIPPED:
+            return "skipped (over budget)";
+        default:
+            return "none";
+    }
+}
+
+void print_plan(const t_plan* plan, const t_partition* partition)
+{
+    printf("Representation plan (memory budget %.1f MB):\n", (double)plan->memory_budget / (1024.0 * 1024.0));
+
+    // Per-class lines: none in summary mode, all of them in full mode
+    int limit = PLAN_LOG_LIMIT;
+    if (output_level() == OUTPUT_SUMMARY)
+    {
+        limit = 0;
+    }
+    else if (output_level() == OUTPUT_FULL)
+    {
+        limit = plan->class_count;
+    }
+
+    int counts[SOLVER_SKIPPED + 1] = {0};
+    int printed = 0;
+    for (int c = 0; c < plan->class_count; c++)
+    {
+        const t_class_plan* entry = &plan->classes[c];
+        counts[entry->solver]++;
+        if (entry->solver == SOLVER_NONE)
+        {
+            continue;
+        }
+        if (printed < limit)
+        {
+            printf("- %s: %d states, %ld edges (density %.3f) -> %s storage, %s (~%zu bytes)\n",
+                   partition->classes[c].name, entry->size, entry->nnz, entry->density,
+                   storage_name(entry->storage), solver_name(entry->solver), entry->estimated_bytes);
+        }
+        printed++;
+    }
+    print_omitted(printed < limit ? printed : limit, printed, "persistent classes");
+    printf("Summary: %d closed form, %d fixed-size kernel, %d dense powers, %d direct LU, %d sparse iteration, "
+           "%d skipped, %d transient\n\n",
+           counts[SOLVER_CLOSED_FORM], counts[SOLVER_TINY_KERNEL], counts[SOLVER_DENSE_POWERS],
+           counts[SOLVER_DIRECT_LU], counts[SOLVER_SPARSE_ITERATION], counts[SOLVER_SKIPPED], counts[SOLVER_NONE]);
+}
+
+void free_plan(t_plan* plan)
+{
+    free(plan->classes);
+    plan->classes = NULL;
+    plan->class_count = 0;
+}
@@ -0,0 +1,69 @@
+#ifndef PLANNER_H
+#define PLANNER_H
+
+#include <stddef.h>
+
+#include "utils.h"
+#include "graph_analysis.h"
+
+// Default memory budget for one class analysis (bytes)
+#define DEFAULT_MEMORY_BUDGET ((size_t)512 << 20)
+
+// Classes up to this size always use the dense GEMM path
+// (the smallest ones, up to TINY_MAX_SIZE, use the fixed-size kernels)
+#define PLANNER_SMALL_CLASS 64
+
+// Above this density a class is considered dense
+#define PLANNER_DENSE_DENSITY 0.25
+
+typedef enum
+{
+    STORAGE_NONE,      // Nothing to store (transient class)
+    STORAGE_DENSE,     // Flat t_matrix
+    STORAGE_SPARSE     // CSR t_sparse_matrix
+} t_storage_kind;
+
+typedef enum
+{
+    SOLVER_NONE,            // Transient class: limiting distribution is zero
+    SOLVER_DENSE_POWERS,    // Powers of the dense submatrix until convergence
+    SOLVER_DIRECT_LU,       // One LU solve of the dense stationary system
+    SOLVER_SPARSE_ITERATION,// Power iteration of one vector over the CSR submatrix
+    SOLVER_CLOSED_FORM,     // 1 or 2 states: stationary distribution written directly
+    SOLVER_TINY_KERNEL,     // Up to TINY_MAX_SIZE states: fixed-size powers on the stack
+    SOLVER_SKIPPED          // Does not fit in the memory budget
+} t_solver_kind;
+
+typedef struct
+{
+    int size;                  // Number of states of the class
+    long nnz;                  // Number of edges inside the class
+    double density;            // nnz / size^2
+    t_storage_kind storage;
+    t_solver_kind solver;
+    size_t estimated_bytes;    // Working memory of the chosen solver
+} t_class_plan;
+
+typedef struct
+{
+    t_class_plan* classes;     // One plan per class of the partition
+    int class_count;
+    size_t memory_budget;      // Budget the plan was made for
+} t_plan;
+
+// Function to choose the storage and the solver of every class from its size and density,
+// so that the working memory of each class analysis stays under memory_budget
+t_plan plan_representation(const t_partition* partition, const adjacency_list* graph, const int* vertex_to_class,
+                           const graph_characteristics* characteristics, size_t memory_budget);
+
+// Function to print the plan: the classes (a preview, depending on the output level) and the number per solver
+void print_plan(const t_plan* plan, const t_partition* partition);
+
+// Functions to get the printed name of a storage kind and of a solver kind
+const char* storage_name(t_storage_kind storage);
+const char* solver_name(t_solver_kind solver);
+
+// Function to free the plans of the classes
+void free_plan(t_plan* plan);
+
+#endif
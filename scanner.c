@@ -0,0 +1,340 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "scanner.h"
+#include "utils.h"
+
+// Powers of ten that are exact in a float (5^10 < 2^24)
+static const float exact_powers[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+
+// Largest mantissa that is exact in a float
+#define EXACT_MANTISSA (1L << 24)
+
+static int is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static int is_word_char(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || is_digit(c) || c == '_' || c == '.';
+}
+
+// Makes room for size bytes and the final '\0', keeping the buffer when it is large enough
+// Returns -1 if it cannot be allocated
+static int reserve_buffer(t_scanner* scanner, size_t size)
+{
+    if (scanner->data == NULL || size + 1 > scanner->capacity)
+    {
+        free(scanner->data);
+        scanner->capacity = size + 1;
+        scanner->data = (char*)malloc(scanner->capacity);
+        if (scanner->data == NULL)
+        {
+            scanner->capacity = 0;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void rewind_scanner(t_scanner* scanner)
+{
+    scanner->data[scanner->size] = '\0';
+    scanner->cursor = scanner->data;
+    scanner->end = scanner->data + scanner->size;
+    scanner->line = 1;
+}
+
+// Reads a whole file into the buffer of the scanner, which grows if the file does not fit
+static int read_whole_file(t_scanner* scanner, const char* filename)
+{
+    FILE* file = fopen(filename, "rb");
+    if (file == NULL)
+    {
+        return -1;
+    }
+
+    // One read of the whole file
+    long size = -1;
+    if (fseek(file, 0, SEEK_END) == 0)
+    {
+        size = ftell(file);
+        rewind(file);
+    }
+    if (size < 0)
+    {
+        fclose(file);
+        return -1;
+    }
+
+    if (reserve_buffer(scanner, (size_t)size) != 0)
+    {
+        fclose(file);
+        fatal_error("Could not allocate memory for '%s' (%ld bytes)", filename, size);
+    }
+    scanner->size = fread(scanner->data, 1, (size_t)size, file);
+    fclose(file);
+    rewind_scanner(scanner);
+    return 0;
+}
+
+int open_scanner(t_scanner* scanner, const char* filename)
+{
+    scanner->data = NULL;
+    scanner->capacity = 0;
+    int status = read_whole_file(scanner, filename);
+    if (status != 0)
+    {
+        close_scanner(scanner);
+    }
+    return status;
+}
+
+int refill_scanner(t_scanner* scanner, const char* filename)
+{
+    return read_whole_file(scanner, filename);
+}
+
+void refill_scanner_text(t_scanner* scanner, const char* text, size_t size, const char* name)
+{
+    if (reserve_buffer(scanner, size) != 0)
+    {
+        fatal_error("Could not allocate memory for '%s' (%zu bytes)", name, size);
+    }
+    memcpy(scanner->data, text, size);
+    scanner->size = size;
+    rewind_scanner(scanner);
+}
+
+void skip_spaces(t_scanner* scanner)
+{
+    const char* c = scanner->cursor;
+    while (c < scanner->end && (*c == ' ' || *c == '\t' || *c == '\n' || *c == '\r' || *c == '\v' || *c == '\f'))
+    {
+        scanner->line += (*c == '\n');
+        c++;
+    }
+    scanner->cursor = c;
+}
+
+void skip_blanks(t_scanner* scanner)
+{
+    const char* c = scanner->cursor;
+    while (c < scanner->end && (*c == ' ' || *c == '\t' || *c == '\r'))
+    {
+        c++;
+    }
+    scanner->cursor = c;
+}
+
+void skip_line(t_scanner* scanner)
+{
+    const char* c = scanner->cursor;
+    while (c < scanner->end && *c != '\n')
+    {
+        c++;
+    }
+    if (c < scanner->end)
+    {
+        c++;
+        scanner->line++;
+    }
+    scanner->cursor = c;
+}
+
+int scanner_at_end(t_scanner* scanner)
+{
+    skip_spaces(scanner);
+    return scanner->cursor >= scanner->end;
+}
+
+int scan_long(t_scanner* scanner, long* value)
+{
+    skip_spaces(scanner);
+    const char* c = scanner->cursor;
+    int negative = 0;
+    if (c < scanner->end && (*c == '-' || *c == '+'))
+    {
+        negative = (*c == '-');
+        c++;
+    }
+    if (c >= scanner->end || !is_digit(*c))
+    {
+        return 0;
+    }
+
+    long result = 0;
+    while (c < scanner->end && is_digit(*c))
+    {
+        int digit = *c - '0';
+        if (result > (LONG_MAX - digit) / 10)
+        {
+            return 0;
+        }
+        result = result * 10 + digit;
+        c++;
+    }
+
+    *value = negative ? -result : result;
+    scanner->cursor = c;
+    return 1;
+}
+
+int scan_int(t_scanner* scanner, int* value)
+{
+    const char* start = scanner->cursor;
+    long result;
+    if (!scan_long(scanner, &result))
+    {
+        return 0;
+    }
+    if (result < INT_MIN || result > INT_MAX)
+    {
+        scanner->cursor = start;
+        return 0;
+    }
+    *value = (int)result;
+    return 1;
+}
+
+int scan_float(t_scanner* scanner, float* value)
+{
+    skip_spaces(scanner);
+    const char* start = scanner->cursor;
+    const char* c = start;
+
+    // Fast path: a mantissa below 2^24 and at most 10 decimals, m * 10^e is then
+    // one correctly rounded float operation, which is exactly what strtof returns
+    int negative = 0;
+    if (c < scanner->end && (*c == '-' || *c == '+'))
+    {
+        negative = (*c == '-');
+        c++;
+    }
+    long mantissa = 0;
+    int exponent = 0;
+    int digits = 0;
+    int exact = 1;
+    while (c < scanner->end && is_digit(*c))
+    {
+        if (exact)
+        {
+            mantissa = mantissa * 10 + (*c - '0');
+            exact = (mantissa < EXACT_MANTISSA);
+        }
+        digits++;
+        c++;
+    }
+    if (c < scanner->end && *c == '.')
+    {
+        c++;
+        while (c < scanner->end && is_digit(*c))
+        {
+            if (exact)
+            {
+                mantissa = mantissa * 10 + (*c - '0');
+                exact = (mantissa < EXACT_MANTISSA);
+            }
+            exponent--;
+            digits++;
+            c++;
+        }
+    }
+    if (c < scanner->end && (*c == 'e' || *c == 'E'))
+    {
+        exact = 0;
+    }
+
+    if (digits > 0 && exact && exponent >= -10)
+    {
+        float result = (exponent < 0) ? (float)mantissa / exact_powers[-exponent] : (float)mantissa;
+        *value = negative ? -result : result;
+        scanner->cursor = c;
+        return 1;
+    }
+
+    // Everything else (long mantissas, exponents, inf, nan, hexadecimal): the C library
+    char* parsed_end;
+    float result = strtof(start, &parsed_end);
+    if (parsed_end == start)
+    {
+        return 0;
+    }
+    *value = result;
+    scanner->cursor = parsed_end;
+    return 1;
+}
+
+size_t scan_word(t_scanner* scanner, const char** word)
+{
+    skip_spaces(scanner);
+    const char* c = scanner->cursor;
+    if (c < scanner->end && *c == '"')
+    {
+        const char* start = ++c;
+        while (c < scanner->end && *c != '"')
+        {
+            if (*c == '\\' && c + 1 < scanner->end)
+            {
+                c++;
+            }
+            scanner->line += (*c == '\n');
+            c++;
+        }
+        *word = start;
+        size_t length = (size_t)(c - start);
+        scanner->cursor = (c < scanner->end) ? c + 1 : c;
+        return length;
+    }
+
+    const char* start = c;
+    while (c < scanner->end && is_word_char(*c))
+    {
+        c++;
+    }
+    *word = start;
+    scanner->cursor = c;
+    return (size_t)(c - start);
+}
+
+size_t scan_token(t_scanner* scanner, const char** token)
+{
+    skip_spaces(scanner);
+    if (scanner->cursor < scanner->end && *scanner->cursor == '"')
+    {
+        return scan_word(scanner, token);
+    }
+
+    const char* c = scanner->cursor;
+    while (c < scanner->end && *c != ' ' && *c != '\t' && *c != '\n' && *c != '\r' && *c != '\v' && *c != '\f')
+    {
+        c++;
+    }
+    *token = scanner->cursor;
+    size_t length = (size_t)(c - scanner->cursor);
+    scanner->cursor = c;
+    return length;
+}
+
+int scan_char(t_scanner* scanner, char expected)
+{
+    skip_spaces(scanner);
+    if (scanner->cursor < scanner->end && *scanner->cursor == expected)
+    {
+        scanner->cursor++;
+        return 1;
+    }
+    return 0;
+}
+
+void close_scanner(t_scanner* scanner)
+{
+    free(scanner->data);
+    scanner->data = NULL;
+    scanner->capacity = 0;
+    scanner->cursor = NULL;
+    scanner->end = NULL;
+}
@@ -0,0 +1,62 @@
+#ifndef SCANNER_H
+#define SCANNER_H
+
+#include <stddef.h>
+
+// Whole input file in memory, read token by token
+// The tokens are never copied: numbers are converted in place and words point into the buffer.
+typedef struct
+{
+    char* data;                // Contents of the file, followed by '\0'
+    size_t size;               // Number of bytes of the file
+    size_t capacity;           // Bytes allocated for data (reused by refill_scanner)
+    const char* cursor;        // Next character to read
+    const char* end;           // data + size
+    int line;                  // Line of the cursor (1-based, for the error messages)
+} t_scanner;
+
+// Function to read a whole file into a scanner; returns -1 (and prints nothing) if it cannot be read
+int open_scanner(t_scanner* scanner, const char* filename);
+
+// Function to read another file into an open scanner, reusing its buffer when the file fits
+// Returns -1 if the file cannot be read (the scanner stays open: close_scanner still frees it)
+// A zero-initialised scanner can be refilled too.
+int refill_scanner(t_scanner* scanner, const char* filename);
+
+// Function to read text already in memory (copied into the buffer; name is for the error messages)
+void refill_scanner_text(t_scanner* scanner, const char* text, size_t size, const char* name);
+
+// Function to skip spaces, tabs and line breaks
+void skip_spaces(t_scanner* scanner);
+
+// Function to skip spaces and tabs only (stops at the end of the line)
+void skip_blanks(t_scanner* scanner);
+
+// Function to skip the rest of the current line, line break included
+void skip_line(t_scanner* scanner);
+
+// 1 once only spaces are left
+int scanner_at_end(t_scanner* scanner);
+
+// Functions to read the next number (leading spaces are skipped)
+// They return 0 and leave the cursor on the token if it is not a number of that kind.
+// scan_long accepts an optional sign and digits only; scan_float also reads decimals and
+// exponents, with the same result as strtof.
+int scan_long(t_scanner* scanner, long* value);
+int scan_int(t_scanner* scanner, int* value);
+int scan_float(t_scanner* scanner, float* value);
+
+// Function to read the next word (letters, digits and '_', or a double-quoted string without its quotes)
+// Returns its length (0 if there is none), *word points into the buffer (not '\0'-terminated)
+size_t scan_word(t_scanner* scanner, const char** word);
+
+// Function to read the next token: any run of non-space characters, or a double-quoted string without its quotes
+// Returns its length (0 at the end of the file), *token points into the buffer (not '\0'-terminated)
+size_t scan_token(t_scanner* scanner, const char** token);
+
+// Function to read one expected character after optional spaces; returns 0 if it is not there
+int scan_char(t_scanner* scanner, char expected);
+
+void close_scanner(t_scanner* scanner);
+
+#endif
@@ -0,0 +1,828 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "server.h"
+#include "markov.h"
+#include "batch.h"
+#include "output.h"
+#include "utils.h"
+#include "thread_pool.h"
+
+// Responses waiting to be sent on a connection: once there is no room for one more line,
+// its requests wait until the client has read enough of them
+#define SERVER_OUTPUT_SIZE ((size_t)64 << 10)
+
+// Waiting connections, before accept
+#define SERVER_BACKLOG 64
+
+typedef struct
+{
+    char name[SERVER_NAME_SIZE];
+    t_markov_context* context;     // Analysed, never changed while it is in the table
+} t_chain;
+
+typedef struct
+{
+    const t_server_options* options;
+
+    // Resident chains: requests take the read lock, LOAD and UNLOAD the write lock
+    // only to swap a context in or out (the loading itself is done outside of the lock)
+    t_chain* chains;
+    int chain_count;
+    int chain_capacity;
+    pthread_rwlock_t chains_lock;
+
+    // Open connections: only the polling thread adds and removes them
+    struct connection** connections;
+    int connection_count;
+    int connection_capacity;
+    pthread_mutex_t lock;      // Protects the busy flags of the connections
+
+    t_thread_pool* pool;
+} t_server;
+
+// State of one connection (non-blocking socket)
+// The polling thread reads the requests into input; once a line is complete the connection is busy
+// and a task of the pool answers the lines into output. The polling thread leaves it alone until the
+// task is done, then sends the responses, and reads nothing more until they are all sent.
+// So the requests of a connection are answered in order and no worker ever waits for a client.
+typedef struct connection
+{
+    t_server* server;
+    int socket;
+    int busy;                  // A task is answering the requests (server lock)
+    int closing;               // QUIT, SHUTDOWN or the client is gone: closed by the polling thread once output is sent
+    char input[SERVER_LINE_SIZE];
+    size_t used;               // Bytes of input received and not answered yet
+    int skipping;              // In the rest of a line that was too long
+    char output[SERVER_OUTPUT_SIZE];
+    size_t output_size;        // Bytes of responses not sent yet
+    int* marks;                // Scratch of REACH: visit marks of the classes...
+    int* queue;                // ...and queue of the search
+    int mark;                  // Current mark (a class is visited if marks[c] == mark)
+    int scratch_size;
+} t_connection;
+
+// Pipe that wakes the polling thread up, and stop request, also seen by the signal handler
+static int server_wake[2] = {-1, -1};
+static atomic_int stop_requested = 0;     // Lock-free: set by the signal handler and by SHUTDOWN in a worker
+
+// Makes poll return in the polling thread (async-signal-safe)
+static void wake_server(void)
+{
+    if (server_wake[1] >= 0)
+    {
+        ssize_t written = write(server_wake[1], "", 1);  // A full pipe already wakes it up
+        (void)written;
+    }
+}
+
+static void request_stop(void)
+{
+    atomic_store(&stop_requested, 1);
+    wake_server();
+}
+
+static void handle_signal(int signal_number)
+{
+    (void)signal_number;
+    request_stop();
+}
+
+// ---------------------------------------------------------------------------------------------
+// Chains
+
+static void* grow_array(void* array, int* capacity, size_t item_size)
+{
+    *capacity = (*capacity > 0) ? *capacity * 2 : 16;
+    void* grown = realloc(array, (size_t)*capacity * item_size);
+    if (grown == NULL)
+    {
+        fatal_error("Could not allocate memory for the server");
+    }
+    return grown;
+}
+
+// Index of a chain in the table (read or write lock held), -1 if there is none
+static int find_chain(const t_server* server, const char* name)
+{
+    for (int c = 0; c < server->chain_count; c++)
+    {
+        if (strcmp(server->chains[c].name, name) == 0)
+        {
+            return c;
+        }
+    }
+    return -1;
+}
+
+// Loads and analyses a chain without any lock; returns NULL (message in error) if it fails
+static t_markov_context* load_chain(const t_server* server, const char* filename, char* error, size_t size)
+{
+    const t_server_options* options = server->options;
+    t_markov_context* context = markov_create_context();
+    if (context == NULL)
+    {
+        snprintf(error, size, "out of memory");
+        return NULL;
+    }
+    markov_set_options(context, options->epsilon, options->max_iterations, options->memory_budget);
+    if (markov_load_file(context, filename, options->intern_labels) != MARKOV_OK ||
+        markov_analyse(context) != MARKOV_OK)
+    {
+        snprintf(error, size, "%s", markov_error_message(context));
+        markov_free_context(context);
+        return NULL;
+    }
+    return context;
+}
+
+// Puts a loaded chain in the table, in place of the chain of the same name if there is one
+static void add_chain(t_server* server, const char* name, t_markov_context* context)
+{
+    pthread_rwlock_wrlock(&server->chains_lock);
+    t_markov_context* replaced = NULL;
+    int c = find_chain(server, name);
+    if (c >= 0)
+    {
+        replaced = server->chains[c].context;
+        server->chains[c].context = context;
+    }
+    else
+    {
+        if (server->chain_count == server->chain_capacity)
+        {
+            server->chains = (t_chain*)grow_array(server->chains, &server->chain_capacity, sizeof(t_chain));
+        }
+        t_chain* chain = &server->chains[server->chain_count++];
+        snprintf(chain->name, sizeof(chain->name), "%s", name);
+        chain->context = context;
+    }
+    pthread_rwlock_unlock(&server->chains_lock);
+
+    // No request can still be reading it: they all hold the read lock
+    markov_free_context(replaced);
+}
+
+static int remove_chain(t_server* server, const char* name)
+{
+    pthread_rwlock_wrlock(&server->chains_lock);
+    t_markov_context* removed = NULL;
+    int c = find_chain(server, name);
+    if (c >= 0)
+    {
+        removed = server->chains[c].context;
+        server->chains[c] = server->chains[--server->chain_count];
+    }
+    pthread_rwlock_unlock(&server->chains_lock);
+    markov_free_context(removed);
+    return (c >= 0) ? 0 : -1;
+}
+
+// "dir/name.txt" -> "name"
+static void chain_name(const char* filename, char* name, size_t size)
+{
+    const char* start = strrchr(filename, '/');
+    start = (start != NULL) ? start + 1 : filename;
+    const char* dot = strrchr(start, '.');
+    size_t length = (dot != NULL && dot > start) ? (size_t)(dot - start) : strlen(start);
+    snprintf(name, size, "%.*s", (int)length, start);
+}
+
+// ---------------------------------------------------------------------------------------------
+// Requests
+
+// Sends the responses the socket takes without blocking, and keeps the rest
+// Returns 0, or -1 when the client is gone (the responses are dropped)
+static int flush_responses(t_connection* connection)
+{
+    size_t sent = 0;
+    int status = 0;
+    while (sent < connection->output_size)
+    {
+        ssize_t written = send(connection->socket, connection->output + sent, connection->output_size - sent,
+                               MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            break;  // Sent when poll says the client has read some
+        }
+        if (written <= 0)
+        {
+            sent = connection->output_size;
+            status = -1;
+            break;
+        }
+        sent += (size_t)written;
+    }
+    memmove(connection->output, connection->output + sent, connection->output_size - sent);
+    connection->output_size -= sent;
+    return status;
+}
+
+// Room for one more response line (the longest one: LIST gets truncated there)
+static int can_respond(const t_connection* connection)
+{
+    return SERVER_OUTPUT_SIZE - connection->output_size >= SERVER_LINE_SIZE;
+}
+
+// Adds a formatted line to the responses of the connection (can_respond is true)
+static void respond(t_connection* connection, const char* format, ...)
+{
+    va_list arguments;
+    va_start(arguments, format);
+    int length = vsnprintf(connection->output + connection->output_size, SERVER_LINE_SIZE - 1, format, arguments);
+    va_end(arguments);
+    if (length > SERVER_LINE_SIZE - 2)
+    {
+        length = SERVER_LINE_SIZE - 2;
+    }
+    connection->output_size += (size_t)length;
+    connection->output[connection->output_size++] = '\n';
+}
+
+// State of a request token: a name of the chain, or a number 1..n; -1 if it is neither
+static int parse_state(const t_markov_context* context, const char* token)
+{
+    int state = markov_find_state(context, token, strlen(token));
+    if (state > 0)
+    {
+        return state;
+    }
+    char* end;
+    long number = strtol(token, &end, 10);
+    if (*token == '\0' || *end != '\0' || number < 1 || number > markov_state_count(context))
+    {
+        return -1;
+    }
+    return (int)number;
+}
+
+// Breadth-first search in the graph of the classes (links go from a class to the classes it reaches)
+static int class_reaches(t_connection* connection, const t_markov_context* context, int from, int to)
+{
+    if (from == to)
+    {
+        return 1;
+    }
+    if (markov_class_is_persistent(context, from))
+    {
+        return 0;  // Nothing leaves a closed class
+    }
+
+    int class_count = markov_class_count(context);
+    if (class_count > connection->scratch_size)
+    {
+        free(connection->marks);
+        free(connection->queue);
+        connection->marks = (int*)calloc((size_t)class_count, sizeof(int));
+        connection->queue = (int*)malloc((size_t)class_count * sizeof(int));
+        if (connection->marks == NULL || connection->queue == NULL)
+        {
+            fatal_error("Could not allocate memory for the server");
+        }
+        connection->scratch_size = class_count;
+        connection->mark = 0;
+    }
+    if (++connection->mark == 0)
+    {
+        memset(connection->marks, 0, (size_t)connection->scratch_size * sizeof(int));
+        connection->mark = 1;
+    }
+
+    int head = 0;
+    int tail = 0;
+    connection->queue[tail++] = from;
+    connection->marks[from] = connection->mark;
+    while (head < tail)
+    {
+        int count;
+        const int* successors = markov_class_successors(context, connection->queue[head++], &count);
+        for (int s = 0; s < count; s++)
+        {
+            int next = successors[s];
+            if (next == to)
+            {
+                return 1;
+            }
+            if (connection->marks[next] != connection->mark)
+            {
+                connection->marks[next] = connection->mark;
+                connection->queue[tail++] = next;
+            }
+        }
+    }
+    return 0;
+}
+
+// Requests about one chain: the read lock is held and the chain exists
+static void query_chain(t_connection* connection, const t_markov_context* context, const char* command,
+                        char** arguments, int argument_count)
+{
+    if (strcmp(command, "INFO") == 0)
+    {
+        int persistent = 0;
+        for (int c = 0; c < markov_class_count(context); c++)
+        {
+            persistent += markov_class_is_persistent(context, c);
+        }
+        respond(connection, "OK states %d classes %d persistent %d irreducible %d absorbing %d",
+                markov_state_count(context), markov_class_count(context), persistent,
+                markov_is_irreducible(context), markov_has_absorbing_state(context));
+        return;
+    }
+
+    int needed = (strcmp(command, "REACH") == 0) ? 2 : 1;
+    if (argument_count != needed)
+    {
+        respond(connection, "ERR %s takes %d state%s", command, needed, needed > 1 ? "s" : "");
+        return;
+    }
+    int state = parse_state(context, arguments[0]);
+    if (state < 0)
+    {
+        respond(connection, "ERR unknown state '%s'", arguments[0]);
+        return;
+    }
+    int c = markov_class_of(context, state);
+
+    if (strcmp(command, "CLASS") == 0)
+    {
+        respond(connection, "OK %d %s %s %d", c, markov_class_name(context, c),
+                markov_class_is_persistent(context, c) ? "persistent" : "transient", markov_class_size(context, c));
+    }
+    else if (strcmp(command, "STATIONARY") == 0)
+    {
+        double probability = markov_stationary_probability(context, state);
+        if (probability < 0.0)
+        {
+            respond(connection, "ERR the distribution of %s was not found", markov_class_name(context, c));
+        }
+        else
+        {
+            respond(connection, "OK %.9g", probability);
+        }
+    }
+    else if (strcmp(command, "PERIOD") == 0)
+    {
+        respond(connection, "OK %d", markov_class_period(context, c));
+    }
+    else
+    {
+        int target = parse_state(context, arguments[1]);
+        if (target < 0)
+        {
+            respond(connection, "ERR unknown state '%s'", arguments[1]);
+            return;
+        }
+        respond(connection, "OK %d", class_reaches(connection, context, c, markov_class_of(context, target)));
+    }
+}
+
+// Returns 0 to go on, 1 to close the connection
+static int handle_request(t_connection* connection, char* line)
+{
+    t_server* server = connection->server;
+    char* tokens[4];
+    int token_count = 0;
+    char* save;
+    for (char* token = strtok_r(line, " \t\r", &save); token != NULL; token = strtok_r(NULL, " \t\r", &save))
+    {
+        if (token_count == 4)
+        {
+            respond(connection, "ERR too many arguments");
+            return 0;
+        }
+        tokens[token_count++] = token;
+    }
+    if (token_count == 0)
+    {
+        return 0;  // Empty lines get no response
+    }
+    const char* command = tokens[0];
+
+    if (strcmp(command, "PING") == 0)
+    {
+        respond(connection, "OK");
+    }
+    else if (strcmp(command, "QUIT") == 0)
+    {
+        respond(connection, "OK");
+        return 1;
+    }
+    else if (strcmp(command, "SHUTDOWN") == 0)
+    {
+        respond(connection, "OK");  // Sent when the pool has stopped, before the connection is closed
+        request_stop();
+        return 1;
+    }
+    else if (strcmp(command, "LIST") == 0)
+    {
+        char names[SERVER_LINE_SIZE];
+        size_t length = 0;
+        pthread_rwlock_rdlock(&server->chains_lock);
+        int count = server->chain_count;
+        for (int c = 0; c < count && length < sizeof(names); c++)
+        {
+            length += (size_t)snprintf(names + length, sizeof(names) - length, " %s", server->chains[c].name);
+        }
+        pthread_rwlock_unlock(&server->chains_lock);
+        names[(length < sizeof(names)) ? length : sizeof(names) - 1] = '\0';
+        respond(connection, "OK %d%s", count, names);
+    }
+    else if (strcmp(command, "LOAD") == 0)
+    {
+        if (token_count != 3 || strlen(tokens[1]) >= SERVER_NAME_SIZE)
+        {
+            respond(connection, "ERR usage: LOAD <chain> <file>");
+            return 0;
+        }
+        char error[256];
+        t_markov_context* context = load_chain(server, tokens[2], error, sizeof(error));
+        if (context == NULL)
+        {
+            respond(connection, "ERR %s", error);
+            return 0;
+        }
+        int states = markov_state_count(context);
+        int classes = markov_class_count(context);
+        add_chain(server, tokens[1], context);
+        respond(connection, "OK %d %d", states, classes);
+    }
+    else if (strcmp(command, "UNLOAD") == 0)
+    {
+        if (token_count != 2 || remove_chain(server, tokens[1]) != 0)
+        {
+            respond(connection, "ERR unknown chain '%s'", token_count > 1 ? tokens[1] : "");
+            return 0;
+        }
+        respond(connection, "OK");
+    }
+    else if (strcmp(command, "INFO") == 0 || strcmp(command, "CLASS") == 0 || strcmp(command, "STATIONARY") == 0 ||
+             strcmp(command, "PERIOD") == 0 || strcmp(command, "REACH") == 0)
+    {
+        if (token_count < 2)
+        {
+            respond(connection, "ERR %s needs a chain", command);
+            return 0;
+        }
+        pthread_rwlock_rdlock(&server->chains_lock);
+        int c = find_chain(server, tokens[1]);
+        if (c < 0)
+        {
+            respond(connection, "ERR unknown chain '%s'", tokens[1]);
+        }
+        else
+        {
+            query_chain(connection, server->chains[c].context, command, tokens + 2, token_count - 2);
+        }
+        pthread_rwlock_unlock(&server->chains_lock);
+    }
+    else
+    {
+        respond(connection, "ERR unknown request '%s'", command);
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------------------------------------
+// Connections
+
+static void add_connection(t_server* server, int socket)
+{
+    t_connection* connection = (t_connection*)calloc(1, sizeof(t_connection));
+    if (connection == NULL)
+    {
+        close(socket);
+        return;
+    }
+    fcntl(socket, F_SETFL, O_NONBLOCK);
+    connection->server = server;
+    connection->socket = socket;
+    if (server->connection_count == server->connection_capacity)
+    {
+        server->connections = (t_connection**)grow_array(server->connections, &server->connection_capacity,
+                                                         sizeof(t_connection*));
+    }
+    server->connections[server->connection_count++] = connection;
+}
+
+static void close_connection(t_server* server, int index)
+{
+    t_connection* connection = server->connections[index];
+    server->connections[index] = server->connections[--server->connection_count];
+    close(connection->socket);
+    free(connection->marks);
+    free(connection->queue);
+    free(connection);
+}
+
+// Task of the pool: answers the complete lines received on a connection, then gives it back to the polling thread
+// The lines that find no room for their response stay in input until the output is sent.
+static void answer_requests(void* argument)
+{
+    t_connection* connection = (t_connection*)argument;
+    char* input = connection->input;
+    int closing = 0;
+
+    // Every complete line, then what is left goes to the front of the buffer
+    size_t start = 0;
+    for (size_t i = 0; i < connection->used && !closing && can_respond(connection); i++)
+    {
+        if (input[i] != '\n')
+        {
+            continue;
+        }
+        input[i] = '\0';
+        if (!connection->skipping)
+        {
+            closing = handle_request(connection, input + start);
+        }
+        connection->skipping = 0;
+        start = i + 1;
+    }
+    if (start == 0 && connection->used == sizeof(connection->input) && can_respond(connection))
+    {
+        if (!connection->skipping)
+        {
+            respond(connection, "ERR request longer than %d bytes", SERVER_LINE_SIZE - 1);
+        }
+        connection->skipping = 1;
+        start = connection->used;
+    }
+    memmove(input, input + start, connection->used - start);
+    connection->used -= start;
+
+    pthread_mutex_lock(&connection->server->lock);
+    connection->closing = closing;
+    connection->busy = 0;
+    pthread_mutex_unlock(&connection->server->lock);
+    wake_server();
+}
+
+// A complete line, or a full buffer, is waiting for a task
+static int has_requests(const t_connection* connection)
+{
+    return connection->used == sizeof(connection->input) ||
+           memchr(connection->input, '\n', connection->used) != NULL;
+}
+
+// Reads what a client sent (poll said it would not block). Returns 0 to go on, -1 when the client is gone.
+static int receive_requests(t_connection* connection)
+{
+    ssize_t received = recv(connection->socket, connection->input + connection->used,
+                            sizeof(connection->input) - connection->used, 0);
+    if (received < 0 && (errno == EINTR || errno == EAGAIN))
+    {
+        return 0;
+    }
+    if (received <= 0)
+    {
+        return -1;
+    }
+    connection->used += (size_t)received;
+    return 0;
+}
+
+// ---------------------------------------------------------------------------------------------
+// Server
+
+static int open_listener(const char* path)
+{
+    struct sockaddr_un address;
+    if (strlen(path) >= sizeof(address.sun_path))
+    {
+        printf("Error: socket path '%s' is too long\n", path);
+        return -1;
+    }
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0)
+    {
+        printf("Error: cannot create a socket\n");
+        return -1;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+    unlink(path);  // Left by a previous server
+    if (bind(listener, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(listener, SERVER_BACKLOG) != 0)
+    {
+        printf("Error: cannot listen on '%s'\n", path);
+        close(listener);
+        return -1;
+    }
+    return listener;
+}
+
+// Chains of the command line: a graph file, or every file of a directory
+static void load_initial_chains(t_server* server, const char* path)
+{
+    struct stat status;
+    char** inputs;
+    int count = 1;
+    char* single = (char*)path;
+    if (stat(path, &status) == 0 && S_ISDIR(status.st_mode))
+    {
+        inputs = list_batch_inputs(path, &count);
+    }
+    else
+    {
+        inputs = &single;
+    }
+    for (int i = 0; inputs != NULL && i < count; i++)
+    {
+        char name[SERVER_NAME_SIZE];
+        char error[256];
+        chain_name(inputs[i], name, sizeof(name));
+        t_markov_context* context = load_chain(server, inputs[i], error, sizeof(error));
+        if (context == NULL)
+        {
+            printf("Error: %s\n", error);
+            continue;
+        }
+        printf("Chain '%s': %d states, %d classes\n", name, markov_state_count(context), markov_class_count(context));
+        add_chain(server, name, context);
+    }
+    if (inputs != &single)
+    {
+        free_batch_inputs(inputs, count);
+    }
+}
+
+static void free_server(t_server* server)
+{
+    for (int c = 0; c < server->chain_count; c++)
+    {
+        markov_free_context(server->chains[c].context);
+    }
+    free(server->chains);
+    for (int i = 0; i < server->connection_count; i++)
+    {
+        close(server->connections[i]->socket);
+        free(server->connections[i]->marks);
+        free(server->connections[i]->queue);
+        free(server->connections[i]);
+    }
+    free(server->connections);
+    pthread_rwlock_destroy(&server->chains_lock);
+    pthread_mutex_destroy(&server->lock);
+}
+
+int run_server(const char* path, const t_server_options* options)
+{
+    t_server server;
+    memset(&server, 0, sizeof(server));
+    server.options = options;
+    pthread_rwlock_init(&server.chains_lock, NULL);
+    pthread_mutex_init(&server.lock, NULL);
+
+    load_initial_chains(&server, path);
+    int listener = open_listener(options->socket_path);
+    if (listener < 0 || pipe(server_wake) != 0)
+    {
+        if (listener >= 0)
+        {
+            close(listener);
+            unlink(options->socket_path);
+        }
+        free_server(&server);
+        return -1;
+    }
+    fcntl(server_wake[0], F_SETFL, O_NONBLOCK);
+    fcntl(server_wake[1], F_SETFL, O_NONBLOCK);
+
+    // No SA_RESTART: a signal also interrupts poll
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handle_signal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    // thread_count workers answer the requests; this thread only accepts the connections and reads them
+    int thread_count = (options->thread_count > 0) ? options->thread_count : 1;
+    server.pool = create_thread_pool(thread_count + 1);
+    printf("Serving %d chains on '%s' with %d threads (SHUTDOWN or Ctrl-C to stop)\n", server.chain_count,
+           options->socket_path, thread_count);
+    flush_output();
+
+    // Polled: the wake pipe, the listener, then the connections that are not busy: for their
+    // responses while some are not sent, otherwise for their requests
+    struct pollfd* polled = NULL;
+    t_connection** polled_connections = NULL;
+    int polled_capacity = 0;
+    while (!atomic_load(&stop_requested))
+    {
+        if (polled_capacity < server.connection_count + 2)
+        {
+            polled_capacity = server.connection_count + 2 + 16;
+            free(polled);
+            free(polled_connections);
+            polled = (struct pollfd*)malloc((size_t)polled_capacity * sizeof(struct pollfd));
+            polled_connections = (t_connection**)malloc((size_t)polled_capacity * sizeof(t_connection*));
+            if (polled == NULL || polled_connections == NULL)
+            {
+                fatal_error("Could not allocate memory for the server");
+            }
+        }
+        polled[0].fd = server_wake[0];
+        polled[0].events = POLLIN;
+        polled[1].fd = listener;
+        polled[1].events = POLLIN;
+        int polled_count = 2;
+        pthread_mutex_lock(&server.lock);
+        for (int i = server.connection_count - 1; i >= 0; i--)
+        {
+            t_connection* connection = server.connections[i];
+            if (connection->busy)
+            {
+                continue;
+            }
+            if (connection->closing && connection->output_size == 0)
+            {
+                close_connection(&server, i);
+                continue;
+            }
+            if (connection->output_size == 0 && has_requests(connection))
+            {
+                connection->busy = 1;
+                thread_pool_submit(server.pool, NULL, answer_requests, connection);
+                continue;
+            }
+            polled[polled_count].fd = connection->socket;
+            polled[polled_count].events = (connection->output_size > 0) ? POLLOUT : POLLIN;
+            polled_connections[polled_count++] = connection;
+        }
+        pthread_mutex_unlock(&server.lock);
+
+        if (poll(polled, (nfds_t)polled_count, -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            break;
+        }
+        if (polled[0].revents != 0)
+        {
+            char drained[64];
+            while (read(server_wake[0], drained, sizeof(drained)) > 0)
+            {
+            }
+        }
+        for (int p = 2; p < polled_count; p++)
+        {
+            t_connection* connection = polled_connections[p];
+            if (polled[p].revents == 0)
+            {
+                continue;
+            }
+            int status = (polled[p].events == POLLOUT) ? flush_responses(connection) : receive_requests(connection);
+            if (status != 0)
+            {
+                connection->closing = 1;  // Closed on the next round
+                connection->output_size = 0;
+            }
+        }
+        if (polled[1].revents != 0)
+        {
+            int socket = accept(listener, NULL, NULL);
+            if (socket >= 0)
+            {
+                add_connection(&server, socket);
+            }
+        }
+    }
+
+    // The tasks still answering finish, then the responses that fit in the sockets are sent (SHUTDOWN's OK)
+    free_thread_pool(server.pool);
+    for (int i = 0; i < server.connection_count; i++)
+    {
+        flush_responses(server.connections[i]);
+    }
+    free(polled);
+    free(polled_connections);
+    close(listener);
+    close(server_wake[0]);
+    close(server_wake[1]);
+    server_wake[0] = server_wake[1] = -1;
+    unlink(options->socket_path);
+    free_server(&server);
+    printf("Server stopped\n");
+    return 0;
+}
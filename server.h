@@ -0,0 +1,43 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stddef.h>
+
+// Longest request line and chain name
+#define SERVER_LINE_SIZE 4096
+#define SERVER_NAME_SIZE 64
+
+// Options of the server (--serve)
+typedef struct
+{
+    const char* socket_path;   // Unix domain socket, replaced if it exists
+    int thread_count;          // Requests answered at the same time (any number of connections stay open)
+    int intern_labels;         // Chains loaded with --labels: states are named in the requests too
+    float epsilon;
+    int max_iterations;
+    size_t memory_budget;
+} t_server_options;
+
+// Function to serve chains until a SHUTDOWN request, SIGINT or SIGTERM
+// The chains of path are loaded and analysed first (a graph file, or every file of a directory),
+// each one named after its file without the extension. Then every chain stays resident
+// (graph, classes, class links, stationary distributions, periods) and the requests only read it.
+//
+// Protocol: one request per line, one response line per request ("OK ..." or "ERR message").
+// States are numbers 1..n, or names for chains loaded with labels.
+//   PING                           OK
+//   LIST                           OK <count> <name>...
+//   INFO <chain>                   OK states <n> classes <k> persistent <p> irreducible <0|1> absorbing <0|1>
+//   CLASS <chain> <state>          OK <index> <name> persistent|transient <size>
+//   STATIONARY <chain> <state>     OK <probability in its class> (0 for a transient state)
+//   PERIOD <chain> <state>         OK <period of its class> (0 for a transient state)
+//   REACH <chain> <from> <to>      OK 1 if <to> can be reached from <from>, OK 0 otherwise
+//   LOAD <chain> <file>            OK <states> <classes>: loads or replaces a chain
+//   UNLOAD <chain>                 OK
+//   QUIT                           OK, then the connection is closed
+//   SHUTDOWN                       OK, then the server stops
+// Requests can be pipelined: the responses come back in order.
+// Returns 0, or -1 if the socket cannot be opened.
+int run_server(const char* path, const t_server_options* options);
+
+#endif
@@ -0,0 +1,395 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "simulation.h"
+#include "output.h"
+
+// Quantile of the normal distribution used for the 95% confidence intervals
+#define CONFIDENCE_Z 1.96
+
+t_alias_table build_alias_table(const adjacency_list* graph)
+{
+    int n = graph->num_vertices;
+    t_alias_table table;
+    table.num_vertices = n;
+    table.offsets = (int*)malloc((n + 1) * sizeof(int));
+    if (table.offsets == NULL)
+    {
+        fatal_error("cannot allocate alias table offsets");
+    }
+
+    // First pass: row sizes
+    int max_degree = 0;
+    table.offsets[0] = 0;
+    for (int v = 0; v < n; v++)
+    {
+        int degree = 0;
+        for (cell* current = graph->lists[v].head; current != NULL; current = current->next)
+        {
+            degree++;
+        }
+        if (degree > max_degree)
+        {
+            max_degree = degree;
+        }
+        table.offsets[v + 1] = table.offsets[v] + degree;
+    }
+
+    int entries = table.offsets[n] > 0 ? table.offsets[n] : 1;
+    table.targets = (int*)malloc(entries * sizeof(int));
+    table.aliases = (int*)malloc(entries * sizeof(int));
+    table.thresholds = (float*)malloc(entries * sizeof(float));
+    double* scaled = (double*)malloc((max_degree + 1) * sizeof(double));
+    int* small = (int*)malloc((max_degree + 1) * sizeof(int));
+    int* large = (int*)malloc((max_degree + 1) * sizeof(int));
+    if (table.targets == NULL || table.aliases == NULL || table.thresholds == NULL ||
+        scaled == NULL || small == NULL || large == NULL)
+    {
+        fatal_error("cannot allocate alias tables");
+    }
+
+    // Second pass: Vose's method on each row
+    for (int v = 0; v < n; v++)
+    {
+        int base = table.offsets[v];
+        int degree = table.offsets[v + 1] - base;
+        if (degree == 0)
+        {
+            continue;
+        }
+
+        double sum = 0.0;
+        int k = 0;
+        for (cell* current = graph->lists[v].head; current != NULL; current = current->next)
+        {
+            table.targets[base + k] = current->arrival_vertex;
+            scaled[k] = current->probability;
+            sum += current->probability;
+            k++;
+        }
+
+        // Scale so that the average entry is 1, then pair each small entry with a large one
+        int small_count = 0;
+        int large_count = 0;
+        for (k = 0; k < degree; k++)
+        {
+            scaled[k] = (sum > 0.0) ? scaled[k] * degree / sum : 1.0;
+            if (scaled[k] < 1.0)
+            {
+                small[small_count++] = k;
+            }
+            else
+            {
+                large[large_count++] = k;
+            }
+        }
+        while (small_count > 0 && large_count > 0)
+        {
+            int s = small[--small_count];
+            int l = large[--large_count];
+            table.thresholds[base + s] = (float)scaled[s];
+            table.aliases[base + s] = table.targets[base + l];
+            scaled[l] = (scaled[l] + scaled[s]) - 1.0;
+            if (scaled[l] < 1.0)
+            {
+                small[small_count++] = l;
+            }
+            else
+            {
+                large[large_count++] = l;
+            }
+        }
+        // What is left is 1 up to rounding errors
+        while (large_count > 0)
+        {
+            int l = large[--large_count];
+            table.thresholds[base + l] = 1.0f;
+            table.aliases[base + l] = table.targets[base + l];
+        }
+        while (small_count > 0)
+        {
+            int s = small[--small_count];
+            table.thresholds[base + s] = 1.0f;
+            table.aliases[base + s] = table.targets[base + s];
+        }
+    }
+
+    free(scaled);
+    free(small);
+    free(large);
+    return table;
+}
+
+int alias_sample(const t_alias_table* table, int vertex, uint64_t random_bits)
+{
+    int base = table->offsets[vertex - 1];
+    int degree = table->offsets[vertex] - base;
+    if (degree == 0)
+    {
+        return vertex;
+    }
+
+    // High 32 bits pick the entry, low 32 bits decide between the entry and its alias
+    int k = (int)(((random_bits >> 32) * (uint64_t)degree) >> 32);
+    float u = (float)(random_bits & 0xFFFFFFFFu) * (1.0f / 4294967296.0f);
+    return (u < table->thresholds[base + k]) ? table->targets[base + k] : table->aliases[base + k];
+}
+
+// SplitMix64 finaliser: a bijective mix of 64 bits
+static uint64_t mix64(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return x;
+}
+
+uint64_t counter_rng(uint64_t seed, uint64_t stream, uint64_t counter)
+{
+    uint64_t key = mix64(seed ^ mix64(stream + 0x9E3779B97F4A7C15ULL));
+    return mix64(key + (counter + 1) * 0x9E3779B97F4A7C15ULL);
+}
+
+// Work and integer accumulators of one thread
+typedef struct
+{
+    const t_alias_table* table;
+    const t_simulation_options* options;
+    const char* is_target;
+    int first_trajectory;
+    int last_trajectory;       // Excluded
+    uint64_t* visit_sum;       // Sum over trajectories of the visit counts
+    uint64_t* visit_square;    // Sum over trajectories of the squared visit counts
+    uint64_t hits;
+    uint64_t time_sum;
+    uint64_t time_square;
+} t_simulation_worker;
+
+static void* simulation_thread(void* argument)
+{
+    t_simulation_worker* worker = (t_simulation_worker*)argument;
+    const t_simulation_options* options = worker->options;
+    int n = worker->table->num_vertices;
+
+    // Visit counts of the current trajectory, reset through the list of touched states
+    int* counts = (int*)calloc(n, sizeof(int));
+    int* touched = (int*)malloc((options->max_steps + 1) * sizeof(int));
+    if (counts == NULL || touched == NULL)
+    {
+        fatal_error("cannot allocate simulation buffers");
+    }
+
+    for (int trajectory = worker->first_trajectory; trajectory < worker->last_trajectory; trajectory++)
+    {
+        int state = options->start_state;
+        int touched_count = 0;
+        int hit_time = worker->is_target[state - 1] ? 0 : -1;
+
+        for (int step = 1; step <= options->max_steps; step++)
+        {
+            state = alias_sample(worker->table, state,
+                                 counter_rng(options->seed, (uint64_t)trajectory, (uint64_t)step));
+            if (counts[state - 1] == 0)
+            {
+                touched[touched_count++] = state - 1;
+            }
+            counts[state - 1]++;
+            if (hit_time < 0 && worker->is_target[state - 1])
+            {
+                hit_time = step;
+            }
+        }
+
+        for (int t = 0; t < touched_count; t++)
+        {
+            uint64_t c = (uint64_t)counts[touched[t]];
+            worker->visit_sum[touched[t]] += c;
+            worker->visit_square[touched[t]] += c * c;
+            counts[touched[t]] = 0;
+        }
+        if (hit_time >= 0)
+        {
+            worker->hits++;
+            worker->time_sum += (uint64_t)hit_time;
+            worker->time_square += (uint64_t)hit_time * (uint64_t)hit_time;
+        }
+    }
+
+    free(counts);
+    free(touched);
+    return NULL;
+}
+
+// Half width of the confidence interval of a mean, from the sums of x and x^2
+static double half_width(double sum, double square, double count)
+{
+    if (count < 2.0)
+    {
+        return 0.0;
+    }
+    double mean = sum / count;
+    double variance = (square - count * mean * mean) / (count - 1.0);
+    if (variance < 0.0)
+    {
+        variance = 0.0;
+    }
+    return CONFIDENCE_Z * sqrt(variance / count);
+}
+
+t_simulation_result simulate_trajectories(const t_alias_table* table, const t_simulation_options* options)
+{
+    int n = table->num_vertices;
+    int thread_count = options->thread_count > 0 ? options->thread_count : 1;
+    if (thread_count > options->trajectory_count && options->trajectory_count > 0)
+    {
+        thread_count = options->trajectory_count;
+    }
+
+    char* is_target = (char*)calloc(n, sizeof(char));
+    t_simulation_worker* workers = (t_simulation_worker*)calloc(thread_count, sizeof(t_simulation_worker));
+    pthread_t* threads = (pthread_t*)malloc(thread_count * sizeof(pthread_t));
+    if (is_target == NULL || workers == NULL || threads == NULL)
+    {
+        fatal_error("cannot allocate simulation workers");
+    }
+    for (int t = 0; t < options->target_count; t++)
+    {
+        if (options->targets[t] >= 1 && options->targets[t] <= n)
+        {
+            is_target[options->targets[t] - 1] = 1;
+        }
+    }
+
+    // Contiguous blocks of trajectories: the streams follow the trajectory, not the thread
+    for (int w = 0; w < thread_count; w++)
+    {
+        workers[w].table = table;
+        workers[w].options = options;
+        workers[w].is_target = is_target;
+        workers[w].first_trajectory = (int)((long)options->trajectory_count * w / thread_count);
+        workers[w].last_trajectory = (int)((long)options->trajectory_count * (w + 1) / thread_count);
+        workers[w].visit_sum = (uint64_t*)calloc(n, sizeof(uint64_t));
+        workers[w].visit_square = (uint64_t*)calloc(n, sizeof(uint64_t));
+        if (workers[w].visit_sum == NULL || workers[w].visit_square == NULL)
+        {
+            fatal_error("cannot allocate simulation accumulators");
+        }
+        if (pthread_create(&threads[w], NULL, simulation_thread, &workers[w]) != 0)
+        {
+            fatal_error("cannot start simulation thread");
+        }
+    }
+    for (int w = 0; w < thread_count; w++)
+    {
+        pthread_join(threads[w], NULL);
+    }
+
+    // Merge the integer sums (exact, so the order of the threads does not matter)
+    t_simulation_result result;
+    result.num_vertices = n;
+    result.visit_frequency = (double*)malloc(n * sizeof(double));
+    result.visit_half_width = (double*)malloc(n * sizeof(double));
+    if (result.visit_frequency == NULL || result.visit_half_width == NULL)
+    {
+        fatal_error("cannot allocate simulation results");
+    }
+
+    double trajectories = (double)options->trajectory_count;
+    double steps = (double)(options->max_steps > 0 ? options->max_steps : 1);
+    uint64_t hits = 0;
+    uint64_t time_sum = 0;
+    uint64_t time_square = 0;
+    for (int w = 0; w < thread_count; w++)
+    {
+        hits += workers[w].hits;
+        time_sum += workers[w].time_sum;
+        time_square += workers[w].time_square;
+    }
+    for (int v = 0; v < n; v++)
+    {
+        uint64_t sum = 0;
+        uint64_t square = 0;
+        for (int w = 0; w < thread_count; w++)
+        {
+            sum += workers[w].visit_sum[v];
+            square += workers[w].visit_square[v];
+        }
+        // Per-trajectory fraction of time spent in v: count / steps
+        result.visit_frequency[v] = (trajectories > 0.0) ? (double)sum / steps / trajectories : 0.0;
+        result.visit_half_width[v] = half_width((double)sum / steps, (double)square / (steps * steps), trajectories);
+    }
+
+    result.hits = (long)hits;
+    result.hit_probability = (trajectories > 0.0) ? (double)hits / trajectories : 0.0;
+    result.hit_probability_half_width = (trajectories > 0.0)
+        ? CONFIDENCE_Z * sqrt(result.hit_probability * (1.0 - result.hit_probability) / trajectories)
+        : 0.0;
+    result.mean_hitting_time = (hits > 0) ? (double)time_sum / (double)hits : INFINITY;
+    result.hitting_time_half_width = half_width((double)time_sum, (double)time_square, (double)hits);
+
+    for (int w = 0; w < thread_count; w++)
+    {
+        free(workers[w].visit_sum);
+        free(workers[w].visit_square);
+    }
+    free(workers);
+    free(threads);
+    free(is_target);
+    return result;
+}
+
+void print_simulation_result(const t_simulation_result* result, const t_simulation_options* options,
+                             const t_label_table* labels)
+{
+    char label[STATE_LABEL_SIZE];
+    printf("Monte Carlo estimates (%d trajectories of %d steps from state %s, seed %llu):\n",
+           options->trajectory_count, options->max_steps, state_label(labels, options->start_state, label),
+           (unsigned long long)options->seed);
+    printf("Visit frequencies (95%% confidence):\n");
+    int shown_states = output_preview(result->num_vertices);
+    for (int v = 0; v < shown_states; v++)
+    {
+        printf("  State %s: %.4f +/- %.4f\n", state_label(labels, v + 1, label),
+               result->visit_frequency[v], result->visit_half_width[v]);
+    }
+    print_omitted(shown_states, result->num_vertices, "states");
+
+    if (options->target_count > 0)
+    {
+        printf("Probability of reaching the targets within %d steps: %.4f +/- %.4f\n",
+               options->max_steps, result->hit_probability, result->hit_probability_half_width);
+        if (result->hits > 0)
+        {
+            printf("Mean hitting time (when reached): %.4f +/- %.4f\n",
+                   result->mean_hitting_time, result->hitting_time_half_width);
+        }
+    }
+    printf("\n");
+}
+
+void free_simulation_result(t_simulation_result* result)
+{
+    free(result->visit_frequency);
+    free(result->visit_half_width);
+    result->visit_frequency = NULL;
+    result->visit_half_width = NULL;
+    result->num_vertices = 0;
+}
+
+void free_alias_table(t_alias_table* table)
+{
+    free(table->offsets);
+    free(table->targets);
+    free(table->aliases);
+    free(table->thresholds);
+    table->offsets = NULL;
+    table->targets = NULL;
+    table->aliases = NULL;
+    table->thresholds = NULL;
+    table->num_vertices = 0;
+}
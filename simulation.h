@@ -0,0 +1,80 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <stdint.h>
+
+#include "utils.h"
+#include "labels.h"
+
+// Vose alias tables for all the vertices of a graph, stored flat:
+// the entries of vertex v are offsets[v] ... offsets[v + 1] - 1
+// Sampling entry k keeps targets[k] with probability thresholds[k], otherwise takes aliases[k]
+typedef struct
+{
+    int* offsets;          // num_vertices + 1 offsets
+    int* targets;          // Destination of each entry (1-based vertex)
+    int* aliases;          // Alternative destination of each entry (1-based vertex)
+    float* thresholds;     // Probability of keeping targets[k]
+    int num_vertices;      // Number of vertices
+} t_alias_table;
+
+// Parameters of a Monte Carlo run
+typedef struct
+{
+    int start_state;       // Every trajectory starts here (1-based)
+    const int* targets;    // Target states for the hitting estimates (1-based, may be NULL)
+    int target_count;      // Number of target states
+    int trajectory_count;  // Number of trajectories
+    int max_steps;         // Length of each trajectory
+    int thread_count;      // Number of worker threads (does not change the results)
+    uint64_t seed;         // Seed of the random streams
+} t_simulation_options;
+
+// Estimates gathered by a Monte Carlo run (half widths are for 95% confidence intervals)
+typedef struct
+{
+    int num_vertices;
+    double* visit_frequency;       // Mean fraction of the steps 1..max_steps spent in each state
+    double* visit_half_width;      // Confidence half width of each frequency
+    long hits;                     // Trajectories that met the targets within max_steps
+    double hit_probability;        // hits / trajectory_count
+    double hit_probability_half_width;
+    double mean_hitting_time;      // Mean first time in the targets, over the trajectories that met them
+    double hitting_time_half_width;
+} t_simulation_result;
+
+// Function to build the alias tables of a graph
+// Each row is normalised by its own sum, a vertex without edges stays where it is
+// Parameters: the adjacency list
+// Returns: the alias tables, O(1) sampling per step afterwards
+t_alias_table build_alias_table(const adjacency_list* graph);
+
+// Function to draw the next state from a vertex
+// Parameters: the alias tables, current vertex (1-based), 64 random bits
+// Returns: the next vertex (1-based)
+int alias_sample(const t_alias_table* table, int vertex, uint64_t random_bits);
+
+// Function to get the random bits at position counter of a stream
+// Counter-based generator: the value only depends on (seed, stream, counter),
+// so any trajectory can be replayed without the ones before it
+uint64_t counter_rng(uint64_t seed, uint64_t stream, uint64_t counter);
+
+// Function to run trajectories in parallel and gather visit and hitting estimates
+// Trajectory i always uses stream i, and all the sums are integers, so the result
+// is identical for any number of threads
+// Parameters: the alias tables, the options
+// Returns: the estimates (free with free_simulation_result)
+t_simulation_result simulate_trajectories(const t_alias_table* table, const t_simulation_options* options);
+
+// Function to display the estimates of a run (states named by labels, NULL for numbers)
+// Only the first states are listed below the full output level
+void print_simulation_result(const t_simulation_result* result, const t_simulation_options* options,
+                             const t_label_table* labels);
+
+// Function to free memory allocated for simulation results
+void free_simulation_result(t_simulation_result* result);
+
+// Function to free memory allocated for alias tables
+void free_alias_table(t_alias_table* table);
+
+#endif
@@ -0,0 +1,509 @@
+#include "sparse.h"
+#include "output.h"
+#include <string.h>
+#include <math.h>
+
+// One (column, value) entry, used when sorting the rows
+typedef struct
+{
+    uint32_t col;
+    float value;
+} t_sparse_entry;
+
+static int compare_by_column(const void* a, const void* b)
+{
+    const t_sparse_entry* x = (const t_sparse_entry*)a;
+    const t_sparse_entry* y = (const t_sparse_entry*)b;
+    return (x->col > y->col) - (x->col < y->col);
+}
+
+static int compare_by_magnitude(const void* a, const void* b)
+{
+    float x = fabsf(((const t_sparse_entry*)a)->value);
+    float y = fabsf(((const t_sparse_entry*)b)->value);
+    return (x < y) - (x > y);  // Largest first
+}
+
+// Function to allocate a sparse matrix with room for nnz_capacity entries
+static t_sparse_matrix allocate_sparse(int rows, int cols, uint32_t nnz_capacity)
+{
+    t_sparse_matrix matrix;
+    matrix.rows = rows;
+    matrix.cols = cols;
+    matrix.nnz = 0;
+    matrix.row_ptr = (uint32_t*)calloc(rows + 1, sizeof(uint32_t));
+    matrix.col_idx = (uint32_t*)malloc((nnz_capacity > 0 ? nnz_capacity : 1) * sizeof(uint32_t));
+    matrix.values = (float*)malloc((nnz_capacity > 0 ? nnz_capacity : 1) * sizeof(float));
+    if (matrix.row_ptr == NULL || matrix.col_idx == NULL || matrix.values == NULL)
+    {
+        fatal_error("cannot allocate memory for sparse matrix");
+    }
+    return matrix;
+}
+
+// Function to create the CSR transition matrix from an adjacency list
+// Each list is copied into a small buffer, sorted by column, and appended to the arrays
+t_sparse_matrix createSparseTransitionMatrix(const adjacency_list* graph)
+{
+    int n = graph->num_vertices;
+
+    // First pass: total number of edges and longest list
+    uint32_t edge_count = 0;
+    int max_degree = 0;
+    for (int i = 0; i < n; i++)
+    {
+        int degree = 0;
+        for (cell* current = graph->lists[i].head; current != NULL; current = current->next)
+        {
+            degree++;
+        }
+        edge_count += (uint32_t)degree;
+        if (degree > max_degree)
+        {
+            max_degree = degree;
+        }
+    }
+
+    t_sparse_matrix matrix = allocate_sparse(n, n, edge_count);
+    t_sparse_entry* row = (t_sparse_entry*)malloc((max_degree > 0 ? max_degree : 1) * sizeof(t_sparse_entry));
+    if (row == NULL)
+    {
+        fatal_error("cannot allocate memory for sparse matrix row");
+    }
+
+    // Second pass: fill the rows
+    for (int i = 0; i < n; i++)
+    {
+        int degree = 0;
+        for (cell* current = graph->lists[i].head; current != NULL; current = current->next)
+        {
+            row[degree].col = (uint32_t)(current->arrival_vertex - 1);
+            row[degree].value = current->probability;
+            degree++;
+        }
+
+        // Stable insertion sort (lists are short), so duplicates keep their list order
+        for (int a = 1; a < degree; a++)
+        {
+            t_sparse_entry entry = row[a];
+            int b = a - 1;
+            while (b >= 0 && row[b].col > entry.col)
+            {
+                row[b + 1] = row[b];
+                b--;
+            }
+            row[b + 1] = entry;
+        }
+
+        // The list is in reverse file order: the last duplicate is the first line of the file
+        for (int a = 0; a < degree; a++)
+        {
+            if (a + 1 < degree && row[a + 1].col == row[a].col)
+            {
+                continue;
+            }
+            matrix.col_idx[matrix.nnz] = row[a].col;
+            matrix.values[matrix.nnz] = row[a].value;
+            matrix.nnz++;
+        }
+        matrix.row_ptr[i + 1] = matrix.nnz;
+    }
+
+    free(row);
+    return matrix;
+}
+
+void sparseMultiplyVector(const t_sparse_matrix* A, const float* x, float* y)
+{
+    for (int i = 0; i < A->rows; i++)
+    {
+        float sum = 0.0f;
+        for (uint32_t k = A->row_ptr[i]; k < A->row_ptr[i + 1]; k++)
+        {
+            sum += A->values[k] * x[A->col_idx[k]];
+        }
+        y[i] = sum;
+    }
+}
+
+void sparseMultiplyVectorTransposed(const t_sparse_matrix* A, const float* x, float* y)
+{
+    memset(y, 0, A->cols * sizeof(float));
+    // Scatter each row: row i contributes x[i] * A[i][j] to y[j]
+    for (int i = 0; i < A->rows; i++)
+    {
+        float xi = x[i];
+        if (xi == 0.0f)
+        {
+            continue;
+        }
+        for (uint32_t k = A->row_ptr[i]; k < A->row_ptr[i + 1]; k++)
+        {
+            y[A->col_idx[k]] += xi * A->values[k];
+        }
+    }
+}
+
+// Function to do the transposed product for a block of vectors (SpMM)
+// Row i scatters A[i][j] times the count values of row i of x into row j of y
+void sparseMultiplyBlockTransposed(const t_sparse_matrix* A, const float* x, float* y, int count)
+{
+    memset(y, 0, (size_t)A->cols * count * sizeof(float));
+    for (int i = 0; i < A->rows; i++)
+    {
+        const float* source = &x[(size_t)i * count];
+        for (uint32_t k = A->row_ptr[i]; k < A->row_ptr[i + 1]; k++)
+        {
+            float* destination = &y[(size_t)A->col_idx[k] * count];
+            float p = A->values[k];
+            for (int d = 0; d < count; d++)
+            {
+                destination[d] += p * source[d];
+            }
+        }
+    }
+}
+
+// Function to multiply two sparse matrices (Gustavson's row-by-row algorithm)
+// For row i of the result, every entry A[i][k] scales row k of B into a dense accumulator;
+// the marker array tells which columns of the accumulator are in use for this row
+t_sparse_matrix sparseMultiply(const t_sparse_matrix* A, const t_sparse_matrix* B,
+                               float drop_tolerance, int max_row_nnz)
+{
+    if (A->cols != B->rows)
+    {
+        printf("Error: incompatible matrix dimensions for multiplication\n");
+        return allocate_sparse(0, 0, 0);
+    }
+
+    uint32_t capacity = A->nnz > B->nnz ? A->nnz : B->nnz;
+    if (capacity == 0)
+    {
+        capacity = 1;
+    }
+    t_sparse_matrix result = allocate_sparse(A->rows, B->cols, capacity);
+
+    float* accumulator = (float*)malloc((B->cols > 0 ? B->cols : 1) * sizeof(float));
+    int* marker = (int*)malloc((B->cols > 0 ? B->cols : 1) * sizeof(int));
+    t_sparse_entry* row = (t_sparse_entry*)malloc((B->cols > 0 ? B->cols : 1) * sizeof(t_sparse_entry));
+    if (accumulator == NULL || marker == NULL || row == NULL)
+    {
+        fatal_error("cannot allocate memory for sparse product");
+    }
+    for (int j = 0; j < B->cols; j++)
+    {
+        marker[j] = -1;
+    }
+
+    for (int i = 0; i < A->rows; i++)
+    {
+        int count = 0;
+        for (uint32_t ka = A->row_ptr[i]; ka < A->row_ptr[i + 1]; ka++)
+        {
+            uint32_t k = A->col_idx[ka];
+            float a = A->values[ka];
+            for (uint32_t kb = B->row_ptr[k]; kb < B->row_ptr[k + 1]; kb++)
+            {
+                uint32_t j = B->col_idx[kb];
+                if (marker[j] != i)
+                {
+                    marker[j] = i;
+                    accumulator[j] = 0.0f;
+                    row[count].col = j;
+                    count++;
+                }
+                accumulator[j] += a * B->values[kb];
+            }
+        }
+
+        // Fill-in control: drop the small entries, then keep the largest ones
+        int kept = 0;
+        for (int c = 0; c < count; c++)
+        {
+            float value = accumulator[row[c].col];
+            if (value != 0.0f && fabsf(value) >= drop_tolerance)
+            {
+                row[kept].col = row[c].col;
+                row[kept].value = value;
+                kept++;
+            }
+        }
+        if (max_row_nnz > 0 && kept > max_row_nnz)
+        {
+            qsort(row, kept, sizeof(t_sparse_entry), compare_by_magnitude);
+            kept = max_row_nnz;
+        }
+        qsort(row, kept, sizeof(t_sparse_entry), compare_by_column);
+
+        // Grow the output arrays if needed
+        if (result.nnz + (uint32_t)kept > capacity)
+        {
+            while (result.nnz + (uint32_t)kept > capacity)
+            {
+                capacity *= 2;
+            }
+            uint32_t* new_cols = (uint32_t*)realloc(result.col_idx, capacity * sizeof(uint32_t));
+            float* new_values = (float*)realloc(result.values, capacity * sizeof(float));
+            if (new_cols == NULL || new_values == NULL)
+            {
+                fatal_error("cannot grow sparse product");
+            }
+            result.col_idx = new_cols;
+            result.values = new_values;
+        }
+        for (int c = 0; c < kept; c++)
+        {
+            result.col_idx[result.nnz] = row[c].col;
+            result.values[result.nnz] = row[c].value;
+            result.nnz++;
+        }
+        result.row_ptr[i + 1] = result.nnz;
+    }
+
+    free(accumulator);
+    free(marker);
+    free(row);
+    return result;
+}
+
+// Function to calculate the difference between two sparse matrices
+// Both rows are sorted, so we walk them together like in a merge
+float sparseMatrixDifference(const t_sparse_matrix* M, const t_sparse_matrix* N)
+{
+    if (M->rows != N->rows || M->cols != N->cols)
+    {
+        printf("Error: cannot compute difference of matrices with different sizes\n");
+        return -1.0f;
+    }
+
+    float diff = 0.0f;
+    for (int i = 0; i < M->rows; i++)
+    {
+        uint32_t a = M->row_ptr[i];
+        uint32_t b = N->row_ptr[i];
+        while (a < M->row_ptr[i + 1] || b < N->row_ptr[i + 1])
+        {
+            if (b >= N->row_ptr[i + 1] || (a < M->row_ptr[i + 1] && M->col_idx[a] < N->col_idx[b]))
+            {
+                diff += fabsf(M->values[a]);
+                a++;
+            }
+            else if (a >= M->row_ptr[i + 1] || N->col_idx[b] < M->col_idx[a])
+            {
+                diff += fabsf(N->values[b]);
+                b++;
+            }
+            else
+            {
+                diff += fabsf(M->values[a] - N->values[b]);
+                a++;
+                b++;
+            }
+        }
+    }
+    return diff;
+}
+
+// Finds the position of a vertex (1-based) in the sorted member list, -1 if absent
+static int member_position(const t_class* compo, int vertex)
+{
+    int low = 0;
+    int high = compo->member_count - 1;
+    while (low <= high)
+    {
+        int middle = (low + high) / 2;
+        if (compo->members[middle] == vertex)
+        {
+            return middle;
+        }
+        if (compo->members[middle] < vertex)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle - 1;
+        }
+    }
+    return -1;
+}
+
+// Function to extract the sparse submatrix of a component
+// The members of a class are sorted, so the local column is found by binary search
+t_sparse_matrix sparseSubMatrix(const t_sparse_matrix* matrix, t_partition part, int compo_index)
+{
+    t_class* compo = &part.classes[compo_index];
+    int compo_size = compo->member_count;
+
+    // Upper bound on the number of entries: all the entries of the member rows
+    uint32_t capacity = 0;
+    for (int i = 0; i < compo_size; i++)
+    {
+        int orig_row_idx = compo->members[i] - 1;
+        capacity += matrix->row_ptr[orig_row_idx + 1] - matrix->row_ptr[orig_row_idx];
+    }
+
+    t_sparse_matrix sub = allocate_sparse(compo_size, compo_size, capacity);
+    for (int i = 0; i < compo_size; i++)
+    {
+        int orig_row_idx = compo->members[i] - 1;
+        // Columns stay sorted: the members and the original columns are both increasing
+        for (uint32_t k = matrix->row_ptr[orig_row_idx]; k < matrix->row_ptr[orig_row_idx + 1]; k++)
+        {
+            int local_col = member_position(compo, (int)matrix->col_idx[k] + 1);
+            if (local_col >= 0)
+            {
+                sub.col_idx[sub.nnz] = (uint32_t)local_col;
+                sub.values[sub.nnz] = matrix->values[k];
+                sub.nnz++;
+            }
+        }
+        sub.row_ptr[i + 1] = sub.nnz;
+    }
+
+    return sub;
+}
+
+// Function to calculate the period of a class with a breadth-first search
+// Every closed walk has a length that is a multiple of the GCD of the "level jumps"
+int getPeriodSparse(const t_sparse_matrix* sub)
+{
+    int k = sub->rows;
+    if (k == 0)
+    {
+        return 0;
+    }
+
+    int* level = (int*)malloc(k * sizeof(int));
+    int* queue = (int*)malloc(k * sizeof(int));
+    if (level == NULL || queue == NULL)
+    {
+        fatal_error("cannot allocate memory for period search");
+    }
+    for (int i = 0; i < k; i++)
+    {
+        level[i] = -1;
+    }
+
+    int head = 0;
+    int tail = 0;
+    level[0] = 0;
+    queue[tail++] = 0;
+    int period = 0;
+    while (head < tail)
+    {
+        int u = queue[head++];
+        for (uint32_t e = sub->row_ptr[u]; e < sub->row_ptr[u + 1]; e++)
+        {
+            int v = (int)sub->col_idx[e];
+            if (level[v] < 0)
+            {
+                level[v] = level[u] + 1;
+                queue[tail++] = v;
+            }
+            else
+            {
+                int jump = level[u] + 1 - level[v];
+                if (jump < 0)
+                {
+                    jump = -jump;
+                }
+                // Euclidean algorithm, as in gcd()
+                int a = period;
+                int b = jump;
+                while (b != 0)
+                {
+                    int temp = b;
+                    b = a % b;
+                    a = temp;
+                }
+                period = a;
+            }
+        }
+    }
+
+    free(level);
+    free(queue);
+    return period;
+}
+
+t_sparse_matrix copySparseMatrix(const t_sparse_matrix* src)
+{
+    t_sparse_matrix copy = allocate_sparse(src->rows, src->cols, src->nnz);
+    memcpy(copy.row_ptr, src->row_ptr, (src->rows + 1) * sizeof(uint32_t));
+    memcpy(copy.col_idx, src->col_idx, src->nnz * sizeof(uint32_t));
+    memcpy(copy.values, src->values, src->nnz * sizeof(float));
+    copy.nnz = src->nnz;
+    return copy;
+}
+
+t_matrix sparseToDense(const t_sparse_matrix* sparse)
+{
+    t_matrix dense = createEmptyMatrix(sparse->rows);
+    for (int i = 0; i < sparse->rows; i++)
+    {
+        for (uint32_t k = sparse->row_ptr[i]; k < sparse->row_ptr[i + 1]; k++)
+        {
+            dense.data[i][sparse->col_idx[k]] = sparse->values[k];
+        }
+    }
+    return dense;
+}
+
+// Function to print a sparse matrix
+// Same layout as printMatrix for small matrices
+void printSparseMatrix(const t_sparse_matrix* matrix)
+{
+    if (output_level() == OUTPUT_SUMMARY)
+    {
+        printf("Sparse matrix (%d x %d, %u non-zero entries)\n\n", matrix->rows, matrix->cols, matrix->nnz);
+        return;
+    }
+
+    int shown_rows = output_preview(matrix->rows);
+    int shown_cols = output_preview(matrix->cols);
+    if (shown_rows < matrix->rows || shown_cols < matrix->cols)
+    {
+        printf("Sparse matrix (%d x %d, %u non-zero entries), top-left corner:\n",
+               matrix->rows, matrix->cols, matrix->nnz);
+    }
+    else
+    {
+        printf("Matrix (%d x %d):\n", matrix->rows, matrix->cols);
+    }
+    for (int i = 0; i < shown_rows; i++)
+    {
+        printf("  ");
+        uint32_t k = matrix->row_ptr[i];
+        for (int j = 0; j < shown_cols; j++)
+        {
+            float value = 0.0f;
+            if (k < matrix->row_ptr[i + 1] && matrix->col_idx[k] == (uint32_t)j)
+            {
+                value = matrix->values[k];
+                k++;
+            }
+            printf("%.4f  ", value);
+        }
+        if (shown_cols < matrix->cols)
+        {
+            printf("... (%d more)", matrix->cols - shown_cols);
+        }
+        printf("\n");
+    }
+    print_omitted(shown_rows, matrix->rows, "rows");
+    printf("\n");
+}
+
+void freeSparseMatrix(t_sparse_matrix* matrix)
+{
+    free(matrix->row_ptr);
+    free(matrix->col_idx);
+    free(matrix->values);
+    matrix->row_ptr = NULL;
+    matrix->col_idx = NULL;
+    matrix->values = NULL;
+    matrix->rows = 0;
+    matrix->cols = 0;
+    matrix->nnz = 0;
+}
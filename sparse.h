@@ -0,0 +1,155 @@
+#ifndef SPARSE_H
+#define SPARSE_H
+
+#include <stdint.h>
+#include "utils.h"
+#include "graph_analysis.h"
+#include "matrix.h"
+
+// Structure to represent a sparse matrix in CSR (compressed sparse row) format
+// The non-zero entries of row i are at positions row_ptr[i] ... row_ptr[i + 1] - 1
+// of col_idx / values, sorted by column
+typedef struct
+{
+    uint32_t* row_ptr;   // rows + 1 offsets
+    uint32_t* col_idx;   // Column of each non-zero entry (0-based)
+    float* values;       // Value of each non-zero entry
+    int rows;            // Number of rows
+    int cols;            // Number of columns
+    uint32_t nnz;        // Number of stored entries
+} t_sparse_matrix;
+
+/**
+ * @brief Creates the sparse transition matrix of a graph
+ *
+ * Built directly from the adjacency list, without any dense n x n storage.
+ * As with createTransitionMatrix, when an edge appears twice the value read
+ * first in the file is kept.
+ *
+ * @param graph The adjacency list representing the Markov graph
+ * @return t_sparse_matrix The transition matrix in CSR format
+ */
+t_sparse_matrix createSparseTransitionMatrix(const adjacency_list* graph);
+
+/**
+ * @brief Sparse matrix-vector product y = A * x
+ *
+ * @param A The sparse matrix
+ * @param x The input vector (A.cols values)
+ * @param y The output vector (A.rows values, must not overlap x)
+ */
+void sparseMultiplyVector(const t_sparse_matrix* A, const float* x, float* y);
+
+/**
+ * @brief Transposed sparse matrix-vector product y = A^T * x
+ *
+ * For a transition matrix this is one step of a distribution: y^T = x^T * M.
+ *
+ * @param A The sparse matrix
+ * @param x The input vector (A.rows values)
+ * @param y The output vector (A.cols values, must not overlap x)
+ */
+void sparseMultiplyVectorTransposed(const t_sparse_matrix* A, const float* x, float* y);
+
+/**
+ * @brief Transposed sparse product for a block of vectors Y = A^T * X
+ *
+ * The count vectors are stored row-major (x[i * count + d] is entry i of vector d),
+ * so each stored entry A[i][j] updates count contiguous values of row j of Y.
+ * For a transition matrix this is one step of count distributions at once.
+ *
+ * @param A The sparse matrix
+ * @param x The input block (A.rows x count values)
+ * @param y The output block (A.cols x count values, must not overlap x)
+ * @param count The number of vectors in the block
+ */
+void sparseMultiplyBlockTransposed(const t_sparse_matrix* A, const float* x, float* y, int count);
+
+/**
+ * @brief Sparse matrix-matrix product (SpGEMM) with fill-in control
+ *
+ * Computes A * B row by row with a dense accumulator (Gustavson's algorithm).
+ * Entries smaller than drop_tolerance in absolute value are dropped, and when
+ * max_row_nnz > 0 only the max_row_nnz largest entries of each row are kept.
+ *
+ * @param A The left operand
+ * @param B The right operand
+ * @param drop_tolerance Entries below this value are not stored (0 keeps everything)
+ * @param max_row_nnz Maximum number of entries per row of the result (0 = no limit)
+ * @return t_sparse_matrix The product
+ */
+t_sparse_matrix sparseMultiply(const t_sparse_matrix* A, const t_sparse_matrix* B,
+                               float drop_tolerance, int max_row_nnz);
+
+/**
+ * @brief Calculates the difference between two sparse matrices
+ *
+ * Same measure as matrixDifference: sum over all i,j of |M[i][j] - N[i][j]|,
+ * computed by merging the rows, so only stored entries are visited.
+ *
+ * @param M The first matrix
+ * @param N The second matrix
+ * @return float The sum of absolute differences (-1 if the sizes differ)
+ */
+float sparseMatrixDifference(const t_sparse_matrix* M, const t_sparse_matrix* N);
+
+/**
+ * @brief Extracts the sparse submatrix of a component
+ *
+ * Same as subMatrix, but only the stored entries of the member rows are visited.
+ *
+ * @param matrix The sparse matrix of the whole graph
+ * @param part The partition of the graph into strongly connected components
+ * @param compo_index The index of the component to extract
+ * @return t_sparse_matrix The submatrix corresponding to the specified component
+ */
+t_sparse_matrix sparseSubMatrix(const t_sparse_matrix* matrix, t_partition part, int compo_index);
+
+/**
+ * @brief Calculates the period of a class from its sparse submatrix
+ *
+ * Graph method instead of matrix powers: a breadth-first search gives a level to
+ * each state, and the period is the GCD of level[u] + 1 - level[v] over all the
+ * edges u -> v. Runs in O(k + nnz) and gives the same result as getPeriod.
+ *
+ * @param sub The sparse submatrix of a strongly connected class
+ * @return int The period of the class (0 for a single state without loop)
+ */
+int getPeriodSparse(const t_sparse_matrix* sub);
+
+/**
+ * @brief Copies a sparse matrix
+ *
+ * @param src The matrix to copy
+ * @return t_sparse_matrix A new matrix with the same entries
+ */
+t_sparse_matrix copySparseMatrix(const t_sparse_matrix* src);
+
+/**
+ * @brief Converts a sparse matrix into a dense one
+ *
+ * Only meant for small matrices (classes, display).
+ *
+ * @param sparse The sparse matrix (must be square)
+ * @return t_matrix The dense matrix
+ */
+t_matrix sparseToDense(const t_sparse_matrix* sparse);
+
+/**
+ * @brief Prints a sparse matrix to the console
+ *
+ * Same layout as printMatrix. Depending on the output level (see output.h), large
+ * matrices only show their top-left corner, or only their size and number of entries.
+ *
+ * @param matrix The matrix to print
+ */
+void printSparseMatrix(const t_sparse_matrix* matrix);
+
+/**
+ * @brief Frees the memory allocated for a sparse matrix
+ *
+ * @param matrix The matrix to free
+ */
+void freeSparseMatrix(t_sparse_matrix* matrix);
+
+#endif // SPARSE_H
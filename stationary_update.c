@@ -0,0 +1,535 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "stationary_update.h"
+
+// Below this the Sherman-Morrison denominator counts as zero: the class is factorised again instead
+#define RANK_ONE_MIN_DENOMINATOR 1e-10
+
+static void* allocate(size_t size)
+{
+    void* block = malloc(size > 0 ? size : 1);
+    if (block == NULL)
+    {
+        fatal_error("Could not allocate memory for the stationary updates");
+    }
+    return block;
+}
+
+t_stationary_tracker* create_stationary_tracker(void)
+{
+    t_stationary_tracker* tracker = (t_stationary_tracker*)calloc(1, sizeof(t_stationary_tracker));
+    if (tracker == NULL)
+    {
+        fatal_error("Could not allocate memory for the stationary updates");
+    }
+    return tracker;
+}
+
+// ---------------------------------------------------------------------------------------------
+// Factors
+
+static void free_row(t_factor_row* row)
+{
+    free(row->columns);
+    free(row->values);
+    row->columns = NULL;
+    row->values = NULL;
+    row->size = 0;
+}
+
+static void clear_updates(t_stationary_factor* factor)
+{
+    for (int m = 0; m < factor->update_count; m++)
+    {
+        free(factor->updates[m].column);
+        free(factor->updates[m].row);
+    }
+    factor->update_count = 0;
+}
+
+static void free_factor(t_stationary_factor* factor)
+{
+    if (factor == NULL)
+    {
+        return;
+    }
+    for (int i = 0; i < factor->size; i++)
+    {
+        free_row(&factor->rows[i]);
+    }
+    clear_updates(factor);
+    freeLU(&factor->lu);
+    free(factor->rows);
+    free(factor->members);
+    free(factor->updates);
+    free(factor->stationary);
+    free(factor);
+}
+
+static void normalise(double* values, int size)
+{
+    double sum = 0.0;
+    for (int i = 0; i < size; i++)
+    {
+        sum += values[i];
+    }
+    for (int i = 0; i < size; i++)
+    {
+        values[i] /= sum;
+    }
+}
+
+// Reads the row of a state from the graph, in the local states of class c
+// Returns 0 (and no row) if an edge leaves the class
+static int read_row(t_stationary_tracker* tracker, const adjacency_list* graph, int c, int state,
+                    t_factor_row* row)
+{
+    int count = 0;
+    for (cell* edge = graph->lists[state - 1].head; edge != NULL; edge = edge->next)
+    {
+        count++;
+    }
+    row->columns = (int*)allocate((size_t)count * sizeof(int));
+    row->values = (double*)allocate((size_t)count * sizeof(double));
+    row->size = 0;
+
+    int inside = 1;
+    for (cell* edge = graph->lists[state - 1].head; edge != NULL; edge = edge->next)
+    {
+        int vertex = edge->arrival_vertex;
+        if (vertex > tracker->vertex_count || tracker->vertex_class[vertex - 1] != c)
+        {
+            inside = 0;
+            break;
+        }
+        // Duplicate edges: keep the first, like the direct solver
+        int j = tracker->vertex_position[vertex - 1];
+        if (tracker->seen[j])
+        {
+            continue;
+        }
+        tracker->seen[j] = 1;
+        row->columns[row->size] = j;
+        row->values[row->size] = edge->probability;
+        row->size++;
+    }
+    for (int e = 0; e < row->size; e++)
+    {
+        tracker->seen[row->columns[e]] = 0;
+    }
+    if (!inside)
+    {
+        free_row(row);
+    }
+    return inside;
+}
+
+// Factorises B = I - P + J from the rows of the factor and solves pi^T B = 1^T
+static void factorise(t_stationary_tracker* tracker, t_stationary_factor* factor)
+{
+    int k = factor->size;
+    double* system = (double*)allocate((size_t)k * k * sizeof(double));
+    for (int i = 0; i < k; i++)
+    {
+        for (int j = 0; j < k; j++)
+        {
+            system[(size_t)i * k + j] = (i == j) ? 2.0 : 1.0;
+        }
+        const t_factor_row* row = &factor->rows[i];
+        for (int e = 0; e < row->size; e++)
+        {
+            system[(size_t)i * k + row->columns[e]] -= row->values[e];
+        }
+    }
+
+    freeLU(&factor->lu);
+    factor->lu = luFactorize(system, k);
+    free(system);
+    clear_updates(factor);
+    tracker->factorisations++;
+
+    if (factor->lu.singular)
+    {
+        free(factor->stationary);
+        factor->stationary = NULL;
+        return;
+    }
+    if (factor->stationary == NULL)
+    {
+        factor->stationary = (double*)allocate((size_t)k * sizeof(double));
+    }
+    for (int i = 0; i < k; i++)
+    {
+        factor->stationary[i] = 1.0;
+    }
+    luSolveTranspose(&factor->lu, factor->stationary, factor->stationary);
+    normalise(factor->stationary, k);
+}
+
+// Factor of class c, whose states already have their positions; NULL if a row leaves the class
+static t_stationary_factor* create_factor(t_stationary_tracker* tracker, const adjacency_list* graph,
+                                          const t_class* cls, int c)
+{
+    int k = cls->member_count;
+    t_stationary_factor* factor = (t_stationary_factor*)calloc(1, sizeof(t_stationary_factor));
+    if (factor == NULL)
+    {
+        fatal_error("Could not allocate memory for the stationary updates");
+    }
+    factor->size = k;
+    factor->members = (int*)allocate((size_t)k * sizeof(int));
+    memcpy(factor->members, cls->members, (size_t)k * sizeof(int));
+    factor->rows = (t_factor_row*)calloc((size_t)k, sizeof(t_factor_row));
+    factor->max_updates = (k / 4 > 8) ? k / 4 : 8;
+    factor->updates = (t_rank_one*)allocate((size_t)factor->max_updates * sizeof(t_rank_one));
+    if (factor->rows == NULL)
+    {
+        fatal_error("Could not allocate memory for the stationary updates");
+    }
+    for (int i = 0; i < k; i++)
+    {
+        if (!read_row(tracker, graph, c, cls->members[i], &factor->rows[i]))
+        {
+            free_factor(factor);
+            return NULL;
+        }
+    }
+    factorise(tracker, factor);
+    return factor;
+}
+
+static void forget_class(t_stationary_tracker* tracker, int c)
+{
+    t_stationary_factor* factor = tracker->factors[c];
+    for (int i = 0; i < factor->size; i++)
+    {
+        tracker->vertex_class[factor->members[i] - 1] = -1;
+    }
+    free_factor(factor);
+    tracker->factors[c] = NULL;
+}
+
+// ---------------------------------------------------------------------------------------------
+// Partitions
+
+static void reserve_scratch(t_stationary_tracker* tracker, int size)
+{
+    if (size <= tracker->scratch_size)
+    {
+        return;
+    }
+    free(tracker->scratch);
+    free(tracker->seen);
+    tracker->scratch = (double*)allocate((size_t)size * 3 * sizeof(double));
+    tracker->seen = (int*)calloc((size_t)size, sizeof(int));
+    if (tracker->seen == NULL)
+    {
+        fatal_error("Could not allocate memory for the stationary updates");
+    }
+    tracker->scratch_size = size;
+}
+
+// Class of the old partition that has exactly the states of cls, or -1
+static int same_class(const t_stationary_tracker* tracker, const t_class* cls)
+{
+    int first = cls->members[0];
+    if (first > tracker->vertex_count)
+    {
+        return -1;
+    }
+    int previous = tracker->vertex_class[first - 1];
+    if (previous < 0 || tracker->factors[previous]->size != cls->member_count)
+    {
+        return -1;
+    }
+    for (int m = 1; m < cls->member_count; m++)
+    {
+        int vertex = cls->members[m];
+        if (vertex > tracker->vertex_count || tracker->vertex_class[vertex - 1] != previous)
+        {
+            return -1;
+        }
+    }
+    return previous;
+}
+
+void track_partition(t_stationary_tracker* tracker, const adjacency_list* graph, const t_partition* partition,
+                     const graph_characteristics* characteristics)
+{
+    int count = partition->class_count;
+    int vertices = graph->num_vertices;
+    t_stationary_factor** factors =
+        (t_stationary_factor**)calloc(count > 0 ? (size_t)count : 1, sizeof(t_stationary_factor*));
+    int* vertex_class = (int*)allocate((size_t)vertices * sizeof(int));
+    int* vertex_position = (int*)allocate((size_t)vertices * sizeof(int));
+    if (factors == NULL)
+    {
+        fatal_error("Could not allocate memory for the stationary updates");
+    }
+    for (int v = 0; v < vertices; v++)
+    {
+        vertex_class[v] = -1;
+    }
+
+    // Classes that kept exactly the same states keep their factor (and its local order)
+    int largest = 0;
+    for (int c = 0; c < count; c++)
+    {
+        const t_class* cls = &partition->classes[c];
+        if (!characteristics->class_is_persistent[c] || cls->member_count > STATIONARY_UPDATE_MAX_SIZE)
+        {
+            continue;
+        }
+        largest = (cls->member_count > largest) ? cls->member_count : largest;
+        int previous = same_class(tracker, cls);
+        if (previous < 0)
+        {
+            continue;
+        }
+        t_stationary_factor* factor = tracker->factors[previous];
+        tracker->factors[previous] = NULL;
+        factors[c] = factor;
+        for (int i = 0; i < factor->size; i++)
+        {
+            vertex_class[factor->members[i] - 1] = c;
+            vertex_position[factor->members[i] - 1] = i;
+        }
+        tracker->reused++;
+    }
+
+    // The factors of the classes that changed are dropped
+    for (int c = 0; c < tracker->class_count; c++)
+    {
+        free_factor(tracker->factors[c]);
+    }
+    free(tracker->factors);
+    free(tracker->vertex_class);
+    free(tracker->vertex_position);
+    tracker->factors = factors;
+    tracker->class_count = count;
+    tracker->vertex_class = vertex_class;
+    tracker->vertex_position = vertex_position;
+    tracker->vertex_count = vertices;
+    reserve_scratch(tracker, largest);
+
+    // The new persistent classes are factorised from the graph
+    for (int c = 0; c < count; c++)
+    {
+        const t_class* cls = &partition->classes[c];
+        if (!characteristics->class_is_persistent[c] || cls->member_count > STATIONARY_UPDATE_MAX_SIZE ||
+            factors[c] != NULL)
+        {
+            continue;
+        }
+        for (int i = 0; i < cls->member_count; i++)
+        {
+            vertex_class[cls->members[i] - 1] = c;
+            vertex_position[cls->members[i] - 1] = i;
+        }
+        factors[c] = create_factor(tracker, graph, cls, c);
+        if (factors[c] == NULL)
+        {
+            for (int i = 0; i < cls->member_count; i++)
+            {
+                vertex_class[cls->members[i] - 1] = -1;
+            }
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------------------------
+// Rank-one updates
+
+// Replaces the row of a state of class c by its row in the graph, with d = new row - old row
+// Returns 1 if the row changed, 0 if not, -1 if it now leaves the class (which is dropped)
+static int replace_row(t_stationary_tracker* tracker, const adjacency_list* graph, int c, int state, double* d)
+{
+    t_stationary_factor* factor = tracker->factors[c];
+    int k = factor->size;
+    t_factor_row row;
+    if (!read_row(tracker, graph, c, state, &row))
+    {
+        forget_class(tracker, c);  // The class is not closed any more
+        return -1;
+    }
+
+    memset(d, 0, (size_t)k * sizeof(double));
+    t_factor_row* old = &factor->rows[tracker->vertex_position[state - 1]];
+    for (int e = 0; e < old->size; e++)
+    {
+        d[old->columns[e]] -= old->values[e];
+    }
+    for (int e = 0; e < row.size; e++)
+    {
+        d[row.columns[e]] += row.values[e];
+    }
+    free_row(old);
+    *old = row;
+
+    for (int j = 0; j < k; j++)
+    {
+        if (d[j] != 0.0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Applies the change d of row r to the solution and to the inverse; returns 0 if B became
+// (nearly) singular, the class must then be factorised again
+static int rank_one_update(t_stationary_tracker* tracker, t_stationary_factor* factor, int r, const double* d)
+{
+    int k = factor->size;
+    double* w = tracker->scratch + k;
+    double* u = w + k;
+
+    // w^T = d^T B^-1 and u = B^-1 e_r, with B^-1 = LU^-1 + the corrections so far
+    luSolveTranspose(&factor->lu, d, w);
+    memset(u, 0, (size_t)k * sizeof(double));
+    u[r] = 1.0;
+    luSolve(&factor->lu, u, u);
+    for (int m = 0; m < factor->update_count; m++)
+    {
+        const t_rank_one* update = &factor->updates[m];
+        double along = 0.0;
+        for (int j = 0; j < k; j++)
+        {
+            along += d[j] * update->column[j];
+        }
+        double at = update->row[r];
+        for (int j = 0; j < k; j++)
+        {
+            w[j] += along * update->row[j];
+            u[j] += at * update->column[j];
+        }
+    }
+
+    double denominator = 1.0 - w[r];
+    if (fabs(denominator) < RANK_ONE_MIN_DENOMINATOR)
+    {
+        return 0;
+    }
+
+    // Sherman-Morrison on the solution, then on the inverse for the next updates
+    double scale = factor->stationary[r] / denominator;
+    for (int j = 0; j < k; j++)
+    {
+        factor->stationary[j] += scale * w[j];
+    }
+    normalise(factor->stationary, k);
+
+    t_rank_one* update = &factor->updates[factor->update_count++];
+    update->column = (double*)allocate((size_t)k * sizeof(double));
+    update->row = (double*)allocate((size_t)k * sizeof(double));
+    memcpy(update->column, u, (size_t)k * sizeof(double));
+    for (int j = 0; j < k; j++)
+    {
+        update->row[j] = w[j] / denominator;
+    }
+    tracker->updates++;
+    return 1;
+}
+
+int stationary_rows_changed(t_stationary_tracker* tracker, const adjacency_list* graph, const int* states,
+                            int count)
+{
+    // Changed rows of each class: a class with more than its remaining updates is factorised once
+    int* changed = (int*)calloc(tracker->class_count > 0 ? (size_t)tracker->class_count : 1, sizeof(int));
+    if (changed == NULL)
+    {
+        fatal_error("Could not allocate memory for the stationary updates");
+    }
+    for (int s = 0; s < count; s++)
+    {
+        int state = states[s];
+        if (state <= tracker->vertex_count && tracker->vertex_class[state - 1] >= 0)
+        {
+            changed[tracker->vertex_class[state - 1]]++;
+        }
+    }
+
+    // 1: rank-one updates, 2: factorised at the end, 3: factorised at the end and a row did change
+    for (int c = 0; c < tracker->class_count; c++)
+    {
+        const t_stationary_factor* factor = tracker->factors[c];
+        if (changed[c] > 0)
+        {
+            changed[c] = (factor->stationary == NULL || changed[c] > factor->max_updates - factor->update_count)
+                             ? 2 : 1;
+        }
+    }
+
+    int applied = 0;
+    for (int s = 0; s < count; s++)
+    {
+        int state = states[s];
+        if (state > tracker->vertex_count || tracker->vertex_class[state - 1] < 0)
+        {
+            continue;
+        }
+        int c = tracker->vertex_class[state - 1];
+        t_stationary_factor* factor = tracker->factors[c];
+        if (replace_row(tracker, graph, c, state, tracker->scratch) <= 0)
+        {
+            continue;
+        }
+        if (changed[c] >= 2 || factor->stationary == NULL)
+        {
+            changed[c] = 3;  // All its rows are replaced first
+        }
+        else if (rank_one_update(tracker, factor, tracker->vertex_position[state - 1], tracker->scratch))
+        {
+            applied++;
+        }
+        else
+        {
+            factorise(tracker, factor);
+        }
+    }
+
+    for (int c = 0; c < tracker->class_count; c++)
+    {
+        if (changed[c] == 3 && tracker->factors[c] != NULL)
+        {
+            factorise(tracker, tracker->factors[c]);
+        }
+    }
+    free(changed);
+    return applied;
+}
+
+double tracked_probability(const t_stationary_tracker* tracker, int state)
+{
+    if (state > tracker->vertex_count || tracker->vertex_class[state - 1] < 0)
+    {
+        return -1.0;
+    }
+    const t_stationary_factor* factor = tracker->factors[tracker->vertex_class[state - 1]];
+    if (factor->stationary == NULL)
+    {
+        return -1.0;
+    }
+    return factor->stationary[tracker->vertex_position[state - 1]];
+}
+
+void free_stationary_tracker(t_stationary_tracker* tracker)
+{
+    if (tracker == NULL)
+    {
+        return;
+    }
+    for (int c = 0; c < tracker->class_count; c++)
+    {
+        free_factor(tracker->factors[c]);
+    }
+    free(tracker->factors);
+    free(tracker->vertex_class);
+    free(tracker->vertex_position);
+    free(tracker->scratch);
+    free(tracker->seen);
+    free(tracker);
+}
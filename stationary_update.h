@@ -0,0 +1,84 @@
+#ifndef STATIONARY_UPDATE_H
+#define STATIONARY_UPDATE_H
+
+#include "utils.h"
+#include "graph_analysis.h"
+#include "matrix.h"
+
+// Largest class whose factorisation is kept (its LU factors take size^2 doubles)
+#define STATIONARY_UPDATE_MAX_SIZE 2048
+
+// Row of P as the factorisation knows it (columns are local states of the class)
+typedef struct
+{
+    int* columns;
+    double* values;
+    int size;
+} t_factor_row;
+
+// One rank-one correction: B_m^-1 = B_(m-1)^-1 + column * row^T
+typedef struct
+{
+    double* column;            // B_(m-1)^-1 e_r
+    double* row;               // d^T B_(m-1)^-1 / (1 - d^T B_(m-1)^-1 e_r)
+} t_rank_one;
+
+// Stationary distribution of one persistent class, kept up to date while its rows change.
+// Same system as the direct LU solver: pi^T B = 1^T with B = I - P + J. B is factorised once;
+// changing row r of P by d^T changes B by -e_r d^T, and Sherman-Morrison gives the new solution
+// from the old one in O(k^2), without factorising again:
+//   pi'^T = pi^T + pi_r (d^T B^-1) / (1 - d^T B^-1 e_r)
+// The corrections pile up on top of the LU factors; after size / 4 of them (at least 8) the class
+// is factorised again, which keeps the amortised cost O(k^2) and the rounding errors small.
+typedef struct
+{
+    int size;
+    int* members;              // Vertex of local state i
+    t_factor_row* rows;
+    t_lu lu;                   // Of B when the class was last factorised
+    t_rank_one* updates;
+    int update_count;
+    int max_updates;
+    double* stationary;        // pi, one value per local state (NULL if B was singular)
+} t_stationary_factor;
+
+// Stationary distributions of all the persistent classes of a graph whose rows change.
+// The caller reports every changed row; when the edge structure changes it gives the new
+// partition, and only the classes whose states changed are factorised again.
+typedef struct
+{
+    t_stationary_factor** factors;  // Factor of class c at factors[c] (NULL: transient or too large)
+    int class_count;
+    int* vertex_class;         // Class of vertex v at vertex_class[v - 1] (-1: not tracked)
+    int* vertex_position;      // Local state of vertex v in its factor
+    int vertex_count;
+    double* scratch;           // Dense work vectors of the largest class
+    int* seen;
+    int scratch_size;
+
+    // What the updates did
+    long updates;              // Rank-one updates applied
+    long factorisations;       // Classes factorised (new, changed, or after too many updates)
+    long reused;               // Factors kept across a new partition
+} t_stationary_tracker;
+
+t_stationary_tracker* create_stationary_tracker(void);
+
+// Function to follow a new partition of the graph: the factor of a persistent class with exactly
+// the same states as before is kept as it is (its changed rows must then be reported with
+// stationary_rows_changed); the other persistent classes are factorised from the graph
+void track_partition(t_stationary_tracker* tracker, const adjacency_list* graph, const t_partition* partition,
+                     const graph_characteristics* characteristics);
+
+// Function to bring the classes up to date after the rows of some states changed: one rank-one
+// update per row, or one new factorisation for a class with more changed rows than updates left.
+// A class that one of the rows now leaves is dropped. Returns the number of rank-one updates.
+int stationary_rows_changed(t_stationary_tracker* tracker, const adjacency_list* graph, const int* states,
+                            int count);
+
+// Function to get the stationary probability of a state in its class (-1 if not tracked)
+double tracked_probability(const t_stationary_tracker* tracker, int state);
+
+void free_stationary_tracker(t_stationary_tracker* tracker);
+
+#endif
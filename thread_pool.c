@@ -0,0 +1,321 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "thread_pool.h"
+#include "utils.h"
+
+#define TASK_QUEUE_INITIAL_CAPACITY 64
+
+// Queue of the calling thread, so that tasks submitted by a task stay on the same thread
+static _Thread_local const t_thread_pool* current_pool = NULL;
+static _Thread_local int current_queue = -1;
+
+typedef struct
+{
+    t_thread_pool* pool;
+    int index;
+} t_worker_start;
+
+static void queue_push(t_task_queue* queue, t_task task)
+{
+    pthread_mutex_lock(&queue->lock);
+    if (queue->tail == queue->capacity)
+    {
+        if (queue->head > 0)
+        {
+            // Reuse the space of the tasks already taken
+            memmove(queue->tasks, queue->tasks + queue->head, (queue->tail - queue->head) * sizeof(t_task));
+            queue->tail -= queue->head;
+            queue->head = 0;
+        }
+        else
+        {
+            int capacity = queue->capacity * 2;
+            t_task* tasks = (t_task*)realloc(queue->tasks, capacity * sizeof(t_task));
+            if (tasks == NULL)
+            {
+                fatal_error("cannot grow task queue");
+            }
+            queue->tasks = tasks;
+            queue->capacity = capacity;
+        }
+    }
+    queue->tasks[queue->tail++] = task;
+    pthread_mutex_unlock(&queue->lock);
+}
+
+// Takes the oldest task (owner) or the newest one (thief); returns 0 if the queue is empty
+static int queue_pop(t_task_queue* queue, int steal, t_task* task)
+{
+    int found = 0;
+    pthread_mutex_lock(&queue->lock);
+    if (queue->head < queue->tail)
+    {
+        *task = steal ? queue->tasks[--queue->tail] : queue->tasks[queue->head++];
+        if (queue->head == queue->tail)
+        {
+            queue->head = 0;
+            queue->tail = 0;
+        }
+        found = 1;
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return found;
+}
+
+// Own queue first, then the other queues in turn
+static int take_task(t_thread_pool* pool, int self, t_task* task)
+{
+    int found = queue_pop(&pool->queues[self], 0, task);
+    for (int offset = 1; !found && offset < pool->thread_count; offset++)
+    {
+        found = queue_pop(&pool->queues[(self + offset) % pool->thread_count], 1, task);
+    }
+    if (found)
+    {
+        pthread_mutex_lock(&pool->lock);
+        pool->queued--;
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return found;
+}
+
+static void run_task(t_thread_pool* pool, t_task task)
+{
+    // The arena of the waiting thread is not the task's (the task may come from another owner)
+    t_arena* arena = set_thread_arena(NULL);
+    task.function(task.argument);
+    set_thread_arena(arena);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->pending--;
+    if (task.group != NULL)
+    {
+        task.group->pending--;
+    }
+    if (pool->pending == 0 || (task.group != NULL && task.group->pending == 0))
+    {
+        pthread_cond_broadcast(&pool->changed);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void* worker_thread(void* argument)
+{
+    t_worker_start* start = (t_worker_start*)argument;
+    t_thread_pool* pool = start->pool;
+    int self = start->index;
+    free(start);
+
+    current_pool = pool;
+    current_queue = self;
+
+    while (1)
+    {
+        t_task task;
+        if (take_task(pool, self, &task))
+        {
+            run_task(pool, task);
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        while (!pool->stop && pool->queued <= 0)
+        {
+            pthread_cond_wait(&pool->changed, &pool->lock);
+        }
+        int stop = pool->stop && pool->queued <= 0;
+        pthread_mutex_unlock(&pool->lock);
+        if (stop)
+        {
+            break;
+        }
+    }
+    return NULL;
+}
+
+t_thread_pool* create_thread_pool(int thread_count)
+{
+    if (thread_count < 1)
+    {
+        thread_count = 1;
+    }
+
+    t_thread_pool* pool = (t_thread_pool*)malloc(sizeof(t_thread_pool));
+    if (pool == NULL)
+    {
+        fatal_error("cannot allocate thread pool");
+    }
+    pool->thread_count = thread_count;
+    pool->queues = (t_task_queue*)malloc(thread_count * sizeof(t_task_queue));
+    pool->threads = (pthread_t*)malloc(thread_count * sizeof(pthread_t));
+    if (pool->queues == NULL || pool->threads == NULL)
+    {
+        fatal_error("cannot allocate thread pool");
+    }
+    for (int q = 0; q < thread_count; q++)
+    {
+        pool->queues[q].tasks = (t_task*)malloc(TASK_QUEUE_INITIAL_CAPACITY * sizeof(t_task));
+        if (pool->queues[q].tasks == NULL)
+        {
+            fatal_error("cannot allocate task queue");
+        }
+        pool->queues[q].head = 0;
+        pool->queues[q].tail = 0;
+        pool->queues[q].capacity = TASK_QUEUE_INITIAL_CAPACITY;
+        pthread_mutex_init(&pool->queues[q].lock, NULL);
+    }
+    pool->queued = 0;
+    pool->pending = 0;
+    pool->next_queue = 0;
+    pool->stop = 0;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->changed, NULL);
+
+    // The last queue belongs to the thread that waits
+    for (int w = 0; w < thread_count - 1; w++)
+    {
+        t_worker_start* start = (t_worker_start*)malloc(sizeof(t_worker_start));
+        if (start == NULL)
+        {
+            fatal_error("cannot allocate thread pool");
+        }
+        start->pool = pool;
+        start->index = w;
+        if (pthread_create(&pool->threads[w], NULL, worker_thread, start) != 0)
+        {
+            fatal_error("cannot start worker thread");
+        }
+    }
+    return pool;
+}
+
+void thread_pool_submit(t_thread_pool* pool, t_task_group* group, t_task_function function, void* argument)
+{
+    t_task task;
+    task.function = function;
+    task.argument = argument;
+    task.group = group;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->pending++;
+    if (group != NULL)
+    {
+        group->pending++;
+    }
+    int target = current_queue;
+    if (current_pool != pool || target < 0)
+    {
+        target = pool->next_queue;
+        pool->next_queue = (pool->next_queue + 1) % pool->thread_count;
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    queue_push(&pool->queues[target], task);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->queued++;
+    pthread_cond_broadcast(&pool->changed);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void thread_pool_wait(t_thread_pool* pool, t_task_group* group)
+{
+    int* pending = (group != NULL) ? &group->pending : &pool->pending;
+
+    // The waiting thread works on the last queue meanwhile
+    const t_thread_pool* saved_pool = current_pool;
+    int saved_queue = current_queue;
+    int self = pool->thread_count - 1;
+    if (current_pool == pool)
+    {
+        self = current_queue;
+    }
+    current_pool = pool;
+    current_queue = self;
+
+    while (1)
+    {
+        t_task task;
+        if (take_task(pool, self, &task))
+        {
+            run_task(pool, task);
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        while (*pending > 0 && pool->queued <= 0)
+        {
+            pthread_cond_wait(&pool->changed, &pool->lock);
+        }
+        int done = (*pending == 0);
+        pthread_mutex_unlock(&pool->lock);
+        if (done)
+        {
+            break;
+        }
+    }
+
+    current_pool = saved_pool;
+    current_queue = saved_queue;
+}
+
+// Stops the workers once the queues are empty and frees the pool
+static void stop_thread_pool(t_thread_pool* pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->changed);
+    pthread_mutex_unlock(&pool->lock);
+    for (int w = 0; w < pool->thread_count - 1; w++)
+    {
+        pthread_join(pool->threads[w], NULL);
+    }
+
+    for (int q = 0; q < pool->thread_count; q++)
+    {
+        free(pool->queues[q].tasks);
+        pthread_mutex_destroy(&pool->queues[q].lock);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->changed);
+    free(pool->queues);
+    free(pool->threads);
+    free(pool);
+}
+
+void free_thread_pool(t_thread_pool* pool)
+{
+    thread_pool_wait(pool, NULL);
+    stop_thread_pool(pool);
+}
+
+void abandon_thread_pool(t_thread_pool* pool)
+{
+    if (pool == NULL)
+    {
+        return;
+    }
+    // The calling thread left thread_pool_wait without restoring its queue
+    if (current_pool == pool)
+    {
+        current_pool = NULL;
+        current_queue = -1;
+    }
+
+    // The tasks not started are never run; the workers finish the ones they are running
+    int dropped = 0;
+    for (int q = 0; q < pool->thread_count; q++)
+    {
+        pthread_mutex_lock(&pool->queues[q].lock);
+        dropped += pool->queues[q].tail - pool->queues[q].head;
+        pool->queues[q].head = 0;
+        pool->queues[q].tail = 0;
+        pthread_mutex_unlock(&pool->queues[q].lock);
+    }
+    pthread_mutex_lock(&pool->lock);
+    pool->queued -= dropped;
+    pthread_mutex_unlock(&pool->lock);
+    stop_thread_pool(pool);
+}
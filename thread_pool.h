@@ -0,0 +1,68 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <pthread.h>
+
+// Function run by a task
+typedef void (*t_task_function)(void* argument);
+
+// Set of tasks that can be waited for together (zero-initialise it before use)
+typedef struct
+{
+    int pending;               // Tasks of the group not finished yet
+} t_task_group;
+
+typedef struct
+{
+    t_task_function function;
+    void* argument;
+    t_task_group* group;       // May be NULL
+} t_task;
+
+// Queue of one worker, protected by its own lock
+// The owner takes tasks from the head (submission order), thieves take them from the tail
+typedef struct
+{
+    t_task* tasks;
+    int head;
+    int tail;
+    int capacity;
+    pthread_mutex_t lock;
+} t_task_queue;
+
+// Work-stealing thread pool
+// thread_count threads execute the tasks: thread_count - 1 workers, plus the thread
+// that calls thread_pool_wait, which helps instead of sleeping.
+// With thread_count <= 1 no thread is started and thread_pool_wait runs everything.
+typedef struct
+{
+    int thread_count;
+    t_task_queue* queues;      // One queue per thread
+    pthread_t* threads;        // thread_count - 1 workers
+    int queued;                // Tasks waiting in the queues
+    int pending;               // Tasks submitted and not finished yet
+    int next_queue;            // Round robin for the tasks submitted from outside the pool
+    int stop;
+    pthread_mutex_t lock;      // Protects queued, pending, next_queue and stop
+    pthread_cond_t changed;    // Signalled on every submission and completion
+} t_thread_pool;
+
+// Function to start a pool of thread_count threads (including the waiting thread)
+t_thread_pool* create_thread_pool(int thread_count);
+
+// Function to add a task to a group (group may be NULL). Tasks may submit other tasks:
+// these go to the queue of the thread that runs them.
+void thread_pool_submit(t_thread_pool* pool, t_task_group* group, t_task_function function, void* argument);
+
+// Function to wait until every task of the group is finished (every task of the pool if group is NULL).
+// The calling thread executes tasks meanwhile, so a task may wait for the tasks it submitted.
+void thread_pool_wait(t_thread_pool* pool, t_task_group* group);
+
+// Function to stop the workers and free the pool (waits for the remaining tasks first)
+void free_thread_pool(t_thread_pool* pool);
+
+// Function to free a pool after fatal_error jumped out of one of its tasks (set_error_recovery):
+// the tasks not started yet are dropped, and the workers finish the ones they are running (pool may be NULL)
+void abandon_thread_pool(t_thread_pool* pool);
+
+#endif
@@ -0,0 +1,150 @@
+#include <stdio.h>
+#include <math.h>
+
+#include "tiny_kernels.h"
+
+// Asks the compiler to fully unroll the fixed-size loops
+#if defined(__clang__)
+#define TINY_UNROLL _Pragma("unroll")
+#elif defined(__GNUC__)
+#define TINY_UNROLL _Pragma("GCC unroll 16")
+#else
+#define TINY_UNROLL
+#endif
+
+// One kernel per size: N is a compile-time constant, so the products have no loop overhead
+// and the three matrices live on the stack
+#define DEFINE_TINY_POWERS(N)                                                                  \
+    static void tiny_multiply_##N(const float* a, const float* b, float* out)                  \
+    {                                                                                          \
+        TINY_UNROLL                                                                            \
+        for (int i = 0; i < N; i++)                                                            \
+        {                                                                                      \
+            TINY_UNROLL                                                                        \
+            for (int j = 0; j < N; j++)                                                        \
+            {                                                                                  \
+                float sum = 0.0f;                                                              \
+                TINY_UNROLL                                                                    \
+                for (int k = 0; k < N; k++)                                                    \
+                {                                                                              \
+                    sum += a[i * N + k] * b[k * N + j];                                        \
+                }                                                                              \
+                out[i * N + j] = sum;                                                          \
+            }                                                                                  \
+        }                                                                                      \
+    }                                                                                          \
+                                                                                               \
+    static int tiny_powers_##N(const float* matrix, float epsilon, int max_iterations,         \
+                               float* stationary, int* iterations)                             \
+    {                                                                                          \
+        float power[N * N];                                                                    \
+        float result[N * N];                                                                   \
+        TINY_UNROLL                                                                            \
+        for (int i = 0; i < N * N; i++)                                                        \
+        {                                                                                      \
+            power[i] = matrix[i];                                                              \
+        }                                                                                      \
+        float diff = 1.0f;                                                                     \
+        int n = 1;                                                                             \
+        while (diff > epsilon && n < max_iterations)                                           \
+        {                                                                                      \
+            tiny_multiply_##N(power, matrix, result);                                          \
+            diff = 0.0f;                                                                       \
+            TINY_UNROLL                                                                        \
+            for (int i = 0; i < N * N; i++)                                                    \
+            {                                                                                  \
+                diff += fabsf(result[i] - power[i]);                                           \
+                power[i] = result[i];                                                          \
+            }                                                                                  \
+            n++;                                                                               \
+        }                                                                                      \
+        *iterations = n;                                                                       \
+        if (n >= max_iterations)                                                               \
+        {                                                                                      \
+            return 0;                                                                          \
+        }                                                                                      \
+        TINY_UNROLL                                                                            \
+        for (int j = 0; j < N; j++)                                                            \
+        {                                                                                      \
+            stationary[j] = power[j];                                                          \
+        }                                                                                      \
+        return 1;                                                                              \
+    }
+
+DEFINE_TINY_POWERS(1)
+DEFINE_TINY_POWERS(2)
+DEFINE_TINY_POWERS(3)
+DEFINE_TINY_POWERS(4)
+DEFINE_TINY_POWERS(5)
+DEFINE_TINY_POWERS(6)
+DEFINE_TINY_POWERS(7)
+DEFINE_TINY_POWERS(8)
+DEFINE_TINY_POWERS(9)
+DEFINE_TINY_POWERS(10)
+DEFINE_TINY_POWERS(11)
+DEFINE_TINY_POWERS(12)
+DEFINE_TINY_POWERS(13)
+DEFINE_TINY_POWERS(14)
+DEFINE_TINY_POWERS(15)
+DEFINE_TINY_POWERS(16)
+
+// Dispatch table indexed by the class size
+static const t_tiny_powers_kernel tiny_kernels[TINY_MAX_SIZE + 1] = {
+    NULL,
+    tiny_powers_1, tiny_powers_2, tiny_powers_3, tiny_powers_4,
+    tiny_powers_5, tiny_powers_6, tiny_powers_7, tiny_powers_8,
+    tiny_powers_9, tiny_powers_10, tiny_powers_11, tiny_powers_12,
+    tiny_powers_13, tiny_powers_14, tiny_powers_15, tiny_powers_16
+};
+
+t_tiny_powers_kernel tiny_powers_kernel(int size)
+{
+    if (size < 1 || size > TINY_MAX_SIZE)
+    {
+        return NULL;
+    }
+    return tiny_kernels[size];
+}
+
+void tiny_load_view(const t_class_view* view, float* matrix)
+{
+    int k = view->size;
+    for (int i = 0; i < k * k; i++)
+    {
+        matrix[i] = 0.0f;
+    }
+    for (int r = 0; r < k; r++)
+    {
+        // Lists are in reverse file order: the first line of the file is written last
+        for (cell* edge = view_row(view, r); edge != NULL; edge = view_next(view, edge))
+        {
+            matrix[r * k + view_column(view, edge)] = edge->probability;
+        }
+    }
+}
+
+int tiny_closed_form(const t_class_view* view, float* stationary)
+{
+    if (view->size == 1)
+    {
+        // Absorbing state: nothing to compute
+        stationary[0] = 1.0f;
+        return 1;
+    }
+    if (view->size != 2)
+    {
+        return 0;
+    }
+
+    float matrix[4];
+    tiny_load_view(view, matrix);
+    float a = matrix[1];
+    float b = matrix[2];
+    if (a + b <= 0.0f)
+    {
+        return 0;
+    }
+    stationary[0] = b / (a + b);
+    stationary[1] = a / (a + b);
+    return 1;
+}
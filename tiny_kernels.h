@@ -0,0 +1,28 @@
+#ifndef TINY_KERNELS_H
+#define TINY_KERNELS_H
+
+#include "class_view.h"
+
+// Largest class handled by the fixed-size kernels
+#define TINY_MAX_SIZE 16
+
+// Powers of a fixed-size k x k matrix, on the stack, with fully unrolled products
+// Same iteration and same float operations as the dense powers path (multiplyMatrices,
+// matrixDifference): stops when sum |M^n - M^(n-1)| <= epsilon or when n reaches max_iterations.
+// Returns 1 and writes row 0 of M^n in stationary when it converged, 0 otherwise.
+typedef int (*t_tiny_powers_kernel)(const float* matrix, float epsilon, int max_iterations,
+                                    float* stationary, int* iterations);
+
+// Function to get the kernel of a class size (NULL if size is 0 or above TINY_MAX_SIZE)
+t_tiny_powers_kernel tiny_powers_kernel(int size);
+
+// Function to copy a class of at most TINY_MAX_SIZE states into a flat row-major array
+// (same content as view_to_dense, without any heap allocation)
+void tiny_load_view(const t_class_view* view, float* matrix);
+
+// Function to get the stationary distribution of a class of 1 or 2 states in closed form
+// 1 state: pi = (1). 2 states with a = P(0 -> 1), b = P(1 -> 0): pi = (b, a) / (a + b)
+// Returns 0 if the class is larger or if a + b = 0 (not a single class)
+int tiny_closed_form(const t_class_view* view, float* stationary);
+
+#endif
@@ -0,0 +1,257 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "transient.h"
+
+// Number of cached powers: M^(2^30) is the largest needed for an int horizon
+#define POWER_CACHE_SLOTS 31
+
+// Size of the stdio buffer used for the binary output
+#define TRANSIENT_OUTPUT_BUFFER (1 << 20)
+
+t_distribution_block createDistributionBlock(int num_vertices, int count)
+{
+    t_distribution_block block;
+    block.num_vertices = num_vertices;
+    block.count = count;
+    block.values = (float*)calloc((size_t)num_vertices * count, sizeof(float));
+    if (block.values == NULL)
+    {
+        fatal_error("cannot allocate distribution block");
+    }
+    return block;
+}
+
+void setPointDistribution(t_distribution_block* block, int d, int state)
+{
+    for (int v = 0; v < block->num_vertices; v++)
+    {
+        block->values[(size_t)v * block->count + d] = (v == state - 1) ? 1.0f : 0.0f;
+    }
+}
+
+void setUniformDistribution(t_distribution_block* block, int d)
+{
+    float mass = 1.0f / (float)block->num_vertices;
+    for (int v = 0; v < block->num_vertices; v++)
+    {
+        block->values[(size_t)v * block->count + d] = mass;
+    }
+}
+
+// Function to do one step for the whole block
+// For each edge i -> j with probability p, the b values of row j receive p times the b values of row i
+void propagateDistributions(const t_sparse_matrix* matrix, const t_distribution_block* in, t_distribution_block* out)
+{
+    sparseMultiplyBlockTransposed(matrix, in->values, out->values, in->count);
+}
+
+t_power_cache createPowerCache(void)
+{
+    t_power_cache cache;
+    cache.count = POWER_CACHE_SLOTS;
+    cache.powers = (t_matrix*)calloc(cache.count, sizeof(t_matrix));
+    if (cache.powers == NULL)
+    {
+        fatal_error("cannot allocate power cache");
+    }
+    return cache;
+}
+
+// Returns M^(2^k), computing the missing squares first
+static t_matrix power_of_two(const t_sparse_matrix* matrix, t_power_cache* cache, int k)
+{
+    if (cache->powers[0].data == NULL)
+    {
+        cache->powers[0] = createEmptyMatrix(matrix->rows);
+        for (int i = 0; i < matrix->rows; i++)
+        {
+            for (uint32_t e = matrix->row_ptr[i]; e < matrix->row_ptr[i + 1]; e++)
+            {
+                cache->powers[0].data[i][matrix->col_idx[e]] = matrix->values[e];
+            }
+        }
+    }
+    for (int level = 1; level <= k; level++)
+    {
+        if (cache->powers[level].data == NULL)
+        {
+            cache->powers[level] = createEmptyMatrix(matrix->rows);
+            multiplyMatrices(cache->powers[level - 1], cache->powers[level - 1], cache->powers[level]);
+        }
+    }
+    return cache->powers[k];
+}
+
+// out = in * power, skipping the zero entries of the (often still sparse) power
+static void multiply_block_dense(const t_distribution_block* in, t_matrix power, t_distribution_block* out)
+{
+    int b = in->count;
+    memset(out->values, 0, (size_t)out->num_vertices * b * sizeof(float));
+    for (int i = 0; i < power.rows; i++)
+    {
+        const float* source = &in->values[(size_t)i * b];
+        for (int j = 0; j < power.cols; j++)
+        {
+            float p = power.data[i][j];
+            if (p == 0.0f)
+            {
+                continue;
+            }
+            float* destination = &out->values[(size_t)j * b];
+            for (int d = 0; d < b; d++)
+            {
+                destination[d] += p * source[d];
+            }
+        }
+    }
+}
+
+void advanceDistributions(const t_sparse_matrix* matrix, t_power_cache* cache, t_distribution_block* block, int steps)
+{
+    if (steps <= 0)
+    {
+        return;
+    }
+
+    double n = (double)matrix->rows;
+    double b = (double)block->count;
+
+    // Cost of stepping over the edges versus multiplying by the cached powers
+    int use_powers = 0;
+    if (cache != NULL && matrix->rows <= TRANSIENT_DENSE_LIMIT)
+    {
+        double vector_cost = (double)steps * (double)matrix->nnz * b;
+        double power_cost = 0.0;
+        for (int k = 0; k < cache->count && (steps >> k) != 0; k++)
+        {
+            if (cache->powers[k].data == NULL && k > 0)
+            {
+                power_cost += n * n * n;  // one squaring
+            }
+            if ((steps >> k) & 1)
+            {
+                power_cost += n * n * b;  // one block product
+            }
+        }
+        use_powers = power_cost < vector_cost;
+    }
+
+    t_distribution_block scratch = createDistributionBlock(block->num_vertices, block->count);
+    if (use_powers)
+    {
+        // pi_t = pi_0 * M^(2^k1) * M^(2^k2) * ... for the bits k of t
+        for (int k = 0; k < cache->count && (steps >> k) != 0; k++)
+        {
+            if ((steps >> k) & 1)
+            {
+                multiply_block_dense(block, power_of_two(matrix, cache, k), &scratch);
+                float* temp = block->values;
+                block->values = scratch.values;
+                scratch.values = temp;
+            }
+        }
+    }
+    else
+    {
+        for (int t = 0; t < steps; t++)
+        {
+            propagateDistributions(matrix, block, &scratch);
+            float* temp = block->values;
+            block->values = scratch.values;
+            scratch.values = temp;
+        }
+    }
+    freeDistributionBlock(&scratch);
+}
+
+static int write_int32(FILE* file, int value)
+{
+    int value32 = value;
+    return fwrite(&value32, sizeof(int), 1, file) == 1;
+}
+
+int computeTransientDistributions(const t_sparse_matrix* matrix, t_power_cache* cache, t_distribution_block* block,
+                                  const int* times, int time_count, const char* output_filename)
+{
+    for (int i = 0; i < time_count; i++)
+    {
+        if (times[i] < 0 || (i > 0 && times[i] < times[i - 1]))
+        {
+            printf("Error: transient horizons must be non-negative and in increasing order\n");
+            return -1;
+        }
+    }
+
+    FILE* file = NULL;
+    if (output_filename != NULL)
+    {
+        file = fopen(output_filename, "wb");
+        if (file == NULL)
+        {
+            printf("Error: cannot open '%s' for writing.\n", output_filename);
+            return -1;
+        }
+        // One large buffer: each time point is written as a single block of floats
+        setvbuf(file, NULL, _IOFBF, TRANSIENT_OUTPUT_BUFFER);
+        if (fwrite("MKTD", 1, 4, file) != 4 || !write_int32(file, 1) || !write_int32(file, block->num_vertices) ||
+            !write_int32(file, block->count) || !write_int32(file, time_count))
+        {
+            printf("Error: cannot write to '%s'.\n", output_filename);
+            fclose(file);
+            return -1;
+        }
+    }
+
+    int current_time = 0;
+    int status = 0;
+    for (int i = 0; i < time_count; i++)
+    {
+        advanceDistributions(matrix, cache, block, times[i] - current_time);
+        current_time = times[i];
+
+        if (file != NULL)
+        {
+            size_t value_count = (size_t)block->num_vertices * block->count;
+            if (!write_int32(file, current_time) ||
+                fwrite(block->values, sizeof(float), value_count, file) != value_count)
+            {
+                printf("Error: cannot write to '%s'.\n", output_filename);
+                status = -1;
+                break;
+            }
+        }
+    }
+
+    // The last buffered block is only written by fclose
+    if (file != NULL && fclose(file) != 0 && status == 0)
+    {
+        printf("Error: cannot write to '%s'.\n", output_filename);
+        status = -1;
+    }
+    return status;
+}
+
+void freeDistributionBlock(t_distribution_block* block)
+{
+    free(block->values);
+    block->values = NULL;
+    block->num_vertices = 0;
+    block->count = 0;
+}
+
+void freePowerCache(t_power_cache* cache)
+{
+    if (cache->powers == NULL)
+    {
+        return;
+    }
+    for (int k = 0; k < cache->count; k++)
+    {
+        freeMatrix(&cache->powers[k]);
+    }
+    free(cache->powers);
+    cache->powers = NULL;
+    cache->count = 0;
+}
@@ -0,0 +1,119 @@
+#ifndef TRANSIENT_H
+#define TRANSIENT_H
+
+#include "utils.h"
+#include "matrix.h"
+#include "sparse.h"
+
+// Above this number of states the dense M^(2^k) cache is never used
+// (one cached power would already take n * n * 4 bytes)
+#define TRANSIENT_DENSE_LIMIT 2048
+
+// A block of probability distributions propagated together
+// The values are stored state-major: values[v * count + d] is the probability of
+// state v+1 in distribution d, so one edge of the graph updates count contiguous values
+typedef struct
+{
+    float* values;       // num_vertices x count values
+    int num_vertices;    // Number of states
+    int count;           // Number of distributions in the block
+} t_distribution_block;
+
+// Cache of the powers M, M^2, M^4, ..., M^(2^k), built on demand by squaring
+typedef struct
+{
+    t_matrix* powers;    // powers[k] = M^(2^k), data == NULL while not computed
+    int count;           // Number of slots in powers
+} t_power_cache;
+
+/**
+ * @brief Creates a block of distributions filled with zeros
+ *
+ * @param num_vertices The number of states
+ * @param count The number of distributions
+ * @return t_distribution_block The new block
+ */
+t_distribution_block createDistributionBlock(int num_vertices, int count);
+
+/**
+ * @brief Sets distribution d of a block to a point mass on one state
+ *
+ * @param block The block
+ * @param d The distribution index (0-based)
+ * @param state The state holding all the mass (1-based)
+ */
+void setPointDistribution(t_distribution_block* block, int d, int state);
+
+/**
+ * @brief Sets distribution d of a block to the uniform distribution
+ *
+ * @param block The block
+ * @param d The distribution index (0-based)
+ */
+void setUniformDistribution(t_distribution_block* block, int d);
+
+/**
+ * @brief Performs one step for every distribution of a block: out = in * M
+ *
+ * Block product (SpMM) over the CSR transition matrix, O(E * count).
+ *
+ * @param matrix The transition matrix of the graph
+ * @param in The current distributions
+ * @param out The distributions after one step (same dimensions, overwritten)
+ */
+void propagateDistributions(const t_sparse_matrix* matrix, const t_distribution_block* in, t_distribution_block* out);
+
+/**
+ * @brief Creates an empty cache of powers of two of the transition matrix
+ *
+ * @return t_power_cache The empty cache
+ */
+t_power_cache createPowerCache(void);
+
+/**
+ * @brief Advances a block of distributions by a number of steps
+ *
+ * Either propagates step by step over the CSR matrix (O(steps * E * count)) or
+ * multiplies by the cached M^(2^k) matching the bits of steps, whichever the
+ * cost estimate says is cheaper. The cache is filled as needed.
+ *
+ * @param matrix The transition matrix of the graph
+ * @param cache The cache of powers (may be NULL to always propagate step by step)
+ * @param block The distributions, updated in place
+ * @param steps The number of steps
+ */
+void advanceDistributions(const t_sparse_matrix* matrix, t_power_cache* cache, t_distribution_block* block, int steps);
+
+/**
+ * @brief Computes the distributions at several horizons and streams them to a binary file
+ *
+ * The file starts with the header "MKTD", version, num_vertices, count, time_count
+ * (all 32-bit integers after the magic), followed for each horizon by the 32-bit
+ * time and the num_vertices x count float values of the block.
+ *
+ * @param matrix The transition matrix of the graph
+ * @param cache The cache of powers (may be NULL)
+ * @param block The initial distributions, left holding the last horizon on return
+ * @param times The horizons, in increasing order
+ * @param time_count The number of horizons
+ * @param output_filename The binary file to write (NULL to skip the output)
+ * @return int 0 on success, -1 if the times are invalid or the file cannot be written
+ */
+int computeTransientDistributions(const t_sparse_matrix* matrix, t_power_cache* cache, t_distribution_block* block,
+                                  const int* times, int time_count, const char* output_filename);
+
+/**
+ * @brief Frees the memory allocated for a block of distributions
+ *
+ * @param block The block to free
+ */
+void freeDistributionBlock(t_distribution_block* block);
+
+/**
+ * @brief Frees the memory allocated for a cache of powers
+ *
+ * @param cache The cache to free
+ */
+void freePowerCache(t_power_cache* cache);
+
+#endif // TRANSIENT_H
@@ -1,22 +1,19 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
+#include <stdarg.h>
 
 #include "utils.h"
+#include "output.h"
+#include "graph_io.h"
 
 // Function to create a new cell
-// We allocate memory for a cell, set its values, and return a pointer to it
+// We take memory for a cell from the current arena (see arena.h), set its values, and return a pointer to it
 cell* create_cell(int arrival, float prob)
 {
-    // Allocate memory for a new cell
-    cell* new_cell = (cell*)malloc(sizeof(cell));
-    
-    // Check if allocation succeeded
-    if (new_cell == NULL)
-    {
-        printf("Error: Could not allocate memory for cell\n");
-        exit(EXIT_FAILURE);
-    }
+    // Allocate memory for a new cell (ends the program if there is none left)
+    cell* new_cell = (cell*)arena_alloc(current_arena(), sizeof(cell));
     
     // Set the values
     new_cell->arrival_vertex = arrival;
@@ -49,11 +46,20 @@ void add_cell_to_list(list* lst, int arrival, float prob)
     lst->head = new_cell;
 }
 
+static void display_labeled_list(list lst, int vertex_num, const t_label_table* labels);
+
 // Function to display a list (for debugging)
 // We traverse the list and print each cell's information
 void display_list(list lst, int vertex_num)
 {
-    printf("List for vertex %d: [head @] -> ", vertex_num);
+    display_labeled_list(lst, vertex_num, NULL);
+}
+
+// Same as display_list, with the names of the vertices if labels is not NULL
+static void display_labeled_list(list lst, int vertex_num, const t_label_table* labels)
+{
+    char buffer[STATE_LABEL_SIZE];
+    printf("List for vertex %s: [head @] -> ", state_label(labels, vertex_num, buffer));
     
     // Start from the head of the list
     cell* current = lst.head;
@@ -62,7 +68,7 @@ void display_list(list lst, int vertex_num)
     while (current != NULL)
     {
         // Print the current cell's information
-        printf("(%d, %.2f)", current->arrival_vertex, current->probability);
+        printf("(%s, %.2f)", state_label(labels, current->arrival_vertex, buffer), current->probability);
         
         // Move to the next cell
         current = current->next;
@@ -85,16 +91,11 @@ adjacency_list create_empty_adjacency_list(int num_vertices)
     
     // Set the number of vertices
     adj_list.num_vertices = num_vertices;
+    adj_list.labels = NULL;
     
-    // Allocate memory for the array of lists
-    adj_list.lists = (list*)malloc(num_vertices * sizeof(list));
-    
-    // Check if allocation succeeded
-    if (adj_list.lists == NULL)
-    {
-        printf("Error: Could not allocate memory for adjacency list\n");
-        exit(EXIT_FAILURE);
-    }
+    // The lists and their cells come from the current arena
+    adj_list.arena = current_arena();
+    adj_list.lists = (list*)arena_alloc(adj_list.arena, (size_t)num_vertices * sizeof(list));
     
     // Initialize each list as empty
     for (int i = 0; i < num_vertices; i++)
@@ -107,16 +108,33 @@ adjacency_list create_empty_adjacency_list(int num_vertices)
 
 // Function to display an adjacency list
 // We display each list in the adjacency list
+// Large graphs only show their first lists (see output.h)
 void display_adjacency_list(adjacency_list adj_list)
 {
     printf("\n=== Adjacency List ===\n");
     
+    if (output_level() == OUTPUT_SUMMARY)
+    {
+        // Count the edges instead of printing them
+        long edge_count = 0;
+        for (int i = 0; i < adj_list.num_vertices; i++)
+        {
+            for (cell* current = adj_list.lists[i].head; current != NULL; current = current->next)
+            {
+                edge_count++;
+            }
+        }
+        printf("%d vertices, %ld edges\n", adj_list.num_vertices, edge_count);
+    }
+    
     // Go through each vertex
-    for (int i = 0; i < adj_list.num_vertices; i++)
+    int shown = output_preview(adj_list.num_vertices);
+    for (int i = 0; i < shown; i++)
     {
         // Display the list for vertex i+1 (vertices are numbered from 1, arrays from 0)
-        display_list(adj_list.lists[i], i + 1);
+        display_labeled_list(adj_list.lists[i], i + 1, adj_list.labels);
     }
+    print_omitted(shown, adj_list.num_vertices, "lists");
     
     printf("======================\n\n");
 }
@@ -125,21 +143,28 @@ void display_adjacency_list(adjacency_list adj_list)
 // We read the file line by line and build the adjacency list
 adjacency_list read_graph(const char* filename)
 {
-    FILE* file = fopen(filename, "rt");  // Try to open file in read text mode
+    return read_graph_file(filename, 0);
+}
+
+adjacency_list read_graph_file(const char* filename, int intern_labels)
+{
+    // The whole file is read at once and scanned in memory
+    t_scanner scanner;
+    int status = open_scanner(&scanner, filename);
     
     // If file not found and filename starts with "data/", try "../data/" instead
     // This handles the case when running from cmake-build-debug directory
-    if (file == NULL && strncmp(filename, "data/", 5) == 0)
+    if (status != 0 && strncmp(filename, "data/", 5) == 0)
     {
         // Build new path: "../data/filename"
         char new_path[256];
         strcpy(new_path, "../");
         strcat(new_path, filename);
-        file = fopen(new_path, "rt");
+        status = open_scanner(&scanner, new_path);
     }
     
     // Check if file opened successfully
-    if (file == NULL)
+    if (status != 0)
     {
         printf("Error: Could not find file '%s'\n", filename);
         printf("Tried: %s\n", filename);
@@ -151,32 +176,9 @@ adjacency_list read_graph(const char* filename)
         exit(EXIT_FAILURE);
     }
     
-    int num_vertices;
-    int start, end;
-    float proba;
+    adjacency_list adj_list = read_graph_scanner(&scanner, filename, intern_labels);
     
-    // Read the first line: number of vertices
-    if (fscanf(file, "%d", &num_vertices) != 1)
-    {
-        perror("Could not read number of vertices");
-        fclose(file);
-        exit(EXIT_FAILURE);
-    }
-    
-    // Create an empty adjacency list with the correct number of vertices
-    adjacency_list adj_list = create_empty_adjacency_list(num_vertices);
-    
-    // Read each edge from the file
-    // Each line has: start_vertex end_vertex probability
-    while (fscanf(file, "%d %d %f", &start, &end, &proba) == 3)
-    {
-        // Add the edge to the adjacency list
-        // Note: vertices in file are 1-based, arrays are 0-based, so we use start-1
-        add_cell_to_list(&(adj_list.lists[start - 1]), end, proba);
-    }
-    
-    // Close the file
-    fclose(file);
+    close_scanner(&scanner);
     
     // Return the completed adjacency list
     return adj_list;
@@ -219,15 +221,13 @@ int is_markov_graph(adjacency_list adj_list)
     return is_valid;
 }
 
-// Function to get ID string from vertex number
+// Function to write the ID string of a vertex number into buffer (at least VERTEX_ID_SIZE chars)
 // Converts 1->"A", 2->"B", ..., 26->"Z", 27->"AA", 28->"AB", etc.
 // This is like Excel column names: A, B, C, ..., Z, AA, AB, AC, ...
-char* get_id(int vertex_num)
+// Returns the length of the ID
+int write_id(int vertex_num, char* buffer)
 {
-    // Static buffer: this variable keeps its value between function calls
-    // This is needed because we return a pointer to it
-    static char buffer[10];
-    char temp[10];  // Temporary array to build the string backwards
+    char temp[VERTEX_ID_SIZE];  // Temporary array to build the string backwards
     int index = 0;  // Current position in temp array
     
     // Convert from 1-based (vertex 1, 2, 3...) to 0-based (0, 1, 2...)
@@ -257,20 +257,157 @@ char* get_id(int vertex_num)
     }
     buffer[index] = '\0';  // Add the end-of-string marker
     
+    return index;
+}
+
+// Function to get ID string from vertex number
+// Each thread has its own buffer, so the result is only overwritten by the next call of the same thread
+char* get_id(int vertex_num)
+{
+    static _Thread_local char buffer[VERTEX_ID_SIZE];
+    write_id(vertex_num, buffer);
     return buffer;
 }
 
+// Function to compute the IDs of all the vertices at once
+// All the IDs are stored one after the other (with their '\0') in one block of memory
+t_vertex_ids build_vertex_ids(int num_vertices)
+{
+    t_vertex_ids ids;
+    ids.count = num_vertices;
+    ids.offsets = (int*)malloc((size_t)(num_vertices + 1) * sizeof(int));
+    
+    // First pass: total size of the IDs, so the block is allocated once
+    size_t total = 0;
+    char buffer[VERTEX_ID_SIZE];
+    for (int v = 1; v <= num_vertices; v++)
+    {
+        total += (size_t)write_id(v, buffer) + 1;
+    }
+    ids.arena = (char*)malloc(total > 0 ? total : 1);
+    
+    if (ids.offsets == NULL || ids.arena == NULL)
+    {
+        fatal_error("Could not allocate memory for the vertex IDs");
+    }
+    
+    // Second pass: write each ID right after the previous one
+    int offset = 0;
+    for (int v = 1; v <= num_vertices; v++)
+    {
+        ids.offsets[v - 1] = offset;
+        offset += write_id(v, ids.arena + offset) + 1;
+    }
+    ids.offsets[num_vertices] = offset;
+    
+    return ids;
+}
+
+void free_vertex_ids(t_vertex_ids* ids)
+{
+    free(ids->arena);
+    free(ids->offsets);
+    ids->arena = NULL;
+    ids->offsets = NULL;
+    ids->count = 0;
+}
+
+// Appends the decimal digits of a non-negative number, returns the new end of the line
+static char* append_int(char* out, int value)
+{
+    char digits[12];
+    int length = 0;
+    do
+    {
+        digits[length++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+    while (length > 0)
+    {
+        *out++ = digits[--length];
+    }
+    return out;
+}
+
+// Appends a probability with 4 decimals, exactly like printf("%.4f")
+// A float times 10000 is exact in a double, so lrint rounds it like printf does
+static char* append_probability(char* out, float probability)
+{
+    if (!(probability >= 0.0f && probability < 100000.0f))
+    {
+        // Unusual values (negative, huge, NaN): let printf handle them
+        return out + sprintf(out, "%.4f", probability);
+    }
+    long scaled = lrint((double)probability * 10000.0);
+    out = append_int(out, (int)(scaled / 10000));
+    *out++ = '.';
+    int decimals = (int)(scaled % 10000);
+    out[0] = (char)('0' + decimals / 1000);
+    out[1] = (char)('0' + decimals / 100 % 10);
+    out[2] = (char)('0' + decimals / 10 % 10);
+    out[3] = (char)('0' + decimals % 10);
+    return out + 4;
+}
+
+static char* append_id(char* out, const t_vertex_ids* ids, int vertex_num)
+{
+    int length = ids->offsets[vertex_num] - ids->offsets[vertex_num - 1] - 1;
+    memcpy(out, vertex_id(ids, vertex_num), (size_t)length);
+    return out + length;
+}
+
 // Function to generate a Mermaid file from the graph
 // Creates a file that can be used with Mermaid to visualize the graph
-void generate_mermaid_file(adjacency_list adj_list, const char* output_filename)
+// Prints nothing on success, so it can run in the background (several exports can run at once)
+int generate_mermaid_file(adjacency_list adj_list, const char* output_filename, long edge_limit)
 {
     FILE* file = fopen(output_filename, "wt");  // Open file in write text mode
     
     // Check if file opened successfully
     if (file == NULL)
     {
-        perror("Could not open file for writing");
-        exit(EXIT_FAILURE);
+        printf("Error: Could not open '%s' for writing\n", output_filename);
+        return -1;
+    }
+    
+    // One large buffer: the file is written in a few big chunks
+    setvbuf(file, NULL, _IOFBF, MERMAID_OUTPUT_BUFFER);
+    
+    // Count the edges: above the limit only one edge out of every `stride` is written
+    long edge_count = 0;
+    for (int i = 0; i < adj_list.num_vertices; i++)
+    {
+        for (cell* current = adj_list.lists[i].head; current != NULL; current = current->next)
+        {
+            edge_count++;
+        }
+    }
+    long stride = 1;
+    if (edge_limit > 0 && edge_count > edge_limit)
+    {
+        stride = (edge_count + edge_limit - 1) / edge_limit;
+    }
+    
+    // The IDs are computed once, instead of once per vertex and once per edge
+    t_vertex_ids ids = build_vertex_ids(adj_list.num_vertices);
+    
+    // When sampling, only the vertices of the kept edges are declared
+    char* is_used = NULL;
+    if (stride > 1)
+    {
+        is_used = (char*)calloc((size_t)adj_list.num_vertices + 1, sizeof(char));
+        long edge = 0;
+        for (int i = 0; i < adj_list.num_vertices; i++)
+        {
+            for (cell* current = adj_list.lists[i].head; current != NULL; current = current->next, edge++)
+            {
+                if (edge % stride == 0)
+                {
+                    is_used[i + 1] = 1;
+                    is_used[current->arrival_vertex] = 1;
+                }
+            }
+        }
     }
     
     // Write the configuration header
@@ -281,53 +418,92 @@ void generate_mermaid_file(adjacency_list adj_list, const char* output_filename)
     fprintf(file, " look: neo\n");
     fprintf(file, "---\n");
     fprintf(file, "flowchart LR\n");
+    if (stride > 1)
+    {
+        fprintf(file, "%%%% Sample: 1 edge out of %ld (%ld edges in the graph)\n", stride, edge_count);
+    }
+    
+    // Each line is built by hand in this buffer (much faster than fprintf)
+    char line[2 * VERTEX_ID_SIZE + 64];
     
     // Write vertex declarations
-    // For each vertex, we declare it with its ID and number
+    // For each vertex, we declare it with its ID and number: A((1))
     for (int i = 0; i < adj_list.num_vertices; i++)
     {
-        char* vertex_id = get_id(i + 1);
-        fprintf(file, "%s((%d))\n", vertex_id, i + 1);
+        if (is_used != NULL && !is_used[i + 1])
+        {
+            continue;
+        }
+        char* end = append_id(line, &ids, i + 1);
+        *end++ = '(';
+        *end++ = '(';
+        if (adj_list.labels != NULL)
+        {
+            // Named vertex: A(("name")), with the quotes of the name escaped for Mermaid
+            *end++ = '"';
+            fwrite(line, 1, (size_t)(end - line), file);
+            for (const char* c = state_label(adj_list.labels, i + 1, NULL); *c != '\0'; c++)
+            {
+                if (*c == '"')
+                {
+                    fputs("#quot;", file);
+                }
+                else
+                {
+                    fputc(*c, file);
+                }
+            }
+            fputs("\"))\n", file);
+            continue;
+        }
+        end = append_int(end, i + 1);
+        memcpy(end, "))\n", 3);
+        fwrite(line, 1, (size_t)(end + 3 - line), file);
     }
     
     // Write edges
-    // For each vertex, we go through its list and write each edge
+    // For each vertex, we go through its list and write each edge: from_id -->|probability|to_id
+    long edge = 0;
     for (int i = 0; i < adj_list.num_vertices; i++)
     {
-        // Get the ID for the source vertex and copy it immediately
-        // (because get_id uses a static buffer that gets overwritten)
-        char* from_id_ptr = get_id(i + 1);
-        char from_id[10];
-        strcpy(from_id, from_id_ptr);  // Copy the string so it doesn't get overwritten
-        
         // Traverse the list for this vertex
-        cell* current = adj_list.lists[i].head;
-        while (current != NULL)
+        for (cell* current = adj_list.lists[i].head; current != NULL; current = current->next, edge++)
         {
-            // Get the ID for the destination vertex
-            char* to_id_ptr = get_id(current->arrival_vertex);
-            char to_id[10];
-            strcpy(to_id, to_id_ptr);  // Copy the string so it doesn't get overwritten
-            
-            // Write the edge: from_id -->|probability|to_id
-            fprintf(file, "%s -->|%.4f|%s\n", from_id, current->probability, to_id);
-            
-            current = current->next;
+            if (edge % stride != 0)
+            {
+                continue;
+            }
+            char* end = append_id(line, &ids, i + 1);
+            memcpy(end, " -->|", 5);
+            end = append_probability(end + 5, current->probability);
+            *end++ = '|';
+            end = append_id(end, &ids, current->arrival_vertex);
+            *end++ = '\n';
+            fwrite(line, 1, (size_t)(end - line), file);
         }
     }
     
+    free(is_used);
+    free_vertex_ids(&ids);
+    
     // Close the file
-    fclose(file);
+    if (ferror(file) | fclose(file))
+    {
+        printf("Error: Could not write '%s'\n", output_filename);
+        return -1;
+    }
     
-    printf("Mermaid file '%s' generated successfully!\n", output_filename);
+    // Number of edges left out of the file
+    return (stride > 1) ? (int)(edge_count - (edge_count + stride - 1) / stride) : 0;
 }
 
 // Function to free memory allocated for an adjacency list
 // We need to free all cells in all lists, then free the array of lists
+// (cells taken from an arena are freed with the arena instead)
 void free_adjacency_list(adjacency_list* adj_list)
 {
-    // Go through each vertex's list
-    for (int i = 0; i < adj_list->num_vertices; i++)
+    // Go through each vertex's list (unless an arena holds the cells)
+    for (int i = 0; adj_list->arena == NULL && i < adj_list->num_vertices; i++)
     {
         // Free all cells in this list
         cell* current = adj_list->lists[i].head;
@@ -339,10 +515,43 @@ void free_adjacency_list(adjacency_list* adj_list)
         }
     }
     
-    // Free the array of lists
-    free(adj_list->lists);
+    // Free the array of lists and the names of the vertices
+    arena_release(adj_list->arena, adj_list->lists, (size_t)adj_list->num_vertices * sizeof(list));
+    free_label_table(adj_list->labels);
     
     // Reset the structure
     adj_list->lists = NULL;
     adj_list->num_vertices = 0;
+    adj_list->labels = NULL;
+    adj_list->arena = NULL;
+}
+
+// Where the fatal errors of this thread go (NULL: they end the program)
+static _Thread_local jmp_buf* error_recovery = NULL;
+static _Thread_local char error_message[256];
+
+void fatal_error(const char* format, ...)
+{
+    va_list arguments;
+    va_start(arguments, format);
+    vsnprintf(error_message, sizeof(error_message), format, arguments);
+    va_end(arguments);
+    if (error_recovery != NULL)
+    {
+        jmp_buf* recovery = error_recovery;
+        error_recovery = NULL;
+        longjmp(*recovery, 1);
+    }
+    printf("Error: %s\n", error_message);
+    exit(EXIT_FAILURE);
+}
+
+void set_error_recovery(jmp_buf* recovery)
+{
+    error_recovery = recovery;
+}
+
+const char* last_error_message(void)
+{
+    return error_message;
 }
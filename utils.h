@@ -3,6 +3,10 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <setjmp.h>
+
+#include "labels.h"
+#include "arena.h"
 
 // Structure for a cell (represents an edge)
 // Each cell contains: arrival vertex, probability, and pointer to next cell
@@ -23,8 +27,28 @@ typedef struct list {
 typedef struct adjacency_list {
     list* lists;              // Array of lists (one per vertex)
     int num_vertices;          // Number of vertices in the graph
+    t_label_table* labels;     // Names of the vertices (NULL when the file numbers them 1..n)
+    t_arena* arena;            // Arena of the lists and cells (NULL: malloc, freed one by one)
 } adjacency_list;
 
+// Longest vertex ID (7 letters cover every int) plus the end-of-string marker
+#define VERTEX_ID_SIZE 10
+
+// Above this number of edges the Mermaid file only holds a sample of the graph (--mermaid-limit)
+#define MERMAID_EDGE_LIMIT 10000
+
+// Size of the buffer of the Mermaid file
+#define MERMAID_OUTPUT_BUFFER ((size_t)1 << 20)
+
+// Table of the IDs of all the vertices, computed once
+// The IDs are stored one after the other in one block: the ID of vertex v starts at arena + offsets[v - 1]
+typedef struct
+{
+    char* arena;               // All the IDs, each one followed by '\0'
+    int* offsets;              // num_vertices + 1 offsets into arena
+    int count;                 // Number of vertices
+} t_vertex_ids;
+
 // Function to create a new cell
 // Parameters: arrival vertex number, probability value
 // Returns: pointer to the newly created cell
@@ -57,6 +81,12 @@ void display_adjacency_list(adjacency_list adj_list);
 // Returns: a complete adjacency list representing the graph
 adjacency_list read_graph(const char* filename);
 
+// Function to read a graph whose states have arbitrary names (--labels)
+// Parameters: filename, 1 to number the state names in order of first appearance
+// (edge list "from to probability" or DOT node IDs), 0 to read state numbers 1..n like read_graph
+// Returns: the adjacency list, with its table of names if intern_labels is 1
+adjacency_list read_graph_file(const char* filename, int intern_labels);
+
 // Function to check if a graph is a valid Markov graph
 // A Markov graph must have: sum of outgoing probabilities per vertex = 1 (with tolerance 0.99-1.0)
 // Parameters: the adjacency list to check
@@ -64,15 +94,49 @@ adjacency_list read_graph(const char* filename);
 int is_markov_graph(adjacency_list adj_list);
 
 // Function to generate a Mermaid file from the graph
-// Parameters: the adjacency list, output filename
+// Parameters: the adjacency list, output filename, largest number of edges written (0 = no limit)
 // Creates a .mmd file that can be used with Mermaid to visualize the graph
-void generate_mermaid_file(adjacency_list adj_list, const char* output_filename);
+// Above edge_limit edges, one edge out of every ceil(edges / edge_limit) is written,
+// with only the vertices of these edges (Mermaid cannot render huge graphs anyway)
+// Returns: -1 if the file cannot be written, otherwise the number of edges left out (the caller reports it)
+// Uses no shared state: several files can be generated at the same time
+int generate_mermaid_file(adjacency_list adj_list, const char* output_filename, long edge_limit);
+
+// Function to write the ID string (A, B, C, ..., Z, AA, AB, ...) of a vertex number
+// Parameters: vertex number (1-based), buffer of at least VERTEX_ID_SIZE chars
+// Returns: the length of the ID
+int write_id(int vertex_num, char* buffer);
 
 // Function to get ID string (A, B, C, ..., Z, AA, AB, ...) from vertex number
 // Parameters: vertex number (1-based)
-// Returns: string like "A" for 1, "B" for 2, etc.
+// Returns: string like "A" for 1, "B" for 2, etc. (buffer of the calling thread, overwritten by its next call)
 char* get_id(int vertex_num);
 
+// Function to compute the IDs of all the vertices at once
+// Parameters: number of vertices
+// Returns: the table of IDs (free it with free_vertex_ids)
+t_vertex_ids build_vertex_ids(int num_vertices);
+
+// Function to get the ID of a vertex from the table (1-based vertex number)
+static inline const char* vertex_id(const t_vertex_ids* ids, int vertex_num)
+{
+    return ids->arena + ids->offsets[vertex_num - 1];
+}
+
+void free_vertex_ids(t_vertex_ids* ids);
+
+// Function to report an error the program cannot go on after (out of memory, malformed file...)
+// Prints "Error: <message>" and ends the program, unless the calling thread set a recovery point:
+// then the message is kept for last_error_message and the thread jumps back to the recovery point
+// (which is cleared). Whatever the failed step allocated is lost.
+_Noreturn void fatal_error(const char* format, ...);
+
+// Function to make the fatal errors of the calling thread jump to recovery; NULL restores the default
+void set_error_recovery(jmp_buf* recovery);
+
+// Function to get the message of the last fatal error of the calling thread
+const char* last_error_message(void);
+
 // Function to free memory allocated for an adjacency list
 // Parameters: pointer to the adjacency list
 void free_adjacency_list(adjacency_list* adj_list);
@@ -0,0 +1,215 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "walks.h"
+
+#define WALK_HEADER_SIZE 20
+
+// State shared by all the generator threads
+typedef struct
+{
+    const t_alias_table* table;
+    const t_walk_options* options;
+    int fd;
+    atomic_llong next_offset;     // Text mode: first free byte of the file
+    atomic_int failed;
+} t_walk_shared;
+
+typedef struct
+{
+    t_walk_shared* shared;
+    long first_walk;
+    long last_walk;               // Excluded
+} t_walk_worker;
+
+t_walk_options default_walk_options(void)
+{
+    t_walk_options options;
+    options.walk_length = 80;
+    options.walks_per_vertex = 10;
+    options.thread_count = 4;
+    options.seed = 1;
+    options.format = WALK_FORMAT_TEXT;
+    options.buffer_size = (size_t)4 << 20;
+    return options;
+}
+
+// Writes the whole buffer at the given offset (pwrite may write less than asked)
+static int write_at(int fd, const char* data, size_t size, long long offset)
+{
+    while (size > 0)
+    {
+        ssize_t written = pwrite(fd, data, size, (off_t)offset);
+        if (written <= 0)
+        {
+            return -1;
+        }
+        data += written;
+        size -= (size_t)written;
+        offset += written;
+    }
+    return 0;
+}
+
+// Writes a positive integer in decimal, returns the number of characters
+static int format_vertex(char* out, uint32_t value)
+{
+    char digits[10];
+    int count = 0;
+    do
+    {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    for (int i = 0; i < count; i++)
+    {
+        out[i] = digits[count - 1 - i];
+    }
+    return count;
+}
+
+static void* walk_thread(void* argument)
+{
+    t_walk_worker* worker = (t_walk_worker*)argument;
+    t_walk_shared* shared = worker->shared;
+    const t_walk_options* options = shared->options;
+    int length = options->walk_length;
+
+    // Room for at least one walk whatever the requested buffer size
+    size_t max_walk_bytes = (options->format == WALK_FORMAT_BINARY) ? (size_t)length * 4 : (size_t)length * 11;
+    size_t capacity = options->buffer_size > max_walk_bytes ? options->buffer_size : max_walk_bytes;
+    char* buffer = (char*)malloc(capacity);
+    if (buffer == NULL)
+    {
+        fatal_error("cannot allocate walk buffer");
+    }
+
+    size_t used = 0;
+    long buffer_first_walk = worker->first_walk;
+    for (long walk = worker->first_walk; walk < worker->last_walk && !atomic_load(&shared->failed); walk++)
+    {
+        if (capacity - used < max_walk_bytes)
+        {
+            // Flush: binary walks have a fixed place, text blocks reserve theirs
+            long long offset = (options->format == WALK_FORMAT_BINARY)
+                ? WALK_HEADER_SIZE + (long long)buffer_first_walk * length * 4
+                : atomic_fetch_add(&shared->next_offset, (long long)used);
+            if (write_at(shared->fd, buffer, used, offset) != 0)
+            {
+                atomic_store(&shared->failed, 1);
+            }
+            used = 0;
+            buffer_first_walk = walk;
+        }
+
+        int state = (int)(walk / options->walks_per_vertex) + 1;
+        for (int step = 0; step < length; step++)
+        {
+            if (step > 0)
+            {
+                state = alias_sample(shared->table, state,
+                                     counter_rng(options->seed, (uint64_t)walk, (uint64_t)step));
+            }
+            if (options->format == WALK_FORMAT_BINARY)
+            {
+                uint32_t value = (uint32_t)state;
+                memcpy(buffer + used, &value, 4);
+                used += 4;
+            }
+            else
+            {
+                used += (size_t)format_vertex(buffer + used, (uint32_t)state);
+                buffer[used++] = (step + 1 < length) ? ' ' : '\n';
+            }
+        }
+    }
+
+    if (used > 0)
+    {
+        long long offset = (options->format == WALK_FORMAT_BINARY)
+            ? WALK_HEADER_SIZE + (long long)buffer_first_walk * length * 4
+            : atomic_fetch_add(&shared->next_offset, (long long)used);
+        if (write_at(shared->fd, buffer, used, offset) != 0)
+        {
+            atomic_store(&shared->failed, 1);
+        }
+    }
+
+    free(buffer);
+    return NULL;
+}
+
+long generate_walks(const t_alias_table* table, const t_walk_options* options, const char* output_filename)
+{
+    if (options->walk_length < 1 || options->walks_per_vertex < 1)
+    {
+        printf("Error: walk length and walks per vertex must be positive\n");
+        return -1;
+    }
+
+    int fd = open(output_filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        printf("Error: cannot open '%s' for writing.\n", output_filename);
+        return -1;
+    }
+
+    long walk_count = (long)table->num_vertices * options->walks_per_vertex;
+    t_walk_shared shared;
+    shared.table = table;
+    shared.options = options;
+    shared.fd = fd;
+    atomic_init(&shared.next_offset, 0);
+    atomic_init(&shared.failed, 0);
+
+    if (options->format == WALK_FORMAT_BINARY)
+    {
+        char header[WALK_HEADER_SIZE];
+        int version = 1;
+        long long count64 = walk_count;
+        memcpy(header, "MKWK", 4);
+        memcpy(header + 4, &version, 4);
+        memcpy(header + 8, &options->walk_length, 4);
+        memcpy(header + 12, &count64, 8);
+        if (write_at(fd, header, WALK_HEADER_SIZE, 0) != 0)
+        {
+            atomic_store(&shared.failed, 1);
+        }
+    }
+
+    int thread_count = options->thread_count > 0 ? options->thread_count : 1;
+    t_walk_worker* workers = (t_walk_worker*)malloc(thread_count * sizeof(t_walk_worker));
+    pthread_t* threads = (pthread_t*)malloc(thread_count * sizeof(pthread_t));
+    if (workers == NULL || threads == NULL)
+    {
+        fatal_error("cannot allocate walk workers");
+    }
+    for (int w = 0; w < thread_count; w++)
+    {
+        workers[w].shared = &shared;
+        workers[w].first_walk = walk_count * w / thread_count;
+        workers[w].last_walk = walk_count * (w + 1) / thread_count;
+        if (pthread_create(&threads[w], NULL, walk_thread, &workers[w]) != 0)
+        {
+            fatal_error("cannot start walk thread");
+        }
+    }
+    for (int w = 0; w < thread_count; w++)
+    {
+        pthread_join(threads[w], NULL);
+    }
+
+    free(workers);
+    free(threads);
+    if (close(fd) != 0 || atomic_load(&shared.failed))
+    {
+        printf("Error: cannot write to '%s'.\n", output_filename);
+        return -1;
+    }
+    return walk_count;
+}
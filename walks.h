@@ -0,0 +1,42 @@
+#ifndef WALKS_H
+#define WALKS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "simulation.h"
+
+// Output formats of the walk generator
+typedef enum
+{
+    WALK_FORMAT_TEXT,      // One walk per line, states separated by spaces
+    WALK_FORMAT_BINARY     // Header then walk_length 32-bit states per walk
+} t_walk_format;
+
+// Parameters of a walk generation run
+typedef struct
+{
+    int walk_length;           // Number of states in each walk (start included)
+    int walks_per_vertex;      // Number of walks starting from each vertex
+    int thread_count;          // Number of generator threads
+    uint64_t seed;             // Seed of the random streams
+    t_walk_format format;      // Output format
+    size_t buffer_size;        // Size of the output buffer of each thread (bytes)
+} t_walk_options;
+
+// Function to get the default walk options (length 80, 10 walks per vertex, text, 4 MiB buffers)
+t_walk_options default_walk_options(void);
+
+// Function to generate fixed-length random walks from every vertex into a file
+// Walk number w starts from vertex w / walks_per_vertex + 1 and uses random stream w,
+// so the walks themselves do not depend on the number of threads.
+// Each thread fills its own buffer and writes it with positioned writes:
+// binary walks go to their fixed place in the file, text blocks reserve their
+// place with an atomic offset, so the writer never takes a lock
+// (in text mode the order of the blocks depends on the scheduling).
+// Binary header: "MKWK", version, walk_length (32-bit), walk count (64-bit)
+// Parameters: the alias tables, the options, output filename
+// Returns: the number of walks written, or -1 on error
+long generate_walks(const t_alias_table* table, const t_walk_options* options, const char* output_filename);
+
+#endif